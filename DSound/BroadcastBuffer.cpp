@@ -0,0 +1,235 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "BroadcastBuffer.h"
+
+#include <string.h>
+
+namespace dsbridge
+{
+
+BroadcastBuffer::BroadcastBuffer()
+: m_begin(0)
+, m_size(0)
+, m_head(0)
+, m_tail(0)
+, m_reclaimLimit(~ULONGLONG(0))
+{
+}
+
+BroadcastBuffer::~BroadcastBuffer()
+{
+	destroy();
+}
+
+bool BroadcastBuffer::create(size_t size)
+{
+	m_begin = new char[size];
+	if (!m_begin)
+		return false;
+
+	m_size = size;
+
+	m_head = 0;
+	m_tail = 0;
+	m_reclaimLimit = ~ULONGLONG(0);
+
+	return true;
+}
+
+void BroadcastBuffer::destroy()
+{
+	delete [] m_begin;
+
+	m_begin = 0;
+	m_size = 0;
+
+	m_head = 0;
+	m_tail = 0;
+}
+
+ULONGLONG BroadcastBuffer::head() const
+{
+	return m_head;
+}
+
+ULONGLONG BroadcastBuffer::tail() const
+{
+	return m_tail;
+}
+
+size_t BroadcastBuffer::available(ULONGLONG position) const
+{
+	if (position < m_tail)
+	{
+		position = m_tail;
+	}
+
+	return static_cast<size_t>(m_head - position);
+}
+
+bool BroadcastBuffer::write(const void* buffer, size_t size)
+{
+	if (!size)
+		return true;
+
+	if (size > m_size)
+	{
+		return false;
+	}
+
+	ULONGLONG newTail = (m_head + size) > m_size ? (m_head + size) - m_size : 0;
+	if (newTail > m_tail)
+	{
+		if (newTail > m_reclaimLimit)
+		{
+			return false;
+		}
+
+		m_tail = newTail;
+	}
+
+	const char* localBuffer = static_cast<const char*>(buffer);
+	size_t offset = static_cast<size_t>(m_head % m_size);
+	size_t endWrite = m_size - offset;
+
+	if (size > endWrite)
+	{
+		::memcpy(m_begin + offset, localBuffer, endWrite);
+		::memcpy(m_begin, localBuffer + endWrite, size - endWrite);
+	}
+	else
+	{
+		::memcpy(m_begin + offset, localBuffer, size);
+	}
+
+	m_head += size;
+
+	return true;
+}
+
+char* BroadcastBuffer::reserve(size_t& size)
+{
+	// contiguous space at the head, short of the wrap and the reclaim limit
+
+	size_t offset = static_cast<size_t>(m_head % m_size);
+	size_t endWrite = m_size - offset;
+	size = size > endWrite ? endWrite : size;
+
+	ULONGLONG newTail = (m_head + size) > m_size ? (m_head + size) - m_size : 0;
+	if (newTail > m_reclaimLimit)
+	{
+		size_t excess = static_cast<size_t>(newTail - m_reclaimLimit);
+		size = excess < size ? size - excess : 0;
+	}
+
+	return m_begin + offset;
+}
+
+void BroadcastBuffer::commit(size_t size)
+{
+	ULONGLONG newTail = (m_head + size) > m_size ? (m_head + size) - m_size : 0;
+	if (newTail > m_tail)
+	{
+		m_tail = newTail;
+	}
+
+	m_head += size;
+}
+
+size_t BroadcastBuffer::read(ULONGLONG& position, void* buffer, size_t size) const
+{
+	size_t maxRead = available(position);
+	size_t actual = size > maxRead ? maxRead : size;
+	if (!actual)
+		return 0;
+
+	char* localBuffer = static_cast<char*>(buffer);
+	size_t offset = static_cast<size_t>(position % m_size);
+	size_t endRead = m_size - offset;
+
+	if (actual > endRead)
+	{
+		::memcpy(localBuffer, m_begin + offset, endRead);
+		::memcpy(localBuffer + endRead, m_begin, actual - endRead);
+	}
+	else
+	{
+		::memcpy(localBuffer, m_begin + offset, actual);
+	}
+
+	position += actual;
+
+	return actual;
+}
+
+const char* BroadcastBuffer::region(ULONGLONG position, size_t& size) const
+{
+	size_t maxRead = available(position);
+	size_t offset = static_cast<size_t>(position % m_size);
+	size_t endRead = m_size - offset;
+
+	maxRead = maxRead > endRead ? endRead : maxRead;
+	size = size > maxRead ? maxRead : size;
+
+	return m_begin + offset;
+}
+
+size_t BroadcastBuffer::catchUp(ULONGLONG& position) const
+{
+	if (position >= m_tail)
+	{
+		return 0;
+	}
+
+	size_t skipped = static_cast<size_t>(m_tail - position);
+	position = m_tail;
+
+	return skipped;
+}
+
+void BroadcastBuffer::truncate(ULONGLONG position)
+{
+	if (position >= m_head)
+	{
+		return;
+	}
+
+	m_head = position < m_tail ? m_tail : position;
+}
+
+void BroadcastBuffer::setReclaimLimit(ULONGLONG position)
+{
+	m_reclaimLimit = position;
+}
+
+ULONGLONG BroadcastBuffer::reclaimLimit() const
+{
+	return m_reclaimLimit;
+}
+
+}
@@ -0,0 +1,77 @@
+#ifndef dsbridge_BroadcastBuffer_h
+#define dsbridge_BroadcastBuffer_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+// Single writer, multiple readers; every reader owns an absolute stream position
+// so all listeners receive the same bytes. Storage is reclaimed oldest-first, but
+// never beyond the reclaim limit, which covers regions still referenced by sends
+// that read straight out of the buffer.
+
+class BroadcastBuffer
+{
+public:
+	BroadcastBuffer();
+	~BroadcastBuffer();
+
+	bool create(size_t size);
+	void destroy();
+
+	size_t size() const { return m_size; }
+	ULONGLONG head() const;
+	ULONGLONG tail() const;
+	size_t available(ULONGLONG position) const;
+
+	bool write(const void* buffer, size_t size);
+	char* reserve(size_t& size);
+	void commit(size_t size);
+	size_t read(ULONGLONG& position, void* buffer, size_t size) const;
+	const char* region(ULONGLONG position, size_t& size) const;
+	size_t catchUp(ULONGLONG& position) const;
+	void truncate(ULONGLONG position);
+
+	void setReclaimLimit(ULONGLONG position);
+	ULONGLONG reclaimLimit() const;
+
+private:
+	char* m_begin;
+	size_t m_size;
+
+	ULONGLONG m_head;
+	ULONGLONG m_tail;
+	ULONGLONG m_reclaimLimit;
+};
+
+}
+
+#endif
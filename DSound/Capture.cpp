@@ -0,0 +1,354 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Capture.h"
+#include "Notify.h"
+#include "FlightRecorder.h"
+
+namespace dsbridge
+{
+
+Capture::Capture()
+: m_sampleRate(44100)
+, m_ended(false)
+, m_readerCount(0)
+, m_rateChangeCount(1)
+, m_stamps(0)
+, m_stampCapacity(0)
+, m_stampCount(0)
+, m_fill(0)
+{
+	InitializeCriticalSection(&m_cs);
+
+	m_rateChanges[0].position = 0;
+	m_rateChanges[0].sampleRate = m_sampleRate;
+}
+
+Capture::~Capture()
+{
+	delete[] m_stamps;
+}
+
+bool Capture::create()
+{
+	if (!m_buffer.create(1024 * 1024))
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "Could not create ringbuffer");
+		return false;
+	}
+
+	// writes share a stamp until they are StampBytes apart, so this many
+	// reach back over everything the ring holds
+
+	m_stampCapacity = m_buffer.size() / StampBytes + 1;
+	m_stamps = new Stamp[m_stampCapacity];
+
+	return true;
+}
+
+void Capture::setSampleRate(DWORD rate)
+{
+	EnterCriticalSection(&m_cs);
+
+	do
+	{
+		m_sampleRate = rate;
+
+		// everything written from here on is at the new rate
+
+		RateChange& last = m_rateChanges[m_rateChangeCount - 1];
+		if (last.sampleRate == rate)
+		{
+			break;
+		}
+
+		if (last.position == m_buffer.head())
+		{
+			last.sampleRate = rate;
+			break;
+		}
+
+		if (m_rateChangeCount == MaxRateChanges)
+		{
+			::memmove(m_rateChanges, m_rateChanges + 1, (MaxRateChanges - 1) * sizeof(RateChange));
+			--m_rateChangeCount;
+		}
+
+		m_rateChanges[m_rateChangeCount].position = m_buffer.head();
+		m_rateChanges[m_rateChangeCount].sampleRate = rate;
+		++m_rateChangeCount;
+	}
+	while (0);
+
+	LeaveCriticalSection(&m_cs);
+}
+
+void Capture::write(const void* buffer, size_t count, LONGLONG unlocked)
+{
+	EnterCriticalSection(&m_cs);
+
+	do
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+
+		ULONGLONG head = m_buffer.head();
+		if (!m_stampCount || ((head - m_stamps[(m_stampCount - 1) % m_stampCapacity].position) >= StampBytes))
+		{
+			Stamp& stamp = m_stamps[m_stampCount++ % m_stampCapacity];
+			stamp.position = head;
+			stamp.unlocked = unlocked;
+			stamp.mixed = now.QuadPart;
+		}
+
+		if (!m_buffer.write(buffer, count))
+		{
+			m_overrunBytes.add(static_cast<DWORD>(count));
+			FlightRecorder::record(FlightRecorder::CaptureOverrun, static_cast<DWORD>(count));
+		}
+
+		m_ended = m_ended && !count;
+		updateFill();
+	}
+	while (0);
+
+	LeaveCriticalSection(&m_cs);
+}
+
+void Capture::end()
+{
+	EnterCriticalSection(&m_cs);
+	m_ended = true;
+	LeaveCriticalSection(&m_cs);
+}
+
+bool Capture::addReader(Reader* reader)
+{
+	bool result = false;
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		if (m_readerCount == MaxReaders)
+		{
+			break;
+		}
+
+		reader->position = m_buffer.head();
+		reader->sampleRate = rateAt(reader->position);
+		reader->active = false;
+		m_readers[m_readerCount++] = reader;
+
+		result = true;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	return result;
+}
+
+size_t Capture::read(Reader& reader, void* buffer)
+{
+	size_t result = 0;
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		if (!reader.active)
+		{
+			reader.active = true;
+			updateReclaimLimit();
+		}
+
+		m_buffer.catchUp(reader.position);
+
+		size_t size = readSize(reader);
+		if (!size)
+		{
+			break;
+		}
+
+		reader.sampleRate = rateAt(reader.position);
+		const Stamp* stamp = stampAt(reader.position);
+		reader.timestamps = Latency::Timestamps();
+		reader.timestamps.unlocked = stamp ? stamp->unlocked : 0;
+		reader.timestamps.mixed = stamp ? stamp->mixed : 0;
+		m_buffer.read(reader.position, buffer, size);
+		updateReclaimLimit();
+
+		result = size;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	return result;
+}
+
+bool Capture::ended(const Reader& reader)
+{
+	EnterCriticalSection(&m_cs);
+
+	// what is left short of a chunk is silence, and never going to be read
+
+	bool result = m_ended && !readSize(reader);
+
+	LeaveCriticalSection(&m_cs);
+
+	return result;
+}
+
+void Capture::skip(Reader& reader, size_t keep)
+{
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		ULONGLONG limit = m_buffer.head();
+		limit = limit > keep ? limit - keep : 0;
+		if (reader.position < limit)
+		{
+			reader.position = limit;
+		}
+		reader.sampleRate = rateAt(reader.position);
+
+		if (reader.active)
+		{
+			reader.active = false;
+			updateReclaimLimit();
+		}
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+}
+
+size_t Capture::trim(Reader& reader, size_t keep)
+{
+	size_t result = 0;
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		// like skip(), but for a reader that keeps reading
+
+		ULONGLONG limit = m_buffer.head();
+		limit = limit > keep ? limit - keep : 0;
+		if (reader.position >= limit)
+		{
+			break;
+		}
+
+		result = static_cast<size_t>(limit - reader.position);
+		reader.position = limit;
+		updateReclaimLimit();
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	return result;
+}
+
+void Capture::updateReclaimLimit()
+{
+	ULONGLONG limit = ~ULONGLONG(0);
+
+	for (size_t i = 0; i < m_readerCount; ++i)
+	{
+		const Reader& reader = *m_readers[i];
+		if (reader.active && (reader.position < limit))
+		{
+			limit = reader.position;
+		}
+	}
+
+	m_buffer.setReclaimLimit(limit);
+	updateFill();
+}
+
+void Capture::updateFill()
+{
+	ULONGLONG head = m_buffer.head();
+	ULONGLONG limit = m_buffer.reclaimLimit();
+
+	m_fill = limit < head ? static_cast<DWORD>(head - limit) : 0;
+}
+
+DWORD Capture::rateAt(ULONGLONG position) const
+{
+	size_t i = m_rateChangeCount - 1;
+	while (i && (m_rateChanges[i].position > position))
+	{
+		--i;
+	}
+
+	return m_rateChanges[i].sampleRate;
+}
+
+const Capture::Stamp* Capture::stampAt(ULONGLONG position) const
+{
+	// the newest write that started at or before the position, found by
+	// bisecting the stamps oldest to newest. One older than every stamp left
+	// has no time rather than a wrong one
+
+	size_t count = m_stampCount < m_stampCapacity ? m_stampCount : m_stampCapacity;
+	size_t oldest = m_stampCount - count;
+
+	size_t low = 0;
+	size_t high = count;
+	while (low < high)
+	{
+		size_t middle = low + (high - low) / 2;
+		if (m_stamps[(oldest + middle) % m_stampCapacity].position <= position)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	return low ? &m_stamps[(oldest + low - 1) % m_stampCapacity] : 0;
+}
+
+size_t Capture::readSize(const Reader& reader) const
+{
+	// a whole chunk, or what is left up to the next rate change
+
+	ULONGLONG end = reader.position + reader.chunkSize;
+	for (size_t i = 0; i < m_rateChangeCount; ++i)
+	{
+		ULONGLONG position = m_rateChanges[i].position;
+		if ((position > reader.position) && (position < end))
+		{
+			end = position;
+			break;
+		}
+	}
+
+	return m_buffer.head() < end ? 0 : static_cast<size_t>(end - reader.position);
+}
+
+}
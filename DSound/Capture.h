@@ -0,0 +1,146 @@
+#ifndef dsbridge_Capture_h
+#define dsbridge_Capture_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "BroadcastBuffer.h"
+#include "Counter.h"
+#include "Latency.h"
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+// Shared PCM capture, holding the mixer output as 16-bit stereo. Every mount
+// encoder reads from it through its own reader. Rate changes are recorded at
+// the ring position they take effect, and a read never spans one, so every
+// reader switches on exactly the right sample. When the mixer ends the stream
+// the capture stays ended until the next write, and readers learn about it
+// once they have read everything before. Every write is stamped with the
+// time it was mixed and when its oldest audio was unlocked, so readers can
+// tell how old what they read is.
+
+class Capture
+{
+public:
+	struct Reader
+	{
+		Reader()
+		: position(0)
+		, chunkSize(0)
+		, sampleRate(0)
+		, active(false)
+		{}
+
+		ULONGLONG position;
+		size_t chunkSize;
+		DWORD sampleRate;
+		Latency::Timestamps timestamps;		// of the first sample of the last read
+		bool active;
+	};
+
+	Capture();
+	~Capture();
+
+	bool create();
+
+	void setSampleRate(DWORD rate);
+	DWORD sampleRate() const { return m_sampleRate; }
+	void write(const void* buffer, size_t count, LONGLONG unlocked);
+	void end();
+
+	bool addReader(Reader* reader);
+	size_t read(Reader& reader, void* buffer);
+	bool ended(const Reader& reader);
+	void skip(Reader& reader, size_t keep = 0);
+	size_t trim(Reader& reader, size_t keep);
+
+	size_t size() const { return m_buffer.size(); }
+	DWORD fill() const { return m_fill; }
+	ULONGLONG overrunBytes() { return m_overrunBytes.total(); }
+
+private:
+
+	enum
+	{
+		MaxReaders = 16,
+		MaxRateChanges = 16,
+		StampBytes = 256
+	};
+
+	struct RateChange
+	{
+		ULONGLONG position;
+		DWORD sampleRate;
+	};
+
+	struct Stamp
+	{
+		ULONGLONG position;
+		LONGLONG unlocked;
+		LONGLONG mixed;
+	};
+
+	void updateReclaimLimit();
+	void updateFill();
+	DWORD rateAt(ULONGLONG position) const;
+	const Stamp* stampAt(ULONGLONG position) const;
+	size_t readSize(const Reader& reader) const;
+
+	DWORD m_sampleRate;
+	bool m_ended;
+	CRITICAL_SECTION m_cs;
+
+	BroadcastBuffer m_buffer;
+
+	Reader* m_readers[MaxReaders];
+	size_t m_readerCount;
+
+	// oldest first; the first entry covers everything before the second
+
+	RateChange m_rateChanges[MaxRateChanges];
+	size_t m_rateChangeCount;
+
+	// one per write, newest last, and enough of them to cover the whole ring
+
+	Stamp* m_stamps;
+	size_t m_stampCapacity;
+	size_t m_stampCount;
+
+	// published for the status pages, which read them without the lock: what
+	// the slowest reader has left to read, and what was mixed while the ring
+	// was full of audio not yet read
+
+	volatile DWORD m_fill;
+	Counter m_overrunBytes;
+};
+
+}
+
+#endif
@@ -0,0 +1,127 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "ClockRecovery.h"
+
+#include <math.h>
+
+namespace dsbridge
+{
+
+// loop bandwidth in Hz. It starts wide to lock quickly and narrows until
+// cursors that are quantized and tens of milliseconds stale average out
+
+static const double s_initialBandwidth = 1.0;
+static const double s_bandwidth = 0.02;
+static const double s_settleTime = 10.0;
+static const double s_maxInterval = 0.05;
+
+// how far the recovered rate may wander from what the buffer claims
+
+static const double s_maxDeviation = 0.01;
+
+ClockRecovery::ClockRecovery()
+: m_nominal(0.0)
+, m_rate(0.0)
+, m_position(0.0)
+, m_time(0.0)
+, m_variance(0.0)
+, m_bandwidth(s_initialBandwidth)
+, m_bufferFrames(0)
+{
+}
+
+void ClockRecovery::reset(double rate, double time, double position, DWORD bufferFrames)
+{
+	m_nominal = rate;
+	m_rate = rate;
+	m_position = position;
+	m_time = time;
+	m_variance = 0.0;
+	m_bandwidth = s_initialBandwidth;
+	m_bufferFrames = bufferFrames;
+}
+
+void ClockRecovery::retune(double rate, double time)
+{
+	// keep the position, and start the rate over from the new nominal
+
+	m_position = position(time);
+	m_time = time;
+	m_nominal = rate;
+	m_rate = rate;
+}
+
+void ClockRecovery::seek(double time, double position)
+{
+	m_position = position;
+	m_time = time;
+}
+
+void ClockRecovery::observe(double time, DWORD cursor)
+{
+	double dt = time - m_time;
+	if ((dt <= 0.0) || !m_bufferFrames)
+	{
+		return;
+	}
+
+	// the lap nearest to where the cursor is expected to be
+
+	double expected = m_position + m_rate * dt;
+	double lap = floor((expected - cursor) / m_bufferFrames + 0.5);
+	double error = (cursor + lap * m_bufferFrames) - expected;
+
+	// an observation after a long silence is still only one observation, and
+	// gets no more say than any other
+
+	double omega = 2.0 * 3.14159265358979323846 * m_bandwidth * (dt < s_maxInterval ? dt : s_maxInterval);
+
+	m_position = expected + 1.4142135623730951 * omega * error;
+	m_rate += omega * omega * error / dt;
+
+	double low = m_nominal * (1.0 - s_maxDeviation);
+	double high = m_nominal * (1.0 + s_maxDeviation);
+	m_rate = m_rate < low ? low : (m_rate > high ? high : m_rate);
+
+	m_bandwidth -= (m_bandwidth - s_bandwidth) * (dt < s_settleTime ? dt / s_settleTime : 1.0);
+
+	m_time = time;
+	m_variance += (error * error - m_variance) * 0.01;
+}
+
+double ClockRecovery::position(double time) const
+{
+	return m_position + m_rate * (time - m_time);
+}
+
+double ClockRecovery::jitter() const
+{
+	return sqrt(m_variance);
+}
+
+}
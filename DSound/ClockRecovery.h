@@ -0,0 +1,71 @@
+#ifndef dsbridge_ClockRecovery_h
+#define dsbridge_ClockRecovery_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+// Second-order delay-locked loop recovering a buffer's real playback clock
+// from play cursor observations. Cursors arrive late and irregularly, and
+// wrap around the buffer; the loop unwraps each against its own prediction,
+// so missed observations are harmless as long as the prediction is off by
+// less than half a buffer, and filters the timing jitter out of both the
+// position and the rate estimate.
+
+class ClockRecovery
+{
+public:
+	ClockRecovery();
+
+	void reset(double rate, double time, double position, DWORD bufferFrames);
+	void retune(double rate, double time);
+	void seek(double time, double position);
+	void observe(double time, DWORD cursor);
+
+	double position(double time) const;
+	double rate() const { return m_rate; }
+	double nominalRate() const { return m_nominal; }
+	double jitter() const;
+
+private:
+
+	double m_nominal;
+	double m_rate;
+	double m_position;
+	double m_time;
+	double m_variance;
+	double m_bandwidth;
+	DWORD m_bufferFrames;
+};
+
+}
+
+#endif
@@ -1,272 +1,646 @@
-/*
-
-Copyright 2009 Jesper Svennevid
-
-Redistribution and use in source and binary forms, with or without
-modification, are permitted provided that the following conditions
-are met:
-
-1. Redistributions of source code must retain the above copyright
-   notice, this list of conditions and the following disclaimer.
-2. Redistributions in binary form must reproduce the above copyright
-   notice, this list of conditions and the following disclaimer in the
-   documentation and/or other materials provided with the distribution.
-
-THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
-IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
-OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
-IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
-INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
-NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
-DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
-THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
-(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
-THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-
-*/
-
-#include "Configuration.h"
-
-#include <stdio.h>
-
-namespace dsbridge
-{
-
-Configuration Configuration::s_instance;
-CRITICAL_SECTION Configuration::s_cs;
-
-Configuration::Configuration()
-: m_settings(0)
-, m_settingsCount(0)
-{
-	::InitializeCriticalSection(&s_cs);
-
-	DWORD length = ::GetModuleFileName(0, m_path, PathLength);
-	m_path[length] = '\0';
-
-	char* offset = ::strrchr(m_path, '\\');
-	if (!offset)
-	{
-		m_path[0] = '\0';
-		m_module[0] = '\0';
-		return;
-	}
-
-	size_t ofslen = ::strlen(offset+1);
-	::memcpy_s(m_module, sizeof(m_module), offset+1, ofslen+1);
-	*(offset+1) = '\0';
-	for (size_t i = 0; i < ofslen; ++i)
-	{
-		m_module[i] = ::toupper(m_module[i]);
-	}
-
-	sprintf_s(m_path, sizeof(m_path), "%sdsbridge.ini", m_path);
-
-	loadSettings(m_module, m_path);
-}
-
-Configuration::~Configuration()
-{
-	::DeleteCriticalSection(&s_cs);
-}
-
-const char* Configuration::getString(const char* name, const char* defaultValue)
-{
-	const char* value;
-
-	::EnterCriticalSection(&s_cs);
-	do
-	{
-		value = s_instance.getStringInternal(name, defaultValue);
-	}
-	while (0);
-	::LeaveCriticalSection(&s_cs);
-
-	return value;
-}
-
-int Configuration::getInteger(const char* name, int defaultValue)
-{
-	int value;
-
-	::EnterCriticalSection(&s_cs);
-	do
-	{
-		value = s_instance.getIntegerInternal(name, defaultValue);
-	}
-	while (0);
-	::LeaveCriticalSection(&s_cs);
-
-	return value;
-}
-
-const char* Configuration::getStringInternal(const char* name, const char* defaultValue)
-{
-	for (unsigned int i = 0; i < m_settingsCount; ++i)
-	{
-		const Setting& setting = m_settings[i];
-
-		if (::_stricmp(setting.name, name))
-		{
-			continue;
-		}
-
-		return setting.value;
-	}
-
-	return defaultValue;
-}
-
-int Configuration::getIntegerInternal(const char* name, int defaultValue)
-{
-	const char* intValue = getStringInternal(name, 0);
-	if (!intValue)
-	{
-		return defaultValue;
-	}
-
-	int value = ::strtol(intValue, 0, 10);
-
-	return value;
-}
-
-void Configuration::loadSettings(const char* section, const char* path)
-{
-	HANDLE file = INVALID_HANDLE_VALUE;
-	const int bufferSize = 8192;
-	char* buffer = new char[bufferSize];
-	enum
-	{
-		SearchingForSection,
-		ParsingSection
-	} state = SearchingForSection;
-
-	do
-	{
-		file = ::CreateFile(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
-		int apa2 = GetLastError();
-		if (file == INVALID_HANDLE_VALUE)
-		{
-			break;
-		}
-
-		char* start = buffer;
-		const char* begin = buffer;
-		const char* end = buffer;
-		for (;;)
-		{
-			if (begin == end)
-			{
-				DWORD readCount;
-				if (!ReadFile(file, start, static_cast<DWORD>(bufferSize - (start - buffer)), &readCount, 0))
-				{
-					break;
-				}
-
-				if (!readCount)
-				{
-					break;
-				}
-
-				begin = start;
-				end = start + readCount;
-				start = buffer;
-			}
-
-			const char* eol = begin;
-			while ((eol != end) && (*eol != '\r') && (*eol != '\n')) ++eol;
-
-			if (eol == end)
-			{
-				// TODO: add logic to refill section
-			}
-
-			switch (state)
-			{
-				case SearchingForSection:
-				{
-					size_t len = ::strlen(section);
-					if ((*begin != '[') || (((eol-1)-(begin+1)) != len) || (*(eol-1) != ']') || ::_strnicmp(begin+1, section, len))
-					{
-						break;
-					}
-
-					state = ParsingSection;
-				}
-				break;
-
-				case ParsingSection:
-				{
-					const char* nameBegin = begin;
-					const char* nameEnd = begin;
-
-					while ((nameEnd != eol) && (*nameEnd != '=')) ++nameEnd;
-					if (nameEnd == eol)
-					{
-						break;
-					}
-
-					if (*nameBegin == '[')
-					{
-						state = SearchingForSection;
-						break;
-					}
-
-					const char* valueBegin = nameEnd+1;
-
-					while ((valueBegin != eol) && (*valueBegin == ' ')) ++valueBegin;
-					const char* valueEnd = eol;
-					while ((valueEnd > (valueBegin+1)) && (*valueEnd == ' ')) --valueEnd;
-
-					if (*valueBegin == '"')
-					{
-						if (*(valueEnd-1) != '"')
-						{
-							break;
-						}
-
-						++valueBegin;
-						--valueEnd;
-
-						if (valueBegin > valueEnd)
-						{
-							break;
-						}
-					}
-
-					Setting temp;
-
-					temp.name = new char[(nameEnd-nameBegin)+1];
-					::memcpy(temp.name, nameBegin, (nameEnd-nameBegin));
-					temp.name[(nameEnd-nameBegin)] = '\0';
-
-					temp.value = new char[(valueEnd-valueBegin)+1];
-					::memcpy(temp.value, valueBegin, (valueEnd-valueBegin));
-					temp.value[(valueEnd-valueBegin)] = '\0';
-
-					Setting* curr = new Setting[m_settingsCount+1];
-					::memcpy_s(curr, sizeof(Setting) * (m_settingsCount+1), m_settings, sizeof(Setting) * m_settingsCount);
-					curr[m_settingsCount] = temp;
-
-					delete [] m_settings;
-					m_settings = curr;
-					++m_settingsCount;
-				}
-				break;
-			}
-
-			begin = eol;
-			while ((begin != end) && ((*begin == '\r') || (*begin == '\n'))) ++begin;
-		}
-	}
-	while (0);
-
-	delete [] buffer;
-	
-	if (file != INVALID_HANDLE_VALUE)
-	{
-		CloseHandle(file);
-	}
-}
-
-}
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Configuration.h"
+#include "Notify.h"
+#include "ExceptionHandler.h"
+
+#include <stdio.h>
+
+namespace dsbridge
+{
+
+Configuration Configuration::s_instance;
+Configuration::Snapshot* volatile Configuration::s_snapshot = 0;
+CRITICAL_SECTION Configuration::s_cs;
+
+Configuration::Configuration()
+: m_thread(0)
+, m_subscriptionCount(0)
+{
+	::InitializeCriticalSection(&s_cs);
+
+	DWORD length = ::GetModuleFileName(0, m_path, PathLength);
+	m_path[length] = '\0';
+
+	char* offset = ::strrchr(m_path, '\\');
+	if (!offset)
+	{
+		m_path[0] = '\0';
+		m_module[0] = '\0';
+		return;
+	}
+
+	size_t ofslen = ::strlen(offset+1);
+	::memcpy_s(m_module, sizeof(m_module), offset+1, ofslen+1);
+	*(offset+1) = '\0';
+	for (size_t i = 0; i < ofslen; ++i)
+	{
+		m_module[i] = ::toupper(m_module[i]);
+	}
+
+	strcat_s(m_path, sizeof(m_path), "dsbridge.ini");
+
+	// the snapshot is complete before anyone can see it, and never changes after
+
+	Snapshot* snapshot = loadSettings(m_module, m_path);
+	InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&s_snapshot), snapshot);
+}
+
+Configuration::~Configuration()
+{
+	// threads may still be looking up settings while the module unloads, so
+	// the snapshots are left for the process to reclaim
+
+	::DeleteCriticalSection(&s_cs);
+}
+
+const char* Configuration::getString(const char* name, const char* defaultValue)
+{
+	const Setting* setting = find(name);
+	return setting ? setting->value : defaultValue;
+}
+
+int Configuration::getInteger(const char* name, int defaultValue)
+{
+	const Setting* setting = find(name);
+	return setting ? setting->integer : defaultValue;
+}
+
+bool Configuration::getBool(const char* name, bool defaultValue)
+{
+	const Setting* setting = find(name);
+	return setting ? setting->boolean : defaultValue;
+}
+
+size_t Configuration::getSize(const char* name, size_t defaultValue)
+{
+	const Setting* setting = find(name);
+	return setting ? static_cast<size_t>(setting->size) : defaultValue;
+}
+
+DWORD Configuration::getDuration(const char* name, DWORD defaultValue, DWORD unit)
+{
+	const Setting* setting = find(name);
+	if (!setting)
+	{
+		return defaultValue;
+	}
+
+	if (setting->milliseconds != ~0u)
+	{
+		return setting->milliseconds;
+	}
+
+	double milliseconds = setting->number * unit;
+	return milliseconds > 0.0 ? static_cast<DWORD>(milliseconds + 0.5) : 0;
+}
+
+bool Configuration::subscribe(const char* name, Handler handler, void* context)
+{
+	bool subscribed = false;
+
+	::EnterCriticalSection(&s_cs);
+	do
+	{
+		if (s_instance.m_subscriptionCount == MaxSubscriptions)
+		{
+			break;
+		}
+
+		Subscription& subscription = s_instance.m_subscriptions[s_instance.m_subscriptionCount++];
+		strncpy_s(subscription.name, sizeof(subscription.name), name, _TRUNCATE);
+		subscription.handler = handler;
+		subscription.context = context;
+
+		subscribed = true;
+	}
+	while (0);
+	::LeaveCriticalSection(&s_cs);
+
+	if (!subscribed)
+	{
+		Notify::update(Notify::DirectSound, Notify::Warning, "Too many subscriptions, %s will not be reloaded", name);
+	}
+
+	return subscribed;
+}
+
+void Configuration::unsubscribe(Handler handler, void* context)
+{
+	::EnterCriticalSection(&s_cs);
+	do
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < s_instance.m_subscriptionCount; ++i)
+		{
+			const Subscription& subscription = s_instance.m_subscriptions[i];
+			if ((subscription.handler != handler) || (subscription.context != context))
+			{
+				s_instance.m_subscriptions[count++] = subscription;
+			}
+		}
+		s_instance.m_subscriptionCount = count;
+	}
+	while (0);
+	::LeaveCriticalSection(&s_cs);
+}
+
+bool Configuration::watch()
+{
+	if (!s_instance.m_path[0])
+	{
+		return true;
+	}
+
+	s_instance.m_thread = CreateThread(0, 0, threadEntry, &s_instance, 0, 0);
+	if (!s_instance.m_thread)
+	{
+		Notify::update(Notify::DirectSound, Notify::Warning, "Could not watch dsbridge.ini for changes");
+		return false;
+	}
+
+	return true;
+}
+
+DWORD WINAPI Configuration::threadEntry(LPVOID parameter)
+{
+	__try
+	{
+		static_cast<Configuration*>(parameter)->run();
+	}
+	__except(ExceptionHandler::filter("Configuration", GetExceptionInformation()))
+	{
+	}
+	return 0;
+}
+
+void Configuration::run()
+{
+	// changes are reported for the directory dsbridge.ini is in
+
+	char directoryPath[PathLength + 1];
+	strcpy_s(directoryPath, sizeof(directoryPath), m_path);
+	char* offset = ::strrchr(directoryPath, '\\');
+	if (offset)
+	{
+		*offset = '\0';
+	}
+
+	HANDLE directory = ::CreateFile(directoryPath, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, 0);
+	if (directory == INVALID_HANDLE_VALUE)
+	{
+		Notify::update(Notify::DirectSound, Notify::Warning, "Could not watch %s for changes", directoryPath);
+		return;
+	}
+
+	DWORD buffer[1024];
+	DWORD bytes;
+	while (ReadDirectoryChangesW(directory, buffer, sizeof(buffer), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE, &bytes, 0, 0))
+	{
+		// nothing returned means the changes overflowed the buffer, so any of
+		// them may have been to the settings
+
+		bool modified = !bytes;
+		for (const BYTE* record = reinterpret_cast<const BYTE*>(buffer); bytes && !modified;)
+		{
+			const FILE_NOTIFY_INFORMATION* information = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(record);
+			modified = (information->FileNameLength == (sizeof(L"dsbridge.ini") - sizeof(WCHAR))) && !::_wcsnicmp(information->FileName, L"dsbridge.ini", information->FileNameLength / sizeof(WCHAR));
+
+			if (!information->NextEntryOffset)
+			{
+				break;
+			}
+			record += information->NextEntryOffset;
+		}
+
+		if (!modified)
+		{
+			continue;
+		}
+
+		// editors often write a file in several steps, so let them finish
+
+		SleepEx(ReloadDelay, FALSE);
+		reload();
+	}
+
+	CloseHandle(directory);
+}
+
+void Configuration::reload()
+{
+	// an editor may still hold the file, or have it half renamed
+
+	Snapshot* snapshot = 0;
+	for (int attempt = 0; !snapshot && (attempt < ReloadAttempts); ++attempt)
+	{
+		if (attempt)
+		{
+			SleepEx(ReloadDelay, FALSE);
+		}
+		snapshot = loadSettings(m_module, m_path);
+	}
+
+	if (!snapshot)
+	{
+		Notify::update(Notify::DirectSound, Notify::Warning, "Could not reload dsbridge.ini");
+		return;
+	}
+
+	Subscription firing[MaxSubscriptions];
+	size_t count = 0;
+
+	::EnterCriticalSection(&s_cs);
+	do
+	{
+		// readers may still hold settings from the old snapshot, strings
+		// included, so it is never freed; it only costs memory per edit
+
+		Snapshot* previous = static_cast<Snapshot*>(InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&s_snapshot), snapshot));
+
+		bool fired[MaxSubscriptions] = { false };
+		changed(previous, snapshot, fired);
+		changed(snapshot, previous, fired);
+
+		for (size_t i = 0; i < m_subscriptionCount; ++i)
+		{
+			if (fired[i])
+			{
+				firing[count++] = m_subscriptions[i];
+			}
+		}
+	}
+	while (0);
+	::LeaveCriticalSection(&s_cs);
+
+	// handlers run without the lock, so they may subscribe and unsubscribe,
+	// or wait on a thread that does
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		firing[i].handler(firing[i].context);
+	}
+
+	Notify::update(Notify::DirectSound, Notify::Info, "Reloaded dsbridge.ini");
+}
+
+void Configuration::changed(const Snapshot* from, const Snapshot* to, bool* fired)
+{
+	// every setting in one snapshot that the other lacks or has another value
+	// for; run both ways, that covers settings added and removed
+
+	if (!from)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < from->count; ++i)
+	{
+		const Setting& setting = from->settings[i];
+
+		// later settings with the same name were never in effect
+
+		if (lookup(from, setting.name, setting.hash) != &setting)
+		{
+			continue;
+		}
+
+		const Setting* other = lookup(to, setting.name, setting.hash);
+		if (other && !::strcmp(other->value, setting.value))
+		{
+			continue;
+		}
+
+		const char* name = ::strrchr(setting.name, '.');
+		name = name ? name + 1 : setting.name;
+
+		for (size_t j = 0; j < m_subscriptionCount; ++j)
+		{
+			const Subscription& subscription = m_subscriptions[j];
+			if (fired[j] || (::_stricmp(subscription.name, setting.name) && ::_stricmp(subscription.name, name)))
+			{
+				continue;
+			}
+
+			fired[j] = true;
+		}
+	}
+}
+
+const Configuration::Setting* Configuration::find(const char* name)
+{
+	// a volatile read, so everything written before the snapshot was
+	// published is visible through it
+
+	const Snapshot* snapshot = s_snapshot;
+	return lookup(snapshot, name, hash(name));
+}
+
+const Configuration::Setting* Configuration::lookup(const Snapshot* snapshot, const char* name, DWORD key)
+{
+	if (!snapshot || !snapshot->count)
+	{
+		return 0;
+	}
+
+	for (DWORD slot = key & snapshot->mask;; slot = (slot + 1) & snapshot->mask)
+	{
+		DWORD entry = snapshot->index[slot];
+		if (!entry)
+		{
+			return 0;
+		}
+
+		const Setting& setting = snapshot->settings[entry - 1];
+		if ((setting.hash == key) && !::_stricmp(setting.name, name))
+		{
+			return &setting;
+		}
+	}
+}
+
+DWORD Configuration::hash(const char* name)
+{
+	// FNV-1a over the lowercased name, as names are case-insensitive
+
+	DWORD hash = 2166136261u;
+	for (; *name; ++name)
+	{
+		char c = *name;
+		hash = (hash ^ BYTE((c >= 'A') && (c <= 'Z') ? c + ('a' - 'A') : c)) * 16777619u;
+	}
+	return hash;
+}
+
+void Configuration::convert(Setting& setting)
+{
+	const char* value = setting.value;
+
+	setting.integer = ::strtol(value, 0, 10);
+	setting.boolean = !::_stricmp(value, "true") || !::_stricmp(value, "yes") || !::_stricmp(value, "on") || (setting.integer > 0);
+
+	char* suffix;
+	setting.number = ::strtod(value, &suffix);
+	while (*suffix == ' ') ++suffix;
+
+	double scale = 1.0;
+	switch (*suffix)
+	{
+		case 'k': case 'K': scale = 1024.0; break;
+		case 'm': case 'M': scale = 1024.0 * 1024.0; break;
+		case 'g': case 'G': scale = 1024.0 * 1024.0 * 1024.0; break;
+	}
+	setting.size = setting.number > 0.0 ? static_cast<ULONGLONG>(setting.number * scale) : 0;
+
+	// ~0 when there is no unit, so the caller's one applies
+
+	setting.milliseconds = ~0u;
+	if (!::_stricmp(suffix, "ms"))
+	{
+		scale = 1.0;
+	}
+	else if (!::_stricmp(suffix, "s"))
+	{
+		scale = 1000.0;
+	}
+	else if (!::_stricmp(suffix, "min"))
+	{
+		scale = 60000.0;
+	}
+	else
+	{
+		return;
+	}
+	setting.milliseconds = setting.number > 0.0 ? static_cast<DWORD>(setting.number * scale + 0.5) : 0;
+}
+
+void Configuration::buildIndex(Snapshot& snapshot)
+{
+	// at most half full, so probe sequences stay short
+
+	DWORD capacity = 16;
+	while (capacity < snapshot.count * 2)
+	{
+		capacity *= 2;
+	}
+
+	snapshot.mask = capacity - 1;
+	snapshot.index = new DWORD[capacity];
+	::memset(snapshot.index, 0, capacity * sizeof(DWORD));
+
+	for (size_t i = 0; i < snapshot.count; ++i)
+	{
+		Setting& setting = snapshot.settings[i];
+		setting.hash = hash(setting.name);
+		convert(setting);
+
+		// the first of several settings with the same name wins
+
+		DWORD slot = setting.hash & snapshot.mask;
+		for (; snapshot.index[slot]; slot = (slot + 1) & snapshot.mask)
+		{
+			if (!::_stricmp(snapshot.settings[snapshot.index[slot] - 1].name, setting.name))
+			{
+				break;
+			}
+		}
+
+		if (!snapshot.index[slot])
+		{
+			snapshot.index[slot] = static_cast<DWORD>(i + 1);
+		}
+	}
+}
+
+Configuration::Snapshot* Configuration::loadSettings(const char* section, const char* path)
+{
+	Snapshot* snapshot = new Snapshot;
+	snapshot->settings = 0;
+	snapshot->count = 0;
+	size_t capacity = 0;
+
+	HANDLE file = INVALID_HANDLE_VALUE;
+	const int bufferSize = 8192;
+	char* buffer = new char[bufferSize];
+	enum State
+	{
+		Skipping,
+		SearchingForSection,
+		ParsingSection
+	} state = SearchingForSection;
+
+	do
+	{
+		file = ::CreateFile(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			break;
+		}
+
+		const char* begin = buffer;
+		const char* end = buffer;
+		bool finished = false;
+		bool cut = false;
+		for (;;)
+		{
+			const char* eol = begin;
+			while ((eol != end) && (*eol != '\r') && (*eol != '\n')) ++eol;
+
+			// a line that runs past what has been read is moved to the front
+			// and completed by the next read, unless it fills the whole buffer
+
+			if ((eol == end) && !finished && ((begin != buffer) || (end != (buffer + bufferSize))))
+			{
+				size_t remaining = end - begin;
+				::memmove(buffer, begin, remaining);
+
+				DWORD readCount;
+				if (!ReadFile(file, buffer + remaining, static_cast<DWORD>(bufferSize - remaining), &readCount, 0))
+				{
+					readCount = 0;
+				}
+
+				finished = !readCount;
+				begin = buffer;
+				end = buffer + remaining + readCount;
+				continue;
+			}
+
+			if (begin == end)
+			{
+				break;
+			}
+
+			// the rest of a line longer than the buffer is skipped
+
+			bool skipped = cut;
+			cut = (eol == end) && !finished;
+
+			switch (skipped ? Skipping : state)
+			{
+				case Skipping:
+				break;
+
+				case SearchingForSection:
+				{
+					size_t len = ::strlen(section);
+					if ((*begin != '[') || (static_cast<size_t>((eol-1)-(begin+1)) != len) || (*(eol-1) != ']') || ::_strnicmp(begin+1, section, len))
+					{
+						break;
+					}
+
+					state = ParsingSection;
+				}
+				break;
+
+				case ParsingSection:
+				{
+					const char* nameBegin = begin;
+					const char* nameEnd = begin;
+
+					if (*nameBegin == '[')
+					{
+						state = SearchingForSection;
+						break;
+					}
+
+					while ((nameEnd != eol) && (*nameEnd != '=')) ++nameEnd;
+					if (nameEnd == eol)
+					{
+						break;
+					}
+
+					const char* valueBegin = nameEnd+1;
+
+					while ((valueBegin != eol) && (*valueBegin == ' ')) ++valueBegin;
+					const char* valueEnd = eol;
+					while ((valueEnd > (valueBegin+1)) && (*valueEnd == ' ')) --valueEnd;
+
+					if (*valueBegin == '"')
+					{
+						if (*(valueEnd-1) != '"')
+						{
+							break;
+						}
+
+						++valueBegin;
+						--valueEnd;
+
+						if (valueBegin > valueEnd)
+						{
+							break;
+						}
+					}
+
+					Setting temp;
+
+					temp.name = new char[(nameEnd-nameBegin)+1];
+					::memcpy(temp.name, nameBegin, (nameEnd-nameBegin));
+					temp.name[(nameEnd-nameBegin)] = '\0';
+
+					temp.value = new char[(valueEnd-valueBegin)+1];
+					::memcpy(temp.value, valueBegin, (valueEnd-valueBegin));
+					temp.value[(valueEnd-valueBegin)] = '\0';
+
+					if (snapshot->count == capacity)
+					{
+						capacity = capacity ? capacity * 2 : 16;
+
+						Setting* curr = new Setting[capacity];
+						::memcpy_s(curr, sizeof(Setting) * capacity, snapshot->settings, sizeof(Setting) * snapshot->count);
+
+						delete [] snapshot->settings;
+						snapshot->settings = curr;
+					}
+
+					snapshot->settings[snapshot->count++] = temp;
+				}
+				break;
+			}
+
+			begin = eol;
+			while ((begin != end) && ((*begin == '\r') || (*begin == '\n'))) ++begin;
+		}
+	}
+	while (0);
+
+	delete [] buffer;
+	
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		delete snapshot;
+		return 0;
+	}
+
+	CloseHandle(file);
+
+	buildIndex(*snapshot);
+	return snapshot;
+}
+
+}
@@ -1,75 +1,150 @@
-#ifndef dsbridge_Configuration_h
-#define dsbridge_Configuration_h
-
-/*
-
-Copyright 2009 Jesper Svennevid
-
-Redistribution and use in source and binary forms, with or without
-modification, are permitted provided that the following conditions
-are met:
-
-1. Redistributions of source code must retain the above copyright
-   notice, this list of conditions and the following disclaimer.
-2. Redistributions in binary form must reproduce the above copyright
-   notice, this list of conditions and the following disclaimer in the
-   documentation and/or other materials provided with the distribution.
-
-THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
-IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
-OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
-IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
-INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
-NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
-DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
-THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
-(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
-THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-
-*/
-
-#include <windows.h>
-
-namespace dsbridge
-{
-
-class Configuration
-{
-public:
-
-	static const char* getString(const char* name, const char* defaultValue = "");
-	static int getInteger(const char* name, int defaultValue = 0);
-
-private:
-
-	enum
-	{
-		PathLength = MAX_PATH
-	};
-
-	struct Setting
-	{
-		char* name;
-		char* value;
-	};
-
-	Configuration();
-	~Configuration();
-
-	const char* getStringInternal(const char* name, const char* defaultValue = "");
-	int getIntegerInternal(const char* name, int defaultValue = 0);
-	void loadSettings(const char* section, const char* path);
-
-	char m_module[PathLength + 1];
-	char m_path[PathLength+1];
-
-	Setting* m_settings;
-	size_t m_settingsCount;
-
-	static Configuration s_instance;
-	static CRITICAL_SECTION s_cs;
-};
-
-}
-
-#endif
+#ifndef dsbridge_Configuration_h
+#define dsbridge_Configuration_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+// The settings are parsed into an immutable snapshot, with every value
+// already converted to the types it may be asked for and an open-addressing
+// index over the names. Lookups read the published snapshot without taking
+// a lock, so they are cheap enough to make on every call.
+//
+// Once watch() has been called, saving dsbridge.ini parses it into a new
+// snapshot, which replaces the old one. Subscribers to a setting that
+// changed are then called on the watching thread, outside any lock, so one
+// that has just unsubscribed may still be called once; a subscription to a
+// name also covers it prefixed with a mount.
+
+class Configuration
+{
+public:
+
+	static const char* getString(const char* name, const char* defaultValue = "");
+	static int getInteger(const char* name, int defaultValue = 0);
+
+	// 1, true, yes and on are true, as is any other number above 0
+
+	static bool getBool(const char* name, bool defaultValue = false);
+
+	// bytes, or with a k, m or g suffix (powers of 1024)
+
+	static size_t getSize(const char* name, size_t defaultValue = 0);
+
+	// milliseconds, from a number with an ms, s or min suffix; a bare number
+	// is counted in units of the given number of milliseconds
+
+	static DWORD getDuration(const char* name, DWORD defaultValue = 0, DWORD unit = 1);
+
+	typedef void (*Handler)(void* context);
+
+	static bool subscribe(const char* name, Handler handler, void* context);
+	static void unsubscribe(Handler handler, void* context);
+	static bool watch();
+
+private:
+
+	enum
+	{
+		PathLength = MAX_PATH,
+		NameLength = 64,
+		MaxSubscriptions = 64,
+		ReloadDelay = 200,
+		ReloadAttempts = 5
+	};
+
+	struct Setting
+	{
+		char* name;
+		char* value;
+		DWORD hash;
+
+		int integer;
+		bool boolean;
+		ULONGLONG size;
+		double number;
+		DWORD milliseconds;
+	};
+
+	struct Snapshot
+	{
+		Setting* settings;
+		size_t count;
+
+		// setting index + 1 for every slot, 0 when empty
+
+		DWORD* index;
+		DWORD mask;
+	};
+
+	struct Subscription
+	{
+		char name[NameLength];
+		Handler handler;
+		void* context;
+	};
+
+	Configuration();
+	~Configuration();
+
+	static const Setting* find(const char* name);
+	static const Setting* lookup(const Snapshot* snapshot, const char* name, DWORD key);
+	static DWORD hash(const char* name);
+	static void convert(Setting& setting);
+
+	static Snapshot* loadSettings(const char* section, const char* path);
+	static void buildIndex(Snapshot& snapshot);
+
+	static DWORD WINAPI threadEntry(LPVOID parameter);
+
+	void run();
+	void reload();
+	void changed(const Snapshot* from, const Snapshot* to, bool* fired);
+
+	char m_module[PathLength + 1];
+	char m_path[PathLength+1];
+
+	HANDLE m_thread;
+
+	Subscription m_subscriptions[MaxSubscriptions];
+	size_t m_subscriptionCount;
+
+	static Configuration s_instance;
+	static Snapshot* volatile s_snapshot;
+
+	// only subscribing and reloading take it, never a lookup
+
+	static CRITICAL_SECTION s_cs;
+};
+
+}
+
+#endif
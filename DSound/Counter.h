@@ -0,0 +1,72 @@
+#ifndef dsbridge_Counter_h
+#define dsbridge_Counter_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+// A count bumped by one thread and read by another without a lock. The writer
+// does a plain 32-bit add, which is never torn, and the reader widens it to 64
+// bits by folding in the difference since it last looked, so it has to look at
+// least once per 4 GB worth of adds.
+
+class Counter
+{
+public:
+	Counter()
+	: m_value(0)
+	, m_seen(0)
+	, m_total(0)
+	{}
+
+	void add(DWORD count) { m_value = m_value + count; }
+
+	ULONGLONG total()
+	{
+		DWORD value = m_value;
+		m_total += value - m_seen;
+		m_seen = value;
+		return m_total;
+	}
+
+private:
+
+	volatile DWORD m_value;
+
+	// only touched by the reader
+
+	DWORD m_seen;
+	ULONGLONG m_total;
+};
+
+}
+
+#endif
@@ -0,0 +1,304 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "CursorCapture.h"
+#include "Voice.h"
+#include "Notify.h"
+#include "ExceptionHandler.h"
+
+namespace dsbridge
+{
+
+CursorCapture::CursorCapture()
+: m_thread(0)
+, m_wake(0)
+, m_sourceCount(0)
+{
+	InitializeCriticalSection(&m_cs);
+}
+
+CursorCapture::~CursorCapture()
+{
+}
+
+bool CursorCapture::create()
+{
+	m_wake = CreateEvent(0, FALSE, FALSE, 0);
+	if (!m_wake)
+	{
+		Notify::update(Notify::DirectSound, Notify::Error, "Could not create cursor capture event");
+		return false;
+	}
+
+	m_thread = CreateThread(0, 0, threadEntry, this, 0, 0);
+	if (!m_thread)
+	{
+		Notify::update(Notify::DirectSound, Notify::Error, "Could not create cursor capture thread");
+		return false;
+	}
+
+	SetThreadPriority(m_thread, THREAD_PRIORITY_BELOW_NORMAL);
+	return true;
+}
+
+bool CursorCapture::add(Source* source)
+{
+	bool result = false;
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		if (!m_thread || (m_sourceCount == MaxSources))
+		{
+			break;
+		}
+
+		m_sources[m_sourceCount++] = source;
+		result = true;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	return result;
+}
+
+void CursorCapture::remove(Source* source)
+{
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		for (size_t i = 0; i < m_sourceCount; ++i)
+		{
+			if (m_sources[i] == source)
+			{
+				m_sources[i] = m_sources[--m_sourceCount];
+				break;
+			}
+		}
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+}
+
+void CursorCapture::onPlay(Source* source, bool looping)
+{
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		source->looping = looping;
+		source->ended = source->ended && !looping;
+		if (source->playing)
+		{
+			break;
+		}
+
+		// what plays is the buffer from the play cursor onwards
+
+		DWORD play;
+		if (FAILED(source->buffer->GetCurrentPosition(&play, 0)))
+		{
+			break;
+		}
+
+		source->position = play;
+		source->play = play;
+		source->playing = true;
+		source->ended = false;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	SetEvent(m_wake);
+}
+
+void CursorCapture::onSeek(Source* source, DWORD position)
+{
+	EnterCriticalSection(&m_cs);
+	source->position = position;
+	source->play = position;
+	source->ended = false;
+	LeaveCriticalSection(&m_cs);
+}
+
+void CursorCapture::onStop(Source* source)
+{
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		if (!source->playing)
+		{
+			break;
+		}
+
+		DWORD play;
+		if (!source->ended && SUCCEEDED(source->buffer->GetCurrentPosition(&play, 0)))
+		{
+			catchUp(*source, play);
+		}
+
+		source->playing = false;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+}
+
+DWORD WINAPI CursorCapture::threadEntry(LPVOID parameter)
+{
+	__try
+	{
+		CursorCapture* capture = static_cast<CursorCapture*>(parameter);
+
+		for (;;)
+		{
+			WaitForSingleObject(capture->m_wake, capture->run());
+		}
+	}
+	__except(ExceptionHandler::filter("CursorCapture", GetExceptionInformation()))
+	{
+	}
+	return 0;
+}
+
+DWORD CursorCapture::run()
+{
+	DWORD interval = INFINITE;
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		for (size_t i = 0; i < m_sourceCount; ++i)
+		{
+			Source& source = *m_sources[i];
+			if (!source.playing)
+			{
+				continue;
+			}
+
+			DWORD play, write;
+			DWORD status = 0;
+			if (FAILED(source.buffer->GetCurrentPosition(&play, &write)) || FAILED(source.buffer->GetStatus(&status)))
+			{
+				continue;
+			}
+
+			// a buffer played without looping stops by itself at the end
+
+			if (!(status & DSBSTATUS_PLAYING))
+			{
+				if (source.looping)
+				{
+					catchUp(source, play);
+				}
+				else if (!source.ended)
+				{
+					snapshot(source, 0);
+				}
+				source.playing = false;
+				source.voice->onStop(play);
+				continue;
+			}
+
+			source.voice->onUpdate(play);
+
+			// what is left to play was read already, only its stop is still to come
+
+			if (source.ended)
+			{
+				interval = MaxInterval < interval ? MaxInterval : interval;
+				continue;
+			}
+
+			// without looping nothing beyond the end of the buffer plays, and
+			// the write cursor wrapping around only means it has got there
+
+			bool end = !source.looping && (write < source.position);
+			if (end)
+			{
+				write = 0;
+			}
+
+			snapshot(source, write);
+			source.play = play;
+			source.ended = end && !source.position;
+
+			// come back well before the play cursor reaches what has been read
+
+			DWORD lead = (source.position + source.bufferSize - play) % source.bufferSize;
+			DWORD wait = source.bytesPerSecond ? static_cast<DWORD>((ULONGLONG(lead) * 1000) / source.bytesPerSecond / 2) : MinInterval;
+			wait = wait < MinInterval ? MinInterval : (wait > MaxInterval ? MaxInterval : wait);
+
+			interval = wait < interval ? wait : interval;
+		}
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	return interval;
+}
+
+void CursorCapture::catchUp(Source& source, DWORD play)
+{
+	// the rest up to where it stopped was heard, beyond that was not; the
+	// last poll may have read past that already, up to the write cursor
+
+	DWORD heard = (play + source.bufferSize - source.play) % source.bufferSize;
+	DWORD captured = (source.position + source.bufferSize - source.play) % source.bufferSize;
+	if (heard > captured)
+	{
+		snapshot(source, play);
+	}
+}
+
+void CursorCapture::snapshot(Source& source, DWORD end)
+{
+	DWORD size = (end + source.bufferSize - source.position) % source.bufferSize;
+	if (!size)
+	{
+		return;
+	}
+
+	LPVOID audio1, audio2;
+	DWORD bytes1, bytes2;
+	if (FAILED(source.buffer->Lock(source.position, size, &audio1, &bytes1, &audio2, &bytes2, 0)))
+	{
+		return;
+	}
+
+	source.voice->write(audio1, bytes1);
+	if (audio2)
+	{
+		source.voice->write(audio2, bytes2);
+	}
+
+	// nothing was changed, so the same bytes go back
+
+	source.buffer->Unlock(audio1, bytes1, audio2, bytes2);
+
+	source.position = end % source.bufferSize;
+}
+
+}
@@ -0,0 +1,118 @@
+#ifndef dsbridge_CursorCapture_h
+#define dsbridge_CursorCapture_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+#include <audiodefs.h>
+#include <dsound.h>
+
+namespace dsbridge
+{
+
+class Voice;
+
+// Captures buffers by reading their memory as the cursors move, instead of
+// in Unlock, so static and looping buffers that are filled once and then only
+// played are heard too. Everything up to the write cursor is committed and
+// safe to read; anything behind the play cursor may already be overwritten,
+// so the poll interval follows how far ahead of the play cursor capture is.
+
+class CursorCapture
+{
+public:
+	struct Source
+	{
+		Source()
+		: buffer(0)
+		, voice(0)
+		, bufferSize(0)
+		, bytesPerSecond(0)
+		, position(0)
+		, play(0)
+		, playing(false)
+		, looping(false)
+		, ended(false)
+		{}
+
+		LPDIRECTSOUNDBUFFER buffer;
+		Voice* voice;
+		DWORD bufferSize;
+		DWORD bytesPerSecond;
+		DWORD position;
+
+		// the play cursor as of the last poll, which capture is ahead of
+
+		DWORD play;
+		bool playing;
+		bool looping;
+
+		// set once a buffer played without looping has been read to its end,
+		// after which its cursors only point at what was already captured
+
+		bool ended;
+	};
+
+	CursorCapture();
+	~CursorCapture();
+
+	bool create();
+
+	bool add(Source* source);
+	void remove(Source* source);
+
+	void onPlay(Source* source, bool looping);
+	void onSeek(Source* source, DWORD position);
+	void onStop(Source* source);
+
+private:
+
+	enum
+	{
+		MaxSources = 64,
+		MinInterval = 2,
+		MaxInterval = 50
+	};
+
+	static DWORD WINAPI threadEntry(LPVOID parameter);
+
+	DWORD run();
+	void snapshot(Source& source, DWORD end);
+	void catchUp(Source& source, DWORD play);
+
+	CRITICAL_SECTION m_cs;
+	HANDLE m_thread;
+	HANDLE m_wake;
+
+	Source* m_sources[MaxSources];
+	size_t m_sourceCount;
+};
+
+}
+
+#endif
@@ -1,382 +1,575 @@
-/*
-
-Copyright 2009 Jesper Svennevid
-
-Redistribution and use in source and binary forms, with or without
-modification, are permitted provided that the following conditions
-are met:
-
-1. Redistributions of source code must retain the above copyright
-   notice, this list of conditions and the following disclaimer.
-2. Redistributions in binary form must reproduce the above copyright
-   notice, this list of conditions and the following disclaimer in the
-   documentation and/or other materials provided with the distribution.
-
-THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
-IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
-OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
-IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
-INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
-NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
-DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
-THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
-(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
-THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-
-*/
-
-#include "DirectSoundBuffer.h"
-#include "Encoder.h"
-#include "HttpServer.h"
-#include "Configuration.h"
-
-#include <stdio.h>
-
-namespace dsbridge
-{
-
-extern Encoder g_encoder;
-
-class DirectSoundBuffer : public IDirectSoundBuffer
-{
-public:
-	DirectSoundBuffer(LPDIRECTSOUNDBUFFER dsb, const DSBCAPS& caps);
-	~DirectSoundBuffer();
-
-    virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, LPVOID *);
-    virtual ULONG STDMETHODCALLTYPE AddRef();
-    virtual ULONG STDMETHODCALLTYPE Release();
-
-    virtual HRESULT STDMETHODCALLTYPE GetCaps(LPDSBCAPS pDSBufferCaps);
-    virtual HRESULT STDMETHODCALLTYPE GetCurrentPosition(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor);
-    virtual HRESULT STDMETHODCALLTYPE GetFormat(LPWAVEFORMATEX pwfxFormat, DWORD dwSizeAllocated, LPDWORD pdwSizeWritten);
-    virtual HRESULT STDMETHODCALLTYPE GetVolume(LPLONG plVolume);
-    virtual HRESULT STDMETHODCALLTYPE GetPan(LPLONG plPan);
-    virtual HRESULT STDMETHODCALLTYPE GetFrequency(LPDWORD pdwFrequency);
-    virtual HRESULT STDMETHODCALLTYPE GetStatus(LPDWORD pdwStatus);
-    virtual HRESULT STDMETHODCALLTYPE Initialize(LPDIRECTSOUND pDirectSound, LPCDSBUFFERDESC pcDSBufferDesc);
-    virtual HRESULT STDMETHODCALLTYPE Lock(DWORD dwOffset, DWORD dwBytes, LPVOID *ppvAudioPtr1, LPDWORD pdwAudioBytes1,
-                                           LPVOID *ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags);
-    virtual HRESULT STDMETHODCALLTYPE Play(DWORD dwReserved1, DWORD dwPriority, DWORD dwFlags);
-    virtual HRESULT STDMETHODCALLTYPE SetCurrentPosition(DWORD dwNewPosition);
-    virtual HRESULT STDMETHODCALLTYPE SetFormat(LPCWAVEFORMATEX pcfxFormat);
-    virtual HRESULT STDMETHODCALLTYPE SetVolume(LONG lVolume);
-    virtual HRESULT STDMETHODCALLTYPE SetPan(LONG lPan);
-    virtual HRESULT STDMETHODCALLTYPE SetFrequency(DWORD dwFrequency);
-    virtual HRESULT STDMETHODCALLTYPE Stop();
-    virtual HRESULT STDMETHODCALLTYPE Unlock(LPVOID pvAudioPtr1, DWORD dwAudioBytes1, LPVOID pvAudioPtr2, DWORD dwAudioBytes2);
-    virtual HRESULT STDMETHODCALLTYPE Restore();
-
-private:
-
-	struct BufferInfo
-	{
-		BufferInfo()
-		: m_buffer(0)
-		, m_size(0)
-		{}
-
-		LPVOID m_buffer;
-		DWORD m_size;
-	};
-
-	LPDIRECTSOUNDBUFFER m_dsb;
-
-	LPWAVEFORMATEX m_format;
-	DWORD m_formatSize;
-
-	BufferInfo m_internal;
-	BufferInfo m_physical1;
-	BufferInfo m_physical2;
-};
-
-extern Encoder g_encoder;
-
-DirectSoundBuffer::DirectSoundBuffer(LPDIRECTSOUNDBUFFER dsb, const DSBCAPS& caps)
-: m_dsb(dsb)
-, m_format(0)
-, m_formatSize(0)
-{
-	HRESULT hr;
-
-	do
-	{
-		DWORD sizeWritten;
-		hr = dsb->GetFormat(0, 0, &sizeWritten);
-		if (FAILED(hr))
-		{
-			break;
-		}
-
-		char* format = new char[sizeWritten];
-		hr = dsb->GetFormat(reinterpret_cast<LPWAVEFORMATEX>(format), sizeWritten, 0);
-		if (FAILED(hr))
-		{
-			delete [] format;
-			break;
-		}
-
-		m_format = reinterpret_cast<LPWAVEFORMATEX>(format);
-		m_formatSize = sizeWritten;
-
-		g_encoder.setFormat(m_format);
-	}
-	while (0);
-
-	g_encoder.onCreate(caps.dwBufferBytes);
-}
-
-DirectSoundBuffer::~DirectSoundBuffer()
-{
-	delete [] reinterpret_cast<char*>(m_format);
-	delete [] m_internal.m_buffer;
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::QueryInterface(REFIID riid, LPVOID FAR* ppvObj)
-{
-	return m_dsb->QueryInterface(riid, ppvObj);
-}
-
-ULONG STDMETHODCALLTYPE DirectSoundBuffer::AddRef()
-{
-	return m_dsb->AddRef();
-}
-
-ULONG STDMETHODCALLTYPE DirectSoundBuffer::Release()
-{
-	ULONG result = m_dsb->Release();
-	if (!result)
-	{
-		delete this;
-	}
-	return result;
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::GetCaps(LPDSBCAPS pDSBufferCaps)
-{
-	return m_dsb->GetCaps(pDSBufferCaps);
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::GetCurrentPosition(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor)
-{
-	DWORD playCursor, writeCursor;
-	HRESULT hr = m_dsb->GetCurrentPosition(&playCursor, &writeCursor);
-	if (FAILED(hr))
-	{
-		return hr;
-	}
-
-	g_encoder.onUpdate(playCursor);
-
-	if (pdwCurrentPlayCursor)
-	{
-		*pdwCurrentPlayCursor = playCursor;
-	}
-
-	if (pdwCurrentWriteCursor)
-	{
-		*pdwCurrentWriteCursor = writeCursor;
-	}
-
-	return hr;
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::GetFormat(LPWAVEFORMATEX pwfxFormat, DWORD dwSizeAllocated, LPDWORD pdwSizeWritten)
-{
-	return m_dsb->GetFormat(pwfxFormat, dwSizeAllocated, pdwSizeWritten);
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::GetVolume(LPLONG plVolume)
-{
-	return m_dsb->GetVolume(plVolume);
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::GetPan(LPLONG plPan)
-{
-	return m_dsb->GetPan(plPan);
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::GetFrequency(LPDWORD pdwFrequency)
-{
-	return m_dsb->GetFrequency(pdwFrequency);
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::GetStatus(LPDWORD pdwStatus)
-{
-	return m_dsb->GetStatus(pdwStatus);
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::Initialize(LPDIRECTSOUND pDirectSound, LPCDSBUFFERDESC pcDSBufferDesc)
-{
-	return m_dsb->Initialize(pDirectSound, pcDSBufferDesc);
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::Lock(DWORD dwOffset, DWORD dwBytes, LPVOID *ppvAudioPtr1, LPDWORD pdwAudioBytes1,
-                                       LPVOID *ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags)
-{
-	HRESULT hr;
-
-	hr = m_dsb->Lock(dwOffset, dwBytes, ppvAudioPtr1 ? &m_physical1.m_buffer : 0, pdwAudioBytes1 ? &m_physical1.m_size : 0, ppvAudioPtr2 ? &m_physical2.m_buffer : 0, pdwAudioBytes2 ? &m_physical2.m_size : 0, dwFlags);
-	if (FAILED(hr))
-	{
-		return hr;
-	}
-
-	DWORD bufferSize = ((m_physical1.m_size + 15) & ~15) + ((m_physical2.m_size + 15) & ~15);
-	if (m_internal.m_size < bufferSize)
-	{
-		delete [] reinterpret_cast<char*>(m_internal.m_buffer);
-		m_internal.m_buffer = new char[bufferSize];
-		m_internal.m_size = bufferSize;
-	}
-
-	char* curr = static_cast<char*>(m_internal.m_buffer);
-
-	if (ppvAudioPtr1)
-	{
-		(*ppvAudioPtr1) = curr;
-		curr += (m_physical1.m_size + 15) & ~15;
-	}
-
-	if (pdwAudioBytes1)
-	{
-		(*pdwAudioBytes1) = m_physical1.m_size;
-	}
-
-	if (ppvAudioPtr2)
-	{
-		(*ppvAudioPtr2) = curr;
-	}
-
-	if (pdwAudioBytes2)
-	{
-		(*pdwAudioBytes2) = m_physical2.m_size;
-	}
-
-	return hr;
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::Play(DWORD dwReserved1, DWORD dwPriority, DWORD dwFlags)
-{
-	HRESULT result = m_dsb->Play(dwReserved1, dwPriority, dwFlags);
-	if (FAILED(result))
-	{
-		return result;
-	}
-
-	DWORD position;
-	m_dsb->GetCurrentPosition(&position, 0);
-	g_encoder.onPlay(position);
-
-	return result;
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::SetCurrentPosition(DWORD dwNewPosition)
-{
-	return m_dsb->SetCurrentPosition(dwNewPosition);
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::SetFormat(LPCWAVEFORMATEX pcfxFormat)
-{
-	// TODO: update cached format
-	return m_dsb->SetFormat(pcfxFormat);
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::SetVolume(LONG lVolume)
-{
-	return m_dsb->SetVolume(lVolume);
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::SetPan(LONG lPan)
-{
-	return m_dsb->SetPan(lPan);
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::SetFrequency(DWORD dwFrequency)
-{
-	return m_dsb->SetFrequency(dwFrequency);
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::Stop()
-{
-	HRESULT result = m_dsb->Stop();
-	if (FAILED(result))
-	{
-		return result;
-	}
-
-	DWORD position;
-	m_dsb->GetCurrentPosition(&position, 0);
-	g_encoder.onStop(position);
-
-	return result;
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::Unlock(LPVOID pvAudioPtr1, DWORD dwAudioBytes1, LPVOID pvAudioPtr2, DWORD dwAudioBytes2)
-{
-	static bool muteWhenStreaming = Configuration::getInteger("MuteWhenStreaming") > 0;
-	bool isStreaming = HttpServer::isStreaming();
-
-	if (pvAudioPtr1)
-	{
-		if (muteWhenStreaming && isStreaming)
-		{
-			::memset(m_physical1.m_buffer, 0, dwAudioBytes1);
-		}
-		else
-		{
-			::memcpy(m_physical1.m_buffer, pvAudioPtr1, dwAudioBytes1);
-		}
-	}
-
-	if (pvAudioPtr2)
-	{
-		if (muteWhenStreaming && isStreaming)
-		{
-			::memset(m_physical2.m_buffer, 0, dwAudioBytes2);
-		}
-		else
-		{
-			::memcpy(m_physical2.m_buffer, pvAudioPtr2, dwAudioBytes2);
-		}
-	}
-
-	HRESULT hr = m_dsb->Unlock(m_physical1.m_buffer, dwAudioBytes1, m_physical2.m_buffer, dwAudioBytes2);
-
-	if (pvAudioPtr1)
-	{
-		g_encoder.write(pvAudioPtr1, dwAudioBytes1);
-	}
-
-	if (pvAudioPtr2)
-	{
-		g_encoder.write(pvAudioPtr2, dwAudioBytes2);
-	}
-
-	m_physical1 = m_physical2 = BufferInfo();
-
-	DWORD position;
-	m_dsb->GetCurrentPosition(&position, 0);
-	g_encoder.onUpdate(position);
-
-	return hr;
-}
-
-HRESULT STDMETHODCALLTYPE DirectSoundBuffer::Restore()
-{
-	return m_dsb->Restore();
-}
-
-LPDIRECTSOUNDBUFFER createWrapper(LPDIRECTSOUNDBUFFER dsb)
-{
-	DSBCAPS caps;
-	caps.dwSize = sizeof(caps);
-	if (FAILED(dsb->GetCaps(&caps)))
-	{
-		return 0;
-	}
-
-	return reinterpret_cast<LPDIRECTSOUNDBUFFER>(new DirectSoundBuffer(dsb, caps));
-}
-
-}
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "DirectSoundBuffer.h"
+#include "Voice.h"
+#include "Mixer.h"
+#include "CursorCapture.h"
+#include "HttpServer.h"
+#include "Configuration.h"
+#include "Trace.h"
+#include "FlightRecorder.h"
+
+#include <stdio.h>
+
+namespace dsbridge
+{
+
+extern Mixer g_mixer;
+extern CursorCapture g_cursorCapture;
+
+class DirectSoundBuffer : public IDirectSoundBuffer
+{
+public:
+	DirectSoundBuffer(LPDIRECTSOUNDBUFFER dsb, const DSBCAPS& caps);
+	~DirectSoundBuffer();
+
+    virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, LPVOID *);
+    virtual ULONG STDMETHODCALLTYPE AddRef();
+    virtual ULONG STDMETHODCALLTYPE Release();
+
+    virtual HRESULT STDMETHODCALLTYPE GetCaps(LPDSBCAPS pDSBufferCaps);
+    virtual HRESULT STDMETHODCALLTYPE GetCurrentPosition(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor);
+    virtual HRESULT STDMETHODCALLTYPE GetFormat(LPWAVEFORMATEX pwfxFormat, DWORD dwSizeAllocated, LPDWORD pdwSizeWritten);
+    virtual HRESULT STDMETHODCALLTYPE GetVolume(LPLONG plVolume);
+    virtual HRESULT STDMETHODCALLTYPE GetPan(LPLONG plPan);
+    virtual HRESULT STDMETHODCALLTYPE GetFrequency(LPDWORD pdwFrequency);
+    virtual HRESULT STDMETHODCALLTYPE GetStatus(LPDWORD pdwStatus);
+    virtual HRESULT STDMETHODCALLTYPE Initialize(LPDIRECTSOUND pDirectSound, LPCDSBUFFERDESC pcDSBufferDesc);
+    virtual HRESULT STDMETHODCALLTYPE Lock(DWORD dwOffset, DWORD dwBytes, LPVOID *ppvAudioPtr1, LPDWORD pdwAudioBytes1,
+                                           LPVOID *ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags);
+    virtual HRESULT STDMETHODCALLTYPE Play(DWORD dwReserved1, DWORD dwPriority, DWORD dwFlags);
+    virtual HRESULT STDMETHODCALLTYPE SetCurrentPosition(DWORD dwNewPosition);
+    virtual HRESULT STDMETHODCALLTYPE SetFormat(LPCWAVEFORMATEX pcfxFormat);
+    virtual HRESULT STDMETHODCALLTYPE SetVolume(LONG lVolume);
+    virtual HRESULT STDMETHODCALLTYPE SetPan(LONG lPan);
+    virtual HRESULT STDMETHODCALLTYPE SetFrequency(DWORD dwFrequency);
+    virtual HRESULT STDMETHODCALLTYPE Stop();
+    virtual HRESULT STDMETHODCALLTYPE Unlock(LPVOID pvAudioPtr1, DWORD dwAudioBytes1, LPVOID pvAudioPtr2, DWORD dwAudioBytes2);
+    virtual HRESULT STDMETHODCALLTYPE Restore();
+
+private:
+
+	struct BufferInfo
+	{
+		BufferInfo()
+		: m_buffer(0)
+		, m_size(0)
+		{}
+
+		LPVOID m_buffer;
+		DWORD m_size;
+	};
+
+	void detach();
+
+	LPDIRECTSOUNDBUFFER m_dsb;
+	bool m_primary;
+	bool m_voiceCreated;
+	bool m_mixed;
+	bool m_directLock;
+	bool m_cursorCapture;
+
+	Voice m_voice;
+	CursorCapture::Source m_source;
+
+	LPWAVEFORMATEX m_format;
+	DWORD m_formatSize;
+
+	BufferInfo m_internal;
+	BufferInfo m_physical1;
+	BufferInfo m_physical2;
+};
+
+DirectSoundBuffer::DirectSoundBuffer(LPDIRECTSOUNDBUFFER dsb, const DSBCAPS& caps)
+: m_dsb(dsb)
+, m_primary((caps.dwFlags & DSBCAPS_PRIMARYBUFFER) != 0)
+, m_voiceCreated(false)
+, m_mixed(false)
+, m_directLock(Configuration::getBool("DirectLock", true))
+, m_cursorCapture(false)
+, m_format(0)
+, m_formatSize(0)
+{
+	HRESULT hr;
+
+	do
+	{
+		DWORD sizeWritten;
+		hr = dsb->GetFormat(0, 0, &sizeWritten);
+		if (FAILED(hr))
+		{
+			break;
+		}
+
+		char* format = new char[sizeWritten];
+		hr = dsb->GetFormat(reinterpret_cast<LPWAVEFORMATEX>(format), sizeWritten, 0);
+		if (FAILED(hr))
+		{
+			delete [] format;
+			break;
+		}
+
+		m_format = reinterpret_cast<LPWAVEFORMATEX>(format);
+		m_formatSize = sizeWritten;
+	}
+	while (0);
+
+	FlightRecorder::record(FlightRecorder::BufferCreated, caps.dwBufferBytes, m_format ? m_format->nSamplesPerSec : 0, m_format ? (m_format->nChannels << 16) | m_format->wBitsPerSample : 0);
+
+	// games play the primary buffer for the whole session, so it only joins
+	// the mix once the application writes to it, or it would never go idle
+
+	m_voiceCreated = m_voice.create(m_format, caps.dwBufferBytes);
+	if (m_voiceCreated && !m_primary)
+	{
+		m_mixed = g_mixer.add(&m_voice);
+	}
+
+	// the primary buffer cannot be locked unless the application mixes itself
+
+	static bool cursorCapture = Configuration::getBool("CursorCapture");
+	if (cursorCapture && !m_primary && m_mixed)
+	{
+		m_source.buffer = dsb;
+		m_source.voice = &m_voice;
+		m_source.bufferSize = caps.dwBufferBytes;
+		m_source.bytesPerSecond = m_format ? m_format->nAvgBytesPerSec : 0;
+
+		m_cursorCapture = g_cursorCapture.add(&m_source);
+		m_directLock = m_directLock || m_cursorCapture;
+	}
+}
+
+DirectSoundBuffer::~DirectSoundBuffer()
+{
+	detach();
+
+	delete [] reinterpret_cast<char*>(m_format);
+	delete [] reinterpret_cast<char*>(m_internal.m_buffer);
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::QueryInterface(REFIID riid, LPVOID FAR* ppvObj)
+{
+	return m_dsb->QueryInterface(riid, ppvObj);
+}
+
+ULONG STDMETHODCALLTYPE DirectSoundBuffer::AddRef()
+{
+	return m_dsb->AddRef();
+}
+
+ULONG STDMETHODCALLTYPE DirectSoundBuffer::Release()
+{
+	// the cursor capture and mixer threads stop using the buffer before the
+	// last reference to it goes, not after
+
+	ULONG references = m_dsb->AddRef() - 1;
+	m_dsb->Release();
+	if (references == 1)
+	{
+		detach();
+	}
+
+	ULONG result = m_dsb->Release();
+	if (!result)
+	{
+		delete this;
+	}
+	return result;
+}
+
+void DirectSoundBuffer::detach()
+{
+	if (m_cursorCapture)
+	{
+		g_cursorCapture.remove(&m_source);
+		m_cursorCapture = false;
+	}
+
+	if (m_mixed)
+	{
+		g_mixer.remove(&m_voice);
+		m_mixed = false;
+	}
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::GetCaps(LPDSBCAPS pDSBufferCaps)
+{
+	return m_dsb->GetCaps(pDSBufferCaps);
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::GetCurrentPosition(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor)
+{
+	DSBRIDGE_TRACECALL(__FUNCTION__);
+
+	DWORD playCursor, writeCursor;
+	HRESULT hr = m_dsb->GetCurrentPosition(&playCursor, &writeCursor);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	m_voice.onUpdate(playCursor);
+
+	if (pdwCurrentPlayCursor)
+	{
+		*pdwCurrentPlayCursor = playCursor;
+	}
+
+	if (pdwCurrentWriteCursor)
+	{
+		*pdwCurrentWriteCursor = writeCursor;
+	}
+
+	return hr;
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::GetFormat(LPWAVEFORMATEX pwfxFormat, DWORD dwSizeAllocated, LPDWORD pdwSizeWritten)
+{
+	return m_dsb->GetFormat(pwfxFormat, dwSizeAllocated, pdwSizeWritten);
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::GetVolume(LPLONG plVolume)
+{
+	return m_dsb->GetVolume(plVolume);
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::GetPan(LPLONG plPan)
+{
+	return m_dsb->GetPan(plPan);
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::GetFrequency(LPDWORD pdwFrequency)
+{
+	return m_dsb->GetFrequency(pdwFrequency);
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::GetStatus(LPDWORD pdwStatus)
+{
+	return m_dsb->GetStatus(pdwStatus);
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::Initialize(LPDIRECTSOUND pDirectSound, LPCDSBUFFERDESC pcDSBufferDesc)
+{
+	return m_dsb->Initialize(pDirectSound, pcDSBufferDesc);
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::Lock(DWORD dwOffset, DWORD dwBytes, LPVOID *ppvAudioPtr1, LPDWORD pdwAudioBytes1,
+                                       LPVOID *ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags)
+{
+	DSBRIDGE_TRACECALL(__FUNCTION__);
+
+	// the application writes straight into the real buffer, and Unlock
+	// captures from there, so its data is copied once instead of three times
+
+	if (m_directLock)
+	{
+		return m_dsb->Lock(dwOffset, dwBytes, ppvAudioPtr1, pdwAudioBytes1, ppvAudioPtr2, pdwAudioBytes2, dwFlags);
+	}
+
+	HRESULT hr;
+
+	hr = m_dsb->Lock(dwOffset, dwBytes, ppvAudioPtr1 ? &m_physical1.m_buffer : 0, pdwAudioBytes1 ? &m_physical1.m_size : 0, ppvAudioPtr2 ? &m_physical2.m_buffer : 0, pdwAudioBytes2 ? &m_physical2.m_size : 0, dwFlags);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	DWORD bufferSize = ((m_physical1.m_size + 15) & ~15) + ((m_physical2.m_size + 15) & ~15);
+	if (m_internal.m_size < bufferSize)
+	{
+		delete [] reinterpret_cast<char*>(m_internal.m_buffer);
+		m_internal.m_buffer = new char[bufferSize];
+		m_internal.m_size = bufferSize;
+	}
+
+	char* curr = static_cast<char*>(m_internal.m_buffer);
+
+	if (ppvAudioPtr1)
+	{
+		(*ppvAudioPtr1) = curr;
+		curr += (m_physical1.m_size + 15) & ~15;
+	}
+
+	if (pdwAudioBytes1)
+	{
+		(*pdwAudioBytes1) = m_physical1.m_size;
+	}
+
+	if (ppvAudioPtr2)
+	{
+		(*ppvAudioPtr2) = curr;
+	}
+
+	if (pdwAudioBytes2)
+	{
+		(*pdwAudioBytes2) = m_physical2.m_size;
+	}
+
+	return hr;
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::Play(DWORD dwReserved1, DWORD dwPriority, DWORD dwFlags)
+{
+	DSBRIDGE_TRACECALL(__FUNCTION__);
+
+	HRESULT result = m_dsb->Play(dwReserved1, dwPriority, dwFlags);
+	if (FAILED(result))
+	{
+		return result;
+	}
+
+	DWORD position;
+	m_dsb->GetCurrentPosition(&position, 0);
+	m_voice.onPlay(position);
+
+	if (m_cursorCapture)
+	{
+		g_cursorCapture.onPlay(&m_source, (dwFlags & DSBPLAY_LOOPING) != 0);
+	}
+
+	return result;
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::SetCurrentPosition(DWORD dwNewPosition)
+{
+	DSBRIDGE_TRACECALL(__FUNCTION__);
+
+	HRESULT hr = m_dsb->SetCurrentPosition(dwNewPosition);
+	if (SUCCEEDED(hr))
+	{
+		m_voice.onSeek(dwNewPosition);
+	}
+
+	if (SUCCEEDED(hr) && m_cursorCapture)
+	{
+		g_cursorCapture.onSeek(&m_source, dwNewPosition);
+	}
+
+	return hr;
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::SetFormat(LPCWAVEFORMATEX pcfxFormat)
+{
+	DSBRIDGE_TRACECALL(__FUNCTION__);
+
+	HRESULT hr = m_dsb->SetFormat(pcfxFormat);
+
+	FlightRecorder::record(FlightRecorder::FormatChanged, pcfxFormat ? pcfxFormat->nSamplesPerSec : 0, pcfxFormat ? (pcfxFormat->nChannels << 16) | pcfxFormat->wBitsPerSample : 0, hr);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	m_voice.setFormat(pcfxFormat);
+
+	// the primary buffer format is the rate the application mixes for
+
+	if (m_primary)
+	{
+		g_mixer.setSampleRate(pcfxFormat->nSamplesPerSec);
+	}
+
+	return hr;
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::SetVolume(LONG lVolume)
+{
+	DSBRIDGE_TRACECALL(__FUNCTION__);
+
+	HRESULT hr = m_dsb->SetVolume(lVolume);
+	if (SUCCEEDED(hr))
+	{
+		m_voice.setVolume(lVolume);
+	}
+
+	return hr;
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::SetPan(LONG lPan)
+{
+	DSBRIDGE_TRACECALL(__FUNCTION__);
+
+	HRESULT hr = m_dsb->SetPan(lPan);
+	if (SUCCEEDED(hr))
+	{
+		m_voice.setPan(lPan);
+	}
+
+	return hr;
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::SetFrequency(DWORD dwFrequency)
+{
+	DSBRIDGE_TRACECALL(__FUNCTION__);
+
+	HRESULT hr = m_dsb->SetFrequency(dwFrequency);
+	if (SUCCEEDED(hr))
+	{
+		m_voice.setFrequency(dwFrequency);
+	}
+
+	return hr;
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::Stop()
+{
+	DSBRIDGE_TRACECALL(__FUNCTION__);
+
+	HRESULT result = m_dsb->Stop();
+	if (FAILED(result))
+	{
+		return result;
+	}
+
+	if (m_cursorCapture)
+	{
+		g_cursorCapture.onStop(&m_source);
+	}
+
+	DWORD position;
+	m_dsb->GetCurrentPosition(&position, 0);
+	m_voice.onStop(position);
+
+	return result;
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::Unlock(LPVOID pvAudioPtr1, DWORD dwAudioBytes1, LPVOID pvAudioPtr2, DWORD dwAudioBytes2)
+{
+	DSBRIDGE_TRACECALL(__FUNCTION__);
+
+	if (m_voiceCreated && !m_mixed && m_primary)
+	{
+		m_mixed = g_mixer.add(&m_voice);
+	}
+
+	bool muteWhenStreaming = Configuration::getBool("MuteWhenStreaming");
+	bool isStreaming = HttpServer::isStreaming();
+
+	if (m_directLock)
+	{
+		// the locked memory is only valid until the real buffer is unlocked
+
+		if (pvAudioPtr1 && !m_cursorCapture)
+		{
+			m_voice.write(pvAudioPtr1, dwAudioBytes1);
+		}
+
+		if (pvAudioPtr2 && !m_cursorCapture)
+		{
+			m_voice.write(pvAudioPtr2, dwAudioBytes2);
+		}
+
+		// a buffer captured by its cursors still has to be read back, so it is never muted
+
+		if (muteWhenStreaming && isStreaming && !m_cursorCapture)
+		{
+			if (pvAudioPtr1)
+			{
+				::memset(pvAudioPtr1, 0, dwAudioBytes1);
+			}
+
+			if (pvAudioPtr2)
+			{
+				::memset(pvAudioPtr2, 0, dwAudioBytes2);
+			}
+		}
+
+		HRESULT hr = m_dsb->Unlock(pvAudioPtr1, dwAudioBytes1, pvAudioPtr2, dwAudioBytes2);
+
+		DWORD position;
+		m_dsb->GetCurrentPosition(&position, 0);
+		m_voice.onUpdate(position);
+
+		return hr;
+	}
+
+	if (pvAudioPtr1)
+	{
+		if (muteWhenStreaming && isStreaming)
+		{
+			::memset(m_physical1.m_buffer, 0, dwAudioBytes1);
+		}
+		else
+		{
+			::memcpy(m_physical1.m_buffer, pvAudioPtr1, dwAudioBytes1);
+		}
+	}
+
+	if (pvAudioPtr2)
+	{
+		if (muteWhenStreaming && isStreaming)
+		{
+			::memset(m_physical2.m_buffer, 0, dwAudioBytes2);
+		}
+		else
+		{
+			::memcpy(m_physical2.m_buffer, pvAudioPtr2, dwAudioBytes2);
+		}
+	}
+
+	HRESULT hr = m_dsb->Unlock(m_physical1.m_buffer, dwAudioBytes1, m_physical2.m_buffer, dwAudioBytes2);
+
+	if (pvAudioPtr1)
+	{
+		m_voice.write(pvAudioPtr1, dwAudioBytes1);
+	}
+
+	if (pvAudioPtr2)
+	{
+		m_voice.write(pvAudioPtr2, dwAudioBytes2);
+	}
+
+	m_physical1 = m_physical2 = BufferInfo();
+
+	DWORD position;
+	m_dsb->GetCurrentPosition(&position, 0);
+	m_voice.onUpdate(position);
+
+	return hr;
+}
+
+HRESULT STDMETHODCALLTYPE DirectSoundBuffer::Restore()
+{
+	return m_dsb->Restore();
+}
+
+LPDIRECTSOUNDBUFFER createWrapper(LPDIRECTSOUNDBUFFER dsb)
+{
+	DSBCAPS caps;
+	caps.dwSize = sizeof(caps);
+	if (FAILED(dsb->GetCaps(&caps)))
+	{
+		return 0;
+	}
+
+	return reinterpret_cast<LPDIRECTSOUNDBUFFER>(new DirectSoundBuffer(dsb, caps));
+}
+
+}
@@ -1,374 +1,457 @@
-/*
-
-Copyright 2009 Jesper Svennevid
-
-Redistribution and use in source and binary forms, with or without
-modification, are permitted provided that the following conditions
-are met:
-
-1. Redistributions of source code must retain the above copyright
-   notice, this list of conditions and the following disclaimer.
-2. Redistributions in binary form must reproduce the above copyright
-   notice, this list of conditions and the following disclaimer in the
-   documentation and/or other materials provided with the distribution.
-
-THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
-IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
-OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
-IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
-INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
-NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
-DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
-THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
-(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
-THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-
-*/
-
-#include "Encoder.h"
-#include "HttpServer.h"
-#include "Notify.h"
-#include "ExceptionHandler.h"
-#include "Configuration.h"
-
-#include <stdio.h>
-
-namespace dsbridge
-{
-
-extern HttpServer g_httpServer;
-
-Encoder::Encoder()
-: m_playing(false)
-, m_destroyed(false)
-, m_raw(0)
-, m_current(0)
-, m_goal(0)
-, m_bufferSize(0)
-{
-	InitializeCriticalSection(&m_cs);
-}
-
-Encoder::~Encoder()
-{
-}
-
-bool Encoder::create()
-{
-	if (!m_buffer.create(1024 * 1024))
-	{
-		Notify::update(Notify::Encoder, Notify::Error, "Could not create ringbuffer");
-		return false;
-	}
-
-	m_module = LoadLibrary("lame_enc.dll");
-	if (!m_module)
-	{
-		Notify::update(Notify::Encoder, Notify::Error, "Could not load lame_enc.dll");
-		return false;
-	}
-
-	BEINITSTREAM beInitStream = reinterpret_cast<BEINITSTREAM>(GetProcAddress(m_module, "beInitStream"));
-	if (!beInitStream)
-	{
-		Notify::update(Notify::Encoder, Notify::Error, "Could not resolve beInitStream()");
-		return false;
-	}
-
-	BE_CONFIG init;
-	memset(&init, 0, sizeof(init));
-	init.dwConfig = BE_CONFIG_LAME;
-	init.format.LHV1.dwStructVersion = 1;
-	init.format.LHV1.dwStructSize = sizeof(init);
-	init.format.LHV1.dwSampleRate = 44100;
-	init.format.LHV1.dwReSampleRate = 0;
-	init.format.LHV1.nMode = BE_MP3_MODE_JSTEREO;
-	init.format.LHV1.dwBitrate = init.format.LHV1.dwMaxBitrate = Configuration::getInteger("MP3BitRate", 192);
-	init.format.LHV1.nPreset = LQP_NOPRESET;
-	init.format.LHV1.bCopyright = false;
-	init.format.LHV1.bCRC = false;
-	init.format.LHV1.bOriginal = false;
-	init.format.LHV1.bPrivate = false;
-	init.format.LHV1.bWriteVBRHeader = false;
-	init.format.LHV1.bEnableVBR = false;
-	init.format.LHV1.nVBRQuality = 0;
-	init.format.LHV1.dwVbrAbr_bps = 0;
-	init.format.LHV1.bNoRes = false;
-	BE_ERR result = beInitStream(&init, &m_samples, &m_outputSize, &m_stream);
-	if (result != BE_ERR_SUCCESSFUL)
-	{
-		Notify::update(Notify::Encoder, Notify::Error, "beInitStream() failed - %08x", result);
-		return false;
-	}
-
-	m_outputBuffer = new BYTE[m_outputSize];
-	m_inputBuffer = new BYTE[m_samples * 2 * 2];
-
-	m_thread = CreateThread(0, 0, threadEntry, this, CREATE_SUSPENDED, 0);
-	if(!m_thread)
-	{
-		Notify::update(Notify::Encoder, Notify::Error, "Could not create thread");
-		return false;
-	}
-
-	ResumeThread(m_thread);
-	return true;
-}
-
-void Encoder::setFormat(LPWAVEFORMATEX format)
-{
-	EnterCriticalSection(&m_cs);
-
-	do
-	{
-		// TODO: configure resampling / channel mixing
-/*
-		char buf[1024];
-		sprintf_s(buf, sizeof(buf),
-		"wFormatTag: %d\n"
-		"nChannels: %d\n"
-		"nSamplesPerSec: %d\n"
-		"nAvgBytesPerSec: %d\n"
-		"nBlockAlign: %d\n"
-		"wBitsPerSample: %d\n"
-		"cbSize: %d\n",
-		format->wFormatTag,
-		format->nChannels,
-		format->nSamplesPerSec,
-		format->nAvgBytesPerSec,
-		format->nBlockAlign,
-		format->wBitsPerSample,
-		format->cbSize);
-
-		MessageBox(0, buf, "DirectSound Bridge", MB_ICONERROR|MB_OK);
-*/
-	}
-	while (0);
-
-	LeaveCriticalSection(&m_cs);
-}
-
-void Encoder::write(const void* buffer, size_t count)
-{
-	EnterCriticalSection(&m_cs);
-
-	do
-	{
-		m_buffer.write(buffer, count);
-	}
-	while (0);
-
-	LeaveCriticalSection(&m_cs);
-}
-
-void Encoder::onCreate(DWORD bufferSize)
-{
-	EnterCriticalSection(&m_cs);
-	do
-	{
-		m_playing = false;
-		m_destroyed = false;
-		m_raw = 0;
-		m_current = 0;
-		m_goal = 0;
-		m_bufferSize = bufferSize;
-		m_lastTimer.QuadPart = 0;
-	}
-	while (0);
-	LeaveCriticalSection(&m_cs);
-}
-
-void Encoder::onPlay(DWORD position)
-{
-	EnterCriticalSection(&m_cs);
-	do
-	{
-		if (!m_playing)
-		{
-			QueryPerformanceCounter(&m_lastTimer);
-			m_playing = true;
-		}
-
-		updatePosition(position);
-	}
-	while (0);
-	LeaveCriticalSection(&m_cs);
-}
-
-void Encoder::onStop(DWORD position)
-{
-	EnterCriticalSection(&m_cs);
-	do
-	{
-		if (m_playing)
-		{
-			updatePosition(position);
-		}
-		m_playing = false;
-	}
-	while (0);
-	LeaveCriticalSection(&m_cs);
-
-	onDestroy();
-}
-
-void Encoder::onUpdate(DWORD position)
-{
-	EnterCriticalSection(&m_cs);
-	do
-	{
-		if (m_playing)
-		{
-			updatePosition(position);
-		}
-	}
-	while (0);
-	LeaveCriticalSection(&m_cs);
-}
-
-void Encoder::onDestroy()
-{
-	EnterCriticalSection(&m_cs);
-	do
-	{
-		m_destroyed = true;
-
-		// TODO: use a waitable object instead
-
-		while (m_buffer.written() > (m_goal - m_current))
-		{
-			LeaveCriticalSection(&m_cs);
-			SleepEx(10, TRUE);
-			EnterCriticalSection(&m_cs);
-		}
-
-		m_raw = 0;
-		m_goal -= m_current;
-		m_current = 0;
-
-		m_playing = false;
-		m_destroyed = false;
-	}
-	while (0);
-	LeaveCriticalSection(&m_cs);
-}
-
-DWORD WINAPI Encoder::threadEntry(LPVOID parameter)
-{
-	__try
-	{
-		Notify::update(Notify::Encoder, Notify::Info, "Started");
-		Encoder* encoder = static_cast<Encoder*>(parameter);
-
-		while (encoder->run())
-		{
-			SleepEx(1, TRUE);
-		}
-
-		Notify::update(Notify::Encoder, Notify::Info, "Stopped");
-	}
-	__except(ExceptionHandler::filter("Encoder", GetExceptionInformation()))
-	{
-	}
-	return 0;
-}
-
-bool Encoder::run()
-{
-	for (;;)
-	{
-		bool done = false;
-		EnterCriticalSection(&m_cs);
-		do
-		{
-			size_t readMax = (m_goal - m_current);
-			size_t readNeeded = m_samples * 2;
-			size_t readAvailable = m_buffer.written();
-
-			readAvailable = readMax < readAvailable ? readMax : readAvailable;
-
-			if (m_destroyed)
-			{
-				if (readAvailable < readNeeded)
-				{
-					m_buffer.discard(m_buffer.written() - readMax);
-					done = true;
-					break;
-				}
-			}
-
-
-			if (readAvailable < readNeeded)
-			{
-				done = true;
-				break;
-			}
-
-			m_buffer.read(m_inputBuffer, readNeeded);
-
-			m_current += readNeeded;
-		}
-		while (0);
-		LeaveCriticalSection(&m_cs);
-
-		if (done)
-		{
-			break;
-		}
-
-		DWORD bytesWritten;
-		static BEENCODECHUNK beEncodeChunk = reinterpret_cast<BEENCODECHUNK>(GetProcAddress(m_module, "beEncodeChunk"));
-		if (!beEncodeChunk)
-		{
-			Notify::update(Notify::Encoder, Notify::Error, "Could not resolve beEncodeChunk()");
-			return false;
-		}
-		BE_ERR result = beEncodeChunk(m_stream, m_samples, (PSHORT)m_inputBuffer, m_outputBuffer, &bytesWritten);
-		if (result != BE_ERR_SUCCESSFUL)
-		{
-			Notify::update(Notify::Encoder, Notify::Warning, "beEncodeChunk() failed - %08x", result);
-			break;
-		}
-
-		g_httpServer.write(m_outputBuffer, bytesWritten);
-	}
-
-	return true;
-}
-
-void Encoder::updatePosition(DWORD position)
-{
-	static int useOldEncodingLimiter = Configuration::getInteger("UseOldEncodingLimiter");
-	if (useOldEncodingLimiter)
-	{
-		DWORD actual = position;
-		if (position < m_raw)
-		{
-			actual += m_bufferSize;
-		}
-
-		m_goal += actual - m_raw;
-	}
-	else
-	{
-		LARGE_INTEGER currTimer;
-		QueryPerformanceCounter(&currTimer);
-
-		if (m_playing)
-		{
-			LARGE_INTEGER freq;
-			QueryPerformanceFrequency(&freq);
-
-			double delta = (currTimer.QuadPart - m_lastTimer.QuadPart) / static_cast<double>(freq.QuadPart);
-			DWORD spent = static_cast<DWORD>(delta * 44100);
-
-			m_goal += spent * (2*2);
-		}
-
-		m_lastTimer = currTimer;
-	}
-
-	m_raw = position;
-}
-
-}
\ No newline at end of file
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Encoder.h"
+#include "Mount.h"
+#include "Notify.h"
+#include "ExceptionHandler.h"
+#include "FlightRecorder.h"
+#include "Configuration.h"
+
+#include <stdio.h>
+
+namespace dsbridge
+{
+
+extern Capture g_capture;
+
+Encoder::Encoder()
+: m_mount(0)
+, m_backend(0)
+, m_thread(0)
+, m_worker(0)
+, m_rate(0)
+, m_quality(Resampler::Medium)
+, m_staging(0)
+, m_fifo(0)
+, m_fifoFrames(0)
+, m_fifoCapacity(0)
+, m_idle(true)
+, m_ended(false)
+, m_startPending(false)
+, m_preRoll(0)
+, m_lowLatency(0)
+, m_heartbeat(0)
+, m_reconfigure(0)
+{
+}
+
+Encoder::~Encoder()
+{
+}
+
+bool Encoder::create(Mount& mount)
+{
+	m_mount = &mount;
+
+	m_backend = EncoderBackend::create(mount.name());
+	if (!m_backend)
+	{
+		return false;
+	}
+
+	m_reader.chunkSize = m_backend->chunkSize();
+	m_staging = new BYTE[m_reader.chunkSize];
+	m_rate = m_backend->sampleRate();
+
+	int quality = Mount::getInteger(mount.name(), "ResampleQuality", Resampler::Medium);
+	m_quality = static_cast<Resampler::Quality>(quality < Resampler::Low ? Resampler::Low : (quality > Resampler::High ? Resampler::High : quality));
+
+	// audio kept around while idle, so a new listener gets a burst right away;
+	// a low-latency mount keeps less, as the burst would only be skipped
+
+	int lowLatency = Mount::getInteger(mount.name(), "LowLatency", 0);
+	m_lowLatency = lowLatency > 0 ? lowLatency : 0;
+	m_preRoll = Mount::getInteger(mount.name(), "PreRoll", m_lowLatency ? m_lowLatency / 2 : 500);
+
+	if (!g_capture.addReader(&m_reader))
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "Too many mounts");
+		return false;
+	}
+
+	Configuration::subscribe("MP3BitRate", settingsChanged, this);
+	Configuration::subscribe("OpusBitRate", settingsChanged, this);
+
+	return true;
+}
+
+bool Encoder::start(DWORD processor)
+{
+	m_worker = new Worker;
+	m_worker->encoder = this;
+	m_worker->backend = m_backend;
+	m_worker->state = Idle;
+
+	m_thread = CreateThread(0, 0, threadEntry, m_worker, CREATE_SUSPENDED, 0);
+	if(!m_thread)
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "Could not create thread");
+		return false;
+	}
+
+	// mounts encode in parallel, so spread them over the available cores
+
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	SetThreadIdealProcessor(m_thread, processor % info.dwNumberOfProcessors);
+
+	ResumeThread(m_thread);
+	return true;
+}
+
+bool Encoder::restart()
+{
+	// a thread stuck anywhere but the codec cannot be left behind
+
+	if (!m_worker || (m_worker->state != Encoding))
+	{
+		return false;
+	}
+
+	EncoderBackend* backend = EncoderBackend::create(m_mount->name());
+	if (!backend)
+	{
+		return false;
+	}
+
+	Worker* worker = new Worker;
+	worker->encoder = this;
+	worker->backend = backend;
+	worker->state = Idle;
+
+	if (InterlockedCompareExchange(&m_worker->state, Abandoned, Encoding) != Encoding)
+	{
+		delete worker;
+		delete backend;
+		return false;
+	}
+
+	// the stuck thread keeps its worker, and frees it if it ever comes back;
+	// the new one starts from a fresh codec stream
+
+	m_worker = worker;
+	m_backend = backend;
+	m_fifoFrames = 0;
+	m_idle = true;
+
+	CloseHandle(m_thread);
+	m_thread = CreateThread(0, 0, threadEntry, worker, 0, 0);
+	if (!m_thread)
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "Could not create thread");
+		return false;
+	}
+
+	return true;
+}
+
+void Encoder::settingsChanged(void* context)
+{
+	InterlockedExchange(&static_cast<Encoder*>(context)->m_reconfigure, 1);
+}
+
+DWORD WINAPI Encoder::threadEntry(LPVOID parameter)
+{
+	__try
+	{
+		Notify::update(Notify::Encoder, Notify::Info, "Started");
+		Worker* worker = static_cast<Worker*>(parameter);
+
+		while (worker->encoder->run(*worker))
+		{
+			SleepEx(1, TRUE);
+		}
+
+		// only an abandoned worker ever stops, and nothing refers to it any more
+
+		delete worker->backend;
+		delete worker;
+
+		Notify::update(Notify::Encoder, Notify::Info, "Stopped");
+	}
+	__except(ExceptionHandler::filter("Encoder", GetExceptionInformation()))
+	{
+	}
+	return 0;
+}
+
+bool Encoder::run(Worker& worker)
+{
+	for (;;)
+	{
+		m_heartbeat = m_heartbeat + 1;
+
+		// nobody is listening, so let the capture move on without encoding
+
+		if (!m_mount->listeners())
+		{
+			size_t preRoll = static_cast<size_t>(m_preRoll) * g_capture.sampleRate() / 1000 * 4;
+			g_capture.skip(m_reader, preRoll - (preRoll % m_reader.chunkSize));
+			m_idle = true;
+			break;
+		}
+
+		if (m_idle)
+		{
+			if (!m_backend->start())
+			{
+				FlightRecorder::record(FlightRecorder::EncodeError, m_mount->index(), 0);
+				break;
+			}
+
+			if (m_resampler.inputRate())
+			{
+				m_resampler.reset();
+			}
+			m_fifoFrames = 0;
+
+			m_idle = false;
+			m_startPending = true;
+		}
+
+		const BYTE* output;
+		DWORD bytesWritten;
+		if (m_backend->output(output, bytesWritten))
+		{
+			if (!bytesWritten)
+			{
+				continue;
+			}
+
+			m_timestamps.encoded = Latency::now();
+			Latency::record(Latency::Encode, m_timestamps.read, m_timestamps.encoded);
+
+			m_mount->write(output, bytesWritten, m_timestamps);
+
+			if (m_startPending)
+			{
+				LARGE_INTEGER now, freq;
+				QueryPerformanceCounter(&now);
+				QueryPerformanceFrequency(&freq);
+
+				double latency = ((now.QuadPart - m_mount->connectTime().QuadPart) * 1000.0) / freq.QuadPart;
+				m_mount->setStartLatency(latency);
+				m_startPending = false;
+
+				Notify::update(Notify::Encoder, Notify::Info, "%s started in %d ms", m_mount->path(), static_cast<int>(latency));
+			}
+			continue;
+		}
+
+		// everything encoded so far is out, so the codec is between frames
+
+		if (m_reconfigure && InterlockedExchange(&m_reconfigure, 0))
+		{
+			if (!m_backend->reconfigure(m_mount->name()))
+			{
+				Notify::update(Notify::Encoder, Notify::Warning, "%s cannot change codec settings until restarted", m_mount->path());
+			}
+			continue;
+		}
+
+		// a low-latency mount drops what it fell behind on instead of carrying
+		// the delay on to every listener
+
+		if (m_lowLatency)
+		{
+			trim();
+		}
+
+		void* input = m_backend->input();
+		if (!input || !fill(input))
+		{
+			// the mix ended, and so does the stream once listeners have
+			// everything encoded up to here
+
+			if (input && !m_ended && g_capture.ended(m_reader))
+			{
+				m_mount->end();
+				m_ended = true;
+			}
+			break;
+		}
+
+		m_ended = false;
+
+		LARGE_INTEGER begin, end, freq;
+		QueryPerformanceCounter(&begin);
+
+		InterlockedExchange(&worker.state, Encoding);
+
+		bool encoded = worker.backend->encode();
+
+		// the watchdog gave up on this thread while it was in the codec, and
+		// another one has taken over with a worker of its own
+
+		if (InterlockedCompareExchange(&worker.state, Idle, Encoding) == Abandoned)
+		{
+			return false;
+		}
+
+		if (!encoded)
+		{
+			FlightRecorder::record(FlightRecorder::EncodeError, m_mount->index(), 1);
+			break;
+		}
+
+		QueryPerformanceCounter(&end);
+		QueryPerformanceFrequency(&freq);
+
+		DWORD busy = static_cast<DWORD>(((end.QuadPart - begin.QuadPart) * 1000000) / freq.QuadPart);
+		m_chunks.add(1);
+		m_busy.add(busy);
+
+		FlightRecorder::record(FlightRecorder::EncodeTime, m_mount->index(), busy);
+	}
+
+	return true;
+}
+
+bool Encoder::fill(void* input)
+{
+	size_t frames = m_reader.chunkSize / (2 * 2);
+
+	while (m_fifoFrames < frames)
+	{
+		// straight into the codec when nothing is buffered and no conversion is needed
+
+		bool direct = !m_fifoFrames && (m_rate == m_backend->sampleRate());
+		PBYTE buffer = direct ? static_cast<PBYTE>(input) : m_staging;
+
+		size_t size = g_capture.read(m_reader, buffer);
+		if (!size)
+		{
+			return false;
+		}
+
+		m_reader.timestamps.read = Latency::now();
+		Latency::record(Latency::Capture, m_reader.timestamps.mixed, m_reader.timestamps.read);
+
+		if (direct && (size == m_reader.chunkSize) && (m_reader.sampleRate == m_rate))
+		{
+			m_timestamps = m_reader.timestamps;
+			return true;
+		}
+
+		if (!m_fifoFrames)
+		{
+			m_fifoTimestamps = m_reader.timestamps;
+		}
+
+		if ((m_reader.sampleRate != m_rate) && !setRate(m_reader.sampleRate))
+		{
+			return false;
+		}
+
+		size_t count = size / (2 * 2);
+		if (m_rate == m_backend->sampleRate())
+		{
+			reserve(m_fifoFrames + count);
+			::memcpy(m_fifo + m_fifoFrames * 2, buffer, size);
+			m_fifoFrames += count;
+		}
+		else
+		{
+			reserve(m_fifoFrames + m_resampler.maxOutput(count));
+			m_fifoFrames += m_resampler.process(reinterpret_cast<const short*>(buffer), count, m_fifo + m_fifoFrames * 2);
+		}
+	}
+
+	::memcpy(input, m_fifo, m_reader.chunkSize);
+	m_fifoFrames -= frames;
+	::memmove(m_fifo, m_fifo + frames * 2, m_fifoFrames * 2 * sizeof(short));
+
+	// what is left over came from the tail of the last read
+
+	m_timestamps = m_fifoTimestamps;
+	m_fifoTimestamps = m_reader.timestamps;
+
+	return true;
+}
+
+void Encoder::trim()
+{
+	// a quarter of the target may wait in the capture, but never less than
+	// the chunk the codec needs
+
+	size_t keep = static_cast<size_t>(m_lowLatency) * g_capture.sampleRate() / 4000 * 4;
+	keep = keep > m_reader.chunkSize ? keep : m_reader.chunkSize;
+
+	size_t skipped = g_capture.trim(m_reader, keep);
+	if (skipped)
+	{
+		Notify::update(Notify::Encoder, Notify::Warning, "%s fell behind, skipped %d ms", m_mount->path(), static_cast<int>((skipped / 4) * 1000 / g_capture.sampleRate()));
+	}
+}
+
+bool Encoder::setRate(DWORD rate)
+{
+	// the old filter still holds the last few input samples, so they go out
+	// before the new rate takes over and nothing is dropped at the switch
+
+	if (m_resampler.inputRate())
+	{
+		reserve(m_fifoFrames + m_resampler.maxOutput(0));
+		m_fifoFrames += m_resampler.flush(m_fifo + m_fifoFrames * 2);
+		m_resampler.destroy();
+	}
+
+	Notify::update(Notify::Encoder, Notify::Info, "%s capture rate changed from %d Hz to %d Hz", m_mount->path(), m_rate, rate);
+	m_rate = rate;
+
+	if (rate == m_backend->sampleRate())
+	{
+		return true;
+	}
+
+	if (!m_resampler.create(rate, m_backend->sampleRate(), m_quality, m_reader.chunkSize / (2 * 2)))
+	{
+		Notify::update(Notify::Encoder, Notify::Warning, "Cannot resample from %d Hz", rate);
+		m_rate = 0;
+		return false;
+	}
+
+	return true;
+}
+
+void Encoder::reserve(size_t frames)
+{
+	if (frames <= m_fifoCapacity)
+	{
+		return;
+	}
+
+	short* fifo = new short[frames * 2];
+	::memcpy(fifo, m_fifo, m_fifoFrames * 2 * sizeof(short));
+	delete [] m_fifo;
+
+	m_fifo = fifo;
+	m_fifoCapacity = frames;
+}
+
+}
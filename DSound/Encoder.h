@@ -1,92 +1,143 @@
-#ifndef dsbridge_Encoder_h
-#define dsbridge_Encoder_h
-
-/*
-
-Copyright 2009 Jesper Svennevid
-
-Redistribution and use in source and binary forms, with or without
-modification, are permitted provided that the following conditions
-are met:
-
-1. Redistributions of source code must retain the above copyright
-   notice, this list of conditions and the following disclaimer.
-2. Redistributions in binary form must reproduce the above copyright
-   notice, this list of conditions and the following disclaimer in the
-   documentation and/or other materials provided with the distribution.
-
-THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
-IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
-OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
-IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
-INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
-NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
-DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
-THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
-(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
-THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-
-*/
-
-#include "RingBuffer.h"
-
-#include <windows.h>
-#include <audiodefs.h>
-
-#include "BladeMP3EncDLL.h"
-
-namespace dsbridge
-{
-
-class Encoder
-{
-public:
-	Encoder();
-	~Encoder();
-
-	bool create();
-	void destroy();
-
-	void setFormat(LPWAVEFORMATEX format);
-	void write(const void* buffer, size_t count);
-
-	void onCreate(DWORD bufferSize);
-	void onPlay(DWORD position);
-	void onStop(DWORD position);
-	void onUpdate(DWORD position);
-	void onDestroy();
-
-private:
-
-	static DWORD WINAPI threadEntry(LPVOID parameter);
-
-	bool run();
-	void updatePosition(DWORD position);
-
-	HMODULE m_module;
-	WAVEFORMATEX m_format;
-	CRITICAL_SECTION m_cs;
-
-	HANDLE m_thread;
-
-	HBE_STREAM m_stream;
-	DWORD m_samples;
-
-	DWORD m_outputSize;
-	PBYTE m_outputBuffer;
-	PBYTE m_inputBuffer;
-
-	RingBuffer m_buffer;
-
-	bool m_playing;
-	bool m_destroyed;
-	DWORD m_raw;
-	DWORD m_current;
-	DWORD m_goal;
-	DWORD m_bufferSize;
-	LARGE_INTEGER m_lastTimer;
-};
-
-}
-
-#endif
+#ifndef dsbridge_Encoder_h
+#define dsbridge_Encoder_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Capture.h"
+#include "Counter.h"
+#include "EncoderBackend.h"
+#include "Resampler.h"
+
+#include <windows.h>
+#include <audiodefs.h>
+
+namespace dsbridge
+{
+
+class Mount;
+
+class Encoder
+{
+public:
+	Encoder();
+	~Encoder();
+
+	bool create(Mount& mount);
+	bool start(DWORD processor);
+	void destroy();
+
+	const char* contentType() const { return m_backend->contentType(); }
+	const char* extension() const { return m_backend->extension(); }
+	const BYTE* header(DWORD& size) const { return m_backend->header(size); }
+	size_t bufferSize() const { return m_backend->bufferSize(); }
+
+	// read by the status pages only
+
+	ULONGLONG chunks() { return m_chunks.total(); }
+	ULONGLONG busyMicroseconds() { return m_busy.total(); }
+
+	// for the watchdog: the heartbeat moves every time round the loop, and a
+	// thread stuck in the codec can be left behind for a new one
+
+	LONG heartbeat() const { return m_heartbeat; }
+	bool restart();
+
+private:
+
+	enum EncodeState
+	{
+		Idle,
+		Encoding,
+		Abandoned
+	};
+
+	// what one thread encodes with. Once the watchdog abandons a worker it
+	// stays abandoned, so its thread leaves whenever it gets back out of the
+	// codec, and takes the backend nobody else uses any more with it
+
+	struct Worker
+	{
+		Encoder* encoder;
+		EncoderBackend* backend;
+		volatile LONG state;
+	};
+
+	static DWORD WINAPI threadEntry(LPVOID parameter);
+	static void settingsChanged(void* context);
+
+	bool run(Worker& worker);
+	bool fill(void* input);
+	void trim();
+	bool setRate(DWORD rate);
+	void reserve(size_t frames);
+
+	Mount* m_mount;
+	EncoderBackend* m_backend;
+
+	HANDLE m_thread;
+	Worker* m_worker;
+
+	Capture::Reader m_reader;
+
+	// capture rate of the audio last read, which is resampled whenever it
+	// differs from what the codec takes
+
+	DWORD m_rate;
+	Resampler m_resampler;
+	Resampler::Quality m_quality;
+	PBYTE m_staging;
+	short* m_fifo;
+	size_t m_fifoFrames;
+	size_t m_fifoCapacity;
+
+	// where the oldest audio in the fifo and the chunk last filled have been
+
+	Latency::Timestamps m_fifoTimestamps;
+	Latency::Timestamps m_timestamps;
+
+	bool m_idle;
+	bool m_ended;
+	bool m_startPending;
+	DWORD m_preRoll;
+	DWORD m_lowLatency;
+
+	// chunks encoded, and the time spent encoding them
+
+	Counter m_chunks;
+	Counter m_busy;
+
+	volatile LONG m_heartbeat;
+
+	// set when the codec settings changed, for the thread to pick up between chunks
+
+	volatile LONG m_reconfigure;
+};
+
+}
+
+#endif
@@ -0,0 +1,200 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "EncoderBackend.h"
+#include "LameBackend.h"
+#include "PcmBackend.h"
+#include "FlacBackend.h"
+#include "OpusBackend.h"
+#include "Mount.h"
+#include "Notify.h"
+
+#include <emmintrin.h>
+
+namespace dsbridge
+{
+
+EncoderBackend::EncoderBackend()
+: m_chunkSize(0)
+, m_silenceThreshold(0)
+, m_input(0)
+, m_output(0)
+, m_outputSize(0)
+, m_outputBytes(0)
+, m_pending(false)
+, m_silent(silentScalar)
+{
+	m_silent = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE) ? silentSSE2 : silentScalar;
+}
+
+EncoderBackend::~EncoderBackend()
+{
+	delete [] m_input;
+	delete [] m_output;
+}
+
+EncoderBackend* EncoderBackend::create(const char* mount)
+{
+	const char* codec = Mount::getString(mount, "Codec", "mp3");
+
+	EncoderBackend* backend = 0;
+	if (!::_stricmp(codec, "mp3"))
+	{
+		backend = new LameBackend;
+	}
+	else if (!::_stricmp(codec, "wav"))
+	{
+		backend = new PcmBackend(PcmBackend::Wave);
+	}
+	else if (!::_stricmp(codec, "l16"))
+	{
+		backend = new PcmBackend(PcmBackend::L16);
+	}
+	else if (!::_stricmp(codec, "flac"))
+	{
+		backend = new FlacBackend;
+	}
+	else if (!::_stricmp(codec, "opus"))
+	{
+		backend = new OpusBackend;
+	}
+	else
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "Unknown codec %s", codec);
+		return 0;
+	}
+
+	if (!backend->initialize(mount))
+	{
+		delete backend;
+		return 0;
+	}
+
+	// samples this close to zero count as silence, so dither or a faint hiss
+	// does not keep an idle stream encoding
+
+	int threshold = Mount::getInteger(mount, "SilenceThreshold", 0);
+	backend->m_silenceThreshold = static_cast<short>(threshold < 0 ? 0 : (threshold > 32767 ? 32767 : threshold));
+
+	return backend;
+}
+
+void* EncoderBackend::input()
+{
+	return m_input;
+}
+
+bool EncoderBackend::encode()
+{
+	if (!encodeChunk(m_input, m_output, m_outputBytes))
+	{
+		return false;
+	}
+
+	m_pending = true;
+	return true;
+}
+
+bool EncoderBackend::output(const BYTE*& data, DWORD& size)
+{
+	if (!m_pending)
+	{
+		return false;
+	}
+
+	data = m_output;
+	size = m_outputBytes;
+	m_pending = false;
+
+	return true;
+}
+
+bool EncoderBackend::flush()
+{
+	if (!flushChunk(m_output, m_outputBytes))
+	{
+		return false;
+	}
+
+	m_pending = true;
+	return true;
+}
+
+void EncoderBackend::allocate(size_t chunkSize, DWORD outputSize)
+{
+	m_chunkSize = chunkSize;
+	m_outputSize = outputSize;
+
+	m_input = new BYTE[m_chunkSize];
+	m_output = new BYTE[m_outputSize];
+}
+
+bool EncoderBackend::silent(const void* input) const
+{
+	return m_silent(static_cast<const short*>(input), m_chunkSize / sizeof(short), m_silenceThreshold);
+}
+
+bool EncoderBackend::silentScalar(const short* input, size_t samples, short threshold)
+{
+	for (size_t i = 0; i < samples; ++i)
+	{
+		if ((input[i] > threshold) || (input[i] < -threshold))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool EncoderBackend::silentSSE2(const short* input, size_t samples, short threshold)
+{
+	__m128i high = _mm_setzero_si128();
+	__m128i low = _mm_setzero_si128();
+
+	// the extremes of the whole chunk, checked once at the end; a chunk is
+	// only a few kilobytes, so bailing out early would not pay for its branches
+
+	size_t i = 0;
+	for (; (i + 8) <= samples; i += 8)
+	{
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+		high = _mm_max_epi16(high, value);
+		low = _mm_min_epi16(low, value);
+	}
+
+	__m128i limit = _mm_set1_epi16(threshold);
+	__m128i outside = _mm_or_si128(_mm_cmpgt_epi16(high, limit), _mm_cmplt_epi16(low, _mm_sub_epi16(_mm_setzero_si128(), limit)));
+	if (_mm_movemask_epi8(outside))
+	{
+		return false;
+	}
+
+	return silentScalar(input + i, samples - i, threshold);
+}
+
+}
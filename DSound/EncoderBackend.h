@@ -0,0 +1,103 @@
+#ifndef dsbridge_EncoderBackend_h
+#define dsbridge_EncoderBackend_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+// A codec turning chunks of 16-bit stereo PCM into stream data. Each chunk
+// becomes one self-contained piece of output (a frame or a page), so listeners
+// can join the stream at any write boundary after receiving header().
+//
+// The default input()/encode()/output() handle one chunk at a time through
+// encodeChunk(); codecs that encode asynchronously override all three.
+// silent() tells codecs whether a chunk holds nothing audible, for those that
+// can send silence cheaper than encoding it.
+
+class EncoderBackend
+{
+public:
+	EncoderBackend();
+	virtual ~EncoderBackend();
+
+	static EncoderBackend* create(const char* mount);
+
+	virtual bool initialize(const char* mount) = 0;
+	virtual bool start() = 0;
+
+	// picks up changed settings between two chunks, false when they need a
+	// new stream
+
+	virtual bool reconfigure(const char* mount) { return false; }
+
+	virtual const char* contentType() const = 0;
+	virtual const char* extension() const = 0;
+	virtual DWORD sampleRate() const { return 44100; }
+	virtual const BYTE* header(DWORD& size) const { size = 0; return 0; }
+	virtual size_t bufferSize() const { return 100 * 1024; }
+
+	size_t chunkSize() const { return m_chunkSize; }
+
+	virtual void* input();
+	virtual bool encode();
+	virtual bool output(const BYTE*& data, DWORD& size);
+	virtual bool flush();
+
+protected:
+
+	void allocate(size_t chunkSize, DWORD outputSize);
+	bool silent(const void* input) const;
+
+	virtual bool encodeChunk(const void* input, PBYTE output, DWORD& size) = 0;
+	virtual bool flushChunk(PBYTE output, DWORD& size) { size = 0; return true; }
+
+	size_t m_chunkSize;
+	short m_silenceThreshold;
+
+	PBYTE m_input;
+	PBYTE m_output;
+	DWORD m_outputSize;
+	DWORD m_outputBytes;
+	bool m_pending;
+
+private:
+
+	typedef bool (*SilenceFunction)(const short* input, size_t samples, short threshold);
+
+	static bool silentScalar(const short* input, size_t samples, short threshold);
+	static bool silentSSE2(const short* input, size_t samples, short threshold);
+
+	SilenceFunction m_silent;
+};
+
+}
+
+#endif
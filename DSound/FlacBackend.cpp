@@ -0,0 +1,429 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "FlacBackend.h"
+#include "Mount.h"
+
+namespace dsbridge
+{
+
+class BitWriter
+{
+public:
+	BitWriter(PBYTE buffer)
+	: m_buffer(buffer)
+	, m_bytes(0)
+	, m_cache(0)
+	, m_bits(0)
+	{}
+
+	void write(ULONGLONG value, int bits)
+	{
+		m_cache = (m_cache << bits) | (value & ((ULONGLONG(1) << bits) - 1));
+		m_bits += bits;
+
+		while (m_bits >= 8)
+		{
+			m_bits -= 8;
+			m_buffer[m_bytes++] = BYTE(m_cache >> m_bits);
+		}
+	}
+
+	void writeRice(unsigned int value, int parameter)
+	{
+		unsigned int zeros = value >> parameter;
+		while (zeros >= 32)
+		{
+			write(0, 32);
+			zeros -= 32;
+		}
+
+		write(1, zeros + 1);
+
+		if (parameter)
+		{
+			write(value, parameter);
+		}
+	}
+
+	void align()
+	{
+		if (m_bits)
+		{
+			write(0, 8 - m_bits);
+		}
+	}
+
+	size_t bytes() const { return m_bytes; }
+
+private:
+	PBYTE m_buffer;
+	size_t m_bytes;
+	ULONGLONG m_cache;
+	int m_bits;
+};
+
+static BYTE s_crc8[256];
+static WORD s_crc16[256];
+
+static void buildTables()
+{
+	for (int i = 0; i < 256; ++i)
+	{
+		BYTE crc8 = BYTE(i);
+		WORD crc16 = WORD(i << 8);
+
+		for (int j = 0; j < 8; ++j)
+		{
+			crc8 = BYTE((crc8 << 1) ^ ((crc8 & 0x80) ? 0x07 : 0));
+			crc16 = WORD((crc16 << 1) ^ ((crc16 & 0x8000) ? 0x8005 : 0));
+		}
+
+		s_crc8[i] = crc8;
+		s_crc16[i] = crc16;
+	}
+}
+
+static BYTE crc8(const BYTE* data, size_t size)
+{
+	BYTE crc = 0;
+	for (size_t i = 0; i < size; ++i)
+	{
+		crc = s_crc8[crc ^ data[i]];
+	}
+	return crc;
+}
+
+static WORD crc16(const BYTE* data, size_t size)
+{
+	WORD crc = 0;
+	for (size_t i = 0; i < size; ++i)
+	{
+		crc = WORD((crc << 8) ^ s_crc16[(crc >> 8) ^ data[i]]);
+	}
+	return crc;
+}
+
+FlacBackend::FlacBackend()
+: m_blockSize(MaxBlockSize)
+, m_blockCode(12)
+, m_frameNumber(0)
+{
+	::memset(m_header, 0, sizeof(m_header));
+}
+
+FlacBackend::~FlacBackend()
+{
+}
+
+bool FlacBackend::initialize(const char* mount)
+{
+	buildTables();
+
+	if (Mount::getInteger(mount, "LowLatency", 0) > 0)
+	{
+		m_blockSize = 1024;
+		m_blockCode = 10;
+	}
+
+	// a frame is never larger than both channels stored verbatim, side at 17 bits
+
+	allocate(m_blockSize * 2 * 2, m_blockSize * 2 * 3 + 64);
+
+	// STREAMINFO, with frame sizes, length and MD5 left unknown
+
+	BitWriter out(m_header);
+	out.write('f', 8);
+	out.write('L', 8);
+	out.write('a', 8);
+	out.write('C', 8);
+	out.write(1, 1);
+	out.write(0, 7);
+	out.write(34, 24);
+	out.write(m_blockSize, 16);
+	out.write(m_blockSize, 16);
+	out.write(0, 24);
+	out.write(0, 24);
+	out.write(44100, 20);
+	out.write(2 - 1, 3);
+	out.write(16 - 1, 5);
+	out.write(0, 4);
+	out.write(0, 32);
+	for (int i = 0; i < 4; ++i)
+	{
+		out.write(0, 32);
+	}
+
+	return true;
+}
+
+bool FlacBackend::encodeChunk(const void* input, PBYTE output, DWORD& size)
+{
+	const short* in = static_cast<const short*>(input);
+	for (size_t i = 0; i < m_blockSize; ++i)
+	{
+		int left = in[i * 2 + 0];
+		int right = in[i * 2 + 1];
+
+		m_channels[0][i] = left;
+		m_channels[1][i] = right;
+		m_channels[2][i] = (left + right) >> 1;
+		m_channels[3][i] = left - right;
+	}
+
+	Subframe subframes[4];
+	analyze(m_channels[0], 16, subframes[0]);
+	analyze(m_channels[1], 16, subframes[1]);
+	analyze(m_channels[2], 16, subframes[2]);
+	analyze(m_channels[3], 17, subframes[3]);
+
+	// independent, left/side, side/right or mid/side, whichever is smallest
+
+	static const int assignments[4][3] =
+	{
+		{ 1, 0, 1 },
+		{ 8, 0, 3 },
+		{ 9, 3, 1 },
+		{ 10, 2, 3 }
+	};
+
+	int best = 0;
+	for (int i = 1; i < 4; ++i)
+	{
+		if ((subframes[assignments[i][1]].bits + subframes[assignments[i][2]].bits) < (subframes[assignments[best][1]].bits + subframes[assignments[best][2]].bits))
+		{
+			best = i;
+		}
+	}
+
+	BitWriter out(output);
+	out.write(0x3ffe, 14);
+	out.write(0, 1);
+	out.write(0, 1);
+	out.write(m_blockCode, 4);
+	out.write(9, 4);
+	out.write(assignments[best][0], 4);
+	out.write(4, 3);
+	out.write(0, 1);
+
+	// frame number, in the extended UTF-8 coding
+
+	DWORD number = m_frameNumber++ & 0x7fffffff;
+	if (number < 0x80)
+	{
+		out.write(number, 8);
+	}
+	else
+	{
+		int count = 2;
+		while ((count < 6) && (number >= (DWORD(1) << (5 * count + 1))))
+		{
+			++count;
+		}
+
+		out.write(((0xff << (8 - count)) & 0xff) | (number >> (6 * (count - 1))), 8);
+		for (int i = count - 2; i >= 0; --i)
+		{
+			out.write(0x80 | ((number >> (6 * i)) & 0x3f), 8);
+		}
+	}
+
+	out.write(crc8(output, out.bytes()), 8);
+
+	for (int i = 1; i < 3; ++i)
+	{
+		int channel = assignments[best][i];
+		write(out, m_channels[channel], channel == 3 ? 17 : 16, subframes[channel]);
+	}
+
+	out.align();
+	out.write(crc16(output, out.bytes()), 16);
+
+	size = static_cast<DWORD>(out.bytes());
+	return true;
+}
+
+void FlacBackend::analyze(const int* samples, int bps, Subframe& subframe)
+{
+	size_t i;
+	for (i = 1; (i < m_blockSize) && (samples[i] == samples[0]); ++i);
+	if (i == m_blockSize)
+	{
+		subframe.type = Subframe::Constant;
+		subframe.bits = 8 + bps;
+		return;
+	}
+
+	subframe.type = Subframe::Verbatim;
+	subframe.bits = 8 + m_blockSize * bps;
+
+	// the predictor with the smallest total error tends to code smallest
+
+	ULONGLONG errors[MaxOrder + 1] = { 0 };
+	for (i = MaxOrder; i < m_blockSize; ++i)
+	{
+		int e0 = samples[i];
+		int e1 = e0 - samples[i - 1];
+		int e2 = e1 - (samples[i - 1] - samples[i - 2]);
+		int e3 = e2 - (samples[i - 1] - 2 * samples[i - 2] + samples[i - 3]);
+		int e4 = e3 - (samples[i - 1] - 3 * samples[i - 2] + 3 * samples[i - 3] - samples[i - 4]);
+
+		errors[0] += e0 < 0 ? -e0 : e0;
+		errors[1] += e1 < 0 ? -e1 : e1;
+		errors[2] += e2 < 0 ? -e2 : e2;
+		errors[3] += e3 < 0 ? -e3 : e3;
+		errors[4] += e4 < 0 ? -e4 : e4;
+	}
+
+	int order = 0;
+	for (int j = 1; j <= MaxOrder; ++j)
+	{
+		if (errors[j] < errors[order])
+		{
+			order = j;
+		}
+	}
+
+	fold(samples, order);
+
+	// estimated sizes are an upper bound, sum(x >> k) never exceeds sum(x) >> k
+
+	for (int partitionOrder = 0; partitionOrder <= MaxPartitionOrder; ++partitionOrder)
+	{
+		size_t partitionSize = m_blockSize >> partitionOrder;
+		if (partitionSize <= size_t(order))
+		{
+			break;
+		}
+
+		int parameters[1 << MaxPartitionOrder];
+		size_t bits = 8 + order * bps + 2 + 4;
+
+		for (int p = 0; p < (1 << partitionOrder); ++p)
+		{
+			size_t begin = p ? p * partitionSize : order;
+			size_t end = (p + 1) * partitionSize;
+			size_t count = end - begin;
+
+			ULONGLONG sum = 0;
+			for (size_t j = begin; j < end; ++j)
+			{
+				sum += m_residual[j];
+			}
+
+			int k = 0;
+			while ((k < MaxRiceParameter) && ((ULONGLONG(count) << (k + 1)) < sum))
+			{
+				++k;
+			}
+
+			parameters[p] = k;
+			bits += 4 + count * (k + 1) + size_t(sum >> k);
+		}
+
+		if (bits < subframe.bits)
+		{
+			subframe.type = Subframe::Fixed;
+			subframe.order = order;
+			subframe.partitionOrder = partitionOrder;
+			subframe.bits = bits;
+			::memcpy(subframe.parameters, parameters, sizeof(int) << partitionOrder);
+		}
+	}
+}
+
+void FlacBackend::write(BitWriter& out, const int* samples, int bps, const Subframe& subframe)
+{
+	switch (subframe.type)
+	{
+		case Subframe::Constant:
+		{
+			out.write(0, 8);
+			out.write(samples[0], bps);
+		}
+		break;
+
+		case Subframe::Verbatim:
+		{
+			out.write(1 << 1, 8);
+			for (size_t i = 0; i < m_blockSize; ++i)
+			{
+				out.write(samples[i], bps);
+			}
+		}
+		break;
+
+		case Subframe::Fixed:
+		{
+			out.write((8 | subframe.order) << 1, 8);
+			for (int i = 0; i < subframe.order; ++i)
+			{
+				out.write(samples[i], bps);
+			}
+
+			fold(samples, subframe.order);
+
+			out.write(0, 2);
+			out.write(subframe.partitionOrder, 4);
+
+			size_t partitionSize = m_blockSize >> subframe.partitionOrder;
+			for (int p = 0; p < (1 << subframe.partitionOrder); ++p)
+			{
+				int k = subframe.parameters[p];
+				out.write(k, 4);
+
+				for (size_t i = p ? p * partitionSize : subframe.order, end = (p + 1) * partitionSize; i < end; ++i)
+				{
+					out.writeRice(m_residual[i], k);
+				}
+			}
+		}
+		break;
+	}
+}
+
+void FlacBackend::fold(const int* samples, int order)
+{
+	// residuals are zigzag folded to unsigned for Rice coding
+
+	for (size_t i = order; i < m_blockSize; ++i)
+	{
+		int residual;
+		switch (order)
+		{
+			case 0: residual = samples[i]; break;
+			case 1: residual = samples[i] - samples[i - 1]; break;
+			case 2: residual = samples[i] - 2 * samples[i - 1] + samples[i - 2]; break;
+			case 3: residual = samples[i] - 3 * samples[i - 1] + 3 * samples[i - 2] - samples[i - 3]; break;
+			default: residual = samples[i] - 4 * samples[i - 1] + 6 * samples[i - 2] - 4 * samples[i - 3] + samples[i - 4]; break;
+		}
+
+		m_residual[i] = (static_cast<unsigned int>(residual) << 1) ^ static_cast<unsigned int>(residual >> 31);
+	}
+}
+
+}
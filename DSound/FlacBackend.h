@@ -0,0 +1,108 @@
+#ifndef dsbridge_FlacBackend_h
+#define dsbridge_FlacBackend_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "EncoderBackend.h"
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+class BitWriter;
+
+// Lossless output using FLAC's fixed polynomial predictors and Rice coded
+// residuals, picking the cheapest stereo decorrelation for every frame. No LPC
+// analysis, which keeps it cheap enough to run next to the game. Low-latency
+// mounts use quarter-size blocks.
+
+class FlacBackend : public EncoderBackend
+{
+public:
+	FlacBackend();
+	virtual ~FlacBackend();
+
+	virtual bool initialize(const char* mount);
+	virtual bool start() { m_pending = false; return true; }
+
+	virtual const char* contentType() const { return "audio/flac"; }
+	virtual const char* extension() const { return "flac"; }
+	virtual const BYTE* header(DWORD& size) const { size = sizeof(m_header); return m_header; }
+	virtual size_t bufferSize() const { return 1024 * 1024; }
+
+protected:
+
+	virtual bool encodeChunk(const void* input, PBYTE output, DWORD& size);
+
+private:
+
+	enum
+	{
+		MaxBlockSize = 4096,
+		MaxOrder = 4,
+		MaxPartitionOrder = 6,
+		MaxRiceParameter = 14,
+		HeaderSize = 42
+	};
+
+	struct Subframe
+	{
+		enum Type
+		{
+			Constant,
+			Verbatim,
+			Fixed
+		};
+
+		Type type;
+		int order;
+		int partitionOrder;
+		int parameters[1 << MaxPartitionOrder];
+		size_t bits;
+	};
+
+	void analyze(const int* samples, int bps, Subframe& subframe);
+	void write(BitWriter& out, const int* samples, int bps, const Subframe& subframe);
+	void fold(const int* samples, int order);
+
+	int m_channels[4][MaxBlockSize];
+	unsigned int m_residual[MaxBlockSize];
+
+	// samples per block, and its code in the frame header
+
+	size_t m_blockSize;
+	int m_blockCode;
+
+	DWORD m_frameNumber;
+	BYTE m_header[HeaderSize];
+};
+
+}
+
+#endif
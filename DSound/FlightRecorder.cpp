@@ -0,0 +1,148 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "FlightRecorder.h"
+
+#include <intrin.h>
+
+namespace dsbridge
+{
+
+FlightRecorder::Recording FlightRecorder::s_recording;
+volatile LONG FlightRecorder::s_recorded = 0;
+
+// the counters as the recording starts, so later times can be converted
+
+static LONGLONG startCounter()
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return now.QuadPart;
+}
+
+static const ULONGLONG s_startTime = __rdtsc();
+static const LONGLONG s_startCounter = startCounter();
+
+void FlightRecorder::record(Event event, DWORD first, DWORD second, DWORD third)
+{
+	LONG position = InterlockedIncrement(&s_recorded) - 1;
+
+	Entry& entry = s_recording.entries[DWORD(position) % EntryCount];
+	entry.sequence = 0;
+	entry.time = __rdtsc();
+	entry.thread = GetCurrentThreadId();
+	entry.event = event;
+	entry.values[0] = first;
+	entry.values[1] = second;
+	entry.values[2] = third;
+	entry.sequence = position + 1;
+}
+
+const char* FlightRecorder::name(DWORD event)
+{
+	static const char* names[EventCount] =
+	{
+		"BufferCreated",
+		"FormatChanged",
+		"ClientConnected",
+		"ClientDropped",
+		"ListenerSkipped",
+		"CaptureOverrun",
+		"EncodeError",
+		"EncodeTime",
+		"Crash",
+		"Stall"
+	};
+
+	return event < EventCount ? names[event] : "";
+}
+
+size_t FlightRecorder::copy(Entry* entries, size_t count)
+{
+	LONG recorded = s_recorded;
+	LONG first = recorded > LONG(count) ? recorded - LONG(count) : 0;
+	first = (recorded - first) > EntryCount ? recorded - EntryCount : first;
+
+	// entries being written, or already overwritten, are left out
+
+	size_t copied = 0;
+	for (LONG position = first; position < recorded; ++position)
+	{
+		const Entry& entry = s_recording.entries[DWORD(position) % EntryCount];
+		if (entry.sequence != (position + 1))
+		{
+			continue;
+		}
+
+		entries[copied] = entry;
+		if (entry.sequence == (position + 1))
+		{
+			++ copied;
+		}
+	}
+
+	return copied;
+}
+
+double FlightRecorder::age(ULONGLONG time)
+{
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+	ULONGLONG nowTime = __rdtsc();
+
+	// the counter rate is measured against the performance counter since the
+	// start, which assumes it runs at a constant rate
+
+	double seconds = double(now.QuadPart - s_startCounter) / freq.QuadPart;
+	double rate = seconds > 0.0 ? double(nowTime - s_startTime) / seconds : 0.0;
+
+	return rate > 0.0 ? double(LONGLONG(nowTime - time)) / rate : 0.0;
+}
+
+const void* FlightRecorder::snapshot(DWORD& size)
+{
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+
+	Header& header = s_recording.header;
+	header.version = 1;
+	header.entrySize = sizeof(Entry);
+	header.entryCount = EntryCount;
+	header.recorded = s_recorded;
+	header.startTime = s_startTime;
+	header.startCounter = s_startCounter;
+	header.dumpTime = __rdtsc();
+	header.dumpCounter = now.QuadPart;
+	header.frequency = freq.QuadPart;
+
+	size = sizeof(s_recording);
+	return &s_recording;
+}
+
+}
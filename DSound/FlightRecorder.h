@@ -0,0 +1,111 @@
+#ifndef dsbridge_FlightRecorder_h
+#define dsbridge_FlightRecorder_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+// The last few thousand pipeline events, kept for crash dumps and
+// /events.json. Recording claims an entry with one interlocked increment and
+// stamps it with the time stamp counter, so the audio threads can afford it;
+// the recording goes into minidumps as a user stream just as it is in memory.
+
+class FlightRecorder
+{
+public:
+	enum Event
+	{
+		BufferCreated,		// buffer bytes, sample rate, channels << 16 | bits
+		FormatChanged,		// sample rate, channels << 16 | bits, result
+		ClientConnected,	// listeners, address, port
+		ClientDropped,		// mount, kilobytes sent, seconds connected
+		ListenerSkipped,	// mount, bytes skipped
+		CaptureOverrun,		// bytes lost
+		EncodeError,		// mount, 0 when starting and 1 when encoding
+		EncodeTime,			// mount, microseconds for one chunk
+		Crash,				// exception code, address
+		Stall,				// watchdog stage, mount, 1 when restarted
+		EventCount
+	};
+
+	enum
+	{
+		EntryCount = 4096,
+		StreamType = 0x44534246		// 'DSBF', above LastReservedStream
+	};
+
+	struct Entry
+	{
+		ULONGLONG time;				// time stamp counter
+		volatile LONG sequence;		// position + 1 once written, 0 while it is
+		DWORD thread;
+		DWORD event;
+		DWORD values[3];
+	};
+
+	static void record(Event event, DWORD first = 0, DWORD second = 0, DWORD third = 0);
+	static const char* name(DWORD event);
+
+	static size_t copy(Entry* entries, size_t count);
+	static double age(ULONGLONG time);
+
+	static const void* snapshot(DWORD& size);
+
+private:
+
+	// the times in the entries convert to seconds through the counter pairs
+
+	struct Header
+	{
+		DWORD version;
+		DWORD entrySize;
+		DWORD entryCount;
+		DWORD recorded;
+		ULONGLONG startTime;
+		LONGLONG startCounter;
+		ULONGLONG dumpTime;
+		LONGLONG dumpCounter;
+		LONGLONG frequency;
+	};
+
+	struct Recording
+	{
+		Header header;
+		Entry entries[EntryCount];
+	};
+
+	static Recording s_recording;
+	static volatile LONG s_recorded;
+};
+
+}
+
+#endif
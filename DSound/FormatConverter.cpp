@@ -0,0 +1,332 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "FormatConverter.h"
+
+#include <emmintrin.h>
+
+namespace dsbridge
+{
+
+// what each speaker position contributes to the left and right outputs, in
+// dwChannelMask bit order; the LFE channel is dropped
+
+static const float s_speakerGains[18][2] =
+{
+	{ 1.0f, 0.0f },			// front left
+	{ 0.0f, 1.0f },			// front right
+	{ 0.7071f, 0.7071f },	// front center
+	{ 0.0f, 0.0f },			// low frequency
+	{ 0.7071f, 0.0f },		// back left
+	{ 0.0f, 0.7071f },		// back right
+	{ 0.7071f, 0.0f },		// front left of center
+	{ 0.0f, 0.7071f },		// front right of center
+	{ 0.5f, 0.5f },			// back center
+	{ 0.7071f, 0.0f },		// side left
+	{ 0.0f, 0.7071f },		// side right
+	{ 0.5f, 0.5f },			// top center
+	{ 0.7071f, 0.0f },		// top front left
+	{ 0.5f, 0.5f },			// top front center
+	{ 0.0f, 0.7071f },		// top front right
+	{ 0.5f, 0.0f },			// top back left
+	{ 0.3536f, 0.3536f },	// top back center
+	{ 0.0f, 0.5f }			// top back right
+};
+
+// layouts assumed when the format does not carry a speaker mask
+
+static const DWORD s_defaultMasks[9] =
+{
+	0,
+	0x4,		// mono
+	0x3,		// stereo
+	0x7,		// 3.0
+	0x33,		// quad
+	0x37,		// 5.0
+	0x3f,		// 5.1
+	0x13f,		// 6.1
+	0x63f		// 7.1
+};
+
+// the GUID subformats differ only in their first member
+
+static const DWORD s_subFormatPcm = 0x00000001;
+static const DWORD s_subFormatFloat = 0x00000003;
+
+static short saturate(float value)
+{
+	value += value < 0.0f ? -0.5f : 0.5f;
+	return short(value > 32767.0f ? 32767 : (value < -32768.0f ? -32768 : int(value)));
+}
+
+FormatConverter::FormatConverter()
+: m_encoding(Signed16)
+, m_channels(2)
+, m_blockAlign(2 * 2)
+, m_sampleSize(2)
+, m_convert(stereo16)
+{
+	buildMatrix(s_defaultMasks[2]);
+}
+
+FormatConverter::~FormatConverter()
+{
+}
+
+bool FormatConverter::configure(const WAVEFORMATEX* format)
+{
+	WORD tag = format->wFormatTag;
+	DWORD channelMask = 0;
+
+	if ((tag == WAVE_FORMAT_EXTENSIBLE) && (format->cbSize >= (sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX))))
+	{
+		const WAVEFORMATEXTENSIBLE* extensible = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(format);
+
+		channelMask = extensible->dwChannelMask;
+		if (extensible->SubFormat.Data1 == s_subFormatPcm)
+		{
+			tag = WAVE_FORMAT_PCM;
+		}
+		else if (extensible->SubFormat.Data1 == s_subFormatFloat)
+		{
+			tag = WAVE_FORMAT_IEEE_FLOAT;
+		}
+	}
+
+	Encoding encoding;
+	if ((tag == WAVE_FORMAT_PCM) && (format->wBitsPerSample == 8))
+	{
+		encoding = Unsigned8;
+	}
+	else if ((tag == WAVE_FORMAT_PCM) && (format->wBitsPerSample == 16))
+	{
+		encoding = Signed16;
+	}
+	else if ((tag == WAVE_FORMAT_PCM) && (format->wBitsPerSample == 24))
+	{
+		encoding = Signed24;
+	}
+	else if ((tag == WAVE_FORMAT_PCM) && (format->wBitsPerSample == 32))
+	{
+		encoding = Signed32;
+	}
+	else if ((tag == WAVE_FORMAT_IEEE_FLOAT) && (format->wBitsPerSample == 32))
+	{
+		encoding = Float32;
+	}
+	else
+	{
+		return false;
+	}
+
+	size_t channels = format->nChannels;
+	size_t sampleSize = format->wBitsPerSample / 8;
+	if (!channels || (channels > MaxChannels) || (format->nBlockAlign != channels * sampleSize))
+	{
+		return false;
+	}
+
+	m_encoding = encoding;
+	m_channels = channels;
+	m_sampleSize = sampleSize;
+	m_blockAlign = format->nBlockAlign;
+
+	if (!channelMask)
+	{
+		channelMask = channels < (sizeof(s_defaultMasks) / sizeof(s_defaultMasks[0])) ? s_defaultMasks[channels] : (1 << channels) - 1;
+	}
+	buildMatrix(channelMask);
+
+	bool sse2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE) != FALSE;
+	bool stereo = (channels == 2) && (m_matrix[0][0] == 1.0f) && (m_matrix[0][1] == 0.0f) && (m_matrix[1][0] == 0.0f) && (m_matrix[1][1] == 1.0f);
+
+	m_convert = 0;
+	if (stereo && (encoding == Signed16))
+	{
+		m_convert = stereo16;
+	}
+	else if (sse2 && stereo && (encoding == Unsigned8))
+	{
+		m_convert = stereo8SSE2;
+	}
+	else if (sse2 && stereo && (encoding == Float32))
+	{
+		m_convert = stereoFloatSSE2;
+	}
+	else if (sse2 && (channels == 1) && (encoding == Signed16))
+	{
+		m_convert = mono16SSE2;
+	}
+
+	return true;
+}
+
+size_t FormatConverter::convert(const BYTE* input, size_t frames, short* output)
+{
+	if (m_convert)
+	{
+		m_convert(input, frames, output);
+	}
+	else
+	{
+		convertGeneric(input, frames, output);
+	}
+
+	return frames;
+}
+
+void FormatConverter::buildMatrix(DWORD channelMask)
+{
+	::memset(m_matrix, 0, sizeof(m_matrix));
+
+	if (m_channels == 1)
+	{
+		m_matrix[0][0] = m_matrix[0][1] = 1.0f;
+		return;
+	}
+
+	// channels are stored in mask bit order; any beyond the mask stay silent
+
+	size_t channel = 0;
+	for (size_t bit = 0; (bit < MaxChannels) && (channel < m_channels); ++bit)
+	{
+		if (channelMask & (1 << bit))
+		{
+			m_matrix[channel][0] = s_speakerGains[bit][0];
+			m_matrix[channel][1] = s_speakerGains[bit][1];
+			++channel;
+		}
+	}
+}
+
+void FormatConverter::convertGeneric(const BYTE* input, size_t frames, short* output)
+{
+	// samples are scaled to the 16-bit range before mixing
+
+	for (size_t i = 0; i < frames; ++i)
+	{
+		float left = 0.0f;
+		float right = 0.0f;
+
+		for (size_t channel = 0; channel < m_channels; ++channel)
+		{
+			const BYTE* in = input + channel * m_sampleSize;
+			float sample;
+
+			switch (m_encoding)
+			{
+				case Unsigned8: sample = float((int(in[0]) - 128) << 8); break;
+				case Signed16: sample = float(*reinterpret_cast<const short*>(in)); break;
+				case Signed24: sample = float(int((DWORD(in[0]) << 8) | (DWORD(in[1]) << 16) | (DWORD(in[2]) << 24))) * (1.0f / 65536.0f); break;
+				case Signed32: sample = float(*reinterpret_cast<const int*>(in)) * (1.0f / 65536.0f); break;
+				default: sample = *reinterpret_cast<const float*>(in) * 32768.0f; break;
+			}
+
+			left += sample * m_matrix[channel][0];
+			right += sample * m_matrix[channel][1];
+		}
+
+		output[i * 2 + 0] = saturate(left);
+		output[i * 2 + 1] = saturate(right);
+
+		input += m_blockAlign;
+	}
+}
+
+void FormatConverter::stereo16(const BYTE* input, size_t frames, short* output)
+{
+	::memcpy(output, input, frames * 2 * sizeof(short));
+}
+
+void FormatConverter::stereo8SSE2(const BYTE* input, size_t frames, short* output)
+{
+	// (x - 128) << 8 is x << 8 with the sign bit flipped
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(short(0x8000));
+
+	size_t samples = frames * 2;
+	size_t i = 0;
+
+	for (; (i + 16) <= samples; i += 16)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_xor_si128(_mm_unpacklo_epi8(zero, x), bias));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i + 8), _mm_xor_si128(_mm_unpackhi_epi8(zero, x), bias));
+	}
+
+	for (; i < samples; ++i)
+	{
+		output[i] = short((int(input[i]) - 128) << 8);
+	}
+}
+
+void FormatConverter::stereoFloatSSE2(const BYTE* input, size_t frames, short* output)
+{
+	const float* in = reinterpret_cast<const float*>(input);
+
+	// clamp before converting, out of range values would come back as 0x80000000
+
+	const __m128 scale = _mm_set1_ps(32768.0f);
+	const __m128 upper = _mm_set1_ps(32767.0f);
+	const __m128 lower = _mm_set1_ps(-32768.0f);
+
+	size_t samples = frames * 2;
+	size_t i = 0;
+
+	for (; (i + 8) <= samples; i += 8)
+	{
+		__m128 a = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), upper), lower);
+		__m128 b = _mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale), upper), lower);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+	}
+
+	for (; i < samples; ++i)
+	{
+		output[i] = saturate(in[i] * 32768.0f);
+	}
+}
+
+void FormatConverter::mono16SSE2(const BYTE* input, size_t frames, short* output)
+{
+	const short* in = reinterpret_cast<const short*>(input);
+	size_t i = 0;
+
+	for (; (i + 8) <= frames; i += 8)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 2), _mm_unpacklo_epi16(x, x));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 2 + 8), _mm_unpackhi_epi16(x, x));
+	}
+
+	for (; i < frames; ++i)
+	{
+		output[i * 2 + 0] = output[i * 2 + 1] = in[i];
+	}
+}
+
+}
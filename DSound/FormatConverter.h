@@ -0,0 +1,94 @@
+#ifndef dsbridge_FormatConverter_h
+#define dsbridge_FormatConverter_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+#include <audiodefs.h>
+
+namespace dsbridge
+{
+
+// Turns whatever the wrapped buffer plays (8-bit unsigned, 16/24/32-bit
+// integer or 32-bit float PCM, one to eighteen channels) into the 16-bit
+// stereo the encoders take. Surround layouts are folded down through a
+// matrix built from the speaker mask; mono is copied to both sides.
+
+class FormatConverter
+{
+public:
+	FormatConverter();
+	~FormatConverter();
+
+	bool configure(const WAVEFORMATEX* format);
+
+	size_t blockAlign() const { return m_blockAlign; }
+	size_t convert(const BYTE* input, size_t frames, short* output);
+
+private:
+
+	enum
+	{
+		MaxChannels = 18
+	};
+
+	enum Encoding
+	{
+		Unsigned8,
+		Signed16,
+		Signed24,
+		Signed32,
+		Float32
+	};
+
+	typedef void (*ConvertFunction)(const BYTE* input, size_t frames, short* output);
+
+	void buildMatrix(DWORD channelMask);
+	void convertGeneric(const BYTE* input, size_t frames, short* output);
+
+	static void stereo16(const BYTE* input, size_t frames, short* output);
+	static void stereo8SSE2(const BYTE* input, size_t frames, short* output);
+	static void stereoFloatSSE2(const BYTE* input, size_t frames, short* output);
+	static void mono16SSE2(const BYTE* input, size_t frames, short* output);
+
+	Encoding m_encoding;
+	size_t m_channels;
+	size_t m_blockAlign;
+	size_t m_sampleSize;
+
+	float m_matrix[MaxChannels][2];
+
+	// set when the layout has a dedicated kernel, otherwise every frame goes
+	// through the matrix
+
+	ConvertFunction m_convert;
+};
+
+}
+
+#endif
@@ -0,0 +1,158 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Histogram.h"
+
+namespace dsbridge
+{
+
+Histogram::Histogram()
+{
+	clear();
+}
+
+void Histogram::record(DWORD value)
+{
+	InterlockedIncrement(&m_counts[index(value)]);
+}
+
+void Histogram::clear()
+{
+	for (size_t i = 0; i < BucketCount; ++i)
+	{
+		m_counts[i] = 0;
+	}
+}
+
+void Histogram::copy(Histogram& target) const
+{
+	for (size_t i = 0; i < BucketCount; ++i)
+	{
+		target.m_counts[i] = m_counts[i];
+	}
+}
+
+void Histogram::add(const Histogram& other)
+{
+	for (size_t i = 0; i < BucketCount; ++i)
+	{
+		m_counts[i] += other.m_counts[i];
+	}
+}
+
+void Histogram::subtract(const Histogram& earlier)
+{
+	for (size_t i = 0; i < BucketCount; ++i)
+	{
+		m_counts[i] -= earlier.m_counts[i];
+	}
+}
+
+ULONGLONG Histogram::count() const
+{
+	ULONGLONG result = 0;
+	for (size_t i = 0; i < BucketCount; ++i)
+	{
+		result += static_cast<DWORD>(m_counts[i]);
+	}
+
+	return result;
+}
+
+DWORD Histogram::percentile(double fraction) const
+{
+	ULONGLONG total = count();
+	if (!total)
+	{
+		return 0;
+	}
+
+	// the smallest value at least that fraction of the samples are no larger than
+
+	ULONGLONG target = static_cast<ULONGLONG>(fraction * total + 0.5);
+	target = target ? (target < total ? target : total) : 1;
+
+	ULONGLONG seen = 0;
+	for (size_t i = 0; i < BucketCount; ++i)
+	{
+		seen += static_cast<DWORD>(m_counts[i]);
+		if (seen >= target)
+		{
+			return value(i);
+		}
+	}
+
+	return value(BucketCount - 1);
+}
+
+DWORD Histogram::maximum() const
+{
+	for (size_t i = BucketCount; i > 0; --i)
+	{
+		if (m_counts[i - 1])
+		{
+			return value(i - 1);
+		}
+	}
+
+	return 0;
+}
+
+size_t Histogram::index(DWORD value)
+{
+	if (value < LinearBuckets)
+	{
+		return value;
+	}
+
+	// scaled down until it falls in the top half of the linear range
+
+	size_t shift = 1;
+	while ((value >> shift) >= LinearBuckets)
+	{
+		++shift;
+	}
+
+	return LinearBuckets + (shift - 1) * SubBuckets + ((value >> shift) - SubBuckets);
+}
+
+DWORD Histogram::value(size_t index)
+{
+	if (index < LinearBuckets)
+	{
+		return static_cast<DWORD>(index);
+	}
+
+	// the middle of the bucket
+
+	size_t shift = (index - LinearBuckets) / SubBuckets + 1;
+	DWORD lower = static_cast<DWORD>(((index - LinearBuckets) % SubBuckets + SubBuckets) << shift);
+
+	return lower + (DWORD(1) << (shift - 1));
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef dsbridge_Histogram_h
+#define dsbridge_Histogram_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+// Log-linear histogram of durations in the style of HDR histograms: exact
+// below 64, and 32 buckets per power of two above that, so every value is
+// kept to within about 3% all the way up to an hour of microseconds.
+// Threads record into it without a lock; readers work on a copy.
+
+class Histogram
+{
+public:
+	Histogram();
+
+	void record(DWORD value);
+	void clear();
+
+	void copy(Histogram& target) const;
+	void add(const Histogram& other);
+	void subtract(const Histogram& earlier);
+
+	ULONGLONG count() const;
+	DWORD percentile(double fraction) const;
+	DWORD maximum() const;
+
+private:
+
+	enum
+	{
+		LinearBuckets = 64,
+		SubBuckets = 32,
+		BucketCount = LinearBuckets + 26 * SubBuckets
+	};
+
+	static size_t index(DWORD value);
+	static DWORD value(size_t index);
+
+	volatile LONG m_counts[BucketCount];
+};
+
+}
+
+#endif
@@ -1,686 +1,1588 @@
-/*
-
-Copyright 2009 Jesper Svennevid
-
-Redistribution and use in source and binary forms, with or without
-modification, are permitted provided that the following conditions
-are met:
-
-1. Redistributions of source code must retain the above copyright
-   notice, this list of conditions and the following disclaimer.
-2. Redistributions in binary form must reproduce the above copyright
-   notice, this list of conditions and the following disclaimer in the
-   documentation and/or other materials provided with the distribution.
-
-THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
-IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
-OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
-IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
-INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
-NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
-DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
-THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
-(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
-THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-
-*/
-
-#include "HttpServer.h"
-#include "Notify.h"
-#include "ExceptionHandler.h"
-#include "Configuration.h"
-
-#include <windows.h>
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <time.h>
-
-namespace dsbridge
-{
-
-volatile bool HttpServer::s_isStreaming = false;
-
-HttpServer::HttpServer()
-: m_thread(0)
-, m_socket(-1)
-, m_clients(0)
-, m_clientCount(0)
-, m_running(false)
-, m_lastAnnounce(time(0))
-, m_port(0)
-{}
-
-HttpServer::~HttpServer()
-{
-}
-
-bool HttpServer::create()
-{
-	InitializeCriticalSection(&m_cs);
-
-	if (!m_buffer.create(100 * 1024))
-	{
-		Notify::update(Notify::HttpServer, Notify::Error, "Could not create ringbuffer");
-		return false;
-	}
-
-	m_thread = CreateThread(0, 0, threadEntry, this, CREATE_SUSPENDED, 0);
-	if (!m_thread)
-	{
-		Notify::update(Notify::HttpServer, Notify::Error, "Could not create thread");
-		return false;
-	}
-
-	m_running = true;
-	ResumeThread(m_thread);
-
-	return true;
-}
-
-void HttpServer::destroy()
-{
-	m_running = false;
-	SleepEx(10, FALSE);
-
-	m_thread = 0;
-}
-
-void HttpServer::write(const void* buffer, size_t count)
-{
-	EnterCriticalSection(&m_cs);
-	do
-	{
-		if (m_buffer.left() < count)
-		{
-			m_buffer.seek((m_buffer.left() + m_buffer.written()) / 2);
-		}
-
-		m_buffer.write(buffer, count);
-	}
-	while (0);
-	LeaveCriticalSection(&m_cs);
-}
-
-DWORD WINAPI HttpServer::threadEntry(LPVOID parameters)
-{
-	__try
-	{
-		HttpServer* server = static_cast<HttpServer*>(parameters);
-
-		if (!server->initialize())
-		{
-			return 0;
-		}
-
-		while (server->run())
-		{
-			SleepEx(1, TRUE);
-		}
-
-		server->shutdown();
-
-		Notify::update(Notify::HttpServer, Notify::Info, "Stopped");
-	}
-	__except(ExceptionHandler::filter("HttpServer", GetExceptionInformation()))
-	{
-	}
-	return 0;
-}
-
-bool HttpServer::initialize()
-{
-	int delayNetworking = Configuration::getInteger("DelayNetworking");
-	if (delayNetworking > 0)
-	{
-		SleepEx(delayNetworking, FALSE);
-	}
-
-	int initializeNetworking = Configuration::getInteger("InitializeNetworking");
-	if (initializeNetworking)
-	{
-		WSADATA data;
-		if (WSAStartup(MAKEWORD(2,2), &data))
-		{
-			Notify::update(Notify::HttpServer, Notify::Error, "Could not initialize networking");
-			return false;
-		}
-	}
-
-	m_socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-	if (m_socket < 0)
-	{
-		Notify::update(Notify::HttpServer, Notify::Error, "Could not create socket");
-		return false;
-	}
-
-	SOCKADDR_IN saddr;
-	saddr.sin_family = AF_INET;
-	saddr.sin_addr.S_un.S_addr = INADDR_ANY;
-	saddr.sin_port = htons(m_port = Configuration::getInteger("HTTPPort", 8124));
-	if (::bind(m_socket, reinterpret_cast<SOCKADDR*>(&saddr), sizeof(saddr)) < 0)
-	{
-		Notify::update(Notify::HttpServer, Notify::Error, "Could not bind to port %d", m_port);
-		return false;
-	}
-
-	BOOL reuse = TRUE;
-	if (::setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse)) < 0)
-	{
-		Notify::update(Notify::HttpServer, Notify::Error, "Could not set SO_REUSEADDR");
-		return false;
-	}
-
-	ULONG nonblock = 1;
-	if (::ioctlsocket(m_socket, FIONBIO, &nonblock) < 0)
-	{
-		Notify::update(Notify::HttpServer, Notify::Error, "Could not set server to non-blocking");
-		return false;
-	}
-
-	if (::listen(m_socket, 1) < 0)
-	{
-		Notify::update(Notify::HttpServer, Notify::Error, "Could not start listening to port");
-		return false;
-	}
-
-	Notify::update(Notify::HttpServer, Notify::Info, "Listening on port %d", m_port);
-	return true;
-}
-
-bool HttpServer::run()
-{
-	fd_set rfds;
-	fd_set wfds;
-
-	FD_ZERO(&rfds);
-	FD_ZERO(&wfds);
-
-	FD_SET(m_socket, &rfds);
-
-	time_t newAnnounce = time(0);
-	if ((newAnnounce - m_lastAnnounce) > 5)
-	{
-		Notify::setConnected(m_clientCount > 0);
-		Notify::update(Notify::HttpServer, Notify::Info, "http://localhost:%d/", m_port);
-		m_lastAnnounce = newAnnounce;
-	}
-
-	for (unsigned int i = 0; i < m_clientCount; ++i)
-	{
-		Client& client = m_clients[i];
-		switch (client.m_state)
-		{
-			case Header:
-			{
-				FD_SET(client.m_socket, &rfds);
-			}
-			break;
-
-			case Close:
-			case Streaming:
-			case Cover:
-			{
-				FD_SET(client.m_socket, &wfds);
-			}
-			break;
-		}
-	}
-
-	timeval timeout = {0};
-	int fd = ::select(0, &rfds, &wfds, 0, &timeout);
-	if (fd < 0)
-	{
-		Notify::update(Notify::HttpServer, Notify::Error, "select() failed - %d", fd);
-		return false;
-	}
-	else if (!fd)
-	{
-		return m_running;
-	}
-
-	bool isStreaming = false;
-	for (unsigned int i = 0; i < m_clientCount; ++i)
-	{
-		Client& client = m_clients[i];
-
-		switch (client.m_state)
-		{
-			case Header:
-			{
-				if (!FD_ISSET(client.m_socket, &rfds))
-				{
-					break;
-				}
-
-				int result = ::recv(client.m_socket, client.m_buffer + client.m_bufferSize, int(sizeof(client.m_buffer) - client.m_bufferSize), 0);
-				if (result <= 0)
-				{
-					client.m_state = Close;
-					client.m_bufferSize = client.m_bufferOffset = 0;
-					break;
-				}
-
-				client.m_bufferSize += result;
-
-				processHeader(client);
-			}
-			break;
-
-			case Close:
-			{
-				if (!FD_ISSET(client.m_socket, &wfds))
-				{
-					break;
-				}
-
-				int result = ::send(client.m_socket, client.m_buffer + client.m_bufferOffset, int(client.m_bufferSize - client.m_bufferOffset), 0);
-				if (result == SOCKET_ERROR)
-				{
-					client.m_state = Close;	
-					client.m_bufferSize = client.m_bufferOffset = 0;
-					break;
-				}
-
-				client.m_bufferOffset += result;
-			}
-			break;
-
-			case Streaming:
-			{
-				isStreaming = true;
-
-				if (!FD_ISSET(client.m_socket, &wfds))
-				{
-					break;
-				}
-
-				processStreaming(client);
-
-				int result = ::send(client.m_socket, client.m_buffer + client.m_bufferOffset, int(client.m_bufferSize - client.m_bufferOffset), 0);
-				if (result == SOCKET_ERROR)
-				{
-					client.m_state = Close;	
-					client.m_bufferSize = client.m_bufferOffset = 0;
-					break;
-				}
-
-				client.m_bufferOffset += result;
-			}
-			break;
-
-			case Cover:
-			{
-				if (!FD_ISSET(client.m_socket, &wfds))
-				{
-					break;
-				}
-
-				processCover(client);
-
-				int result = ::send(client.m_socket, client.m_buffer + client.m_bufferOffset, int(client.m_bufferSize - client.m_bufferOffset), 0);
-				if (result == SOCKET_ERROR)
-				{
-					client.m_state = Close;	
-					client.m_bufferSize = client.m_bufferOffset = 0;
-					break;
-				}
-
-				client.m_bufferOffset += result;
-			}
-			break;
-		}
-	}
-
-	for (unsigned int i = 0; i < m_clientCount;)
-	{
-		Client& client = m_clients[i];
-		if ((client.m_state != Close) || (client.m_bufferSize != client.m_bufferOffset))
-		{
-			++i;
-			continue;
-		}
-
-		delete client.m_cover;
-
-		::closesocket(client.m_socket);
-
-		::memmove(&client, &client + 1, sizeof(Client) * (m_clientCount - (i+1)));
-		--m_clientCount;
-	}
-
-	s_isStreaming = isStreaming && (m_clientCount > 0);
-
-	if (FD_ISSET(m_socket, &rfds))
-	{
-		SOCKADDR_IN saddr;
-		int saddrlen = sizeof(saddr);
-		SOCKET clientSocket = ::accept(m_socket, reinterpret_cast<SOCKADDR*>(&saddr), &saddrlen);
-		if (clientSocket != INVALID_SOCKET)
-		{
-			Client* clients = new Client[m_clientCount + 1];
-			if (m_clientCount > 0)
-			{
-				memcpy(clients, m_clients, m_clientCount * sizeof(Client));
-				delete [] m_clients;
-			}
-
-			clients[m_clientCount].m_socket = clientSocket;
-			clients[m_clientCount].m_state = Header;
-
-			m_clients = clients;
-			++ m_clientCount;
-		}
-	}
-
-	return m_running;
-}
-
-void HttpServer::shutdown()
-{
-	::closesocket(m_socket);
-	m_socket = -1;
-}
-
-void HttpServer::processHeader(Client& client)
-{
-	enum State
-	{
-		ParseRequest,
-		ParseHeader
-	} state = ParseRequest;
-	ClientState clientState = Close;
-
-	for (const char* begin = client.m_buffer, *end = client.m_buffer + client.m_bufferSize; (begin != end) && (client.m_state == Header);)
-	{
-		const char* eol = begin;
-		while ((eol != end) && (*eol != '\r') && (*eol != '\n')) ++eol;
-
-		if (eol == end)
-		{
-			break;
-		}
-
-		switch (state)
-		{
-			case ParseRequest:
-			{
-				const char* curr = begin;
-				const char* methodBegin = curr;
-				const char* methodEnd = methodBegin;
-				while ((methodEnd != eol) && (*methodEnd != ' ')) ++methodEnd;
-
-				if ((methodEnd == eol) || ((methodEnd-methodBegin) != 3) || ::_strnicmp(methodBegin, "GET", 3))
-				{
-					client.m_state = Close;
-					sprintf_s(client.m_buffer, sizeof(client.m_buffer), "HTTP/1.0 405 Method Not Allowed\r\nAllow: GET\r\n\r\n");
-					client.m_bufferSize = static_cast<int>(::strlen(client.m_buffer));
-					client.m_bufferOffset = 0;
-					break;
-				}
-				curr = methodEnd + 1;
-
-				const char* uriBegin = curr;
-				const char* uriEnd = uriBegin;
-				while ((uriEnd != eol) && (*uriEnd != ' ')) ++uriEnd;
-
-				static int coverArtEnabled = Configuration::getInteger("CoverArt");
-
-				if ((uriEnd != eol) && ((uriEnd-uriBegin) == 1) && !::_strnicmp(uriBegin, "/", 1))
-				{
-					clientState = Streaming;
-				}
-				else if ((uriEnd != eol) && ((uriEnd-uriBegin) >= 6) && !::_strnicmp(uriBegin, "/cover", 6) && coverArtEnabled)
-				{
-					clientState = Cover;
-				}
-				else
-				{
-					client.m_state = Close;
-					sprintf_s(client.m_buffer, sizeof(client.m_buffer), "HTTP/1.0 404 Not Found\r\n\r\n");
-					client.m_bufferSize = static_cast<int>(::strlen(client.m_buffer));
-					client.m_bufferOffset = 0;
-					break;
-				}
-				curr = uriEnd + 1;
-
-				if (((eol-curr) != 8) || (::_strnicmp(curr,"HTTP/1.0",8) && ::_strnicmp(curr,"HTTP/1.1",8)))
-				{
-					client.m_state = Close;
-					sprintf_s(client.m_buffer, sizeof(client.m_buffer), "HTTP/1.0 505 HTTP Version Not Supported\r\n\r\n");
-					client.m_bufferSize = static_cast<int>(::strlen(client.m_buffer));
-					client.m_bufferOffset = 0;
-					break;
-				}
-
-				state = ParseHeader;
-			}
-			break;
-
-			case ParseHeader:
-			{
-				if (begin == eol)
-				{
-					client.m_state = clientState;
-					sprintf_s(client.m_buffer, sizeof(client.m_buffer), "HTTP/1.0 200 OK\r\n");
-
-					if (client.m_metaData)
-					{
-						sprintf_s(client.m_buffer, sizeof(client.m_buffer), "%sicy-metaint: %d\r\n", client.m_buffer, s_metaSize);
-					}
-
-					if (client.m_state == Cover)
-					{
-						sprintf_s(client.m_buffer, sizeof(client.m_buffer), "%sContent-Type: image/png\r\n", client.m_buffer);
-					}
-					else if (client.m_state == Streaming)
-					{
-					sprintf_s(client.m_buffer, sizeof(client.m_buffer), "%sContent-Type: audio/mpeg\r\n", client.m_buffer);
-					}
-
-					sprintf_s(client.m_buffer, sizeof(client.m_buffer), "%s\r\n", client.m_buffer);
-
-					client.m_bufferSize = static_cast<int>(::strlen(client.m_buffer));
-					client.m_metaOffset = s_metaSize;
-					break;
-				}
-
-				const char* headerEnd = begin;
-				while ((headerEnd != eol) && (*headerEnd != ':')) ++headerEnd;
-
-				if (headerEnd == eol)
-				{
-					break;
-				}
-				const char* valueBegin = headerEnd + 1;
-				while ((valueBegin != eol) && (*valueBegin == ' ')) ++valueBegin;
-
-				if (((headerEnd - begin) == 12) && !::_strnicmp(begin, "Icy-MetaData", 12))
-				{
-					const char* value = begin;
-					while ((eol != end) && (*eol == ' ')) ++eol;
-
-					if (::strtoul(begin + 13, 0, 10) > 0)
-					{
-						client.m_metaData = true;
-					}
-				}
-
-				if (((headerEnd - begin) == 4) && !::_strnicmp(begin, "Host", 4))
-				{
-					::memset(client.m_host, 0, sizeof(client.m_host));
-					::strncpy_s(client.m_host, sizeof(client.m_host), valueBegin, eol - valueBegin);
-				}
-			}
-			break;
-		}
-
-		while ((eol != end) && (*eol == '\r')) ++eol;
-		while ((eol != end) && (*eol == '\n')) ++eol;
-		begin = eol;
-	}
-
-	if ((client.m_bufferSize == sizeof(client.m_buffer)) && (client.m_state == Header))
-	{
-		client.m_state = Close;
-		client.m_bufferSize = client.m_bufferOffset = 0;
-	}
-}
-
-void HttpServer::processStreaming(Client& client)
-{
-	do
-	{
-		if (client.m_bufferOffset != client.m_bufferSize)
-		{
-			break;
-		}
-
-		client.m_bufferOffset = client.m_bufferSize = 0;
-
-		if (client.m_metaOffset > 0)
-		{
-			break;
-		}
-
-		client.m_metaOffset = s_metaSize;
-
-		if (!client.m_metaData)
-		{
-			break;
-		}
-
-		char windowTitle[256];
-		if (!GetWindowText(Notify::window(), windowTitle, sizeof(windowTitle)))
-		{
-			windowTitle[0] = '\0';
-		}
-
-		unsigned int newHash = hash(windowTitle, ::strlen(windowTitle));
-		if (newHash == client.m_titleHash && !client.m_sendCover)
-		{
-			client.m_buffer[0] = '\0';
-			client.m_bufferSize = 1;
-			break;
-		}
-
-		char* buf = client.m_buffer+1;
-		size_t bufsize = sizeof(client.m_buffer)-1;
-		static int coverArtEnabled = Configuration::getInteger("CoverArt");
-		if (newHash != client.m_titleHash)
-		{
-			char* activeTitle = windowTitle;
-			static const char* titlePrefix = Configuration::getString("TitlePrefix");
-			if (!::_strnicmp(activeTitle, titlePrefix, ::strlen(titlePrefix)))
-			{
-				activeTitle += ::strlen(titlePrefix);
-			}
-
-			for (size_t i = 0, n = ::strlen(activeTitle); i < n; ++i)
-			{
-				char& c = activeTitle[i];
-
-				switch (c)
-				{
-					case -106: c = '-'; break;
-					case -107: c = '-'; break;
-				}
-			}
-
-			sprintf_s(buf, bufsize, "StreamTitle='%s';", activeTitle);
-			client.m_sendCover = Notify::window() && (::strlen(client.m_host) > 0) && coverArtEnabled;
-		}
-		else if (client.m_sendCover)
-		{
-			sprintf_s(buf, bufsize, "StreamUrl='http://%s/cover/%d.png';", client.m_host, time(0));
-			client.m_sendCover = false;
-		}
-		size_t length = ::strlen(buf) + 1;
-		size_t fill = ((length + 15) & ~15) - length;
-		size_t packetLength = length + fill;
-
-		memset(buf + length, 0, fill);
-
-		client.m_buffer[0] = char(packetLength / 16);
-
-		client.m_bufferSize = packetLength + 1;
-		client.m_titleHash = newHash;
-	}
-	while (0);
-
-	size_t maxRead = client.m_metaOffset < (sizeof(client.m_buffer) - client.m_bufferSize) ? client.m_metaOffset : sizeof(client.m_buffer) - client.m_bufferSize;
-	if (!maxRead)
-	{
-		return;
-	}
-
-	EnterCriticalSection(&m_cs);
-	do
-	{
-		size_t actual = m_buffer.read(client.m_buffer + client.m_bufferSize, maxRead);
-		client.m_bufferSize += actual;	
-		client.m_metaOffset -= actual;
-	}
-	while (0);
-	LeaveCriticalSection(&m_cs);
-}
-
-unsigned int HttpServer::hash(const char* str, size_t length)
-{
-	unsigned int hash = 0;
-
-	for(unsigned int i = 0; i < length; ++str, ++i)
-	{
-		unsigned int x;
-
-		hash = (hash << 4) + (*str);
-
-		if((x = hash & 0xF0000000L) != 0)
-		{
-			hash ^= (x >> 24);
-		}
-
-		hash &= ~x;
-	}
-
-	return hash;
-}
-
-void HttpServer::processCover(Client& client)
-{
-	int i = 0;
-
-	if (!client.m_cover)
-	{
-		client.m_cover = CoverExtractor::getCoverImage(Notify::window());
-		if (!client.m_cover)
-		{
-			client.m_state = Close;
-		}
-	}
-
-	do
-	{
-		if (client.m_bufferOffset != client.m_bufferSize)
-		{
-			break;
-		}
-
-		if (client.m_coverOffset == client.m_cover->length)
-		{
-			client.m_state = Close;
-			break;
-		}
-
-		size_t maxCopy = (client.m_cover->length - client.m_coverOffset) > sizeof(client.m_buffer) ? sizeof(client.m_buffer) : (client.m_cover->length - client.m_coverOffset);
-
-		::memcpy_s(client.m_buffer, sizeof(client.m_buffer), client.m_cover->image + client.m_coverOffset, maxCopy);
-
-		client.m_bufferOffset = 0;
-		client.m_bufferSize = maxCopy;
-		client.m_coverOffset += maxCopy;
-	}
-	while (0);
-}
-
-}
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "HttpServer.h"
+#include "Capture.h"
+#include "Mount.h"
+#include "Latency.h"
+#include "Notify.h"
+#include "ExceptionHandler.h"
+#include "Configuration.h"
+#include "FlightRecorder.h"
+#include "Trace.h"
+#include "Watchdog.h"
+
+#include <windows.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+namespace dsbridge
+{
+
+extern Capture g_capture;
+
+volatile bool HttpServer::s_isStreaming = false;
+
+HttpServer::HttpServer()
+: m_thread(0)
+, m_listening(0)
+, m_socket(-1)
+, m_clients(0)
+, m_clientCount(0)
+, m_running(false)
+, m_abandoned(false)
+, m_handedOver(false)
+, m_heartbeat(0)
+, m_lastAnnounce(time(0))
+, m_port(0)
+, m_zeroCopy(false)
+, m_rates(0)
+{
+	m_lastSample.QuadPart = 0;
+}
+
+HttpServer::~HttpServer()
+{
+	if (m_listening)
+	{
+		CloseHandle(m_listening);
+	}
+}
+
+bool HttpServer::create(HttpServer* replaced)
+{
+	m_listening = CreateEvent(0, TRUE, FALSE, 0);
+	if (!m_listening)
+	{
+		Notify::update(Notify::HttpServer, Notify::Error, "Could not create event");
+		return false;
+	}
+
+	m_thread = CreateThread(0, 0, threadEntry, this, CREATE_SUSPENDED, 0);
+	if (!m_thread)
+	{
+		Notify::update(Notify::HttpServer, Notify::Error, "Could not create thread");
+		return false;
+	}
+
+	// a replacement never binds the port while the server it replaces still
+	// listens on it, where new connections could be queued for a server that
+	// never accepts them; it carries on with the same socket instead
+
+	if (replaced)
+	{
+		m_socket = replaced->m_socket;
+		m_port = replaced->m_port;
+		replaced->m_handedOver = true;
+	}
+
+	m_running = true;
+	ResumeThread(m_thread);
+
+	return true;
+}
+
+void HttpServer::destroy()
+{
+	Configuration::unsubscribe(settingsChanged, this);
+
+	m_running = false;
+	SleepEx(10, FALSE);
+
+	m_thread = 0;
+}
+
+bool HttpServer::waitListening(DWORD timeout)
+{
+	// the thread ends straight away if it cannot listen
+
+	HANDLE handles[] = { m_listening, m_thread };
+	return WaitForMultipleObjects(2, handles, FALSE, timeout) == WAIT_OBJECT_0;
+}
+
+void HttpServer::abandon()
+{
+	Configuration::unsubscribe(settingsChanged, this);
+
+	// only the thread closes its sockets. From here one could be closed
+	// under a call the thread is still in, and Winsock may hand the same
+	// handle out again before the thread gets to use it
+
+	m_abandoned = true;
+	m_running = false;
+}
+
+void HttpServer::settingsChanged(void* context)
+{
+	static_cast<HttpServer*>(context)->m_zeroCopy = Configuration::getBool("ZeroCopySend");
+}
+
+DWORD WINAPI HttpServer::threadEntry(LPVOID parameters)
+{
+	__try
+	{
+		HttpServer* server = static_cast<HttpServer*>(parameters);
+
+		if (!server->initialize())
+		{
+			return 0;
+		}
+
+		while (server->run())
+		{
+			SleepEx(1, TRUE);
+		}
+
+		// an abandoned server gets here once it is unstuck, and its listeners
+		// are let go of and stop counting against their mounts like any other
+
+		server->shutdown();
+
+		Notify::update(Notify::HttpServer, Notify::Info, server->m_abandoned ? "Abandoned server stopped" : "Stopped");
+	}
+	__except(ExceptionHandler::filter("HttpServer", GetExceptionInformation()))
+	{
+	}
+	return 0;
+}
+
+bool HttpServer::initialize()
+{
+	if ((m_socket == INVALID_SOCKET) && !openListener())
+	{
+		return false;
+	}
+
+	m_zeroCopy = Configuration::getBool("ZeroCopySend");
+	Configuration::subscribe("ZeroCopySend", settingsChanged, this);
+
+	Notify::update(Notify::HttpServer, Notify::Info, "Listening on port %d", m_port);
+	SetEvent(m_listening);
+
+	return true;
+}
+
+bool HttpServer::openListener()
+{
+	int delayNetworking = Configuration::getInteger("DelayNetworking");
+	if (delayNetworking > 0)
+	{
+		SleepEx(delayNetworking, FALSE);
+	}
+
+	int initializeNetworking = Configuration::getInteger("InitializeNetworking");
+	if (initializeNetworking)
+	{
+		WSADATA data;
+		if (WSAStartup(MAKEWORD(2,2), &data))
+		{
+			Notify::update(Notify::HttpServer, Notify::Error, "Could not initialize networking");
+			return false;
+		}
+	}
+
+	m_socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (m_socket < 0)
+	{
+		Notify::update(Notify::HttpServer, Notify::Error, "Could not create socket");
+		return false;
+	}
+
+	SOCKADDR_IN saddr;
+	saddr.sin_family = AF_INET;
+	saddr.sin_addr.S_un.S_addr = INADDR_ANY;
+	saddr.sin_port = htons(m_port = Configuration::getInteger("HTTPPort", 8124));
+
+	// nothing else may bind the port alongside this socket and take its
+	// connections; a restarted server takes the socket itself over
+
+	BOOL exclusive = TRUE;
+	if (::setsockopt(m_socket, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, reinterpret_cast<const char*>(&exclusive), sizeof(exclusive)) < 0)
+	{
+		Notify::update(Notify::HttpServer, Notify::Error, "Could not set SO_EXCLUSIVEADDRUSE");
+		return false;
+	}
+
+	if (::bind(m_socket, reinterpret_cast<SOCKADDR*>(&saddr), sizeof(saddr)) < 0)
+	{
+		Notify::update(Notify::HttpServer, Notify::Error, "Could not bind to port %d", m_port);
+		return false;
+	}
+
+	ULONG nonblock = 1;
+	if (::ioctlsocket(m_socket, FIONBIO, &nonblock) < 0)
+	{
+		Notify::update(Notify::HttpServer, Notify::Error, "Could not set server to non-blocking");
+		return false;
+	}
+
+	if (::listen(m_socket, 1) < 0)
+	{
+		Notify::update(Notify::HttpServer, Notify::Error, "Could not start listening to port");
+		return false;
+	}
+
+	return true;
+}
+
+bool HttpServer::run()
+{
+	fd_set rfds;
+	fd_set wfds;
+
+	// an abandoned server stops before it touches a socket again
+
+	if (!m_running)
+	{
+		return false;
+	}
+
+	FD_ZERO(&rfds);
+	FD_ZERO(&wfds);
+
+	if (!m_handedOver)
+	{
+		FD_SET(m_socket, &rfds);
+	}
+
+	m_heartbeat = m_heartbeat + 1;
+
+	completeDirectSends();
+
+	time_t newAnnounce = time(0);
+	if ((newAnnounce - m_lastAnnounce) > 5)
+	{
+		Notify::setConnected(m_clientCount > 0);
+		Notify::update(Notify::HttpServer, Notify::Info, "http://localhost:%d/", m_port);
+		m_lastAnnounce = newAnnounce;
+	}
+
+	Latency::update();
+	sample();
+
+	for (unsigned int i = 0; i < m_clientCount; ++i)
+	{
+		Client& client = *m_clients[i];
+		switch (client.m_state)
+		{
+			case Header:
+			{
+				FD_SET(client.m_socket, &rfds);
+			}
+			break;
+
+			case Close:
+			case Streaming:
+			case Cover:
+			case Report:
+			{
+				FD_SET(client.m_socket, &wfds);
+			}
+			break;
+		}
+	}
+
+	timeval timeout = {0};
+	int fd = ::select(0, &rfds, &wfds, 0, &timeout);
+	if (fd < 0)
+	{
+		Notify::update(Notify::HttpServer, Notify::Error, "select() failed - %d", fd);
+		return false;
+	}
+	else if (!fd)
+	{
+		return m_running;
+	}
+
+	bool isStreaming = false;
+	for (unsigned int i = 0; i < m_clientCount; ++i)
+	{
+		Client& client = *m_clients[i];
+
+		switch (client.m_state)
+		{
+			case Header:
+			{
+				if (!FD_ISSET(client.m_socket, &rfds))
+				{
+					break;
+				}
+
+				int result = ::recv(client.m_socket, client.m_buffer + client.m_bufferSize, int(sizeof(client.m_buffer) - client.m_bufferSize), 0);
+				if (result <= 0)
+				{
+					client.m_state = Close;
+					client.m_bufferSize = client.m_bufferOffset = 0;
+					break;
+				}
+
+				client.m_bufferSize += result;
+
+				processHeader(client);
+			}
+			break;
+
+			case Close:
+			{
+				if (!FD_ISSET(client.m_socket, &wfds))
+				{
+					break;
+				}
+
+				int result = ::send(client.m_socket, client.m_buffer + client.m_bufferOffset, int(client.m_bufferSize - client.m_bufferOffset), 0);
+				if (result == SOCKET_ERROR)
+				{
+					client.m_state = Close;	
+					client.m_bufferSize = client.m_bufferOffset = 0;
+					break;
+				}
+
+				client.m_bufferOffset += result;
+			}
+			break;
+
+			case Streaming:
+			{
+				isStreaming = true;
+
+				if (!FD_ISSET(client.m_socket, &wfds))
+				{
+					break;
+				}
+
+				processStreaming(client);
+
+				if (client.m_bufferOffset == client.m_bufferSize)
+				{
+					break;
+				}
+
+				int result = ::send(client.m_socket, client.m_buffer + client.m_bufferOffset, int(client.m_bufferSize - client.m_bufferOffset), 0);
+				if (result == SOCKET_ERROR)
+				{
+					client.m_state = Close;	
+					client.m_bufferSize = client.m_bufferOffset = 0;
+					break;
+				}
+
+				client.m_bufferOffset += result;
+				client.m_sentBytes += result;
+
+				++ m_statistics.copySends;
+				m_statistics.copyBytes += result;
+			}
+			break;
+
+			case Report:
+			{
+				if (!FD_ISSET(client.m_socket, &wfds))
+				{
+					break;
+				}
+
+				processReport(client);
+
+				int result = ::send(client.m_socket, client.m_buffer + client.m_bufferOffset, int(client.m_bufferSize - client.m_bufferOffset), 0);
+				if (result == SOCKET_ERROR)
+				{
+					client.m_state = Close;	
+					client.m_bufferSize = client.m_bufferOffset = 0;
+					break;
+				}
+
+				client.m_bufferOffset += result;
+			}
+			break;
+
+			case Cover:
+			{
+				if (!FD_ISSET(client.m_socket, &wfds))
+				{
+					break;
+				}
+
+				processCover(client);
+
+				int result = ::send(client.m_socket, client.m_buffer + client.m_bufferOffset, int(client.m_bufferSize - client.m_bufferOffset), 0);
+				if (result == SOCKET_ERROR)
+				{
+					client.m_state = Close;	
+					client.m_bufferSize = client.m_bufferOffset = 0;
+					break;
+				}
+
+				client.m_bufferOffset += result;
+			}
+			break;
+		}
+	}
+
+	for (unsigned int i = 0; i < m_clientCount;)
+	{
+		Client& client = *m_clients[i];
+		if ((client.m_state != Close) || (client.m_bufferSize != client.m_bufferOffset) || client.m_sendPending)
+		{
+			++i;
+			continue;
+		}
+
+		removeClient(i);
+	}
+
+	s_isStreaming = isStreaming && (m_clientCount > 0);
+
+	if (!m_handedOver && FD_ISSET(m_socket, &rfds))
+	{
+		SOCKADDR_IN saddr;
+		int saddrlen = sizeof(saddr);
+		SOCKET clientSocket = ::accept(m_socket, reinterpret_cast<SOCKADDR*>(&saddr), &saddrlen);
+		if (clientSocket != INVALID_SOCKET)
+		{
+			Client** clients = new Client*[m_clientCount + 1];
+			if (m_clientCount > 0)
+			{
+				memcpy(clients, m_clients, m_clientCount * sizeof(Client*));
+				delete [] m_clients;
+			}
+
+			clients[m_clientCount] = new Client;
+			clients[m_clientCount]->m_socket = clientSocket;
+			clients[m_clientCount]->m_state = Header;
+
+			sprintf_s(clients[m_clientCount]->m_address, sizeof(clients[m_clientCount]->m_address), "%s:%d", ::inet_ntoa(saddr.sin_addr), ntohs(saddr.sin_port));
+			QueryPerformanceCounter(&clients[m_clientCount]->m_connectTime);
+
+			FlightRecorder::record(FlightRecorder::ClientConnected, m_clientCount + 1, saddr.sin_addr.s_addr, ntohs(saddr.sin_port));
+
+			m_clients = clients;
+			++ m_clientCount;
+		}
+	}
+
+	return m_running;
+}
+
+void HttpServer::shutdown()
+{
+	while (m_clientCount > 0)
+	{
+		removeClient(m_clientCount - 1);
+	}
+
+	// a socket handed over is the replacement's to close
+
+	if (!m_handedOver)
+	{
+		::closesocket(m_socket);
+	}
+	m_socket = -1;
+
+	delete [] m_rates;
+	m_rates = 0;
+}
+
+void HttpServer::removeClient(unsigned int index)
+{
+	Client* client = m_clients[index];
+
+	if (client->m_sendPending)
+	{
+		DWORD transferred;
+		::CancelIo(reinterpret_cast<HANDLE>(client->m_socket));
+		::GetOverlappedResult(reinterpret_cast<HANDLE>(client->m_socket), &client->m_overlapped, &transferred, TRUE);
+		client->m_sendPending = false;
+	}
+
+	if (client->m_overlapped.hEvent)
+	{
+		::CloseHandle(client->m_overlapped.hEvent);
+	}
+
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+
+	FlightRecorder::record(FlightRecorder::ClientDropped, client->m_mount ? client->m_mount->index() : 0xffffffff, static_cast<DWORD>(client->m_sentBytes / 1024), static_cast<DWORD>((now.QuadPart - client->m_connectTime.QuadPart) / freq.QuadPart));
+
+	if (client->m_mount)
+	{
+		if (client->m_latencyCount)
+		{
+			Notify::update(Notify::HttpServer, Notify::Info, "%s listener left, %d ms average and %d ms worst from mix to socket, skipped ahead %d times", client->m_mount->path(), static_cast<int>(client->m_latencySum / client->m_latencyCount), static_cast<int>(client->m_latencyMax), client->m_skips);
+		}
+
+		client->m_mount->removeListener();
+	}
+
+	delete client->m_cover;
+	delete [] client->m_report;
+
+	::closesocket(client->m_socket);
+
+	delete client;
+
+	::memmove(m_clients + index, m_clients + index + 1, sizeof(Client*) * (m_clientCount - (index+1)));
+	--m_clientCount;
+
+	updateReclaimLimit();
+}
+
+void HttpServer::processHeader(Client& client)
+{
+	enum State
+	{
+		ParseRequest,
+		ParseHeader
+	} state = ParseRequest;
+	ClientState clientState = Close;
+	Mount* mount = 0;
+	bool latency = false;
+
+	enum
+	{
+		StatusPage,
+		MetricsPage,
+		EventsPage,
+#if DSBRIDGE_TRACE
+		TracePage,
+		TraceEventsPage
+#endif
+	} page = StatusPage;
+
+	for (const char* begin = client.m_buffer, *end = client.m_buffer + client.m_bufferSize; (begin != end) && (client.m_state == Header);)
+	{
+		const char* eol = begin;
+		while ((eol != end) && (*eol != '\r') && (*eol != '\n')) ++eol;
+
+		if (eol == end)
+		{
+			break;
+		}
+
+		switch (state)
+		{
+			case ParseRequest:
+			{
+				const char* curr = begin;
+				const char* methodBegin = curr;
+				const char* methodEnd = methodBegin;
+				while ((methodEnd != eol) && (*methodEnd != ' ')) ++methodEnd;
+
+				if ((methodEnd == eol) || ((methodEnd-methodBegin) != 3) || ::_strnicmp(methodBegin, "GET", 3))
+				{
+					client.m_state = Close;
+					sprintf_s(client.m_buffer, sizeof(client.m_buffer), "HTTP/1.0 405 Method Not Allowed\r\nAllow: GET\r\n\r\n");
+					client.m_bufferSize = static_cast<int>(::strlen(client.m_buffer));
+					client.m_bufferOffset = 0;
+					break;
+				}
+				curr = methodEnd + 1;
+
+				const char* uriBegin = curr;
+				const char* uriEnd = uriBegin;
+				while ((uriEnd != eol) && (*uriEnd != ' ')) ++uriEnd;
+
+				bool coverArtEnabled = Configuration::getBool("CoverArt");
+
+				if ((uriEnd != eol) && ((mount = Mount::find(uriBegin, uriEnd-uriBegin)) != 0))
+				{
+					clientState = Streaming;
+				}
+				else if ((uriEnd != eol) && ((uriEnd-uriBegin) >= 6) && !::_strnicmp(uriBegin, "/cover", 6) && coverArtEnabled)
+				{
+					clientState = Cover;
+				}
+				else if ((uriEnd != eol) && ((uriEnd-uriBegin) == 8) && !::_strnicmp(uriBegin, "/latency", 8))
+				{
+					latency = true;
+				}
+				else if ((uriEnd != eol) && ((uriEnd-uriBegin) == 12) && !::_strnicmp(uriBegin, "/status.json", 12))
+				{
+					clientState = Report;
+				}
+				else if ((uriEnd != eol) && ((uriEnd-uriBegin) == 8) && !::_strnicmp(uriBegin, "/metrics", 8))
+				{
+					clientState = Report;
+					page = MetricsPage;
+				}
+				else if ((uriEnd != eol) && ((uriEnd-uriBegin) == 12) && !::_strnicmp(uriBegin, "/events.json", 12))
+				{
+					clientState = Report;
+					page = EventsPage;
+				}
+#if DSBRIDGE_TRACE
+				else if ((uriEnd != eol) && ((uriEnd-uriBegin) == 6) && !::_strnicmp(uriBegin, "/trace", 6))
+				{
+					clientState = Report;
+					page = TracePage;
+				}
+				else if ((uriEnd != eol) && ((uriEnd-uriBegin) == 11) && !::_strnicmp(uriBegin, "/trace.json", 11))
+				{
+					clientState = Report;
+					page = TraceEventsPage;
+				}
+#endif
+				else
+				{
+					client.m_state = Close;
+					sprintf_s(client.m_buffer, sizeof(client.m_buffer), "HTTP/1.0 404 Not Found\r\n\r\n");
+					client.m_bufferSize = static_cast<int>(::strlen(client.m_buffer));
+					client.m_bufferOffset = 0;
+					break;
+				}
+				curr = uriEnd + 1;
+
+				if (((eol-curr) != 8) || (::_strnicmp(curr,"HTTP/1.0",8) && ::_strnicmp(curr,"HTTP/1.1",8)))
+				{
+					client.m_state = Close;
+					sprintf_s(client.m_buffer, sizeof(client.m_buffer), "HTTP/1.0 505 HTTP Version Not Supported\r\n\r\n");
+					client.m_bufferSize = static_cast<int>(::strlen(client.m_buffer));
+					client.m_bufferOffset = 0;
+					break;
+				}
+
+				state = ParseHeader;
+			}
+			break;
+
+			case ParseHeader:
+			{
+				if (begin == eol)
+				{
+					client.m_state = clientState;
+					sprintf_s(client.m_buffer, sizeof(client.m_buffer), "HTTP/1.0 200 OK\r\n");
+
+					if (client.m_metaData)
+					{
+						sprintf_s(client.m_buffer, sizeof(client.m_buffer), "%sicy-metaint: %d\r\n", client.m_buffer, s_metaSize);
+					}
+
+					if (client.m_state == Cover)
+					{
+						sprintf_s(client.m_buffer, sizeof(client.m_buffer), "%sContent-Type: image/png\r\n", client.m_buffer);
+					}
+					else if (client.m_state == Streaming)
+					{
+						sprintf_s(client.m_buffer, sizeof(client.m_buffer), "%sContent-Type: %s\r\n", client.m_buffer, mount->contentType());
+					}
+					else if (latency)
+					{
+						sprintf_s(client.m_buffer, sizeof(client.m_buffer), "%sContent-Type: text/plain\r\n", client.m_buffer);
+					}
+#if DSBRIDGE_TRACE
+					else if ((client.m_state == Report) && (page == TracePage))
+					{
+						sprintf_s(client.m_buffer, sizeof(client.m_buffer), "%sContent-Type: text/plain\r\n", client.m_buffer);
+					}
+#endif
+					else if (client.m_state == Report)
+					{
+						sprintf_s(client.m_buffer, sizeof(client.m_buffer), "%sContent-Type: %s\r\n", client.m_buffer, page == MetricsPage ? "text/plain; version=0.0.4" : "application/json");
+					}
+
+					sprintf_s(client.m_buffer, sizeof(client.m_buffer), "%s\r\n", client.m_buffer);
+
+					client.m_bufferSize = static_cast<int>(::strlen(client.m_buffer));
+
+					// the whole report goes out with the header, and the client is closed once it is sent
+
+					if (latency)
+					{
+						client.m_bufferSize += Latency::report(client.m_buffer + client.m_bufferSize, sizeof(client.m_buffer) - client.m_bufferSize);
+					}
+
+					// status pages are rendered right away, from counters the audio
+					// threads publish without taking any locks
+
+					if (client.m_state == Report)
+					{
+						switch (page)
+						{
+							case StatusPage:
+							{
+								renderStatus(client);
+							}
+							break;
+
+							case MetricsPage:
+							{
+								renderMetrics(client);
+							}
+							break;
+
+							case EventsPage:
+							{
+								renderEvents(client);
+							}
+							break;
+
+#if DSBRIDGE_TRACE
+							case TracePage:
+							{
+								client.m_reportCapacity = Trace::ReportSize;
+								client.m_report = new char[client.m_reportCapacity];
+								client.m_reportSize = Trace::report(client.m_report, client.m_reportCapacity);
+							}
+							break;
+
+							case TraceEventsPage:
+							{
+								client.m_report = Trace::events(client.m_reportSize);
+								client.m_reportCapacity = client.m_reportSize;
+							}
+							break;
+#endif
+						}
+					}
+					client.m_metaOffset = s_metaSize;
+
+					if (client.m_state == Streaming)
+					{
+						beginStreaming(client, mount);
+					}
+					break;
+				}
+
+				const char* headerEnd = begin;
+				while ((headerEnd != eol) && (*headerEnd != ':')) ++headerEnd;
+
+				if (headerEnd == eol)
+				{
+					break;
+				}
+				const char* valueBegin = headerEnd + 1;
+				while ((valueBegin != eol) && (*valueBegin == ' ')) ++valueBegin;
+
+				if (((headerEnd - begin) == 12) && !::_strnicmp(begin, "Icy-MetaData", 12))
+				{
+					const char* value = begin;
+					while ((eol != end) && (*eol == ' ')) ++eol;
+
+					if (::strtoul(begin + 13, 0, 10) > 0)
+					{
+						client.m_metaData = true;
+					}
+				}
+
+				if (((headerEnd - begin) == 4) && !::_strnicmp(begin, "Host", 4))
+				{
+					::memset(client.m_host, 0, sizeof(client.m_host));
+					::strncpy_s(client.m_host, sizeof(client.m_host), valueBegin, eol - valueBegin);
+				}
+			}
+			break;
+		}
+
+		while ((eol != end) && (*eol == '\r')) ++eol;
+		while ((eol != end) && (*eol == '\n')) ++eol;
+		begin = eol;
+	}
+
+	if ((client.m_bufferSize == sizeof(client.m_buffer)) && (client.m_state == Header))
+	{
+		client.m_state = Close;
+		client.m_bufferSize = client.m_bufferOffset = 0;
+	}
+}
+
+void HttpServer::processStreaming(Client& client)
+{
+	if ((client.m_bufferOffset != client.m_bufferSize) || client.m_sendPending)
+	{
+		return;
+	}
+
+	client.m_bufferOffset = client.m_bufferSize = 0;
+
+	if (!client.m_metaOffset)
+	{
+		client.m_metaOffset = s_metaSize;
+
+		if (client.m_metaData)
+		{
+			processMetaData(client);
+			return;
+		}
+	}
+
+	// the stream ended since this listener joined, and it has been sent all of it
+
+	if (client.m_mount->ended(client.m_generation, client.m_position))
+	{
+		client.m_state = Close;
+		return;
+	}
+
+	if (client.m_mount->lowLatency())
+	{
+		skipAhead(client);
+	}
+
+	if (beginDirectSend(client))
+	{
+		return;
+	}
+
+	size_t maxRead = client.m_metaOffset < client.m_stageBytes ? client.m_metaOffset : client.m_stageBytes;
+
+	Mount& mount = *client.m_mount;
+	ULONGLONG position;
+
+	mount.lock();
+	do
+	{
+		size_t skipped = mount.buffer().catchUp(client.m_position);
+		if (skipped)
+		{
+			FlightRecorder::record(FlightRecorder::ListenerSkipped, mount.index(), static_cast<DWORD>(skipped));
+		}
+
+		m_statistics.skippedBytes += skipped;
+		position = client.m_position;
+
+		size_t actual = mount.buffer().read(client.m_position, client.m_buffer, maxRead);
+		client.m_bufferSize += actual;	
+		client.m_metaOffset -= actual;
+	}
+	while (0);
+	mount.unlock();
+
+	if (client.m_position != position)
+	{
+		recordLatency(client, position);
+	}
+}
+
+void HttpServer::processMetaData(Client& client)
+{
+	do
+	{
+		char windowTitle[256];
+		if (!GetWindowText(Notify::window(), windowTitle, sizeof(windowTitle)))
+		{
+			windowTitle[0] = '\0';
+		}
+
+		unsigned int newHash = hash(windowTitle, ::strlen(windowTitle));
+		if (newHash == client.m_titleHash && !client.m_sendCover)
+		{
+			client.m_buffer[0] = '\0';
+			client.m_bufferSize = 1;
+			break;
+		}
+
+		char* buf = client.m_buffer+1;
+		size_t bufsize = sizeof(client.m_buffer)-1;
+		bool coverArtEnabled = Configuration::getBool("CoverArt");
+		if (newHash != client.m_titleHash)
+		{
+			char* activeTitle = windowTitle;
+			const char* titlePrefix = Configuration::getString("TitlePrefix");
+			if (!::_strnicmp(activeTitle, titlePrefix, ::strlen(titlePrefix)))
+			{
+				activeTitle += ::strlen(titlePrefix);
+			}
+
+			for (size_t i = 0, n = ::strlen(activeTitle); i < n; ++i)
+			{
+				char& c = activeTitle[i];
+
+				switch (c)
+				{
+					case -106: c = '-'; break;
+					case -107: c = '-'; break;
+				}
+			}
+
+			sprintf_s(buf, bufsize, "StreamTitle='%s';", activeTitle);
+			client.m_sendCover = Notify::window() && (::strlen(client.m_host) > 0) && coverArtEnabled;
+		}
+		else if (client.m_sendCover)
+		{
+			sprintf_s(buf, bufsize, "StreamUrl='http://%s/cover/%d.png';", client.m_host, time(0));
+			client.m_sendCover = false;
+		}
+		size_t length = ::strlen(buf) + 1;
+		size_t fill = ((length + 15) & ~15) - length;
+		size_t packetLength = length + fill;
+
+		memset(buf + length, 0, fill);
+
+		client.m_buffer[0] = char(packetLength / 16);
+
+		client.m_bufferSize = packetLength + 1;
+		client.m_titleHash = newHash;
+	}
+	while (0);
+}
+
+void HttpServer::beginStreaming(Client& client, Mount* mount)
+{
+	client.m_position = mount->addListener(client.m_generation);
+	client.m_mount = mount;
+
+	// codecs that need a stream header get it right after the response header
+
+	DWORD headerSize;
+	const BYTE* header = mount->header(headerSize);
+	if (header && ((client.m_bufferSize + headerSize) <= sizeof(client.m_buffer)))
+	{
+		::memcpy(client.m_buffer + client.m_bufferSize, header, headerSize);
+		client.m_bufferSize += headerSize;
+		client.m_metaOffset -= headerSize;
+	}
+
+	// a low-latency mount keeps a quarter of its target in the staging buffer
+	// and as much again in the socket, so a listener that stalls backs up into
+	// the stream buffer where it can be skipped ahead
+
+	if (mount->lowLatency())
+	{
+		size_t bytes = static_cast<size_t>(ULONGLONG(mount->byteRate()) * mount->lowLatency() / 4000);
+		bytes = bytes ? bytes : sizeof(client.m_buffer);
+		client.m_stageBytes = bytes < 1024 ? 1024 : (bytes > sizeof(client.m_buffer) ? sizeof(client.m_buffer) : bytes);
+
+		int sendBuffer = static_cast<int>(client.m_stageBytes);
+		if (!m_zeroCopy && (::setsockopt(client.m_socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&sendBuffer), sizeof(sendBuffer)) < 0))
+		{
+			Notify::update(Notify::HttpServer, Notify::Warning, "Could not set SO_SNDBUF");
+		}
+	}
+
+	if (!m_zeroCopy)
+	{
+		return;
+	}
+
+	// without a send buffer the stack transmits straight out of the stream buffer,
+	// so the region has to stay untouched until the overlapped send completes
+
+	int sendBuffer = 0;
+	if (::setsockopt(client.m_socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&sendBuffer), sizeof(sendBuffer)) < 0)
+	{
+		Notify::update(Notify::HttpServer, Notify::Warning, "Could not set SO_SNDBUF");
+		return;
+	}
+
+	client.m_overlapped.hEvent = ::CreateEvent(0, TRUE, FALSE, 0);
+}
+
+bool HttpServer::beginDirectSend(Client& client)
+{
+	if (!client.m_overlapped.hEvent)
+	{
+		return false;
+	}
+
+	const char* region;
+	size_t size = client.m_metaData ? client.m_metaOffset : ~size_t(0);
+	Mount& mount = *client.m_mount;
+
+	if (mount.lowLatency() && (size > client.m_stageBytes))
+	{
+		size = client.m_stageBytes;
+	}
+
+	mount.lock();
+	do
+	{
+		BroadcastBuffer& buffer = mount.buffer();
+
+		size_t skipped = buffer.catchUp(client.m_position);
+		if (skipped)
+		{
+			FlightRecorder::record(FlightRecorder::ListenerSkipped, mount.index(), static_cast<DWORD>(skipped));
+		}
+
+		m_statistics.skippedBytes += skipped;
+
+		region = buffer.region(client.m_position, size);
+		if (!size)
+		{
+			break;
+		}
+
+		if (client.m_position < buffer.reclaimLimit())
+		{
+			buffer.setReclaimLimit(client.m_position);
+		}
+	}
+	while (0);
+	mount.unlock();
+
+	if (!size)
+	{
+		return true;
+	}
+
+	::ResetEvent(client.m_overlapped.hEvent);
+	client.m_overlapped.Internal = client.m_overlapped.InternalHigh = 0;
+	client.m_overlapped.Offset = client.m_overlapped.OffsetHigh = 0;
+
+	if (!::WriteFile(reinterpret_cast<HANDLE>(client.m_socket), region, static_cast<DWORD>(size), 0, &client.m_overlapped) && (::GetLastError() != ERROR_IO_PENDING))
+	{
+		++ m_statistics.copyFallbacks;
+		updateReclaimLimit();
+		return false;
+	}
+
+	QueryPerformanceCounter(&client.m_sendIssued);
+	client.m_sendDropped = mount.droppedBytes();
+	client.m_sendPending = true;
+	return true;
+}
+
+void HttpServer::completeDirectSends()
+{
+	bool completed = false;
+
+	for (unsigned int i = 0; i < m_clientCount; ++i)
+	{
+		Client& client = *m_clients[i];
+		if (!client.m_sendPending)
+		{
+			continue;
+		}
+
+		DWORD transferred;
+		if (!::GetOverlappedResult(reinterpret_cast<HANDLE>(client.m_socket), &client.m_overlapped, &transferred, FALSE))
+		{
+			bool incomplete = ::GetLastError() == ERROR_IO_INCOMPLETE;
+			if (incomplete && !isStalled(client))
+			{
+				continue;
+			}
+
+			// a send that never completes would hold back the stream for every
+			// listener on the mount, so it is cancelled and its listener dropped
+
+			if (incomplete)
+			{
+				Notify::update(Notify::HttpServer, Notify::Warning, "%s listener %s stalled, dropping it", client.m_mount->path(), client.m_address);
+				::CancelIo(reinterpret_cast<HANDLE>(client.m_socket));
+				::GetOverlappedResult(reinterpret_cast<HANDLE>(client.m_socket), &client.m_overlapped, &transferred, TRUE);
+			}
+
+			client.m_state = Close;
+			client.m_bufferSize = client.m_bufferOffset = 0;
+			transferred = 0;
+		}
+
+		client.m_sendPending = false;
+		client.m_sentBytes += transferred;
+
+		if (transferred)
+		{
+			recordLatency(client, client.m_position);
+		}
+
+		client.m_position += transferred;
+		if (client.m_metaData)
+		{
+			client.m_metaOffset -= transferred;
+		}
+
+		++ m_statistics.zeroCopySends;
+		m_statistics.zeroCopyBytes += transferred;
+
+		completed = true;
+	}
+
+	if (completed)
+	{
+		updateReclaimLimit();
+	}
+}
+
+bool HttpServer::isStalled(Client& client)
+{
+	Mount& mount = *client.m_mount;
+
+	// the send holds the reclaim limit while the encoder has to drop output
+
+	if (mount.droppedBytes() != client.m_sendDropped)
+	{
+		bool blocking = false;
+
+		mount.lock();
+		do
+		{
+			blocking = client.m_position <= mount.buffer().reclaimLimit();
+		}
+		while (0);
+		mount.unlock();
+
+		if (blocking)
+		{
+			return true;
+		}
+	}
+
+	// or it has been pending for longer than the stream buffer holds
+
+	DWORD byteRate = mount.byteRate();
+	if (!byteRate)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+
+	LONGLONG duration = static_cast<LONGLONG>((ULONGLONG(freq.QuadPart) * mount.buffer().size()) / byteRate);
+	return (now.QuadPart - client.m_sendIssued.QuadPart) > duration;
+}
+
+void HttpServer::skipAhead(Client& client)
+{
+	Mount& mount = *client.m_mount;
+
+	Latency::Timestamps timestamps;
+	if (!mount.timestamps(client.m_position, timestamps) || !timestamps.mixed)
+	{
+		return;
+	}
+
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+
+	// past three quarters of the target the listener jumps to the first frame
+	// mixed within half of it, so it lands with room to spare instead of
+	// hovering at the limit and skipping again
+
+	LONGLONG target = (freq.QuadPart * mount.lowLatency()) / 1000;
+	if ((now.QuadPart - timestamps.mixed) <= (target * 3) / 4)
+	{
+		return;
+	}
+
+	ULONGLONG position = mount.freshest(client.m_position, now.QuadPart - target / 2);
+	if (position == client.m_position)
+	{
+		return;
+	}
+
+	FlightRecorder::record(FlightRecorder::ListenerSkipped, mount.index(), static_cast<DWORD>(position - client.m_position));
+
+	m_statistics.skippedBytes += position - client.m_position;
+	client.m_position = position;
+	++ client.m_skips;
+}
+
+void HttpServer::recordLatency(Client& client, ULONGLONG position)
+{
+	Latency::Timestamps timestamps;
+	if (!client.m_mount->timestamps(position, timestamps) || !timestamps.mixed)
+	{
+		return;
+	}
+
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+
+	Latency::record(Latency::Send, timestamps.encoded, now.QuadPart);
+	Latency::record(Latency::Total, timestamps.unlocked, now.QuadPart);
+
+	double latency = ((now.QuadPart - timestamps.mixed) * 1000.0) / freq.QuadPart;
+
+	client.m_latencySum += latency;
+	++ client.m_latencyCount;
+	client.m_latencyMax = latency > client.m_latencyMax ? latency : client.m_latencyMax;
+}
+
+void HttpServer::updateReclaimLimit()
+{
+	for (size_t i = 0; i < Mount::count(); ++i)
+	{
+		Mount& mount = Mount::at(i);
+		ULONGLONG limit = ~ULONGLONG(0);
+
+		for (unsigned int j = 0; j < m_clientCount; ++j)
+		{
+			const Client& client = *m_clients[j];
+			if ((client.m_mount == &mount) && client.m_sendPending && (client.m_position < limit))
+			{
+				limit = client.m_position;
+			}
+		}
+
+		mount.lock();
+		do
+		{
+			mount.buffer().setReclaimLimit(limit);
+		}
+		while (0);
+		mount.unlock();
+	}
+}
+
+unsigned int HttpServer::hash(const char* str, size_t length)
+{
+	unsigned int hash = 0;
+
+	for(unsigned int i = 0; i < length; ++str, ++i)
+	{
+		unsigned int x;
+
+		hash = (hash << 4) + (*str);
+
+		if((x = hash & 0xF0000000L) != 0)
+		{
+			hash ^= (x >> 24);
+		}
+
+		hash &= ~x;
+	}
+
+	return hash;
+}
+
+void HttpServer::processCover(Client& client)
+{
+	int i = 0;
+
+	if (!client.m_cover)
+	{
+		client.m_cover = CoverExtractor::getCoverImage(Notify::window());
+		if (!client.m_cover)
+		{
+			client.m_state = Close;
+		}
+	}
+
+	do
+	{
+		if (client.m_bufferOffset != client.m_bufferSize)
+		{
+			break;
+		}
+
+		if (client.m_coverOffset == client.m_cover->length)
+		{
+			client.m_state = Close;
+			break;
+		}
+
+		size_t maxCopy = (client.m_cover->length - client.m_coverOffset) > sizeof(client.m_buffer) ? sizeof(client.m_buffer) : (client.m_cover->length - client.m_coverOffset);
+
+		::memcpy_s(client.m_buffer, sizeof(client.m_buffer), client.m_cover->image + client.m_coverOffset, maxCopy);
+
+		client.m_bufferOffset = 0;
+		client.m_bufferSize = maxCopy;
+		client.m_coverOffset += maxCopy;
+	}
+	while (0);
+}
+
+void HttpServer::processReport(Client& client)
+{
+	do
+	{
+		if (client.m_bufferOffset != client.m_bufferSize)
+		{
+			break;
+		}
+
+		if (client.m_reportOffset == client.m_reportSize)
+		{
+			client.m_state = Close;
+			break;
+		}
+
+		size_t maxCopy = (client.m_reportSize - client.m_reportOffset) > sizeof(client.m_buffer) ? sizeof(client.m_buffer) : (client.m_reportSize - client.m_reportOffset);
+
+		::memcpy_s(client.m_buffer, sizeof(client.m_buffer), client.m_report + client.m_reportOffset, maxCopy);
+
+		client.m_bufferOffset = 0;
+		client.m_bufferSize = maxCopy;
+		client.m_reportOffset += maxCopy;
+	}
+	while (0);
+}
+
+void HttpServer::sample()
+{
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+
+	if (m_lastSample.QuadPart && ((now.QuadPart - m_lastSample.QuadPart) < freq.QuadPart))
+	{
+		return;
+	}
+
+	if (!m_rates)
+	{
+		m_rates = new EncoderRate[Mount::count()];
+	}
+
+	// reading the counters is also what widens them, which has to happen at
+	// least once per 4 GB even when nobody asks for a status page
+
+	double elapsed = m_lastSample.QuadPart ? double(now.QuadPart - m_lastSample.QuadPart) / freq.QuadPart : 0.0;
+
+	for (size_t i = 0; i < Mount::count(); ++i)
+	{
+		Mount& mount = Mount::at(i);
+		EncoderRate& rate = m_rates[i];
+
+		ULONGLONG chunks = mount.encodedChunks();
+		ULONGLONG microseconds = mount.encodeMicroseconds();
+
+		if (elapsed > 0.0)
+		{
+			rate.chunksPerSecond = (chunks - rate.chunks) / elapsed;
+			rate.msPerChunk = chunks != rate.chunks ? (microseconds - rate.microseconds) / 1000.0 / (chunks - rate.chunks) : 0.0;
+		}
+
+		rate.chunks = chunks;
+		rate.microseconds = microseconds;
+
+		mount.writtenBytes();
+		mount.droppedBytes();
+	}
+
+	g_capture.overrunBytes();
+
+	m_lastSample = now;
+}
+
+ULONGLONG HttpServer::streamFill(Mount& mount, ULONGLONG head) const
+{
+	// what the slowest listener has left to send, up to what the buffer holds
+
+	ULONGLONG oldest = head;
+	for (unsigned int i = 0; i < m_clientCount; ++i)
+	{
+		const Client& client = *m_clients[i];
+		if ((client.m_mount == &mount) && (client.m_position < oldest))
+		{
+			oldest = client.m_position;
+		}
+	}
+
+	ULONGLONG fill = head - oldest;
+	return fill < mount.buffer().size() ? fill : mount.buffer().size();
+}
+
+void HttpServer::renderStatus(Client& client)
+{
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+
+	append(client, "{\"capture\":{\"sizeBytes\":%u,\"fillBytes\":%u,\"overrunBytes\":%I64u},\"mounts\":[", static_cast<DWORD>(g_capture.size()), g_capture.fill(), g_capture.overrunBytes());
+
+	for (size_t i = 0; i < Mount::count(); ++i)
+	{
+		Mount& mount = Mount::at(i);
+		const EncoderRate& rate = m_rates ? m_rates[i] : EncoderRate();
+		ULONGLONG head = mount.writtenBytes();
+
+		append(client, "%s{\"path\":\"%s\",\"contentType\":\"%s\",\"listeners\":%d,", i ? "," : "", mount.path(), mount.contentType(), mount.listeners());
+		append(client, "\"encoder\":{\"chunks\":%I64u,\"chunksPerSecond\":%.1f,\"msPerChunk\":%.3f,\"busySeconds\":%.3f},", mount.encodedChunks(), rate.chunksPerSecond, rate.msPerChunk, mount.encodeMicroseconds() / 1000000.0);
+		append(client, "\"stream\":{\"sizeBytes\":%u,\"fillBytes\":%I64u,\"writtenBytes\":%I64u,\"droppedBytes\":%I64u},\"clients\":[", static_cast<DWORD>(mount.buffer().size()), streamFill(mount, head), head, mount.droppedBytes());
+
+		bool first = true;
+		for (unsigned int j = 0; j < m_clientCount; ++j)
+		{
+			const Client& listener = *m_clients[j];
+			if (listener.m_mount != &mount)
+			{
+				continue;
+			}
+
+			ULONGLONG lag = head > listener.m_position ? head - listener.m_position : 0;
+			double connected = double(now.QuadPart - listener.m_connectTime.QuadPart) / freq.QuadPart;
+
+			append(client, "%s{\"address\":\"%s\",\"sentBytes\":%I64u,\"lagBytes\":%I64u,\"connectedSeconds\":%.1f}", first ? "" : ",", listener.m_address, listener.m_sentBytes, lag, connected);
+			first = false;
+		}
+
+		append(client, "]}");
+	}
+
+	append(client, "],\"http\":{\"zeroCopySends\":%I64u,\"zeroCopyBytes\":%I64u,\"copySends\":%I64u,\"copyBytes\":%I64u,\"copyFallbacks\":%I64u,\"skippedBytes\":%I64u},",
+		m_statistics.zeroCopySends, m_statistics.zeroCopyBytes, m_statistics.copySends, m_statistics.copyBytes, m_statistics.copyFallbacks, m_statistics.skippedBytes);
+	append(client, "\"watchdog\":{\"encoderStalls\":%d,\"encoderRestarts\":%d,\"serverStalls\":%d,\"serverRestarts\":%d}}\n",
+		Watchdog::stalls(Watchdog::EncoderStage), Watchdog::restarts(Watchdog::EncoderStage), Watchdog::stalls(Watchdog::ServerStage), Watchdog::restarts(Watchdog::ServerStage));
+}
+
+void HttpServer::renderMetrics(Client& client)
+{
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+
+	append(client, "# HELP dsbridge_capture_size_bytes Size of the PCM capture ring.\n# TYPE dsbridge_capture_size_bytes gauge\n");
+	append(client, "dsbridge_capture_size_bytes %u\n", static_cast<DWORD>(g_capture.size()));
+	append(client, "# HELP dsbridge_capture_fill_bytes PCM the slowest encoder has yet to read.\n# TYPE dsbridge_capture_fill_bytes gauge\n");
+	append(client, "dsbridge_capture_fill_bytes %u\n", g_capture.fill());
+	append(client, "# HELP dsbridge_capture_overrun_bytes_total PCM mixed while the capture ring was full.\n# TYPE dsbridge_capture_overrun_bytes_total counter\n");
+	append(client, "dsbridge_capture_overrun_bytes_total %I64u\n", g_capture.overrunBytes());
+
+	// one family at a time, with a sample per mount
+
+	append(client, "# HELP dsbridge_encoder_chunks_total Chunks encoded.\n# TYPE dsbridge_encoder_chunks_total counter\n");
+	for (size_t i = 0; i < Mount::count(); ++i)
+	{
+		append(client, "dsbridge_encoder_chunks_total{mount=\"%s\"} %I64u\n", Mount::at(i).path(), Mount::at(i).encodedChunks());
+	}
+
+	append(client, "# HELP dsbridge_encoder_busy_seconds_total Time spent encoding chunks.\n# TYPE dsbridge_encoder_busy_seconds_total counter\n");
+	for (size_t i = 0; i < Mount::count(); ++i)
+	{
+		append(client, "dsbridge_encoder_busy_seconds_total{mount=\"%s\"} %.6f\n", Mount::at(i).path(), Mount::at(i).encodeMicroseconds() / 1000000.0);
+	}
+
+	append(client, "# HELP dsbridge_stream_size_bytes Size of the encoded stream buffer.\n# TYPE dsbridge_stream_size_bytes gauge\n");
+	for (size_t i = 0; i < Mount::count(); ++i)
+	{
+		append(client, "dsbridge_stream_size_bytes{mount=\"%s\"} %u\n", Mount::at(i).path(), static_cast<DWORD>(Mount::at(i).buffer().size()));
+	}
+
+	append(client, "# HELP dsbridge_stream_fill_bytes Encoded data the slowest listener has yet to send.\n# TYPE dsbridge_stream_fill_bytes gauge\n");
+	for (size_t i = 0; i < Mount::count(); ++i)
+	{
+		Mount& mount = Mount::at(i);
+		append(client, "dsbridge_stream_fill_bytes{mount=\"%s\"} %I64u\n", mount.path(), streamFill(mount, mount.writtenBytes()));
+	}
+
+	append(client, "# HELP dsbridge_stream_dropped_bytes_total Encoded data dropped because sends still held the buffer.\n# TYPE dsbridge_stream_dropped_bytes_total counter\n");
+	for (size_t i = 0; i < Mount::count(); ++i)
+	{
+		append(client, "dsbridge_stream_dropped_bytes_total{mount=\"%s\"} %I64u\n", Mount::at(i).path(), Mount::at(i).droppedBytes());
+	}
+
+	append(client, "# HELP dsbridge_listeners Connected listeners.\n# TYPE dsbridge_listeners gauge\n");
+	for (size_t i = 0; i < Mount::count(); ++i)
+	{
+		append(client, "dsbridge_listeners{mount=\"%s\"} %d\n", Mount::at(i).path(), Mount::at(i).listeners());
+	}
+
+	append(client, "# HELP dsbridge_listener_sent_bytes_total Bytes sent to a listener.\n# TYPE dsbridge_listener_sent_bytes_total counter\n");
+	for (unsigned int i = 0; i < m_clientCount; ++i)
+	{
+		const Client& listener = *m_clients[i];
+		if (listener.m_mount)
+		{
+			append(client, "dsbridge_listener_sent_bytes_total{mount=\"%s\",address=\"%s\"} %I64u\n", listener.m_mount->path(), listener.m_address, listener.m_sentBytes);
+		}
+	}
+
+	append(client, "# HELP dsbridge_listener_lag_bytes Encoded data a listener has yet to send.\n# TYPE dsbridge_listener_lag_bytes gauge\n");
+	for (unsigned int i = 0; i < m_clientCount; ++i)
+	{
+		const Client& listener = *m_clients[i];
+		if (listener.m_mount)
+		{
+			ULONGLONG head = listener.m_mount->writtenBytes();
+			append(client, "dsbridge_listener_lag_bytes{mount=\"%s\",address=\"%s\"} %I64u\n", listener.m_mount->path(), listener.m_address, head > listener.m_position ? head - listener.m_position : 0);
+		}
+	}
+
+	append(client, "# HELP dsbridge_listener_connected_seconds Time since a listener connected.\n# TYPE dsbridge_listener_connected_seconds gauge\n");
+	for (unsigned int i = 0; i < m_clientCount; ++i)
+	{
+		const Client& listener = *m_clients[i];
+		if (listener.m_mount)
+		{
+			append(client, "dsbridge_listener_connected_seconds{mount=\"%s\",address=\"%s\"} %.1f\n", listener.m_mount->path(), listener.m_address, double(now.QuadPart - listener.m_connectTime.QuadPart) / freq.QuadPart);
+		}
+	}
+
+	append(client, "# HELP dsbridge_http_skipped_bytes_total Stream data listeners skipped over, overrun or skipped ahead.\n# TYPE dsbridge_http_skipped_bytes_total counter\n");
+	append(client, "dsbridge_http_skipped_bytes_total %I64u\n", m_statistics.skippedBytes);
+	append(client, "# HELP dsbridge_http_sent_bytes_total Stream data sent, by how it was sent.\n# TYPE dsbridge_http_sent_bytes_total counter\n");
+	append(client, "dsbridge_http_sent_bytes_total{path=\"copy\"} %I64u\n", m_statistics.copyBytes);
+	append(client, "dsbridge_http_sent_bytes_total{path=\"zerocopy\"} %I64u\n", m_statistics.zeroCopyBytes);
+
+	append(client, "# HELP dsbridge_watchdog_stalls_total Stages the watchdog found without progress.\n# TYPE dsbridge_watchdog_stalls_total counter\n");
+	append(client, "dsbridge_watchdog_stalls_total{stage=\"encoder\"} %d\n", Watchdog::stalls(Watchdog::EncoderStage));
+	append(client, "dsbridge_watchdog_stalls_total{stage=\"server\"} %d\n", Watchdog::stalls(Watchdog::ServerStage));
+	append(client, "# HELP dsbridge_watchdog_restarts_total Stalled stages the watchdog restarted.\n# TYPE dsbridge_watchdog_restarts_total counter\n");
+	append(client, "dsbridge_watchdog_restarts_total{stage=\"encoder\"} %d\n", Watchdog::restarts(Watchdog::EncoderStage));
+	append(client, "dsbridge_watchdog_restarts_total{stage=\"server\"} %d\n", Watchdog::restarts(Watchdog::ServerStage));
+}
+
+void HttpServer::renderEvents(Client& client)
+{
+	// oldest first, with how many seconds ago each happened
+
+	FlightRecorder::Entry* entries = new FlightRecorder::Entry[FlightRecorder::EntryCount];
+	size_t count = FlightRecorder::copy(entries, FlightRecorder::EntryCount);
+
+	append(client, "{\"events\":[");
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const FlightRecorder::Entry& entry = entries[i];
+		append(client, "%s{\"age\":%.6f,\"thread\":%u,\"event\":\"%s\",\"values\":[%u,%u,%u]}", i ? "," : "", FlightRecorder::age(entry.time), entry.thread, FlightRecorder::name(entry.event), entry.values[0], entry.values[1], entry.values[2]);
+	}
+
+	append(client, "]}\n");
+
+	delete [] entries;
+}
+
+void HttpServer::append(Client& client, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	size_t length = static_cast<size_t>(_vscprintf(format, args));
+	va_end(args);
+
+	if ((client.m_reportSize + length + 1) > client.m_reportCapacity)
+	{
+		size_t capacity = client.m_reportCapacity ? client.m_reportCapacity : 4096;
+		while ((client.m_reportSize + length + 1) > capacity)
+		{
+			capacity *= 2;
+		}
+
+		char* report = new char[capacity];
+		::memcpy(report, client.m_report, client.m_reportSize);
+		delete [] client.m_report;
+
+		client.m_report = report;
+		client.m_reportCapacity = capacity;
+	}
+
+	va_start(args, format);
+	vsprintf_s(client.m_report + client.m_reportSize, client.m_reportCapacity - client.m_reportSize, format, args);
+	va_end(args);
+
+	client.m_reportSize += length;
+}
+
+}
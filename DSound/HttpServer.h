@@ -1,132 +1,262 @@
-#ifndef dsbridge_HttpServer_h
-#define dsbridge_HttpServer_h
-
-/*
-
-Copyright 2009 Jesper Svennevid
-
-Redistribution and use in source and binary forms, with or without
-modification, are permitted provided that the following conditions
-are met:
-
-1. Redistributions of source code must retain the above copyright
-   notice, this list of conditions and the following disclaimer.
-2. Redistributions in binary form must reproduce the above copyright
-   notice, this list of conditions and the following disclaimer in the
-   documentation and/or other materials provided with the distribution.
-
-THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
-IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
-OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
-IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
-INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
-NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
-DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
-THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
-(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
-THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-
-*/
-
-#include "RingBuffer.h"
-#include "CoverExtractor.h"
-
-#include <windows.h>
-
-namespace dsbridge
-{
-
-class HttpServer
-{
-public:
-	HttpServer();
-	~HttpServer();
-
-	bool create();
-	void destroy();
-
-	short port() const;
-
-	void write(const void* buffer, size_t count);
-	static bool isStreaming() { return s_isStreaming; }
-
-private:
-
-	enum ClientState
-	{
-		Header,
-		Close,
-		Streaming,
-		Cover
-	};
-
-	struct Client
-	{
-		Client()
-		: m_socket(INVALID_SOCKET)
-		, m_state(Header)
-		, m_bufferSize(0)
-		, m_bufferOffset(0)
-		, m_metaOffset(0)
-		, m_metaData(false)
-		, m_cover(0)
-		, m_coverOffset(0)
-		, m_titleHash(0)
-		, m_sendCover(false)
-		{
-			m_host[0] = '\0';
-		}
-
-		SOCKET m_socket;
-		ClientState m_state;
-
-		char m_buffer[8192];
-		size_t m_bufferSize;
-		size_t m_bufferOffset;
-		size_t m_metaOffset;
-		bool m_metaData;
-
-		CoverExtractor::Cover* m_cover;
-		size_t m_coverOffset;
-
-		unsigned int m_titleHash;
-		bool m_sendCover;
-
-		char m_host[512];
-	};
-
-	static DWORD WINAPI threadEntry(LPVOID parameter);
-
-	bool initialize();
-	bool run();
-	void shutdown();
-
-	void processHeader(Client& client);
-	void processStreaming(Client& client);
-	void processCover(Client& client);
-
-	static unsigned int hash(const char* str, size_t length);
-
-	HANDLE m_thread;
-	HANDLE m_io;
-	SOCKET m_socket;
-
-	Client* m_clients;
-	DWORD m_clientCount;
-
-	volatile bool m_running;
-
-	RingBuffer m_buffer;
-	CRITICAL_SECTION m_cs;
-
-	time_t m_lastAnnounce;
-	int m_port;
-
-	static volatile bool s_isStreaming;
-
-	static const unsigned int s_metaSize = 45000;
-};
-
-}
-
-#endif
+#ifndef dsbridge_HttpServer_h
+#define dsbridge_HttpServer_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "CoverExtractor.h"
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+class Mount;
+
+class HttpServer
+{
+public:
+	HttpServer();
+	~HttpServer();
+
+	bool create(HttpServer* replaced = 0);
+	void destroy();
+
+	// for the watchdog: the heartbeat moves every time round the loop, and a
+	// server given up on lets go of its listeners on its own thread, whenever
+	// it gets back round its loop. A replacement takes over the listening
+	// socket of the server it replaces, which then leaves it alone
+
+	LONG heartbeat() const { return m_heartbeat; }
+	DWORD clients() const { return m_clientCount; }
+	bool waitListening(DWORD timeout);
+	void abandon();
+
+	short port() const;
+
+	static bool isStreaming() { return s_isStreaming; }
+
+	struct Statistics
+	{
+		Statistics()
+		: zeroCopySends(0)
+		, zeroCopyBytes(0)
+		, copySends(0)
+		, copyBytes(0)
+		, copyFallbacks(0)
+		, skippedBytes(0)
+		{}
+
+		ULONGLONG zeroCopySends;	// completed sends issued straight from the stream buffer
+		ULONGLONG zeroCopyBytes;
+		ULONGLONG copySends;		// sends staged through a client buffer (headers, metadata, covers)
+		ULONGLONG copyBytes;
+		ULONGLONG copyFallbacks;	// direct sends that could not be issued and were staged instead
+		ULONGLONG skippedBytes;		// stream data reclaimed before a lagging listener could send it
+	};
+
+	Statistics statistics() const { return m_statistics; }
+
+private:
+
+	enum ClientState
+	{
+		Header,
+		Close,
+		Streaming,
+		Cover,
+		Report
+	};
+
+	struct Client
+	{
+		Client()
+		: m_socket(INVALID_SOCKET)
+		, m_state(Header)
+		, m_bufferSize(0)
+		, m_bufferOffset(0)
+		, m_metaOffset(0)
+		, m_metaData(false)
+		, m_cover(0)
+		, m_coverOffset(0)
+		, m_titleHash(0)
+		, m_sendCover(false)
+		, m_mount(0)
+		, m_position(0)
+		, m_generation(0)
+		, m_sendPending(false)
+		, m_sendDropped(0)
+		, m_stageBytes(sizeof(m_buffer))
+		, m_latencySum(0)
+		, m_latencyCount(0)
+		, m_latencyMax(0)
+		, m_skips(0)
+		, m_sentBytes(0)
+		, m_report(0)
+		, m_reportSize(0)
+		, m_reportCapacity(0)
+		, m_reportOffset(0)
+		{
+			m_host[0] = '\0';
+			m_address[0] = '\0';
+			m_connectTime.QuadPart = 0;
+			m_sendIssued.QuadPart = 0;
+			::memset(&m_overlapped, 0, sizeof(m_overlapped));
+		}
+
+		SOCKET m_socket;
+		ClientState m_state;
+
+		char m_buffer[8192];
+		size_t m_bufferSize;
+		size_t m_bufferOffset;
+		size_t m_metaOffset;
+		bool m_metaData;
+
+		CoverExtractor::Cover* m_cover;
+		size_t m_coverOffset;
+
+		unsigned int m_titleHash;
+		bool m_sendCover;
+
+		char m_host[512];
+
+		Mount* m_mount;
+		ULONGLONG m_position;
+		DWORD m_generation;
+		OVERLAPPED m_overlapped;
+		bool m_sendPending;
+
+		// when the pending send was issued, and the mount's dropped bytes then,
+		// so a send that pins the stream buffer can be told apart
+
+		LARGE_INTEGER m_sendIssued;
+		ULONGLONG m_sendDropped;
+
+		// stream data staged or sent per step, smaller on low-latency mounts,
+		// and the milliseconds from mix to socket it has taken so far
+
+		size_t m_stageBytes;
+		double m_latencySum;
+		DWORD m_latencyCount;
+		double m_latencyMax;
+		DWORD m_skips;
+
+		char m_address[32];
+		LARGE_INTEGER m_connectTime;
+		ULONGLONG m_sentBytes;
+
+		// a status page, rendered in full before it is sent
+
+		char* m_report;
+		size_t m_reportSize;
+		size_t m_reportCapacity;
+		size_t m_reportOffset;
+	};
+
+	// encoder throughput over the last second, per mount
+
+	struct EncoderRate
+	{
+		EncoderRate()
+		: chunks(0)
+		, microseconds(0)
+		, chunksPerSecond(0)
+		, msPerChunk(0)
+		{}
+
+		ULONGLONG chunks;
+		ULONGLONG microseconds;
+		double chunksPerSecond;
+		double msPerChunk;
+	};
+
+	static DWORD WINAPI threadEntry(LPVOID parameter);
+	static void settingsChanged(void* context);
+
+	bool initialize();
+	bool openListener();
+	bool run();
+	void shutdown();
+
+	void processHeader(Client& client);
+	void processStreaming(Client& client);
+	void processMetaData(Client& client);
+	void processCover(Client& client);
+	void processReport(Client& client);
+
+	void beginStreaming(Client& client, Mount* mount);
+	bool beginDirectSend(Client& client);
+	void completeDirectSends();
+	bool isStalled(Client& client);
+	void skipAhead(Client& client);
+	void recordLatency(Client& client, ULONGLONG position);
+	void updateReclaimLimit();
+	void removeClient(unsigned int index);
+
+	void sample();
+	void renderStatus(Client& client);
+	void renderMetrics(Client& client);
+	void renderEvents(Client& client);
+	ULONGLONG streamFill(Mount& mount, ULONGLONG head) const;
+	static void append(Client& client, const char* format, ...);
+
+	static unsigned int hash(const char* str, size_t length);
+
+	HANDLE m_thread;
+	HANDLE m_listening;
+	HANDLE m_io;
+	SOCKET m_socket;
+
+	Client** m_clients;
+	DWORD m_clientCount;
+
+	volatile bool m_running;
+	volatile bool m_abandoned;
+	volatile bool m_handedOver;
+	volatile LONG m_heartbeat;
+
+	time_t m_lastAnnounce;
+	int m_port;
+
+	// how the next listener is sent to; each keeps the way it started with
+
+	volatile bool m_zeroCopy;
+
+	Statistics m_statistics;
+
+	EncoderRate* m_rates;
+	LARGE_INTEGER m_lastSample;
+
+	static volatile bool s_isStreaming;
+
+	static const unsigned int s_metaSize = 45000;
+};
+
+}
+
+#endif
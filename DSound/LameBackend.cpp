@@ -0,0 +1,382 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "LameBackend.h"
+#include "Mount.h"
+#include "Notify.h"
+
+namespace dsbridge
+{
+
+LameBackend::LameBackend()
+: m_module(0)
+, m_beInitStream(0)
+, m_beEncodeChunk(0)
+, m_beDeinitStream(0)
+, m_beCloseStream(0)
+, m_stream(0)
+, m_samples(0)
+, m_slotLag(0)
+, m_slotFraction(0)
+, m_silentChunks(0)
+, m_substituting(false)
+{
+	m_silentSizes[0] = m_silentSizes[1] = 0;
+}
+
+LameBackend::~LameBackend()
+{
+	// the workers have streams and a module of their own
+
+	m_parallel.destroy();
+
+	if (m_stream && m_beCloseStream)
+	{
+		m_beCloseStream(m_stream);
+	}
+
+	if (m_module)
+	{
+		FreeLibrary(m_module);
+	}
+}
+
+bool LameBackend::initialize(const char* mount)
+{
+	m_module = LoadLibrary("lame_enc.dll");
+	if (!m_module)
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "Could not load lame_enc.dll");
+		return false;
+	}
+
+	m_beInitStream = reinterpret_cast<BEINITSTREAM>(GetProcAddress(m_module, "beInitStream"));
+	if (!m_beInitStream)
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "Could not resolve beInitStream()");
+		return false;
+	}
+
+	m_beEncodeChunk = reinterpret_cast<BEENCODECHUNK>(GetProcAddress(m_module, "beEncodeChunk"));
+	if (!m_beEncodeChunk)
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "Could not resolve beEncodeChunk()");
+		return false;
+	}
+
+	m_beDeinitStream = reinterpret_cast<BEDEINITSTREAM>(GetProcAddress(m_module, "beDeinitStream"));
+	m_beCloseStream = reinterpret_cast<BECLOSESTREAM>(GetProcAddress(m_module, "beCloseStream"));
+
+	BE_CONFIG& init = m_config;
+	memset(&init, 0, sizeof(init));
+	init.dwConfig = BE_CONFIG_LAME;
+	init.format.LHV1.dwStructVersion = 1;
+	init.format.LHV1.dwStructSize = sizeof(init);
+	init.format.LHV1.dwSampleRate = 44100;
+	init.format.LHV1.dwReSampleRate = 0;
+	init.format.LHV1.nMode = BE_MP3_MODE_JSTEREO;
+	init.format.LHV1.dwBitrate = init.format.LHV1.dwMaxBitrate = Mount::getInteger(mount, "MP3BitRate", 192);
+	init.format.LHV1.nPreset = LQP_NOPRESET;
+	init.format.LHV1.bCopyright = false;
+	init.format.LHV1.bCRC = false;
+	init.format.LHV1.bOriginal = false;
+	init.format.LHV1.bPrivate = false;
+	init.format.LHV1.bWriteVBRHeader = false;
+	init.format.LHV1.bEnableVBR = false;
+	init.format.LHV1.nVBRQuality = 0;
+	init.format.LHV1.dwVbrAbr_bps = 0;
+	init.format.LHV1.bNoRes = false;
+
+	DWORD outputSize;
+	BE_ERR result = m_beInitStream(&init, &m_samples, &outputSize, &m_stream);
+	if (result != BE_ERR_SUCCESSFUL)
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "beInitStream() failed - %08x", result);
+		return false;
+	}
+
+	allocate(m_samples * 2, outputSize);
+	buildSilence();
+
+	// segments hold back a whole batch of frames, too long for a low-latency mount
+
+	int workers = Mount::getInteger(mount, "LowLatency", 0) > 0 ? 0 : Mount::getInteger(mount, "EncodeThreads", 0);
+	if ((workers > 0) && !m_parallel.create(m_config, m_samples, workers, Mount::getInteger(mount, "SegmentFrames", 32)))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool LameBackend::start()
+{
+	m_pending = false;
+	m_silentChunks = 0;
+	m_substituting = false;
+
+	if (m_parallel.workers())
+	{
+		m_parallel.reset();
+		return true;
+	}
+
+	// the old stream still holds samples from before the pause, so start over
+	// with a fresh one; its first frame then begins at the resumed audio
+
+	return restart();
+}
+
+bool LameBackend::reconfigure(const char* mount)
+{
+	DWORD bitrate = Mount::getInteger(mount, "MP3BitRate", 192);
+	if (bitrate == m_config.format.LHV1.dwBitrate)
+	{
+		return true;
+	}
+
+	// the workers were set up for the old bitrate
+
+	if (m_parallel.workers())
+	{
+		return false;
+	}
+
+	// the new stream is opened first, so a bitrate the encoder will not take
+	// leaves the old stream and its settings running as they were
+
+	BE_CONFIG config = m_config;
+	config.format.LHV1.dwBitrate = config.format.LHV1.dwMaxBitrate = bitrate;
+
+	HBE_STREAM stream;
+	if (!open(config, stream))
+	{
+		return false;
+	}
+
+	// the old stream's last frames go out before the first one at the new
+	// bitrate; players take a bitrate change between any two frames. If they
+	// cannot be had they are lost, as the old stream is done with either way
+
+	flush();
+
+	if (m_beCloseStream)
+	{
+		m_beCloseStream(m_stream);
+	}
+
+	m_stream = stream;
+	m_config = config;
+
+	m_silentSizes[0] = m_silentSizes[1] = 0;
+	m_silentChunks = 0;
+	m_substituting = false;
+	buildSilence();
+
+	return true;
+}
+
+bool LameBackend::open(BE_CONFIG& config, HBE_STREAM& stream)
+{
+	DWORD samples;
+	DWORD outputSize;
+	BE_ERR result = m_beInitStream(&config, &samples, &outputSize, &stream);
+	if (result != BE_ERR_SUCCESSFUL)
+	{
+		Notify::update(Notify::Encoder, Notify::Warning, "beInitStream() failed - %08x", result);
+		return false;
+	}
+
+	return true;
+}
+
+bool LameBackend::restart()
+{
+	// the old stream is only closed once a new one is open, so the backend
+	// always has one to encode with
+
+	HBE_STREAM stream;
+	if (!open(m_config, stream))
+	{
+		return false;
+	}
+
+	if (m_beCloseStream)
+	{
+		m_beCloseStream(m_stream);
+	}
+
+	m_stream = stream;
+	return true;
+}
+
+void* LameBackend::input()
+{
+	return m_parallel.workers() ? m_parallel.input() : EncoderBackend::input();
+}
+
+bool LameBackend::encode()
+{
+	if (m_parallel.workers())
+	{
+		m_parallel.submit();
+		return true;
+	}
+
+	if (m_silentSizes[0] && silent(m_input))
+	{
+		if (m_silentChunks == SilenceLead)
+		{
+			m_outputBytes = silentFrame(m_output);
+			m_pending = true;
+			m_substituting = true;
+			return true;
+		}
+
+		++m_silentChunks;
+	}
+	else
+	{
+		m_silentChunks = 0;
+
+		// the encoder's bit reservoir refers to frames that were never sent,
+		// so it starts over where the sound does
+
+		if (m_substituting)
+		{
+			m_substituting = false;
+			if (!restart())
+			{
+				return false;
+			}
+		}
+	}
+
+	return EncoderBackend::encode();
+}
+
+bool LameBackend::output(const BYTE*& data, DWORD& size)
+{
+	return m_parallel.workers() ? m_parallel.collect(data, size) : EncoderBackend::output(data, size);
+}
+
+bool LameBackend::encodeChunk(const void* input, PBYTE output, DWORD& size)
+{
+	BE_ERR result = m_beEncodeChunk(m_stream, m_samples, (PSHORT)input, output, &size);
+	if (result != BE_ERR_SUCCESSFUL)
+	{
+		Notify::update(Notify::Encoder, Notify::Warning, "beEncodeChunk() failed - %08x", result);
+		return false;
+	}
+
+	return true;
+}
+
+void LameBackend::buildSilence()
+{
+	static const DWORD bitrates[] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+
+	const BE_CONFIG& config = m_config;
+	DWORD bitrate = config.format.LHV1.dwBitrate;
+	DWORD sampleRate = config.format.LHV1.dwSampleRate;
+
+	DWORD index = 0;
+	while ((index < sizeof(bitrates) / sizeof(bitrates[0])) && (bitrates[index] != bitrate))
+	{
+		++index;
+	}
+
+	// only what a plain MPEG-1 frame at 44.1 kHz without a checksum can carry;
+	// anything else is always encoded
+
+	if (!index || (index == sizeof(bitrates) / sizeof(bitrates[0])) || (sampleRate != 44100) || config.format.LHV1.bCRC)
+	{
+		return;
+	}
+
+	// the Blade modes are numbered like the header's. Everything after the
+	// header is zero, which as side info decodes to digital silence without
+	// touching the bit reservoir
+
+	BYTE mode = static_cast<BYTE>(config.format.LHV1.nMode & 3);
+
+	for (DWORD padding = 0; padding < 2; ++padding)
+	{
+		DWORD size = 144 * bitrate * 1000 / sampleRate + padding;
+		PBYTE frame = m_silentFrames[padding];
+
+		::memset(frame, 0, size);
+		frame[0] = 0xff;
+		frame[1] = 0xfb;
+		frame[2] = static_cast<BYTE>((index << 4) | (padding << 1) | (config.format.LHV1.bPrivate ? 1 : 0));
+		frame[3] = static_cast<BYTE>((mode << 6) | (config.format.LHV1.bCopyright ? 0x08 : 0) | (config.format.LHV1.bOriginal ? 0x04 : 0));
+
+		m_silentSizes[padding] = size;
+	}
+
+	m_slotFraction = static_cast<LONG>((144 * bitrate * 1000) % sampleRate);
+	m_slotLag = static_cast<LONG>(sampleRate / 2);
+}
+
+DWORD LameBackend::silentFrame(PBYTE output)
+{
+	// a frame gets the extra byte whenever the fractional bytes have added up
+
+	DWORD padding = 0;
+	m_slotLag -= m_slotFraction;
+	if (m_slotLag < 0)
+	{
+		m_slotLag += static_cast<LONG>(m_config.format.LHV1.dwSampleRate);
+		padding = 1;
+	}
+
+	DWORD size = m_silentSizes[padding];
+	::memcpy(output, m_silentFrames[padding], size);
+
+	return size;
+}
+
+bool LameBackend::flushChunk(PBYTE output, DWORD& size)
+{
+	size = 0;
+
+	if (!m_beDeinitStream || m_parallel.workers())
+	{
+		return true;
+	}
+
+	BE_ERR result = m_beDeinitStream(m_stream, output, &size);
+	if (result != BE_ERR_SUCCESSFUL)
+	{
+		Notify::update(Notify::Encoder, Notify::Warning, "beDeinitStream() failed - %08x", result);
+		return false;
+	}
+
+	return true;
+}
+
+}
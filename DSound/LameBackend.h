@@ -0,0 +1,108 @@
+#ifndef dsbridge_LameBackend_h
+#define dsbridge_LameBackend_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "EncoderBackend.h"
+#include "ParallelEncoder.h"
+
+#include <windows.h>
+
+#include "BladeMP3EncDLL.h"
+
+namespace dsbridge
+{
+
+// MP3 through lame_enc.dll. Once a run of silence has been encoded for long
+// enough to flush what came before it out of the encoder, the rest of the run
+// goes out as prebuilt silent frames at the same bitrate and mode, and the
+// encoder starts over when sound returns.
+
+class LameBackend : public EncoderBackend
+{
+public:
+	LameBackend();
+	virtual ~LameBackend();
+
+	virtual bool initialize(const char* mount);
+	virtual bool start();
+	virtual bool reconfigure(const char* mount);
+
+	virtual const char* contentType() const { return "audio/mpeg"; }
+	virtual const char* extension() const { return "mp3"; }
+
+	virtual void* input();
+	virtual bool encode();
+	virtual bool output(const BYTE*& data, DWORD& size);
+
+protected:
+
+	virtual bool encodeChunk(const void* input, PBYTE output, DWORD& size);
+	virtual bool flushChunk(PBYTE output, DWORD& size);
+
+private:
+
+	enum
+	{
+		SilenceLead = 4,
+		MaxFrameSize = 1048
+	};
+
+	bool open(BE_CONFIG& config, HBE_STREAM& stream);
+	bool restart();
+	void buildSilence();
+	DWORD silentFrame(PBYTE output);
+
+	HMODULE m_module;
+	BEINITSTREAM m_beInitStream;
+	BEENCODECHUNK m_beEncodeChunk;
+	BEDEINITSTREAM m_beDeinitStream;
+	BECLOSESTREAM m_beCloseStream;
+
+	BE_CONFIG m_config;
+
+	HBE_STREAM m_stream;
+	DWORD m_samples;
+
+	ParallelEncoder m_parallel;
+
+	// an unpadded and a padded silent frame, and the encoder's own padding
+	// schedule so the bitrate stays exact
+
+	BYTE m_silentFrames[2][MaxFrameSize];
+	DWORD m_silentSizes[2];
+	LONG m_slotLag;
+	LONG m_slotFraction;
+
+	DWORD m_silentChunks;
+	bool m_substituting;
+};
+
+}
+
+#endif
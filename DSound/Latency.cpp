@@ -0,0 +1,173 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Latency.h"
+#include "Configuration.h"
+#include "Notify.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace dsbridge
+{
+
+static const char* s_names[Latency::StageCount] =
+{
+	"buffer",
+	"capture",
+	"encode",
+	"send",
+	"total",
+	"ahead",
+	"jitter"
+};
+
+Histogram Latency::s_stages[StageCount];
+Histogram Latency::s_logged[StageCount];
+LONGLONG Latency::s_lastLog = 0;
+
+LONGLONG Latency::now()
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
+
+void Latency::record(Stage stage, LONGLONG begin, LONGLONG end)
+{
+	if (!begin || (end < begin))
+	{
+		return;
+	}
+
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+
+	ULONGLONG microseconds = (ULONGLONG(end - begin) * 1000000) / freq.QuadPart;
+	s_stages[stage].record(microseconds < 0xffffffff ? static_cast<DWORD>(microseconds) : 0xffffffff);
+}
+
+void Latency::record(Stage stage, double seconds)
+{
+	// estimates rather than measured spans, recorded the same way
+
+	if (seconds < 0.0)
+	{
+		return;
+	}
+
+	double microseconds = seconds * 1000000.0;
+	s_stages[stage].record(microseconds < 4294967295.0 ? static_cast<DWORD>(microseconds) : 0xffffffff);
+}
+
+size_t Latency::report(char* buffer, size_t size)
+{
+	// since startup, one stage per line
+
+	size_t length = 0;
+	buffer[0] = '\0';
+
+	for (int i = 0; i < StageCount; ++i)
+	{
+		Histogram histogram;
+		s_stages[i].copy(histogram);
+
+		char line[256];
+		format(line, sizeof(line), histogram);
+
+		sprintf_s(buffer + length, size - length, "%-8s %s\r\n", s_names[i], line);
+		length += ::strlen(buffer + length);
+	}
+
+	return length;
+}
+
+void Latency::update()
+{
+	int interval = Configuration::getInteger("LatencyLog", 60);
+	if (interval <= 0)
+	{
+		return;
+	}
+
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+
+	if (!s_lastLog)
+	{
+		s_lastLog = now.QuadPart;
+		return;
+	}
+
+	if ((now.QuadPart - s_lastLog) < (interval * freq.QuadPart))
+	{
+		return;
+	}
+
+	s_lastLog = now.QuadPart;
+
+	for (int i = 0; i < StageCount; ++i)
+	{
+		Histogram histogram;
+		s_stages[i].copy(histogram);
+
+		Histogram current;
+		histogram.copy(current);
+		histogram.subtract(s_logged[i]);
+		current.copy(s_logged[i]);
+
+		// stages nothing went through are left out, so an idle bridge stays quiet
+
+		if (!histogram.count())
+		{
+			continue;
+		}
+
+		char line[256];
+		format(line, sizeof(line), histogram);
+		Notify::update(Notify::HttpServer, Notify::Info, "Latency %s %s", s_names[i], line);
+	}
+}
+
+void Latency::format(char* buffer, size_t size, const Histogram& histogram)
+{
+	static const double percentiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+	sprintf_s(buffer, size, "count %I64u", histogram.count());
+
+	for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); ++i)
+	{
+		size_t length = ::strlen(buffer);
+		sprintf_s(buffer + length, size - length, " p%g %.1f ms", percentiles[i] * 100, histogram.percentile(percentiles[i]) / 1000.0);
+	}
+
+	size_t length = ::strlen(buffer);
+	sprintf_s(buffer + length, size - length, " max %.1f ms", histogram.maximum() / 1000.0);
+}
+
+}
@@ -0,0 +1,96 @@
+#ifndef dsbridge_Latency_h
+#define dsbridge_Latency_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Histogram.h"
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+// How long audio spends in each stage of the pipeline. Audio carries the
+// time it passed every stage boundary along with it, from the Unlock that
+// handed it over, through the mixer, the capture and the encoder, to the
+// send that hands it to a socket, and every stage records how long it took.
+
+class Latency
+{
+public:
+	enum Stage
+	{
+		Buffer,		// unlocked until mixed, the game's own buffering
+		Capture,	// mixed until an encoder read it
+		Encode,		// read until written to the mount
+		Send,		// written to the mount until handed to a socket
+		Total,		// unlocked until handed to a socket
+		Ahead,		// written ahead of a buffer's recovered play position
+		Jitter,		// how far play cursors stray from the recovered clock
+		StageCount
+	};
+
+	// performance counter times, 0 where unknown
+
+	struct Timestamps
+	{
+		Timestamps()
+		: unlocked(0)
+		, mixed(0)
+		, read(0)
+		, encoded(0)
+		{}
+
+		LONGLONG unlocked;
+		LONGLONG mixed;
+		LONGLONG read;
+		LONGLONG encoded;
+	};
+
+	static LONGLONG now();
+	static void record(Stage stage, LONGLONG begin, LONGLONG end);
+	static void record(Stage stage, double seconds);
+
+	static size_t report(char* buffer, size_t size);
+	static void update();
+
+private:
+
+	static void format(char* buffer, size_t size, const Histogram& histogram);
+
+	static Histogram s_stages[StageCount];
+
+	// what the stages held at the last log, so each log covers its interval
+
+	static Histogram s_logged[StageCount];
+	static LONGLONG s_lastLog;
+};
+
+}
+
+#endif
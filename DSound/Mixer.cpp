@@ -0,0 +1,270 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Mixer.h"
+#include "Voice.h"
+#include "Capture.h"
+#include "Latency.h"
+#include "Notify.h"
+#include "Configuration.h"
+#include "ExceptionHandler.h"
+
+#include <emmintrin.h>
+
+namespace dsbridge
+{
+
+extern Capture g_capture;
+
+Mixer::Mixer()
+: m_thread(0)
+, m_voiceCount(0)
+, m_sampleRate(44100)
+, m_running(false)
+, m_produced(0)
+, m_idleTimeout(0)
+, m_ended(false)
+, m_pack(packScalar)
+{
+	InitializeCriticalSection(&m_cs);
+	m_start.QuadPart = 0;
+	m_lastActive.QuadPart = 0;
+}
+
+Mixer::~Mixer()
+{
+}
+
+bool Mixer::create()
+{
+	m_sampleRate = Configuration::getInteger("MixRate", 44100);
+	g_capture.setSampleRate(m_sampleRate);
+
+	// seconds of silence before the stream ends, 0 streams silence for as long
+	// as the game runs
+
+	m_idleTimeout = Configuration::getInteger("IdleTimeout", 0);
+	QueryPerformanceCounter(&m_lastActive);
+
+	m_pack = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE) ? packSSE2 : packScalar;
+
+	m_thread = CreateThread(0, 0, threadEntry, this, 0, 0);
+	if (!m_thread)
+	{
+		Notify::update(Notify::DirectSound, Notify::Error, "Could not create mixer thread");
+		return false;
+	}
+
+	SetThreadPriority(m_thread, THREAD_PRIORITY_ABOVE_NORMAL);
+	return true;
+}
+
+void Mixer::setSampleRate(DWORD rate)
+{
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		if (!rate || (rate == m_sampleRate))
+		{
+			break;
+		}
+
+		m_sampleRate = rate;
+		m_running = false;
+
+		g_capture.setSampleRate(rate);
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+}
+
+bool Mixer::add(Voice* voice)
+{
+	bool result = false;
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		if (m_voiceCount == MaxVoices)
+		{
+			Notify::update(Notify::DirectSound, Notify::Warning, "Too many buffers, not mixing any more");
+			break;
+		}
+
+		m_voices[m_voiceCount++] = voice;
+
+		result = true;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	return result;
+}
+
+void Mixer::remove(Voice* voice)
+{
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		for (size_t i = 0; i < m_voiceCount; ++i)
+		{
+			if (m_voices[i] == voice)
+			{
+				m_voices[i] = m_voices[--m_voiceCount];
+				break;
+			}
+		}
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+}
+
+DWORD WINAPI Mixer::threadEntry(LPVOID parameter)
+{
+	__try
+	{
+		Mixer* mixer = static_cast<Mixer*>(parameter);
+
+		for (;;)
+		{
+			mixer->run();
+			SleepEx(TickMilliseconds, TRUE);
+		}
+	}
+	__except(ExceptionHandler::filter("Mixer", GetExceptionInformation()))
+	{
+	}
+	return 0;
+}
+
+void Mixer::run()
+{
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		bool active = false;
+		for (size_t i = 0; i < m_voiceCount; ++i)
+		{
+			active = m_voices[i]->active() || active;
+		}
+
+		LARGE_INTEGER now, freq;
+		QueryPerformanceCounter(&now);
+		QueryPerformanceFrequency(&freq);
+
+		if (active)
+		{
+			m_lastActive = now;
+			m_ended = false;
+		}
+
+		if (m_ended)
+		{
+			break;
+		}
+
+		// nothing has played for too long, so the stream ends with what was
+		// mixed so far, and starts over with the next sound
+
+		if (m_idleTimeout && (ULONGLONG(now.QuadPart - m_lastActive.QuadPart) >= ULONGLONG(m_idleTimeout) * freq.QuadPart))
+		{
+			Notify::update(Notify::DirectSound, Notify::Info, "Nothing played for %d seconds, ending the stream", m_idleTimeout);
+			g_capture.end();
+
+			m_ended = true;
+			m_running = false;
+			break;
+		}
+
+		if (!m_running)
+		{
+			m_start = now;
+			m_produced = 0;
+			m_running = true;
+			break;
+		}
+
+		ULONGLONG due = (ULONGLONG(now.QuadPart - m_start.QuadPart) * m_sampleRate) / freq.QuadPart;
+		if ((due - m_produced) > MaxFrames)
+		{
+			// the thread was held up for too long, so that stretch is skipped
+
+			m_produced = due - MaxFrames;
+		}
+
+		size_t frames = static_cast<size_t>(due - m_produced);
+		if (!frames)
+		{
+			break;
+		}
+
+		// the tick is as old as the oldest audio in it
+
+		LONGLONG unlocked = 0;
+
+		::memset(m_accumulator, 0, frames * 2 * sizeof(int));
+		for (size_t i = 0; i < m_voiceCount; ++i)
+		{
+			LONGLONG written = m_voices[i]->mix(m_accumulator, frames, m_sampleRate);
+			unlocked = written && (!unlocked || (written < unlocked)) ? written : unlocked;
+		}
+
+		Latency::record(Latency::Buffer, unlocked, now.QuadPart);
+
+		m_pack(m_accumulator, m_output, frames * 2);
+		g_capture.write(m_output, frames * 2 * sizeof(short), unlocked);
+
+		m_produced += frames;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+}
+
+void Mixer::packScalar(const int* input, short* output, size_t samples)
+{
+	for (size_t i = 0; i < samples; ++i)
+	{
+		int value = input[i];
+		output[i] = short(value > 32767 ? 32767 : (value < -32768 ? -32768 : value));
+	}
+}
+
+void Mixer::packSSE2(const int* input, short* output, size_t samples)
+{
+	size_t i = 0;
+
+	for (; (i + 8) <= samples; i += 8)
+	{
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packs_epi32(a, b));
+	}
+
+	packScalar(input + i, output + i, samples - i);
+}
+
+}
@@ -0,0 +1,96 @@
+#ifndef dsbridge_Mixer_h
+#define dsbridge_Mixer_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+class Voice;
+
+// Sums every wrapped buffer into the capture on a thread of its own. Each tick
+// mixes exactly as many frames as have played since the mix started, so the
+// output keeps to the wall clock however unevenly the thread gets scheduled.
+// Quiet stretches are mixed as silence like anything else, so listeners never
+// starve between tracks; only an idle timeout ends the stream.
+
+class Mixer
+{
+public:
+	Mixer();
+	~Mixer();
+
+	bool create();
+
+	void setSampleRate(DWORD rate);
+
+	bool add(Voice* voice);
+	void remove(Voice* voice);
+
+private:
+
+	enum
+	{
+		MaxVoices = 64,
+		MaxFrames = 4096,
+		TickMilliseconds = 10
+	};
+
+	typedef void (*PackFunction)(const int* input, short* output, size_t samples);
+
+	static DWORD WINAPI threadEntry(LPVOID parameter);
+	static void packScalar(const int* input, short* output, size_t samples);
+	static void packSSE2(const int* input, short* output, size_t samples);
+
+	void run();
+
+	CRITICAL_SECTION m_cs;
+	HANDLE m_thread;
+
+	Voice* m_voices[MaxVoices];
+	size_t m_voiceCount;
+
+	DWORD m_sampleRate;
+	bool m_running;
+	LARGE_INTEGER m_start;
+	ULONGLONG m_produced;
+
+	DWORD m_idleTimeout;
+	LARGE_INTEGER m_lastActive;
+	bool m_ended;
+
+	PackFunction m_pack;
+	int m_accumulator[MaxFrames * 2];
+	short m_output[MaxFrames * 2];
+};
+
+}
+
+#endif
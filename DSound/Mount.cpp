@@ -0,0 +1,399 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Mount.h"
+#include "Notify.h"
+#include "Configuration.h"
+
+#include <stdio.h>
+
+namespace dsbridge
+{
+
+Mount* Mount::s_mounts = 0;
+size_t Mount::s_count = 0;
+
+Mount::Mount()
+: m_index(0)
+, m_frameCount(0)
+, m_listeners(0)
+, m_end(0)
+, m_generation(0)
+, m_startLatency(0)
+, m_lowLatency(0)
+{
+	m_name[0] = '\0';
+	m_path[0] = '\0';
+	m_connectTime.QuadPart = 0;
+
+	InitializeCriticalSection(&m_cs);
+}
+
+Mount::~Mount()
+{
+	DeleteCriticalSection(&m_cs);
+}
+
+bool Mount::create(const char* name, size_t index)
+{
+	strcpy_s(m_name, sizeof(m_name), name);
+	m_index = static_cast<DWORD>(index);
+
+	if (!m_encoder.create(*this))
+	{
+		return false;
+	}
+
+	char defaultPath[PathLength];
+	sprintf_s(defaultPath, sizeof(defaultPath), "/%s.%s", name, m_encoder.extension());
+	strcpy_s(m_path, sizeof(m_path), getString(name, "Path", *name ? defaultPath : "/"));
+
+	if (!m_buffer.create(m_encoder.bufferSize()))
+	{
+		Notify::update(Notify::HttpServer, Notify::Error, "Could not create ringbuffer");
+		return false;
+	}
+
+	// milliseconds from mix to socket that listeners should stay within
+
+	int lowLatency = getInteger(name, "LowLatency", 0);
+	m_lowLatency = lowLatency > 0 ? lowLatency : 0;
+
+	// the encoder thread writes to the buffer and reports under the path, so
+	// it starts once both are there
+
+	return m_encoder.start(m_index);
+}
+
+void Mount::write(const void* buffer, size_t count, const Latency::Timestamps& timestamps)
+{
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		ULONGLONG position = m_buffer.head();
+
+		if (!m_buffer.write(buffer, count))
+		{
+			m_droppedBytes.add(static_cast<DWORD>(count));
+			break;
+		}
+
+		m_writtenBytes.add(static_cast<DWORD>(count));
+
+		// every encoded chunk starts on a frame boundary
+
+		if (count > 0)
+		{
+			m_frames[m_frameCount % FrameIndexSize] = position;
+			m_frameTimestamps[m_frameCount % FrameIndexSize] = timestamps;
+			++m_frameCount;
+		}
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+}
+
+void Mount::lock()
+{
+	EnterCriticalSection(&m_cs);
+}
+
+void Mount::unlock()
+{
+	LeaveCriticalSection(&m_cs);
+}
+
+ULONGLONG Mount::addListener(DWORD& generation)
+{
+	ULONGLONG position;
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		// the first listener wakes the encoder up, anything buffered before
+		// that is stale; later listeners get what is buffered as a burst
+
+		if (!m_listeners)
+		{
+			QueryPerformanceCounter(&m_connectTime);
+			position = m_buffer.head();
+		}
+		else
+		{
+			position = syncPoint(m_buffer.tail());
+		}
+
+		InterlockedIncrement(&m_listeners);
+		generation = m_generation;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	return position;
+}
+
+void Mount::removeListener()
+{
+	InterlockedDecrement(&m_listeners);
+}
+
+void Mount::end()
+{
+	EnterCriticalSection(&m_cs);
+	m_end = m_buffer.head();
+	++m_generation;
+	LeaveCriticalSection(&m_cs);
+}
+
+bool Mount::ended(DWORD generation, ULONGLONG position)
+{
+	EnterCriticalSection(&m_cs);
+	bool result = (generation != m_generation) && (position >= m_end);
+	LeaveCriticalSection(&m_cs);
+
+	return result;
+}
+
+ULONGLONG Mount::syncPoint(ULONGLONG position) const
+{
+	ULONGLONG result = m_buffer.head();
+	size_t count = m_frameCount < FrameIndexSize ? m_frameCount : FrameIndexSize;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		ULONGLONG frame = m_frames[(m_frameCount - 1 - i) % FrameIndexSize];
+		if (frame < position)
+		{
+			break;
+		}
+
+		result = frame;
+	}
+
+	return result;
+}
+
+size_t Mount::frameAt(ULONGLONG position) const
+{
+	// how many frames back from the newest the one holding the position is,
+	// or the number of indexed frames if it is older than all of them
+
+	size_t count = m_frameCount < FrameIndexSize ? m_frameCount : FrameIndexSize;
+
+	size_t i = 0;
+	while ((i < count) && (m_frames[(m_frameCount - 1 - i) % FrameIndexSize] > position))
+	{
+		++i;
+	}
+
+	return i;
+}
+
+bool Mount::timestamps(ULONGLONG position, Latency::Timestamps& timestamps)
+{
+	bool result = false;
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		size_t i = frameAt(position);
+		if (i == (m_frameCount < FrameIndexSize ? m_frameCount : FrameIndexSize))
+		{
+			break;
+		}
+
+		timestamps = m_frameTimestamps[(m_frameCount - 1 - i) % FrameIndexSize];
+		result = true;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	return result;
+}
+
+ULONGLONG Mount::freshest(ULONGLONG position, LONGLONG oldest)
+{
+	ULONGLONG result = position;
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		// the oldest frame mixed no earlier than the limit, or the newest one
+		// if even that is too old
+
+		size_t count = m_frameCount < FrameIndexSize ? m_frameCount : FrameIndexSize;
+		for (size_t i = 0; i < count; ++i)
+		{
+			size_t index = (m_frameCount - 1 - i) % FrameIndexSize;
+			if ((m_frames[index] <= position) || (i && (m_frameTimestamps[index].mixed < oldest)))
+			{
+				break;
+			}
+
+			result = m_frames[index];
+		}
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	return result;
+}
+
+DWORD Mount::byteRate()
+{
+	DWORD result = 0;
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		size_t count = m_frameCount < FrameIndexSize ? m_frameCount : FrameIndexSize;
+		if (count < 2)
+		{
+			break;
+		}
+
+		size_t newest = (m_frameCount - 1) % FrameIndexSize;
+		size_t oldest = (m_frameCount - count) % FrameIndexSize;
+
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency(&freq);
+
+		LONGLONG elapsed = m_frameTimestamps[newest].mixed - m_frameTimestamps[oldest].mixed;
+		if (elapsed <= 0)
+		{
+			break;
+		}
+
+		result = static_cast<DWORD>(((m_frames[newest] - m_frames[oldest]) * freq.QuadPart) / elapsed);
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	return result;
+}
+
+bool Mount::createAll()
+{
+	const char* mounts = Configuration::getString("Mounts");
+
+	size_t count = 0;
+	for (const char* curr = mounts; *curr; ++curr)
+	{
+		if ((*curr != ',') && (*curr != ' ') && ((curr == mounts) || (*(curr-1) == ',') || (*(curr-1) == ' ')))
+		{
+			++count;
+		}
+	}
+
+	s_mounts = new Mount[count > 0 ? count : 1];
+
+	if (!count)
+	{
+		s_count = 1;
+		return s_mounts[0].create("", 0);
+	}
+
+	for (const char* begin = mounts; *begin;)
+	{
+		while ((*begin == ',') || (*begin == ' ')) ++begin;
+
+		const char* end = begin;
+		while (*end && (*end != ',') && (*end != ' ')) ++end;
+
+		if (begin == end)
+		{
+			break;
+		}
+
+		char name[NameLength];
+		size_t length = size_t(end - begin) < (sizeof(name) - 1) ? size_t(end - begin) : (sizeof(name) - 1);
+		::memcpy(name, begin, length);
+		name[length] = '\0';
+
+		if (!s_mounts[s_count].create(name, s_count))
+		{
+			Notify::update(Notify::Encoder, Notify::Error, "Could not create mount %s", name);
+			return false;
+		}
+
+		++s_count;
+		begin = end;
+	}
+
+	return true;
+}
+
+Mount* Mount::find(const char* path, size_t length)
+{
+	for (size_t i = 0; i < s_count; ++i)
+	{
+		Mount& mount = s_mounts[i];
+		if ((::strlen(mount.m_path) == length) && !::_strnicmp(mount.m_path, path, length))
+		{
+			return &mount;
+		}
+	}
+
+	// the root always serves the first mount
+
+	if ((s_count > 0) && (length == 1) && (*path == '/'))
+	{
+		return &s_mounts[0];
+	}
+
+	return 0;
+}
+
+const char* Mount::getString(const char* mount, const char* name, const char* defaultValue)
+{
+	if (*mount)
+	{
+		char key[NameLength + 64];
+		sprintf_s(key, sizeof(key), "%s.%s", mount, name);
+
+		const char* value = Configuration::getString(key, 0);
+		if (value)
+		{
+			return value;
+		}
+	}
+
+	return Configuration::getString(name, defaultValue);
+}
+
+int Mount::getInteger(const char* mount, const char* name, int defaultValue)
+{
+	const char* value = getString(mount, name, 0);
+	if (!value)
+	{
+		return defaultValue;
+	}
+
+	return ::strtol(value, 0, 10);
+}
+
+}
@@ -0,0 +1,143 @@
+#ifndef dsbridge_Mount_h
+#define dsbridge_Mount_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "BroadcastBuffer.h"
+#include "Counter.h"
+#include "Encoder.h"
+#include "Latency.h"
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+class Mount
+{
+public:
+	Mount();
+	~Mount();
+
+	bool create(const char* name, size_t index);
+
+	const char* name() const { return m_name; }
+	const char* path() const { return m_path; }
+	DWORD index() const { return m_index; }
+	const char* contentType() const { return m_encoder.contentType(); }
+	const BYTE* header(DWORD& size) const { return m_encoder.header(size); }
+
+	void write(const void* buffer, size_t count, const Latency::Timestamps& timestamps);
+
+	void lock();
+	void unlock();
+	BroadcastBuffer& buffer() { return m_buffer; }
+
+	LONG listeners() const { return m_listeners; }
+	ULONGLONG addListener(DWORD& generation);
+	void removeListener();
+
+	void end();
+	bool ended(DWORD generation, ULONGLONG position);
+
+	const LARGE_INTEGER& connectTime() const { return m_connectTime; }
+	double startLatency() const { return m_startLatency; }
+	void setStartLatency(double latency) { m_startLatency = latency; }
+
+	// read by the status pages only
+
+	ULONGLONG writtenBytes() { return m_writtenBytes.total(); }
+	ULONGLONG droppedBytes() { return m_droppedBytes.total(); }
+	Encoder& encoder() { return m_encoder; }
+	ULONGLONG encodedChunks() { return m_encoder.chunks(); }
+	ULONGLONG encodeMicroseconds() { return m_encoder.busyMicroseconds(); }
+
+	DWORD lowLatency() const { return m_lowLatency; }
+	bool timestamps(ULONGLONG position, Latency::Timestamps& timestamps);
+	ULONGLONG freshest(ULONGLONG position, LONGLONG oldest);
+	DWORD byteRate();
+
+	static bool createAll();
+	static Mount* find(const char* path, size_t length);
+	static size_t count() { return s_count; }
+	static Mount& at(size_t index) { return s_mounts[index]; }
+
+	static const char* getString(const char* mount, const char* name, const char* defaultValue = "");
+	static int getInteger(const char* mount, const char* name, int defaultValue = 0);
+
+private:
+
+	enum
+	{
+		NameLength = 64,
+		PathLength = 256,
+		FrameIndexSize = 256
+	};
+
+	ULONGLONG syncPoint(ULONGLONG position) const;
+	size_t frameAt(ULONGLONG position) const;
+
+	char m_name[NameLength];
+	char m_path[PathLength];
+	DWORD m_index;
+
+	Encoder m_encoder;
+
+	BroadcastBuffer m_buffer;
+	CRITICAL_SECTION m_cs;
+
+	// where each encoded chunk starts, and where its audio has been
+
+	ULONGLONG m_frames[FrameIndexSize];
+	Latency::Timestamps m_frameTimestamps[FrameIndexSize];
+	size_t m_frameCount;
+
+	volatile LONG m_listeners;
+	LARGE_INTEGER m_connectTime;
+
+	// where the stream last ended, for listeners that joined before then
+
+	ULONGLONG m_end;
+	DWORD m_generation;
+	double m_startLatency;
+
+	// everything written to the stream buffer, which is where its head is,
+	// and what was dropped because sends still held the space
+
+	Counter m_writtenBytes;
+	Counter m_droppedBytes;
+
+	DWORD m_lowLatency;
+
+	static Mount* s_mounts;
+	static size_t s_count;
+};
+
+}
+
+#endif
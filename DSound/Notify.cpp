@@ -1,218 +1,364 @@
-/*
-
-Copyright 2009 Jesper Svennevid
-
-Redistribution and use in source and binary forms, with or without
-modification, are permitted provided that the following conditions
-are met:
-
-1. Redistributions of source code must retain the above copyright
-   notice, this list of conditions and the following disclaimer.
-2. Redistributions in binary form must reproduce the above copyright
-   notice, this list of conditions and the following disclaimer in the
-   documentation and/or other materials provided with the distribution.
-
-THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
-IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
-OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
-IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
-INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
-NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
-DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
-THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
-(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
-THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-
-*/
-
-#include "Notify.h"
-
-#include "resource.h"
-
-#include <stdio.h>
-#include <time.h>
-
-#include <windows.h>
-#include <ShellAPI.h>
-
-namespace dsbridge
-{
-
-Notify Notify::s_instance;
-HINSTANCE Notify::s_dll;
-
-Notify::Notify()
-: m_iconAdded(false)
-, m_isConnected(false)
-, m_lastTime(0)
-, m_lastState(Info)
-, m_window(0)
-{
-	InitializeCriticalSection(&m_cs);
-	m_window = findMainWindow();
-}
-
-Notify::~Notify()
-{
-	DeleteCriticalSection(&m_cs);
-}
-
-void Notify::update(ClassType classType, State state, const char* format, ...)
-{
-	va_list ap;
-	va_start(ap, format);
-	s_instance.updateInternal(classType, state, format, ap);
-	va_end(ap);
-}
-
-void Notify::setDllInstance(HINSTANCE hInstDLL)
-{
-	s_dll = hInstDLL;
-}
-
-void Notify::setConnected(bool connected)
-{
-	s_instance.setConnectedInternal(connected);
-}
-
-struct WindowInformation
-{
-	DWORD m_pid;
-	HWND m_result;
-};
-
-HWND Notify::findMainWindow()
-{
-	WindowInformation info;
-	info.m_pid = GetCurrentProcessId();
-	info.m_result = 0;
-	EnumWindows(windowEnumerator, (LPARAM)&info);
-	return info.m_result;
-}
-
-BOOL CALLBACK Notify::windowEnumerator(HWND hwnd, LPARAM lParam)
-{
-	WindowInformation* info = reinterpret_cast<WindowInformation*>(lParam);
-	DWORD processId;
-
-	char windowClass[256];
-	RealGetWindowClass(hwnd, windowClass, sizeof(windowClass));
-
-	char windowName[256];
-	if (!GetWindowText(hwnd, windowName, sizeof(windowName)))
-	{
-		return TRUE;
-	}
-
-	GetWindowThreadProcessId(hwnd, &processId);
-
-	if (processId == info->m_pid)
-	{
-		info->m_result = hwnd;
-		return FALSE;
-	}
-
-	return TRUE;
-}
-
-void Notify::updateInternal(ClassType classType, State state, const char* format, va_list ap)
-{
-	NOTIFYICONDATA data;
-	bool iconAdded = m_iconAdded;
-	bool noNewStatus = false;
-
-	EnterCriticalSection(&m_cs);
-	do
-	{
-		time_t newTime = time(0);
-		switch (m_lastState)
-		{
-			case Info:
-			{
-			}
-			break;
-
-			case Warning:
-			{
-				if (((newTime - m_lastTime) < 5) && state == Info)
-					noNewStatus = true;
-			}
-			break;
-
-			case Error:
-			{
-				noNewStatus = true;
-			}
-			break;
-		}
-
-		if (noNewStatus)
-		{
-			break;
-		}
-
-		m_lastTime = newTime;
-		m_lastState = state;
-
-		const char* className = "";
-		switch (classType)
-		{
-			case DirectSound: className = "DirectSound"; break;
-			case Encoder: className = "Encoder"; break;
-			case HttpServer: className = "HttpServer"; break;
-		}
-
-		char intfmt[64];
-		sprintf_s(intfmt, sizeof(intfmt), "DSBridge\n%s: %s", className, format);
-
-		char buf[64];
-		vsnprintf_s(buf, sizeof(buf), sizeof(buf), intfmt, ap);
-
-		memset(&data, 0, sizeof(data));
-		data.cbSize = sizeof(data);
-		data.uFlags = NIF_ICON | NIF_TIP;
-		data.hWnd = m_window;
-		data.uID = 1337;
-		data.hIcon = getIcon(state);
-		strcpy_s(data.szTip, sizeof(data.szTip), buf);
-
-		m_iconAdded = true;
-
-#if defined(_DEBUG)
-		OutputDebugString(buf);
-		OutputDebugString("\n");
-#endif
-	}
-	while (0);
-	LeaveCriticalSection(&m_cs);
-
-	if (!noNewStatus)
-	{
-		Shell_NotifyIcon(iconAdded ? NIM_MODIFY : NIM_ADD, &data);
-	}
-}
-
-void Notify::setConnectedInternal(bool connected)
-{
-	EnterCriticalSection(&m_cs);
-	do
-	{
-		m_isConnected = connected;
-	}
-	while (0);
-	LeaveCriticalSection(&m_cs);
-}
-
-HICON Notify::getIcon(State state)
-{
-	LPCSTR resource;
-	switch (state)
-	{
-		case Info: resource = MAKEINTRESOURCE(m_isConnected ? IDI_ICONCONNECTED : IDI_ICONIDLE); break;
-		case Warning:  resource = MAKEINTRESOURCE(IDI_ICONWARNING); break;
-		case Error: resource = MAKEINTRESOURCE(IDI_ICONERROR); break;
-	}
-	return LoadIcon(s_dll, resource);
-}
-
-}
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Notify.h"
+
+#include "resource.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#include <windows.h>
+#include <ShellAPI.h>
+
+namespace dsbridge
+{
+
+Notify Notify::s_instance;
+HINSTANCE Notify::s_dll;
+
+Notify::Notify()
+: m_started(0)
+, m_thread(0)
+, m_wake(0)
+, m_sink(tray)
+, m_repeating(false)
+, m_droppedShown(0)
+, m_iconAdded(false)
+, m_isConnected(false)
+, m_window(0)
+, m_lastTime(0)
+, m_lastState(Info)
+{
+	::memset(m_recent, 0, sizeof(m_recent));
+
+	InitializeCriticalSection(&m_cs);
+	m_window = findMainWindow();
+}
+
+Notify::~Notify()
+{
+	DeleteCriticalSection(&m_cs);
+}
+
+void Notify::update(ClassType classType, State state, const char* format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	s_instance.updateInternal(classType, state, format, ap);
+	va_end(ap);
+}
+
+void Notify::setDllInstance(HINSTANCE hInstDLL)
+{
+	s_dll = hInstDLL;
+}
+
+void Notify::setConnected(bool connected)
+{
+	s_instance.m_isConnected = connected;
+}
+
+void Notify::setSink(Sink sink)
+{
+	EnterCriticalSection(&s_instance.m_cs);
+	do
+	{
+		s_instance.m_sink = sink;
+	}
+	while (0);
+	LeaveCriticalSection(&s_instance.m_cs);
+}
+
+void Notify::tray(ClassType classType, State state, const char* message)
+{
+	s_instance.trayInternal(classType, state, message);
+}
+
+void Notify::console(ClassType classType, State state, const char* message)
+{
+	static const char* states[] = { "info", "warning", "error" };
+	fprintf(stderr, "%s %s: %s\n", className(classType), states[state], message);
+}
+
+DWORD WINAPI Notify::threadEntry(LPVOID parameter)
+{
+	static_cast<Notify*>(parameter)->run();
+	return 0;
+}
+
+const char* Notify::className(ClassType classType)
+{
+	switch (classType)
+	{
+		case DirectSound: return "DirectSound";
+		case Encoder: return "Encoder";
+		case HttpServer: return "HttpServer";
+	}
+	return "";
+}
+
+struct WindowInformation
+{
+	DWORD m_pid;
+	HWND m_result;
+};
+
+HWND Notify::findMainWindow()
+{
+	WindowInformation info;
+	info.m_pid = GetCurrentProcessId();
+	info.m_result = 0;
+	EnumWindows(windowEnumerator, (LPARAM)&info);
+	return info.m_result;
+}
+
+BOOL CALLBACK Notify::windowEnumerator(HWND hwnd, LPARAM lParam)
+{
+	WindowInformation* info = reinterpret_cast<WindowInformation*>(lParam);
+	DWORD processId;
+
+	char windowClass[256];
+	RealGetWindowClass(hwnd, windowClass, sizeof(windowClass));
+
+	char windowName[256];
+	if (!GetWindowText(hwnd, windowName, sizeof(windowName)))
+	{
+		return TRUE;
+	}
+
+	GetWindowThreadProcessId(hwnd, &processId);
+
+	if (processId == info->m_pid)
+	{
+		info->m_result = hwnd;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+void Notify::updateInternal(ClassType classType, State state, const char* format, va_list ap)
+{
+	m_queue.push(classType, state, format, ap);
+
+	if (!m_started && !InterlockedExchange(&m_started, 1))
+	{
+		start();
+	}
+
+	if (m_thread)
+	{
+		SetEvent(m_wake);
+		return;
+	}
+
+	// without a thread of its own (or before it exists) the caller delivers
+	// what is queued itself
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		dispatch();
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+}
+
+void Notify::start()
+{
+	m_wake = CreateEvent(0, FALSE, FALSE, 0);
+	if (!m_wake)
+	{
+		return;
+	}
+
+	HANDLE thread = CreateThread(0, 0, threadEntry, this, 0, 0);
+	if (!thread)
+	{
+		return;
+	}
+
+	SetThreadPriority(thread, THREAD_PRIORITY_LOWEST);
+	m_thread = thread;
+}
+
+void Notify::run()
+{
+	for (;;)
+	{
+		// repeats still being counted are shown once they have stopped for a while
+
+		WaitForSingleObject(m_wake, m_repeating ? static_cast<DWORD>(CoalesceInterval) : INFINITE);
+
+		EnterCriticalSection(&m_cs);
+		do
+		{
+			dispatch();
+		}
+		while (0);
+		LeaveCriticalSection(&m_cs);
+	}
+}
+
+void Notify::dispatch()
+{
+	NotifyQueue::Event event;
+	while (m_queue.pop(event))
+	{
+		// notifications are told apart by their format string; one not seen
+		// lately takes the place of the one shown longest ago
+
+		Recent* recent = m_recent;
+		for (size_t i = 0; i < RecentCount; ++i)
+		{
+			if (m_recent[i].format == event.format)
+			{
+				recent = &m_recent[i];
+				break;
+			}
+
+			recent = (m_recent[i].shown - recent->shown) < 0x80000000 ? recent : &m_recent[i];
+		}
+
+		if ((recent->format == event.format) && ((event.time - recent->shown) < CoalesceInterval))
+		{
+			++ recent->repeats;
+			m_repeating = true;
+			continue;
+		}
+
+		flushRepeats(*recent);
+
+		recent->format = event.format;
+		recent->classType = static_cast<ClassType>(event.classType);
+		recent->state = static_cast<State>(event.state);
+		recent->shown = event.time;
+		NotifyQueue::format(event, recent->message, sizeof(recent->message));
+
+		m_sink(recent->classType, recent->state, recent->message);
+	}
+
+	DWORD now = GetTickCount();
+	m_repeating = false;
+
+	for (size_t i = 0; i < RecentCount; ++i)
+	{
+		if ((now - m_recent[i].shown) >= CoalesceInterval)
+		{
+			flushRepeats(m_recent[i]);
+		}
+
+		m_repeating = m_repeating || (m_recent[i].repeats > 0);
+	}
+
+	LONG dropped = m_queue.dropped();
+	if (dropped != m_droppedShown)
+	{
+		char message[MessageCapacity];
+		sprintf_s(message, sizeof(message), "%d notifications dropped", static_cast<int>(dropped - m_droppedShown));
+		m_droppedShown = dropped;
+
+		m_sink(DirectSound, Warning, message);
+	}
+}
+
+void Notify::flushRepeats(Recent& recent)
+{
+	if (!recent.repeats)
+	{
+		return;
+	}
+
+	char message[MessageCapacity];
+	_snprintf_s(message, sizeof(message), _TRUNCATE, "%s (%u more)", recent.message, recent.repeats);
+	recent.repeats = 0;
+
+	m_sink(recent.classType, recent.state, message);
+}
+
+void Notify::trayInternal(ClassType classType, State state, const char* message)
+{
+	time_t newTime = time(0);
+	switch (m_lastState)
+	{
+		case Info:
+		{
+		}
+		break;
+
+		case Warning:
+		{
+			if (((newTime - m_lastTime) < 5) && state == Info)
+				return;
+		}
+		break;
+
+		case Error:
+		{
+			return;
+		}
+		break;
+	}
+
+	m_lastTime = newTime;
+	m_lastState = state;
+
+	char buf[64];
+	_snprintf_s(buf, sizeof(buf), _TRUNCATE, "DSBridge\n%s: %s", className(classType), message);
+
+	NOTIFYICONDATA data;
+	memset(&data, 0, sizeof(data));
+	data.cbSize = sizeof(data);
+	data.uFlags = NIF_ICON | NIF_TIP;
+	data.hWnd = m_window;
+	data.uID = 1337;
+	data.hIcon = getIcon(state);
+	strcpy_s(data.szTip, sizeof(data.szTip), buf);
+
+#if defined(_DEBUG)
+	OutputDebugString(buf);
+	OutputDebugString("\n");
+#endif
+
+	Shell_NotifyIcon(m_iconAdded ? NIM_MODIFY : NIM_ADD, &data);
+	m_iconAdded = true;
+}
+
+HICON Notify::getIcon(State state)
+{
+	LPCSTR resource;
+	switch (state)
+	{
+		case Info: resource = MAKEINTRESOURCE(m_isConnected ? IDI_ICONCONNECTED : IDI_ICONIDLE); break;
+		case Warning:  resource = MAKEINTRESOURCE(IDI_ICONWARNING); break;
+		case Error: resource = MAKEINTRESOURCE(IDI_ICONERROR); break;
+	}
+	return LoadIcon(s_dll, resource);
+}
+
+}
@@ -0,0 +1,374 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "NotifyQueue.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace dsbridge
+{
+
+enum ArgumentType
+{
+	NoArgument,
+	IntArgument,
+	LongArgument,
+	LongLongArgument,
+	SizeArgument,
+	DoubleArgument,
+	PointerArgument,
+	StringArgument
+};
+
+// finds the next conversion in a format string, and how many arguments it
+// takes; conversions this does not know end the format there
+
+static const char* nextConversion(const char* format, const char*& end, int& stars, ArgumentType& type)
+{
+	const char* begin = ::strchr(format, '%');
+	if (!begin)
+	{
+		return 0;
+	}
+
+	const char* curr = begin + 1;
+	while (*curr && ::strchr("-+ #0", *curr)) ++curr;
+
+	stars = 0;
+	if (*curr == '*')
+	{
+		++stars;
+		++curr;
+	}
+	while ((*curr >= '0') && (*curr <= '9')) ++curr;
+
+	if (*curr == '.')
+	{
+		++curr;
+		if (*curr == '*')
+		{
+			++stars;
+			++curr;
+		}
+		while ((*curr >= '0') && (*curr <= '9')) ++curr;
+	}
+
+	type = IntArgument;
+	if (!::strncmp(curr, "I64", 3))
+	{
+		type = LongLongArgument;
+		curr += 3;
+	}
+	else if (!::strncmp(curr, "ll", 2))
+	{
+		type = LongLongArgument;
+		curr += 2;
+	}
+	else if (*curr == 'l')
+	{
+		type = LongArgument;
+		++curr;
+	}
+	else if ((*curr == 'I') || (*curr == 'z'))
+	{
+		type = SizeArgument;
+		++curr;
+	}
+	else
+	{
+		while (*curr == 'h') ++curr;
+	}
+
+	switch (*curr)
+	{
+		case '%': type = NoArgument; break;
+		case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c': break;
+		case 'e': case 'E': case 'f': case 'g': case 'G': type = DoubleArgument; break;
+		case 'p': type = PointerArgument; break;
+		case 's': type = StringArgument; break;
+		default: return 0;
+	}
+
+	end = curr + 1;
+	return begin;
+}
+
+template<typename T> static bool store(NotifyQueue::Event& event, T value)
+{
+	if ((event.argumentSize + sizeof(T)) > sizeof(event.arguments))
+	{
+		return false;
+	}
+
+	::memcpy(event.arguments + event.argumentSize, &value, sizeof(T));
+	event.argumentSize += sizeof(T);
+	return true;
+}
+
+template<typename T> static bool load(const NotifyQueue::Event& event, size_t& offset, T& value)
+{
+	if ((offset + sizeof(T)) > event.argumentSize)
+	{
+		return false;
+	}
+
+	::memcpy(&value, event.arguments + offset, sizeof(T));
+	offset += sizeof(T);
+	return true;
+}
+
+template<typename T> static void print(char* buffer, size_t size, size_t& length, const char* conversion, T value)
+{
+	int written = _snprintf_s(buffer + length, size - length, _TRUNCATE, conversion, value);
+	length += written < 0 ? ::strlen(buffer + length) : written;
+}
+
+template<typename T> static bool printNext(const NotifyQueue::Event& event, size_t& offset, char* buffer, size_t size, size_t& length, const char* conversion)
+{
+	T value;
+	if (!load(event, offset, value))
+	{
+		return false;
+	}
+
+	print(buffer, size, length, conversion, value);
+	return true;
+}
+
+static void append(char* buffer, size_t size, size_t& length, const char* text, size_t count)
+{
+	count = (length + count) < size ? count : size - length - 1;
+	::memcpy(buffer + length, text, count);
+	length += count;
+	buffer[length] = '\0';
+}
+
+NotifyQueue::NotifyQueue()
+: m_tail(0)
+, m_head(0)
+, m_dropped(0)
+{
+	for (LONG i = 0; i < Capacity; ++i)
+	{
+		m_slots[i].sequence = i;
+	}
+}
+
+bool NotifyQueue::push(int classType, int state, const char* format, va_list ap)
+{
+	// a slot is free for the writer at position when its sequence is position,
+	// and ready for the reader once it is position + 1
+
+	LONG position = m_tail;
+	Slot* slot;
+	for (;;)
+	{
+		slot = &m_slots[DWORD(position) % Capacity];
+
+		LONG difference = slot->sequence - position;
+		if (difference == 0)
+		{
+			LONG previous = InterlockedCompareExchange(&m_tail, position + 1, position);
+			if (previous == position)
+			{
+				break;
+			}
+
+			position = previous;
+		}
+		else if (difference < 0)
+		{
+			InterlockedIncrement(&m_dropped);
+			return false;
+		}
+		else
+		{
+			position = m_tail;
+		}
+	}
+
+	Event& event = slot->event;
+	event.classType = classType;
+	event.state = state;
+	event.format = format;
+	event.time = GetTickCount();
+	event.argumentSize = 0;
+	capture(event, format, ap);
+
+	InterlockedExchange(&slot->sequence, position + 1);
+	return true;
+}
+
+bool NotifyQueue::pop(Event& event)
+{
+	Slot& slot = m_slots[DWORD(m_head) % Capacity];
+	if (slot.sequence != (m_head + 1))
+	{
+		return false;
+	}
+
+	event = slot.event;
+
+	InterlockedExchange(&slot.sequence, m_head + Capacity);
+	++ m_head;
+
+	return true;
+}
+
+bool NotifyQueue::capture(Event& event, const char* format, va_list ap)
+{
+	const char* end;
+	int stars;
+	ArgumentType type;
+
+	for (const char* begin = nextConversion(format, end, stars, type); begin; begin = nextConversion(end, end, stars, type))
+	{
+		for (int i = 0; i < stars; ++i)
+		{
+			if (!store(event, va_arg(ap, int)))
+			{
+				return false;
+			}
+		}
+
+		bool stored = true;
+		switch (type)
+		{
+			case NoArgument: break;
+			case IntArgument: stored = store(event, va_arg(ap, int)); break;
+			case LongArgument: stored = store(event, va_arg(ap, long)); break;
+			case LongLongArgument: stored = store(event, va_arg(ap, LONGLONG)); break;
+			case SizeArgument: stored = store(event, va_arg(ap, size_t)); break;
+			case DoubleArgument: stored = store(event, va_arg(ap, double)); break;
+			case PointerArgument: stored = store(event, va_arg(ap, void*)); break;
+
+			case StringArgument:
+			{
+				// strings are copied, as they rarely outlive the call; long ones
+				// are cut to what is left
+
+				const char* value = va_arg(ap, const char*);
+				value = value ? value : "(null)";
+
+				size_t available = sizeof(event.arguments) - event.argumentSize;
+				size_t length = ::strlen(value);
+				length = length < available ? length : available - 1;
+				stored = available > 1;
+
+				if (stored)
+				{
+					::memcpy(event.arguments + event.argumentSize, value, length);
+					event.arguments[event.argumentSize + length] = '\0';
+					event.argumentSize += length + 1;
+				}
+			}
+			break;
+		}
+
+		if (!stored)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+size_t NotifyQueue::format(const Event& event, char* buffer, size_t size)
+{
+	size_t length = 0;
+	size_t offset = 0;
+	buffer[0] = '\0';
+
+	const char* text = event.format;
+	const char* end;
+	int stars;
+	ArgumentType type;
+
+	for (const char* begin = nextConversion(text, end, stars, type); begin; begin = nextConversion(text, end, stars, type))
+	{
+		append(buffer, size, length, text, begin - text);
+		text = end;
+
+		// the conversion on its own, with the widths given as arguments filled in
+
+		char conversion[48];
+		size_t conversionLength = 0;
+		bool loaded = true;
+
+		for (const char* curr = begin; (curr != end) && (conversionLength < (sizeof(conversion) - 12)); ++curr)
+		{
+			int width;
+			if (*curr != '*')
+			{
+				conversion[conversionLength++] = *curr;
+			}
+			else if ((loaded = load(event, offset, width)) != false)
+			{
+				conversionLength += sprintf_s(conversion + conversionLength, sizeof(conversion) - conversionLength, "%d", width);
+			}
+		}
+		conversion[conversionLength] = '\0';
+
+		switch (type)
+		{
+			case NoArgument: append(buffer, size, length, "%", 1); break;
+			case IntArgument: loaded = loaded && printNext<int>(event, offset, buffer, size, length, conversion); break;
+			case LongArgument: loaded = loaded && printNext<long>(event, offset, buffer, size, length, conversion); break;
+			case LongLongArgument: loaded = loaded && printNext<LONGLONG>(event, offset, buffer, size, length, conversion); break;
+			case SizeArgument: loaded = loaded && printNext<size_t>(event, offset, buffer, size, length, conversion); break;
+			case DoubleArgument: loaded = loaded && printNext<double>(event, offset, buffer, size, length, conversion); break;
+			case PointerArgument: loaded = loaded && printNext<void*>(event, offset, buffer, size, length, conversion); break;
+
+			case StringArgument:
+			{
+				loaded = loaded && (offset < event.argumentSize);
+				if (loaded)
+				{
+					const char* value = reinterpret_cast<const char*>(event.arguments + offset);
+					offset += ::strlen(value) + 1;
+					print(buffer, size, length, conversion, value);
+				}
+			}
+			break;
+		}
+
+		// arguments that did not fit in the event end the message
+
+		if (!loaded)
+		{
+			append(buffer, size, length, "...", 3);
+			return length;
+		}
+	}
+
+	append(buffer, size, length, text, ::strlen(text));
+	return length;
+}
+
+}
@@ -0,0 +1,91 @@
+#ifndef dsbridge_NotifyQueue_h
+#define dsbridge_NotifyQueue_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+
+#include <stdarg.h>
+
+namespace dsbridge
+{
+
+// Bounded queue of notifications, written by any thread and read by one. A
+// writer claims a slot with a single compare-exchange and never waits; when
+// the queue is full the event is counted and dropped. Events keep their
+// format string and a copy of their arguments, so the formatting happens on
+// the reading side.
+
+class NotifyQueue
+{
+public:
+
+	enum
+	{
+		Capacity = 256,
+		ArgumentCapacity = 160
+	};
+
+	struct Event
+	{
+		int classType;
+		int state;
+		const char* format;	// a string literal, so it doubles as the event's code
+		DWORD time;
+		size_t argumentSize;
+		BYTE arguments[ArgumentCapacity];
+	};
+
+	NotifyQueue();
+
+	bool push(int classType, int state, const char* format, va_list ap);
+	bool pop(Event& event);
+
+	LONG dropped() const { return m_dropped; }
+
+	static size_t format(const Event& event, char* buffer, size_t size);
+
+private:
+
+	struct Slot
+	{
+		volatile LONG sequence;
+		Event event;
+	};
+
+	static bool capture(Event& event, const char* format, va_list ap);
+
+	Slot m_slots[Capacity];
+	volatile LONG m_tail;
+	LONG m_head;
+	volatile LONG m_dropped;
+};
+
+}
+
+#endif
@@ -0,0 +1,226 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "OpusBackend.h"
+#include "Mount.h"
+#include "Notify.h"
+
+namespace dsbridge
+{
+
+// values from opus_defines.h
+
+static const int OPUS_APPLICATION_AUDIO = 2049;
+static const int OPUS_APPLICATION_RESTRICTED_LOWDELAY = 2051;
+static const int OPUS_SET_BITRATE_REQUEST = 4002;
+static const int OPUS_GET_LOOKAHEAD_REQUEST = 4027;
+static const int OPUS_RESET_STATE = 4028;
+
+static DWORD s_crc[256];
+
+static void buildTable()
+{
+	for (DWORD i = 0; i < 256; ++i)
+	{
+		DWORD crc = i << 24;
+		for (int j = 0; j < 8; ++j)
+		{
+			crc = (crc << 1) ^ ((crc & 0x80000000) ? 0x04c11db7 : 0);
+		}
+		s_crc[i] = crc;
+	}
+}
+
+static void writeLittle(PBYTE& out, ULONGLONG value, size_t bytes)
+{
+	for (size_t i = 0; i < bytes; ++i)
+	{
+		*out++ = BYTE(value >> (i * 8));
+	}
+}
+
+OpusBackend::OpusBackend()
+: m_module(0)
+, m_opusEncoderCreate(0)
+, m_opusEncode(0)
+, m_opusEncoderCtl(0)
+, m_opusEncoderDestroy(0)
+, m_encoder(0)
+, m_frameSamples(960)
+, m_serial(0)
+, m_sequence(0)
+, m_granule(0)
+, m_headerSize(0)
+{
+}
+
+OpusBackend::~OpusBackend()
+{
+	if (m_encoder)
+	{
+		m_opusEncoderDestroy(m_encoder);
+	}
+
+	if (m_module)
+	{
+		FreeLibrary(m_module);
+	}
+}
+
+bool OpusBackend::initialize(const char* mount)
+{
+	buildTable();
+
+	m_module = LoadLibrary("opus.dll");
+	if (!m_module)
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "Could not load opus.dll");
+		return false;
+	}
+
+	m_opusEncoderCreate = reinterpret_cast<OPUSENCODERCREATE>(GetProcAddress(m_module, "opus_encoder_create"));
+	m_opusEncode = reinterpret_cast<OPUSENCODE>(GetProcAddress(m_module, "opus_encode"));
+	m_opusEncoderCtl = reinterpret_cast<OPUSENCODERCTL>(GetProcAddress(m_module, "opus_encoder_ctl"));
+	m_opusEncoderDestroy = reinterpret_cast<OPUSENCODERDESTROY>(GetProcAddress(m_module, "opus_encoder_destroy"));
+	if (!m_opusEncoderCreate || !m_opusEncode || !m_opusEncoderCtl || !m_opusEncoderDestroy)
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "Could not resolve opus.dll entry points");
+		return false;
+	}
+
+	// low delay drops the speech tools and most of the lookahead
+
+	bool lowLatency = Mount::getInteger(mount, "LowLatency", 0) > 0;
+	m_frameSamples = lowLatency ? 480 : 960;
+
+	int error = 0;
+	m_encoder = m_opusEncoderCreate(48000, 2, lowLatency ? OPUS_APPLICATION_RESTRICTED_LOWDELAY : OPUS_APPLICATION_AUDIO, &error);
+	if (!m_encoder)
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "opus_encoder_create() failed - %d", error);
+		return false;
+	}
+
+	m_opusEncoderCtl(m_encoder, OPUS_SET_BITRATE_REQUEST, Mount::getInteger(mount, "OpusBitRate", 96) * 1000);
+
+	int lookahead = 0;
+	m_opusEncoderCtl(m_encoder, OPUS_GET_LOOKAHEAD_REQUEST, &lookahead);
+
+	allocate(m_frameSamples * 2 * 2, 27 + 255 + MaxPacketSize);
+
+	m_serial = GetTickCount() ^ static_cast<DWORD>(reinterpret_cast<DWORD_PTR>(this));
+
+	// identification and comment headers, each on a page of its own
+
+	BYTE packet[64];
+	PBYTE out = packet;
+	::memcpy(out, "OpusHead", 8); out += 8;
+	writeLittle(out, 1, 1);
+	writeLittle(out, 2, 1);
+	writeLittle(out, lookahead, 2);
+	writeLittle(out, 48000, 4);
+	writeLittle(out, 0, 2);
+	writeLittle(out, 0, 1);
+	m_headerSize = page(m_header, packet, static_cast<DWORD>(out - packet), 0x02);
+
+	out = packet;
+	::memcpy(out, "OpusTags", 8); out += 8;
+	writeLittle(out, 8, 4);
+	::memcpy(out, "dsbridge", 8); out += 8;
+	writeLittle(out, 0, 4);
+	m_headerSize += page(m_header + m_headerSize, packet, static_cast<DWORD>(out - packet), 0);
+
+	return true;
+}
+
+bool OpusBackend::start()
+{
+	m_pending = false;
+	m_opusEncoderCtl(m_encoder, OPUS_RESET_STATE);
+	return true;
+}
+
+bool OpusBackend::reconfigure(const char* mount)
+{
+	// the bitrate can change between any two packets of the same stream
+
+	return m_opusEncoderCtl(m_encoder, OPUS_SET_BITRATE_REQUEST, Mount::getInteger(mount, "OpusBitRate", 96) * 1000) == 0;
+}
+
+bool OpusBackend::encodeChunk(const void* input, PBYTE output, DWORD& size)
+{
+	int result = m_opusEncode(m_encoder, static_cast<const short*>(input), m_frameSamples, m_packet, sizeof(m_packet));
+	if (result < 0)
+	{
+		Notify::update(Notify::Encoder, Notify::Warning, "opus_encode() failed - %d", result);
+		return false;
+	}
+
+	m_granule += m_frameSamples;
+	size = page(output, m_packet, static_cast<DWORD>(result), 0);
+
+	return true;
+}
+
+DWORD OpusBackend::page(PBYTE output, const BYTE* packet, DWORD size, BYTE flags)
+{
+	DWORD segments = size / 255 + 1;
+
+	PBYTE out = output;
+	::memcpy(out, "OggS", 4); out += 4;
+	writeLittle(out, 0, 1);
+	writeLittle(out, flags, 1);
+	writeLittle(out, m_granule, 8);
+	writeLittle(out, m_serial, 4);
+	writeLittle(out, m_sequence++, 4);
+	writeLittle(out, 0, 4);
+	writeLittle(out, segments, 1);
+
+	for (DWORD i = 1; i < segments; ++i)
+	{
+		*out++ = 255;
+	}
+	*out++ = BYTE(size % 255);
+
+	::memcpy(out, packet, size);
+	out += size;
+
+	DWORD length = static_cast<DWORD>(out - output);
+
+	DWORD crc = 0;
+	for (DWORD i = 0; i < length; ++i)
+	{
+		crc = (crc << 8) ^ s_crc[(crc >> 24) ^ output[i]];
+	}
+
+	out = output + 22;
+	writeLittle(out, crc, 4);
+
+	return length;
+}
+
+}
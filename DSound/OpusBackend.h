@@ -0,0 +1,98 @@
+#ifndef dsbridge_OpusBackend_h
+#define dsbridge_OpusBackend_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "EncoderBackend.h"
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+// Opus in Ogg, through opus.dll. Every 20 ms packet goes out in its own page
+// so listeners can join at any page, and nothing waits for a page to fill.
+// Low-latency mounts use 10 ms packets and the restricted low-delay mode.
+
+class OpusBackend : public EncoderBackend
+{
+public:
+	OpusBackend();
+	virtual ~OpusBackend();
+
+	virtual bool initialize(const char* mount);
+	virtual bool start();
+	virtual bool reconfigure(const char* mount);
+
+	virtual const char* contentType() const { return "audio/ogg"; }
+	virtual const char* extension() const { return "opus"; }
+	virtual DWORD sampleRate() const { return 48000; }
+	virtual const BYTE* header(DWORD& size) const { size = m_headerSize; return m_header; }
+
+protected:
+
+	virtual bool encodeChunk(const void* input, PBYTE output, DWORD& size);
+
+private:
+
+	struct OpusEncoder;
+
+	typedef OpusEncoder* (__cdecl *OPUSENCODERCREATE)(int, int, int, int*);
+	typedef int (__cdecl *OPUSENCODE)(OpusEncoder*, const short*, int, unsigned char*, int);
+	typedef int (__cdecl *OPUSENCODERCTL)(OpusEncoder*, int, ...);
+	typedef void (__cdecl *OPUSENCODERDESTROY)(OpusEncoder*);
+
+	enum
+	{
+		MaxPacketSize = 4000,
+		HeaderCapacity = 256
+	};
+
+	DWORD page(PBYTE output, const BYTE* packet, DWORD size, BYTE flags);
+
+	HMODULE m_module;
+	OPUSENCODERCREATE m_opusEncoderCreate;
+	OPUSENCODE m_opusEncode;
+	OPUSENCODERCTL m_opusEncoderCtl;
+	OPUSENCODERDESTROY m_opusEncoderDestroy;
+
+	OpusEncoder* m_encoder;
+	int m_frameSamples;
+
+	DWORD m_serial;
+	DWORD m_sequence;
+	ULONGLONG m_granule;
+
+	BYTE m_packet[MaxPacketSize];
+	BYTE m_header[HeaderCapacity];
+	DWORD m_headerSize;
+};
+
+}
+
+#endif
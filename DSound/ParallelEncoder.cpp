@@ -0,0 +1,514 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "ParallelEncoder.h"
+#include "Notify.h"
+#include "ExceptionHandler.h"
+
+namespace dsbridge
+{
+
+ParallelEncoder::ParallelEncoder()
+: m_module(0)
+, m_beInitStream(0)
+, m_beEncodeChunk(0)
+, m_beDeinitStream(0)
+, m_beCloseStream(0)
+, m_samples(0)
+, m_outputSize(0)
+, m_chunkSize(0)
+, m_segmentChunks(0)
+, m_filled(0)
+, m_segments(0)
+, m_segmentCount(0)
+, m_fill(0)
+, m_collect(0)
+, m_collected(false)
+, m_history(0)
+, m_workers(0)
+, m_workerCount(0)
+, m_semaphore(0)
+, m_stop(0)
+, m_encoding(0)
+, m_settled(0)
+{
+	InitializeCriticalSection(&m_cs);
+}
+
+ParallelEncoder::~ParallelEncoder()
+{
+	destroy();
+	DeleteCriticalSection(&m_cs);
+}
+
+bool ParallelEncoder::create(const BE_CONFIG& config, DWORD samples, size_t workers, size_t segmentChunks)
+{
+	m_module = LoadLibrary("lame_enc.dll");
+	if (!m_module)
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "Could not load lame_enc.dll");
+		return false;
+	}
+
+	m_beInitStream = reinterpret_cast<BEINITSTREAM>(GetProcAddress(m_module, "beInitStream"));
+	m_beEncodeChunk = reinterpret_cast<BEENCODECHUNK>(GetProcAddress(m_module, "beEncodeChunk"));
+	m_beDeinitStream = reinterpret_cast<BEDEINITSTREAM>(GetProcAddress(m_module, "beDeinitStream"));
+	m_beCloseStream = reinterpret_cast<BECLOSESTREAM>(GetProcAddress(m_module, "beCloseStream"));
+	if (!m_beInitStream || !m_beEncodeChunk || !m_beDeinitStream || !m_beCloseStream)
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "Could not resolve lame_enc.dll entry points");
+		return false;
+	}
+
+	// without the reservoir no frame borrows bits from the one before it, so
+	// frames from separately encoded segments can be spliced together
+
+	m_config = config;
+	m_config.format.LHV1.bNoRes = TRUE;
+
+	HBE_STREAM stream;
+	BE_ERR result = m_beInitStream(&m_config, &m_samples, &m_outputSize, &stream);
+	if (result != BE_ERR_SUCCESSFUL)
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "beInitStream() failed - %08x", result);
+		return false;
+	}
+	m_beCloseStream(stream);
+
+	if (m_samples != samples)
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "Segment encoder uses a different chunk size");
+		return false;
+	}
+
+	m_chunkSize = m_samples * 2;
+	m_segmentChunks = segmentChunks > 0 ? segmentChunks : 1;
+
+	size_t chunks = LeadChunks + TrailChunks + m_segmentChunks;
+
+	m_history = new BYTE[(LeadChunks + TrailChunks) * m_chunkSize];
+	::memset(m_history, 0, (LeadChunks + TrailChunks) * m_chunkSize);
+
+	// two segments per worker, so one can be filled while the other encodes
+
+	m_segmentCount = workers * 2;
+	m_segments = new Segment[m_segmentCount];
+	for (size_t i = 0; i < m_segmentCount; ++i)
+	{
+		Segment& segment = m_segments[i];
+		segment.input = new BYTE[chunks * m_chunkSize];
+		segment.output = new BYTE[(chunks + 1) * m_outputSize];
+		segment.begin = 0;
+		segment.size = 0;
+		segment.state = Free;
+	}
+
+	m_semaphore = CreateSemaphore(0, 0, static_cast<LONG>(m_segmentCount), 0);
+	m_stop = CreateEvent(0, TRUE, FALSE, 0);
+	m_settled = CreateEvent(0, TRUE, TRUE, 0);
+	if (!m_semaphore || !m_stop || !m_settled)
+	{
+		Notify::update(Notify::Encoder, Notify::Error, "Could not create worker synchronization objects");
+		return false;
+	}
+
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+
+	m_workers = new HANDLE[workers];
+	for (size_t i = 0; i < workers; ++i)
+	{
+		m_workers[i] = CreateThread(0, 0, threadEntry, this, CREATE_SUSPENDED, 0);
+		if (!m_workers[i])
+		{
+			Notify::update(Notify::Encoder, Notify::Error, "Could not create thread");
+			return false;
+		}
+
+		++m_workerCount;
+
+		SetThreadIdealProcessor(m_workers[i], static_cast<DWORD>(i % info.dwNumberOfProcessors));
+		ResumeThread(m_workers[i]);
+	}
+
+	return true;
+}
+
+void ParallelEncoder::destroy()
+{
+	// workers finish the segment they are on before they see the event
+
+	if (m_stop)
+	{
+		SetEvent(m_stop);
+	}
+
+	for (size_t i = 0; i < m_workerCount; ++i)
+	{
+		WaitForSingleObject(m_workers[i], INFINITE);
+		CloseHandle(m_workers[i]);
+	}
+
+	delete [] m_workers;
+	m_workers = 0;
+	m_workerCount = 0;
+
+	for (size_t i = 0; i < m_segmentCount; ++i)
+	{
+		delete [] m_segments[i].input;
+		delete [] m_segments[i].output;
+	}
+
+	delete [] m_segments;
+	m_segments = 0;
+	m_segmentCount = 0;
+
+	delete [] m_history;
+	m_history = 0;
+
+	HANDLE* handles[] = { &m_semaphore, &m_stop, &m_settled };
+	for (size_t i = 0; i < sizeof(handles) / sizeof(handles[0]); ++i)
+	{
+		if (*handles[i])
+		{
+			CloseHandle(*handles[i]);
+			*handles[i] = 0;
+		}
+	}
+
+	if (m_module)
+	{
+		FreeLibrary(m_module);
+		m_module = 0;
+	}
+
+	m_fill = 0;
+	m_collect = 0;
+	m_filled = 0;
+	m_collected = false;
+	m_encoding = 0;
+}
+
+void* ParallelEncoder::input()
+{
+	void* result = 0;
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		Segment& segment = m_segments[m_fill % m_segmentCount];
+
+		// a new segment starts with the tail end of the previous one
+
+		if (segment.state == Free)
+		{
+			::memcpy(segment.input, m_history, (LeadChunks + TrailChunks) * m_chunkSize);
+			segment.state = Filling;
+			m_filled = 0;
+		}
+
+		if (segment.state != Filling)
+		{
+			break;
+		}
+
+		result = segment.input + (LeadChunks + TrailChunks + m_filled) * m_chunkSize;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	return result;
+}
+
+void ParallelEncoder::submit()
+{
+	if (++m_filled < m_segmentChunks)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		Segment& segment = m_segments[m_fill % m_segmentCount];
+
+		::memcpy(m_history, segment.input + m_segmentChunks * m_chunkSize, (LeadChunks + TrailChunks) * m_chunkSize);
+
+		segment.state = Queued;
+		++m_fill;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	ReleaseSemaphore(m_semaphore, 1, 0);
+}
+
+bool ParallelEncoder::collect(const BYTE*& output, DWORD& size)
+{
+	bool result = false;
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		// the segment handed out last time has been consumed by now
+
+		if (m_collected)
+		{
+			m_segments[m_collect % m_segmentCount].state = Free;
+			++m_collect;
+			m_collected = false;
+		}
+
+		if (m_collect == m_fill)
+		{
+			break;
+		}
+
+		Segment& segment = m_segments[m_collect % m_segmentCount];
+		if (segment.state != Done)
+		{
+			break;
+		}
+
+		output = segment.output + segment.begin;
+		size = segment.size;
+		m_collected = true;
+
+		result = true;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	return result;
+}
+
+void ParallelEncoder::reset()
+{
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		// segments being encoded still write to their buffers, so wait them out
+
+		while (m_encoding)
+		{
+			LeaveCriticalSection(&m_cs);
+			WaitForSingleObject(m_settled, INFINITE);
+			EnterCriticalSection(&m_cs);
+		}
+
+		for (size_t i = 0; i < m_segmentCount; ++i)
+		{
+			m_segments[i].state = Free;
+		}
+
+		::memset(m_history, 0, (LeadChunks + TrailChunks) * m_chunkSize);
+
+		m_fill = 0;
+		m_collect = 0;
+		m_filled = 0;
+		m_collected = false;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+}
+
+size_t ParallelEncoder::frameLength(const BYTE* header)
+{
+	static const int bitRates[2][16] =
+	{
+		{ 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 },
+		{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 }
+	};
+
+	static const int sampleRates[4][4] =
+	{
+		{ 11025, 12000, 8000, 0 },
+		{ 0, 0, 0, 0 },
+		{ 22050, 24000, 16000, 0 },
+		{ 44100, 48000, 32000, 0 }
+	};
+
+	if ((header[0] != 0xff) || ((header[1] & 0xe0) != 0xe0))
+	{
+		return 0;
+	}
+
+	int version = (header[1] >> 3) & 3;
+	int layer = (header[1] >> 1) & 3;
+	if (layer != 1)
+	{
+		return 0;
+	}
+
+	int bitRate = bitRates[version == 3 ? 0 : 1][header[2] >> 4];
+	int sampleRate = sampleRates[version][(header[2] >> 2) & 3];
+	int padding = (header[2] >> 1) & 1;
+	if (!bitRate || !sampleRate)
+	{
+		return 0;
+	}
+
+	return ((version == 3 ? 144000 : 72000) * bitRate) / sampleRate + padding;
+}
+
+DWORD WINAPI ParallelEncoder::threadEntry(LPVOID parameter)
+{
+	__try
+	{
+		ParallelEncoder* encoder = static_cast<ParallelEncoder*>(parameter);
+		encoder->run();
+	}
+	__except(ExceptionHandler::filter("ParallelEncoder", GetExceptionInformation()))
+	{
+	}
+	return 0;
+}
+
+void ParallelEncoder::run()
+{
+	HANDLE handles[] = { m_stop, m_semaphore };
+
+	for (;;)
+	{
+		if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0)
+		{
+			return;
+		}
+
+		Segment* segment = 0;
+
+		EnterCriticalSection(&m_cs);
+		do
+		{
+			for (size_t i = m_collect; i != m_fill; ++i)
+			{
+				Segment& curr = m_segments[i % m_segmentCount];
+				if (curr.state == Queued)
+				{
+					curr.state = Encoding;
+					segment = &curr;
+
+					if (!m_encoding++)
+					{
+						ResetEvent(m_settled);
+					}
+					break;
+				}
+			}
+		}
+		while (0);
+		LeaveCriticalSection(&m_cs);
+
+		if (!segment)
+		{
+			continue;
+		}
+
+		encode(*segment);
+
+		EnterCriticalSection(&m_cs);
+		do
+		{
+			segment->state = Done;
+
+			if (!--m_encoding)
+			{
+				SetEvent(m_settled);
+			}
+		}
+		while (0);
+		LeaveCriticalSection(&m_cs);
+	}
+}
+
+void ParallelEncoder::encode(Segment& segment)
+{
+	segment.begin = 0;
+	segment.size = 0;
+
+	HBE_STREAM stream;
+	DWORD samples;
+	DWORD outputSize;
+	BE_ERR result = m_beInitStream(&m_config, &samples, &outputSize, &stream);
+	if (result != BE_ERR_SUCCESSFUL)
+	{
+		Notify::update(Notify::Encoder, Notify::Warning, "beInitStream() failed - %08x", result);
+		return;
+	}
+
+	DWORD total = 0;
+	size_t chunks = LeadChunks + TrailChunks + m_segmentChunks;
+	for (size_t i = 0; i < chunks; ++i)
+	{
+		DWORD bytesWritten;
+		result = m_beEncodeChunk(stream, m_samples, (PSHORT)(segment.input + i * m_chunkSize), segment.output + total, &bytesWritten);
+		if (result != BE_ERR_SUCCESSFUL)
+		{
+			Notify::update(Notify::Encoder, Notify::Warning, "beEncodeChunk() failed - %08x", result);
+			m_beCloseStream(stream);
+			return;
+		}
+
+		total += bytesWritten;
+	}
+
+	DWORD bytesWritten = 0;
+	m_beDeinitStream(stream, segment.output + total, &bytesWritten);
+	total += bytesWritten;
+
+	m_beCloseStream(stream);
+
+	// every frame covers one chunk of input, so skip the frames of the leading
+	// overlap and keep one frame per chunk of the segment itself
+
+	DWORD offset = 0;
+	size_t frame = 0;
+	while (((offset + 4) <= total) && (frame < (LeadChunks + m_segmentChunks)))
+	{
+		size_t length = frameLength(segment.output + offset);
+		if (!length || ((offset + length) > total))
+		{
+			Notify::update(Notify::Encoder, Notify::Warning, "Lost frame sync in segment");
+			break;
+		}
+
+		if (frame == LeadChunks)
+		{
+			segment.begin = offset;
+		}
+
+		offset += static_cast<DWORD>(length);
+		++frame;
+	}
+
+	if (frame > LeadChunks)
+	{
+		segment.size = offset - segment.begin;
+	}
+}
+
+}
@@ -0,0 +1,130 @@
+#ifndef dsbridge_ParallelEncoder_h
+#define dsbridge_ParallelEncoder_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+
+#include "BladeMP3EncDLL.h"
+
+namespace dsbridge
+{
+
+// Encodes the stream as independent segments on a pool of worker threads. The
+// bit reservoir is disabled so every frame can be decoded on its own; each
+// segment is encoded together with a few chunks of the surrounding audio, and
+// only the frames belonging to the segment itself are kept. Segments are
+// handed back in the order they were submitted.
+
+class ParallelEncoder
+{
+public:
+	ParallelEncoder();
+	~ParallelEncoder();
+
+	bool create(const BE_CONFIG& config, DWORD samples, size_t workers, size_t segmentChunks);
+	void destroy();
+
+	size_t workers() const { return m_workerCount; }
+
+	void* input();
+	void submit();
+
+	bool collect(const BYTE*& output, DWORD& size);
+	void reset();
+
+	static size_t frameLength(const BYTE* header);
+
+private:
+
+	enum
+	{
+		LeadChunks = 2,
+		TrailChunks = 2
+	};
+
+	enum State
+	{
+		Free,
+		Filling,
+		Queued,
+		Encoding,
+		Done
+	};
+
+	struct Segment
+	{
+		PBYTE input;
+		PBYTE output;
+		DWORD begin;
+		DWORD size;
+		volatile State state;
+	};
+
+	static DWORD WINAPI threadEntry(LPVOID parameter);
+
+	void run();
+	void encode(Segment& segment);
+
+	HMODULE m_module;
+	BEINITSTREAM m_beInitStream;
+	BEENCODECHUNK m_beEncodeChunk;
+	BEDEINITSTREAM m_beDeinitStream;
+	BECLOSESTREAM m_beCloseStream;
+
+	BE_CONFIG m_config;
+	DWORD m_samples;
+	DWORD m_outputSize;
+
+	size_t m_chunkSize;
+	size_t m_segmentChunks;
+	size_t m_filled;
+
+	Segment* m_segments;
+	size_t m_segmentCount;
+	size_t m_fill;
+	size_t m_collect;
+	bool m_collected;
+
+	PBYTE m_history;
+
+	HANDLE* m_workers;
+	size_t m_workerCount;
+	HANDLE m_semaphore;
+	HANDLE m_stop;
+	CRITICAL_SECTION m_cs;
+
+	// segments being encoded, and an event set whenever there are none
+
+	size_t m_encoding;
+	HANDLE m_settled;
+};
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef dsbridge_PcmBackend_h
+#define dsbridge_PcmBackend_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "EncoderBackend.h"
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+// Uncompressed output, either as a never-ending WAV file or as raw big-endian
+// L16 (RFC 2586) for renderers that take it directly.
+
+class PcmBackend : public EncoderBackend
+{
+public:
+	enum Format
+	{
+		Wave,
+		L16
+	};
+
+	PcmBackend(Format format);
+	virtual ~PcmBackend();
+
+	virtual bool initialize(const char* mount);
+	virtual bool start() { m_pending = false; return true; }
+
+	virtual const char* contentType() const;
+	virtual const char* extension() const { return m_format == Wave ? "wav" : "pcm"; }
+	virtual const BYTE* header(DWORD& size) const;
+	virtual size_t bufferSize() const { return 1024 * 1024; }
+
+protected:
+
+	virtual bool encodeChunk(const void* input, PBYTE output, DWORD& size);
+
+private:
+
+	enum
+	{
+		ChunkSamples = 1024,
+		HeaderSize = 44
+	};
+
+	Format m_format;
+	BYTE m_header[HeaderSize];
+};
+
+}
+
+#endif
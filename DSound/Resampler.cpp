@@ -0,0 +1,317 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Resampler.h"
+
+#include <math.h>
+#include <malloc.h>
+#include <xmmintrin.h>
+
+namespace dsbridge
+{
+
+static double besselI0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+
+	for (int k = 1; k < 32; ++k)
+	{
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+
+	return sum;
+}
+
+static DWORD gcd(DWORD a, DWORD b)
+{
+	while (b)
+	{
+		DWORD t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+Resampler::Resampler()
+: m_inputRate(0)
+, m_outputRate(0)
+, m_taps(0)
+, m_phases(0)
+, m_exact(false)
+, m_coefficients(0)
+, m_step(0)
+, m_phase(0)
+, m_increment(0)
+, m_fraction(0)
+, m_historySize(0)
+, m_historyCount(0)
+, m_position(0)
+, m_dot(dotScalar)
+{
+	m_history[0] = m_history[1] = 0;
+}
+
+Resampler::~Resampler()
+{
+	destroy();
+}
+
+bool Resampler::create(DWORD inputRate, DWORD outputRate, Quality quality, size_t maxFrames)
+{
+	static const size_t taps[] = { 16, 32, 64 };
+	static const double passband[] = { 0.80, 0.90, 0.95 };
+	static const double beta[] = { 6.0, 8.0, 10.0 };
+
+	destroy();
+
+	if (!inputRate || !outputRate)
+	{
+		return false;
+	}
+
+	m_inputRate = inputRate;
+	m_outputRate = outputRate;
+	m_taps = taps[quality];
+
+	DWORD divisor = gcd(inputRate, outputRate);
+	m_exact = (outputRate / divisor) <= MaxExactPhases;
+	m_phases = m_exact ? outputRate / divisor : InterpolatedPhases;
+	m_step = inputRate / divisor;
+	m_increment = (ULONGLONG(inputRate) << 32) / outputRate;
+
+	// one extra row, so interpolation never has to wrap to the next input sample
+
+	size_t rows = m_phases + 1;
+	m_coefficients = static_cast<float*>(_aligned_malloc(rows * m_taps * sizeof(float), 16));
+
+	// when decimating the cutoff follows the output rate, so nothing aliases
+
+	double cutoff = passband[quality] * (outputRate < inputRate ? double(outputRate) / inputRate : 1.0);
+	double center = double(m_taps / 2 - 1);
+	double norm = besselI0(beta[quality]);
+
+	for (size_t row = 0; row < rows; ++row)
+	{
+		float* coefficients = m_coefficients + row * m_taps;
+		double fraction = double(row) / m_phases;
+		double sum = 0.0;
+
+		for (size_t k = 0; k < m_taps; ++k)
+		{
+			double d = double(k) - center - fraction;
+			double x = d / (m_taps / 2);
+			double window = (x > -1.0) && (x < 1.0) ? besselI0(beta[quality] * sqrt(1.0 - x * x)) / norm : 0.0;
+			double sinc = d != 0.0 ? sin(3.14159265358979323846 * cutoff * d) / (3.14159265358979323846 * cutoff * d) : 1.0;
+
+			double value = cutoff * sinc * window;
+			coefficients[k] = float(value);
+			sum += value;
+		}
+
+		// every phase passes DC at unity gain, or the phases beat against each other
+
+		for (size_t k = 0; k < m_taps; ++k)
+		{
+			coefficients[k] = float(coefficients[k] / sum);
+		}
+	}
+
+	m_historySize = maxFrames + m_taps + 1;
+	m_history[0] = static_cast<float*>(_aligned_malloc(m_historySize * sizeof(float), 16));
+	m_history[1] = static_cast<float*>(_aligned_malloc(m_historySize * sizeof(float), 16));
+
+	m_dot = IsProcessorFeaturePresent(PF_XMMI_INSTRUCTIONS_AVAILABLE) ? dotSSE : dotScalar;
+
+	reset();
+	return true;
+}
+
+void Resampler::destroy()
+{
+	_aligned_free(m_coefficients);
+	_aligned_free(m_history[0]);
+	_aligned_free(m_history[1]);
+
+	m_coefficients = 0;
+	m_history[0] = m_history[1] = 0;
+	m_inputRate = m_outputRate = 0;
+}
+
+void Resampler::reset()
+{
+	// prime with silence so the first output sample lines up with the first input
+
+	m_historyCount = m_taps / 2 - 1;
+	for (size_t i = 0; i < m_historyCount; ++i)
+	{
+		m_history[0][i] = m_history[1][i] = 0.0f;
+	}
+
+	m_position = 0;
+	m_phase = 0;
+	m_fraction = 0;
+}
+
+size_t Resampler::maxOutput(size_t frames) const
+{
+	return size_t((ULONGLONG(frames + m_taps) * m_outputRate) / m_inputRate) + 2;
+}
+
+size_t Resampler::process(const short* input, size_t frames, short* output)
+{
+	float* left = m_history[0];
+	float* right = m_history[1];
+
+	for (size_t i = 0; i < frames; ++i)
+	{
+		left[m_historyCount + i] = input[i * 2 + 0];
+		right[m_historyCount + i] = input[i * 2 + 1];
+	}
+	m_historyCount += frames;
+
+	return produce(output);
+}
+
+size_t Resampler::flush(short* output)
+{
+	// push the last input samples out of the filter with silence
+
+	size_t frames = m_taps / 2;
+	for (size_t i = 0; i < frames; ++i)
+	{
+		m_history[0][m_historyCount + i] = m_history[1][m_historyCount + i] = 0.0f;
+	}
+	m_historyCount += frames;
+
+	size_t produced = produce(output);
+	reset();
+
+	return produced;
+}
+
+size_t Resampler::produce(short* output)
+{
+	float* left = m_history[0];
+	float* right = m_history[1];
+
+	size_t produced = 0;
+	while ((m_position + m_taps) <= m_historyCount)
+	{
+		float result[2];
+
+		if (m_exact)
+		{
+			m_dot(left + m_position, right + m_position, m_coefficients + m_phase * m_taps, m_taps, result);
+
+			m_phase += m_step;
+			m_position += m_phase / m_phases;
+			m_phase %= m_phases;
+		}
+		else
+		{
+			ULONGLONG scaled = ULONGLONG(m_fraction) * m_phases;
+			size_t row = size_t(scaled >> 32);
+			float weight = float(DWORD(scaled)) * (1.0f / 4294967296.0f);
+
+			float next[2];
+			m_dot(left + m_position, right + m_position, m_coefficients + row * m_taps, m_taps, result);
+			m_dot(left + m_position, right + m_position, m_coefficients + (row + 1) * m_taps, m_taps, next);
+
+			result[0] += (next[0] - result[0]) * weight;
+			result[1] += (next[1] - result[1]) * weight;
+
+			ULONGLONG position = ULONGLONG(m_fraction) + m_increment;
+			m_position += size_t(position >> 32);
+			m_fraction = DWORD(position);
+		}
+
+		for (int channel = 0; channel < 2; ++channel)
+		{
+			float value = result[channel] + (result[channel] < 0.0f ? -0.5f : 0.5f);
+			output[produced * 2 + channel] = short(value > 32767.0f ? 32767 : (value < -32768.0f ? -32768 : int(value)));
+		}
+
+		++produced;
+	}
+
+	// keep only what later output samples still need
+
+	if (m_position >= m_historyCount)
+	{
+		m_position -= m_historyCount;
+		m_historyCount = 0;
+	}
+	else
+	{
+		m_historyCount -= m_position;
+		::memmove(left, left + m_position, m_historyCount * sizeof(float));
+		::memmove(right, right + m_position, m_historyCount * sizeof(float));
+		m_position = 0;
+	}
+
+	return produced;
+}
+
+void Resampler::dotScalar(const float* left, const float* right, const float* coefficients, size_t taps, float* result)
+{
+	float l = 0.0f;
+	float r = 0.0f;
+
+	for (size_t i = 0; i < taps; ++i)
+	{
+		l += left[i] * coefficients[i];
+		r += right[i] * coefficients[i];
+	}
+
+	result[0] = l;
+	result[1] = r;
+}
+
+void Resampler::dotSSE(const float* left, const float* right, const float* coefficients, size_t taps, float* result)
+{
+	__m128 l = _mm_setzero_ps();
+	__m128 r = _mm_setzero_ps();
+
+	for (size_t i = 0; i < taps; i += 4)
+	{
+		__m128 c = _mm_load_ps(coefficients + i);
+		l = _mm_add_ps(l, _mm_mul_ps(_mm_loadu_ps(left + i), c));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(right + i), c));
+	}
+
+	// l0+l2 r0+r2 l1+l3 r1+r3, then fold the upper half onto the lower
+
+	__m128 sum = _mm_add_ps(_mm_unpacklo_ps(l, r), _mm_unpackhi_ps(l, r));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+
+	_mm_storel_pi(reinterpret_cast<__m64*>(result), sum);
+}
+
+}
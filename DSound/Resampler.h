@@ -0,0 +1,106 @@
+#ifndef dsbridge_Resampler_h
+#define dsbridge_Resampler_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+// Windowed-sinc polyphase resampler for 16-bit stereo. When the rate ratio
+// reduces to a small fraction (48000 -> 44100 is 147/160, 22050 -> 44100 is
+// 2/1) every output sample uses one exact precomputed phase; other ratios
+// interpolate between neighbouring phases of a finer table.
+
+class Resampler
+{
+public:
+	enum Quality
+	{
+		Low,
+		Medium,
+		High
+	};
+
+	Resampler();
+	~Resampler();
+
+	bool create(DWORD inputRate, DWORD outputRate, Quality quality, size_t maxFrames);
+	void destroy();
+	void reset();
+
+	DWORD inputRate() const { return m_inputRate; }
+	DWORD outputRate() const { return m_outputRate; }
+	size_t maxOutput(size_t frames) const;
+
+	size_t process(const short* input, size_t frames, short* output);
+	size_t flush(short* output);
+
+private:
+
+	enum
+	{
+		MaxExactPhases = 1024,
+		InterpolatedPhases = 256
+	};
+
+	size_t produce(short* output);
+
+	typedef void (*DotFunction)(const float* left, const float* right, const float* coefficients, size_t taps, float* result);
+
+	static void dotScalar(const float* left, const float* right, const float* coefficients, size_t taps, float* result);
+	static void dotSSE(const float* left, const float* right, const float* coefficients, size_t taps, float* result);
+
+	DWORD m_inputRate;
+	DWORD m_outputRate;
+
+	size_t m_taps;
+	size_t m_phases;
+	bool m_exact;
+	float* m_coefficients;
+
+	// exact ratios step through phases by m_step / m_phases, the others use a
+	// 32.32 fixed-point input position
+
+	DWORD m_step;
+	DWORD m_phase;
+	ULONGLONG m_increment;
+	DWORD m_fraction;
+
+	float* m_history[2];
+	size_t m_historySize;
+	size_t m_historyCount;
+	size_t m_position;
+
+	DotFunction m_dot;
+};
+
+}
+
+#endif
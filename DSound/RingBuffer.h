@@ -1,65 +1,65 @@
-#ifndef dsbridge_RingBuffer_h
-#define dsbridge_RingBuffer_h
-
-/*
-
-Copyright 2009 Jesper Svennevid
-
-Redistribution and use in source and binary forms, with or without
-modification, are permitted provided that the following conditions
-are met:
-
-1. Redistributions of source code must retain the above copyright
-   notice, this list of conditions and the following disclaimer.
-2. Redistributions in binary form must reproduce the above copyright
-   notice, this list of conditions and the following disclaimer in the
-   documentation and/or other materials provided with the distribution.
-
-THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
-IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
-OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
-IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
-INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
-NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
-DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
-THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
-(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
-THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-
-*/
-
-#include <stddef.h>
-
-namespace dsbridge
-{
-
-class RingBuffer
-{
-public:
-	RingBuffer();
-	~RingBuffer();
-
-	bool create(size_t size);
-	void destroy();
-
-	size_t written() const;
-	size_t left() const;
-
-	bool write(const void* buffer, size_t size);
-	size_t read(void* buffer, size_t size);
-	size_t peek(void* buffer, size_t size, size_t offset = 0);
-	size_t seek(size_t size);
-	void discard(size_t size);
-private:
-	char* m_write;
-	char* m_read;
-
-	char* m_begin;
-	char* m_end;
-
-	size_t m_dataAvailable;
-};
-
-}
-
-#endif
+#ifndef dsbridge_RingBuffer_h
+#define dsbridge_RingBuffer_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <stddef.h>
+
+namespace dsbridge
+{
+
+class RingBuffer
+{
+public:
+	RingBuffer();
+	~RingBuffer();
+
+	bool create(size_t size);
+	void destroy();
+
+	size_t written() const;
+	size_t left() const;
+
+	bool write(const void* buffer, size_t size);
+	size_t read(void* buffer, size_t size);
+	size_t peek(void* buffer, size_t size, size_t offset = 0);
+	size_t seek(size_t size);
+	void discard(size_t size);
+private:
+	char* m_write;
+	char* m_read;
+
+	char* m_begin;
+	char* m_end;
+
+	size_t m_dataAvailable;
+};
+
+}
+
+#endif
@@ -0,0 +1,228 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Trace.h"
+
+#if DSBRIDGE_TRACE
+
+#include "Histogram.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace dsbridge
+{
+
+static LONGLONG frequency()
+{
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	return freq.QuadPart;
+}
+
+static const LONGLONG s_frequency = frequency();
+static const double s_nanoseconds = 1000000000.0 / s_frequency;
+
+const char* volatile Trace::s_sites[MaxSites];
+Trace::Thread* volatile Trace::s_threads = 0;
+DWORD Trace::s_tls = TlsAlloc();
+
+void Trace::record(const char* name, LONGLONG begin, LONGLONG end)
+{
+	Thread* current = thread();
+	size_t index = site(name);
+	if (!current || (index == MaxSites))
+	{
+		return;
+	}
+
+	// the first call from a thread allocates, every later one only counts
+
+	Histogram* histogram = current->histograms[index];
+	if (!histogram)
+	{
+		histogram = new Histogram;
+		current->histograms[index] = histogram;
+	}
+
+	// nanoseconds, as most of the calls traced take well under a microsecond
+
+	double nanoseconds = (end - begin) * s_nanoseconds;
+	histogram->record(nanoseconds < 4294967295.0 ? static_cast<DWORD>(nanoseconds) : 0xffffffff);
+
+#if DSBRIDGE_TRACE >= 2
+	Event& event = current->events[current->eventCount % RingSize];
+	event.name = name;
+	event.begin = begin;
+	event.end = end;
+	current->eventCount = current->eventCount + 1;
+#endif
+}
+
+size_t Trace::site(const char* name)
+{
+	size_t start = static_cast<size_t>((reinterpret_cast<DWORD_PTR>(name) >> 2) % MaxSites);
+
+	for (size_t i = 0; i < MaxSites; ++i)
+	{
+		size_t index = (start + i) % MaxSites;
+
+		const char* current = s_sites[index];
+		if (!current)
+		{
+			current = static_cast<const char*>(InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(const_cast<char* volatile*>(&s_sites[index])), const_cast<char*>(name), 0));
+			if (!current)
+			{
+				return index;
+			}
+		}
+
+		if (current == name)
+		{
+			return index;
+		}
+	}
+
+	return MaxSites;
+}
+
+Trace::Thread* Trace::thread()
+{
+	if (s_tls == TLS_OUT_OF_INDEXES)
+	{
+		return 0;
+	}
+
+	Thread* current = static_cast<Thread*>(TlsGetValue(s_tls));
+	if (current)
+	{
+		return current;
+	}
+
+	current = new Thread;
+	::memset(current, 0, sizeof(Thread));
+	current->id = GetCurrentThreadId();
+	TlsSetValue(s_tls, current);
+
+	// threads are never taken off the list, so what they recorded is still
+	// reported after they exit
+
+	Thread* head;
+	do
+	{
+		head = s_threads;
+		current->next = head;
+	}
+	while (InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(&s_threads), current, head) != head);
+
+	return current;
+}
+
+size_t Trace::report(char* buffer, size_t size)
+{
+	size_t length = 0;
+	buffer[0] = '\0';
+
+	for (size_t i = 0; i < MaxSites; ++i)
+	{
+		const char* name = s_sites[i];
+		if (!name)
+		{
+			continue;
+		}
+
+		if ((size - length) < 256)
+		{
+			break;
+		}
+
+		Histogram merged;
+		for (Thread* current = s_threads; current; current = current->next)
+		{
+			if (current->histograms[i])
+			{
+				merged.add(*current->histograms[i]);
+			}
+		}
+
+		sprintf_s(buffer + length, size - length, "%-48.128s count %I64u p50 %u ns p99 %u ns p99.9 %u ns max %u ns\r\n", name, merged.count(), merged.percentile(0.5), merged.percentile(0.99), merged.percentile(0.999), merged.maximum());
+		length += ::strlen(buffer + length);
+	}
+
+	return length;
+}
+
+char* Trace::events(size_t& size)
+{
+	size_t capacity = 64;
+
+#if DSBRIDGE_TRACE >= 2
+	for (Thread* current = s_threads; current; current = current->next)
+	{
+		LONG count = current->eventCount;
+		capacity += (count < RingSize ? count : RingSize) * 256;
+	}
+#endif
+
+	char* buffer = new char[capacity];
+	sprintf_s(buffer, capacity, "{\"traceEvents\":[");
+	size_t length = ::strlen(buffer);
+
+#if DSBRIDGE_TRACE >= 2
+	bool first = true;
+
+	for (Thread* current = s_threads; current; current = current->next)
+	{
+		// the oldest calls may be overwritten while this runs, which at worst
+		// garbles a few of them
+
+		LONG count = current->eventCount;
+		for (LONG i = count > RingSize ? count - RingSize : 0; i < count; ++i)
+		{
+			const Event& event = current->events[i % RingSize];
+			if (!event.name || (event.end < event.begin) || ((capacity - length) < 256))
+			{
+				continue;
+			}
+
+			sprintf_s(buffer + length, capacity - length, "%s{\"name\":\"%.128s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",", event.name, current->id, (event.begin * 1000000.0) / s_frequency, ((event.end - event.begin) * 1000000.0) / s_frequency);
+			length += ::strlen(buffer + length);
+			first = false;
+		}
+	}
+#endif
+
+	sprintf_s(buffer + length, capacity - length, "]}\n");
+	length += ::strlen(buffer + length);
+
+	size = length;
+	return buffer;
+}
+
+}
+
+#endif
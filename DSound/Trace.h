@@ -0,0 +1,150 @@
+#ifndef dsbridge_Trace_h
+#define dsbridge_Trace_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+
+// Call tracing, chosen when building: 0 compiles it out, 1 records how long
+// every traced call takes, 2 also keeps the most recent calls of every thread
+// for export as a Chrome trace (chrome://tracing or ui.perfetto.dev)
+
+#ifndef DSBRIDGE_TRACE
+#define DSBRIDGE_TRACE 0
+#endif
+
+#if DSBRIDGE_TRACE
+
+#define DSBRIDGE_BEGINCALL(func) dsbridge::Trace::Call dsbridgeCall(func)
+#define DSBRIDGE_ENDCALL(func) dsbridgeCall.end()
+#define DSBRIDGE_TRACECALL(func) dsbridge::Trace::Call dsbridgeCall(func)
+
+#else
+
+#define DSBRIDGE_BEGINCALL(func)
+#define DSBRIDGE_ENDCALL(func)
+#define DSBRIDGE_TRACECALL(func)
+
+#endif
+
+#if DSBRIDGE_TRACE
+
+namespace dsbridge
+{
+
+class Histogram;
+
+// Every thread records into histograms and an event ring of its own, so a
+// traced call never waits for another thread; readers merge them as they go.
+// Call sites are told apart by the address of their name.
+
+class Trace
+{
+public:
+	class Call
+	{
+	public:
+		Call(const char* name)
+		: m_name(name)
+		{
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			m_begin = now.QuadPart;
+		}
+
+		~Call()
+		{
+			end();
+		}
+
+		void end()
+		{
+			if (m_name)
+			{
+				LARGE_INTEGER now;
+				QueryPerformanceCounter(&now);
+				record(m_name, m_begin, now.QuadPart);
+				m_name = 0;
+			}
+		}
+
+	private:
+		const char* m_name;
+		LONGLONG m_begin;
+	};
+
+	// enough for report() with every call site in use
+
+	enum
+	{
+		ReportSize = 64 * 256
+	};
+
+	static size_t report(char* buffer, size_t size);
+	static char* events(size_t& size);
+
+private:
+
+	enum
+	{
+		MaxSites = 64,
+		RingSize = 4096
+	};
+
+	struct Event
+	{
+		const char* name;
+		LONGLONG begin;
+		LONGLONG end;
+	};
+
+	struct Thread
+	{
+		DWORD id;
+		Histogram* histograms[MaxSites];
+#if DSBRIDGE_TRACE >= 2
+		Event events[RingSize];
+		volatile LONG eventCount;
+#endif
+		Thread* next;
+	};
+
+	static void record(const char* name, LONGLONG begin, LONGLONG end);
+	static size_t site(const char* name);
+	static Thread* thread();
+
+	static const char* volatile s_sites[MaxSites];
+	static Thread* volatile s_threads;
+	static DWORD s_tls;
+};
+
+}
+
+#endif
+
+#endif
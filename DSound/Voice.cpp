@@ -0,0 +1,561 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Voice.h"
+#include "Latency.h"
+#include "Notify.h"
+
+#include <math.h>
+
+namespace dsbridge
+{
+
+static double seconds()
+{
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+
+	return double(counter.QuadPart) / double(frequency.QuadPart);
+}
+
+Voice::Voice()
+: m_supported(true)
+, m_blockAlign(2 * 2)
+, m_partialSize(0)
+, m_stamps(0)
+, m_stampCapacity(0)
+, m_stampCount(0)
+, m_playing(false)
+, m_observed(0)
+, m_observations(0)
+, m_consumed(0)
+, m_anchor(0.0)
+, m_anchorGoal(0)
+, m_goal(0)
+, m_bufferSize(0)
+, m_drain(0)
+, m_draining(false)
+, m_position(0)
+, m_fraction(0)
+, m_primed(false)
+, m_volume(0)
+, m_pan(0)
+, m_frequency(0)
+{
+	InitializeCriticalSection(&m_cs);
+	m_previous[0] = m_previous[1] = 0;
+
+	::memset(&m_format, 0, sizeof(m_format));
+	m_format.wFormatTag = WAVE_FORMAT_PCM;
+	m_format.nChannels = 2;
+	m_format.nSamplesPerSec = 44100;
+	m_format.wBitsPerSample = 16;
+	m_format.nBlockAlign = 2 * 2;
+	m_format.nAvgBytesPerSec = 44100 * 2 * 2;
+
+	updateGains();
+}
+
+Voice::~Voice()
+{
+	delete[] m_stamps;
+	DeleteCriticalSection(&m_cs);
+}
+
+bool Voice::create(LPCWAVEFORMATEX format, DWORD bufferSize)
+{
+	if (format)
+	{
+		setFormat(format);
+	}
+
+	// room for the whole buffer twice over, converted
+
+	size_t size = (bufferSize / m_blockAlign) * (2*2) * 2;
+	if (!m_buffer.create(size > 256 * 1024 ? size : 256 * 1024))
+	{
+		Notify::update(Notify::DirectSound, Notify::Error, "Could not create voice buffer");
+		return false;
+	}
+
+	// writes share a stamp until they are StampBytes apart, so this many
+	// reach back over everything the ring holds
+
+	m_stampCapacity = m_buffer.size() / StampBytes + 1;
+	m_stamps = new Stamp[m_stampCapacity];
+
+	m_buffer.setReclaimLimit(0);
+	m_bufferSize = bufferSize;
+	m_clock.reset(nominalRate(), seconds(), 0.0, bufferSize / static_cast<DWORD>(m_blockAlign));
+
+	return true;
+}
+
+void Voice::setFormat(LPCWAVEFORMATEX format)
+{
+	EnterCriticalSection(&m_cs);
+
+	do
+	{
+		m_format = *format;
+		m_format.cbSize = 0;
+		m_partialSize = 0;
+
+		// an unknown format still advances the voice, as silence
+
+		m_supported = m_converter.configure(format);
+		if (!m_supported)
+		{
+			Notify::update(Notify::DirectSound, Notify::Warning, "Unsupported sample format (tag %d, %d bits, %d channels), mixing silence", format->wFormatTag, format->wBitsPerSample, format->nChannels);
+		}
+
+		m_blockAlign = m_supported ? m_converter.blockAlign() : ((format->nBlockAlign && (format->nBlockAlign <= MaxBlockAlign)) ? format->nBlockAlign : 1);
+	}
+	while (0);
+
+	LeaveCriticalSection(&m_cs);
+}
+
+void Voice::setVolume(LONG volume)
+{
+	EnterCriticalSection(&m_cs);
+	m_volume = volume;
+	updateGains();
+	LeaveCriticalSection(&m_cs);
+}
+
+void Voice::setPan(LONG pan)
+{
+	EnterCriticalSection(&m_cs);
+	m_pan = pan;
+	updateGains();
+	LeaveCriticalSection(&m_cs);
+}
+
+void Voice::setFrequency(DWORD frequency)
+{
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		double time = seconds();
+		if (m_playing)
+		{
+			updatePosition(time);
+		}
+
+		// the recovered deviation belonged to the old rate, so it starts over
+
+		m_frequency = frequency;
+		m_clock.retune(nominalRate(), time);
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+}
+
+void Voice::write(const void* buffer, size_t count)
+{
+	EnterCriticalSection(&m_cs);
+
+	do
+	{
+		const BYTE* input = static_cast<const BYTE*>(buffer);
+
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+
+		ULONGLONG head = m_buffer.head();
+		if (m_stampCapacity && (!m_stampCount || ((head - m_stamps[(m_stampCount - 1) % m_stampCapacity].position) >= StampBytes)))
+		{
+			Stamp& stamp = m_stamps[m_stampCount++ % m_stampCapacity];
+			stamp.position = head;
+			stamp.time = now.QuadPart;
+		}
+
+		if (m_partialSize)
+		{
+			size_t needed = m_blockAlign - m_partialSize;
+			size_t size = count < needed ? count : needed;
+
+			::memcpy(m_partial + m_partialSize, input, size);
+			m_partialSize += size;
+			input += size;
+			count -= size;
+
+			if (m_partialSize < m_blockAlign)
+			{
+				break;
+			}
+
+			convert(m_partial, 1);
+			m_partialSize = 0;
+		}
+
+		size_t frames = count / m_blockAlign;
+		convert(input, frames);
+		input += frames * m_blockAlign;
+
+		m_partialSize = count % m_blockAlign;
+		::memcpy(m_partial, input, m_partialSize);
+	}
+	while (0);
+
+	LeaveCriticalSection(&m_cs);
+}
+
+void Voice::convert(const BYTE* input, size_t frames)
+{
+	// straight into the ring, in up to two pieces around the wrap
+
+	while (frames)
+	{
+		size_t size = frames * (2*2);
+		short* output = reinterpret_cast<short*>(m_buffer.reserve(size));
+
+		size_t count = size / (2*2);
+		if (!count)
+		{
+			break;
+		}
+
+		if (m_supported)
+		{
+			m_converter.convert(input, count, output);
+		}
+		else
+		{
+			::memset(output, 0, count * (2*2));
+		}
+
+		m_buffer.commit(count * (2*2));
+
+		input += count * m_blockAlign;
+		frames -= count;
+	}
+}
+
+void Voice::onPlay(DWORD position)
+{
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		if (!m_playing)
+		{
+			m_anchor = double(position / m_blockAlign);
+			m_anchorGoal = m_goal;
+			m_clock.reset(nominalRate(), seconds(), m_anchor, m_bufferSize / static_cast<DWORD>(m_blockAlign));
+			m_consumed = m_observations;
+			m_primed = false;
+			m_playing = true;
+
+			// playing again before the drain finished carries straight on
+
+			m_draining = false;
+		}
+
+		InterlockedExchange(&m_observed, static_cast<LONG>(position));
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+}
+
+void Voice::onStop(DWORD position)
+{
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		if (!m_playing)
+		{
+			break;
+		}
+
+		InterlockedExchange(&m_observed, static_cast<LONG>(position));
+		InterlockedIncrement(&m_observations);
+		updatePosition(seconds());
+
+		// whatever was written beyond the play position stays, since a pause
+		// resumes right where it stopped. The mixer plays out what was heard
+		// on its own time, and starts over from silence when it gets to the
+		// marker
+
+		m_drain = m_goal;
+		m_draining = true;
+		m_playing = false;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+}
+
+void Voice::onSeek(DWORD position)
+{
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		// moved while stopped, so this was a real stop rather than a pause,
+		// and what was written beyond where it stopped is never heard
+
+		if (!m_playing)
+		{
+			if (m_buffer.head() > m_goal)
+			{
+				m_buffer.truncate(m_goal);
+			}
+
+			break;
+		}
+
+		// the cursor jumps, so the clock is anchored again where the goal stands
+
+		double time = seconds();
+		updatePosition(time);
+
+		m_anchor = double(position / m_blockAlign);
+		m_anchorGoal = m_goal;
+		m_clock.seek(time, m_anchor);
+
+		InterlockedExchange(&m_observed, static_cast<LONG>(position));
+		m_consumed = m_observations;
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+}
+
+void Voice::onUpdate(DWORD position)
+{
+	// applications poll this from any thread, so it must never wait for the mixer
+
+	InterlockedExchange(&m_observed, static_cast<LONG>(position));
+	InterlockedIncrement(&m_observations);
+}
+
+bool Voice::active()
+{
+	EnterCriticalSection(&m_cs);
+	bool result = m_playing || (m_position < readable());
+	LeaveCriticalSection(&m_cs);
+
+	return result;
+}
+
+LONGLONG Voice::mix(int* accumulator, size_t frames, DWORD mixRate)
+{
+	LONGLONG result = 0;
+
+	EnterCriticalSection(&m_cs);
+	do
+	{
+		if (m_playing)
+		{
+			updatePosition(seconds());
+		}
+
+		// consumed at the recovered rate, or the backlog would slowly grow or run dry
+
+		ULONGLONG step = static_cast<ULONGLONG>(m_clock.rate() / mixRate * 4294967296.0);
+		if (!step)
+		{
+			break;
+		}
+
+		ULONGLONG limit = readable();
+		size_t available = limit > m_position ? static_cast<size_t>((limit - m_position) / (2*2)) : 0;
+
+		// hold off until a whole tick is audible, so the timer rounding between
+		// this and the mixer clock can never starve a playing voice
+
+		if (!m_primed)
+		{
+			if (m_playing && (available < static_cast<size_t>((ULONGLONG(frames) * step) >> 32) + 2))
+			{
+				break;
+			}
+
+			m_primed = true;
+		}
+
+		ULONGLONG start = m_position;
+
+		while (frames)
+		{
+			size_t inputs = available < MixFrames ? available : MixFrames;
+			if (!inputs)
+			{
+				break;
+			}
+
+			// as many outputs as the inputs cover, both for interpolating and
+			// for the frame the next call starts from
+
+			ULONGLONG span = ULONGLONG(inputs) << 32;
+			size_t count = static_cast<size_t>((span - 1 - m_fraction) / step) + 1;
+			size_t limited = static_cast<size_t>((span + 0xffffffff - m_fraction) / step);
+			count = count < limited ? count : limited;
+			count = count < frames ? count : frames;
+			if (!count)
+			{
+				break;
+			}
+
+			ULONGLONG end = m_fraction + ULONGLONG(count) * step;
+			size_t consumed = static_cast<size_t>(end >> 32);
+			size_t needed = static_cast<size_t>((m_fraction + ULONGLONG(count - 1) * step) >> 32) + 1;
+			needed = needed > consumed ? needed : consumed;
+
+			ULONGLONG position = m_position;
+			m_samples[0] = m_previous[0];
+			m_samples[1] = m_previous[1];
+			m_buffer.read(position, m_samples + 2, needed * (2*2));
+
+			ULONGLONG fraction = m_fraction;
+			for (size_t i = 0; i < count; ++i)
+			{
+				const short* frame = m_samples + static_cast<size_t>(fraction >> 32) * 2;
+				int weight = static_cast<int>(static_cast<DWORD>(fraction) >> 17);
+
+				int left = frame[0] + (((frame[2] - frame[0]) * weight) >> 15);
+				int right = frame[1] + (((frame[3] - frame[1]) * weight) >> 15);
+
+				accumulator[i * 2 + 0] += (left * m_gains[0]) >> 16;
+				accumulator[i * 2 + 1] += (right * m_gains[1]) >> 16;
+
+				fraction += step;
+			}
+
+			m_previous[0] = m_samples[consumed * 2 + 0];
+			m_previous[1] = m_samples[consumed * 2 + 1];
+			m_fraction = static_cast<DWORD>(end);
+			m_position += consumed * (2*2);
+
+			available -= consumed;
+			accumulator += count * 2;
+			frames -= count;
+		}
+
+		// ran dry, so build up a tick again before continuing
+
+		if (frames && m_playing)
+		{
+			m_primed = false;
+		}
+
+		// a stopped voice has played out, so nothing carries over into the
+		// next time it plays
+
+		if (m_draining && (m_position >= m_drain))
+		{
+			m_previous[0] = m_previous[1] = 0;
+			m_fraction = 0;
+			m_primed = false;
+			m_draining = false;
+		}
+
+		m_buffer.setReclaimLimit(m_position);
+
+		if (m_position != start)
+		{
+			result = writtenAt(start);
+		}
+	}
+	while (0);
+	LeaveCriticalSection(&m_cs);
+
+	return result;
+}
+
+void Voice::updatePosition(double time)
+{
+	// only cursors the application saw since the last update are news
+
+	LONG observations = m_observations;
+	if (observations != m_consumed)
+	{
+		m_consumed = observations;
+		m_clock.observe(time, static_cast<DWORD>(m_observed) / static_cast<DWORD>(m_blockAlign));
+
+		Latency::record(Latency::Jitter, m_clock.jitter() / m_clock.rate());
+	}
+
+	double frames = m_clock.position(time) - m_anchor;
+	if (frames > 0.0)
+	{
+		ULONGLONG goal = m_anchorGoal + static_cast<ULONGLONG>(frames) * (2*2);
+		m_goal = goal > m_goal ? goal : m_goal;
+	}
+
+	// what the application wrote and the device has yet to play is the
+	// latency the buffer adds, in the device's own time
+
+	ULONGLONG head = m_buffer.head();
+	if (head > m_goal)
+	{
+		Latency::record(Latency::Ahead, (head - m_goal) / (2*2) / m_clock.rate());
+	}
+}
+
+void Voice::updateGains()
+{
+	// volume and pan are attenuations in hundredths of a decibel
+
+	double volume = pow(10.0, m_volume / 2000.0);
+	double left = m_pan > 0 ? pow(10.0, -m_pan / 2000.0) : 1.0;
+	double right = m_pan < 0 ? pow(10.0, m_pan / 2000.0) : 1.0;
+
+	m_gains[0] = static_cast<int>(volume * left * 65536.0);
+	m_gains[1] = static_cast<int>(volume * right * 65536.0);
+}
+
+DWORD Voice::nominalRate() const
+{
+	return m_frequency ? m_frequency : m_format.nSamplesPerSec;
+}
+
+ULONGLONG Voice::readable() const
+{
+	ULONGLONG head = m_buffer.head();
+	return m_goal < head ? m_goal : head;
+}
+
+LONGLONG Voice::writtenAt(ULONGLONG position) const
+{
+	// the newest write that started at or before the position, searched newest
+	// first since a stop can take back what was written. One older than every
+	// stamp left has no time rather than a wrong one
+
+	size_t count = m_stampCount < m_stampCapacity ? m_stampCount : m_stampCapacity;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Stamp& stamp = m_stamps[(m_stampCount - 1 - i) % m_stampCapacity];
+		if (stamp.position <= position)
+		{
+			return stamp.time;
+		}
+	}
+
+	return 0;
+}
+
+}
@@ -0,0 +1,154 @@
+#ifndef dsbridge_Voice_h
+#define dsbridge_Voice_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "BroadcastBuffer.h"
+#include "ClockRecovery.h"
+#include "FormatConverter.h"
+
+#include <windows.h>
+#include <audiodefs.h>
+
+namespace dsbridge
+{
+
+// One wrapped buffer as the mixer sees it. Unlocked audio is converted to
+// 16-bit stereo at the buffer rate, and becomes audible as the play position
+// advances; the play position follows the buffer's recovered clock, and the
+// mixer pulls audible frames at that same rate, resampled to the mix rate
+// through linear interpolation and scaled by the buffer's volume and pan.
+// Every write is stamped with the time it arrived, so the mixer can tell how
+// long what it mixes waited in the buffer.
+
+class Voice
+{
+public:
+	Voice();
+	~Voice();
+
+	bool create(LPCWAVEFORMATEX format, DWORD bufferSize);
+
+	void setFormat(LPCWAVEFORMATEX format);
+	void setVolume(LONG volume);
+	void setPan(LONG pan);
+	void setFrequency(DWORD frequency);
+
+	void write(const void* buffer, size_t count);
+
+	void onPlay(DWORD position);
+	void onStop(DWORD position);
+	void onSeek(DWORD position);
+	void onUpdate(DWORD position);
+
+	bool active();
+	LONGLONG mix(int* accumulator, size_t frames, DWORD mixRate);
+
+private:
+
+	enum
+	{
+		MaxBlockAlign = 128,
+		MixFrames = 4096,
+		StampBytes = 256
+	};
+
+	struct Stamp
+	{
+		ULONGLONG position;
+		LONGLONG time;
+	};
+
+	void convert(const BYTE* input, size_t frames);
+	void updatePosition(double time);
+	void updateGains();
+	DWORD nominalRate() const;
+	ULONGLONG readable() const;
+	LONGLONG writtenAt(ULONGLONG position) const;
+
+	CRITICAL_SECTION m_cs;
+
+	WAVEFORMATEX m_format;
+	FormatConverter m_converter;
+	bool m_supported;
+	size_t m_blockAlign;
+
+	BYTE m_partial[MaxBlockAlign];
+	size_t m_partialSize;
+
+	BroadcastBuffer m_buffer;
+
+	// one per write, newest last, and enough of them to cover the whole ring
+
+	Stamp* m_stamps;
+	size_t m_stampCapacity;
+	size_t m_stampCount;
+
+	bool m_playing;
+
+	// the latest play cursor the application saw and how many it has seen,
+	// published without a lock and folded into the clock by the mixer
+
+	volatile LONG m_observed;
+	volatile LONG m_observations;
+	LONG m_consumed;
+
+	// the play position is the clock's position relative to where it was
+	// anchored, added to the ring position it was anchored at
+
+	ClockRecovery m_clock;
+	double m_anchor;
+	ULONGLONG m_anchorGoal;
+	ULONGLONG m_goal;
+	DWORD m_bufferSize;
+
+	// where the audio heard before the last stop ends, for the mixer to reset
+	// on once it has played that far
+
+	ULONGLONG m_drain;
+	bool m_draining;
+
+	// the mixer's read position, the frame it interpolates from and the
+	// 32.32 fraction it is between that frame and the next
+
+	ULONGLONG m_position;
+	short m_previous[2];
+	DWORD m_fraction;
+	bool m_primed;
+
+	LONG m_volume;
+	LONG m_pan;
+	DWORD m_frequency;
+	int m_gains[2];
+
+	short m_samples[(MixFrames + 1) * 2];
+};
+
+}
+
+#endif
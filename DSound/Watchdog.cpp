@@ -0,0 +1,197 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Watchdog.h"
+#include "HttpServer.h"
+#include "Mount.h"
+#include "FlightRecorder.h"
+#include "Notify.h"
+#include "Configuration.h"
+#include "ExceptionHandler.h"
+
+namespace dsbridge
+{
+
+volatile LONG Watchdog::s_stalls[StageCount];
+volatile LONG Watchdog::s_restarts[StageCount];
+
+Watchdog::Watchdog()
+: m_thread(0)
+, m_server(0)
+, m_timeout(0)
+, m_encoders(0)
+{
+	m_serverProgress.heartbeat = 0;
+	m_serverProgress.changed = 0;
+}
+
+Watchdog::~Watchdog()
+{
+	delete [] m_encoders;
+}
+
+bool Watchdog::create(HttpServer* server)
+{
+	// time without progress before a stage is restarted, 0 never restarts
+
+	DWORD timeout = Configuration::getDuration("WatchdogTimeout", 10000, 1000);
+	if (!timeout)
+	{
+		return true;
+	}
+
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+
+	m_server = server;
+	m_timeout = timeout * freq.QuadPart / 1000;
+
+	m_encoders = new Progress[Mount::count()];
+	::memset(m_encoders, 0, Mount::count() * sizeof(Progress));
+
+	m_thread = CreateThread(0, 0, threadEntry, this, 0, 0);
+	if (!m_thread)
+	{
+		Notify::update(Notify::DirectSound, Notify::Error, "Could not create watchdog thread");
+		return false;
+	}
+
+	return true;
+}
+
+DWORD WINAPI Watchdog::threadEntry(LPVOID parameter)
+{
+	__try
+	{
+		Watchdog* watchdog = static_cast<Watchdog*>(parameter);
+
+		while (watchdog->run())
+		{
+			SleepEx(Interval, TRUE);
+		}
+	}
+	__except(ExceptionHandler::filter("Watchdog", GetExceptionInformation()))
+	{
+	}
+	return 0;
+}
+
+bool Watchdog::run()
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	for (size_t i = 0; i < Mount::count(); ++i)
+	{
+		Mount& mount = Mount::at(i);
+		Encoder& encoder = mount.encoder();
+
+		if (!stalled(m_encoders[i], encoder.heartbeat(), mount.listeners() > 0, now.QuadPart))
+		{
+			continue;
+		}
+
+		// only a thread stuck in the codec can be replaced safely; anywhere
+		// else it may be holding on to state the new one would need
+
+		bool restarted = encoder.restart();
+		FlightRecorder::record(FlightRecorder::Stall, EncoderStage, mount.index(), restarted);
+
+		InterlockedIncrement(&s_stalls[EncoderStage]);
+		if (restarted)
+		{
+			InterlockedIncrement(&s_restarts[EncoderStage]);
+			Notify::update(Notify::Encoder, Notify::Warning, "%s stalled, restarted the encoder", mount.path());
+		}
+		else
+		{
+			Notify::update(Notify::Encoder, Notify::Error, "%s stalled outside the codec, could not restart", mount.path());
+		}
+	}
+
+	if (stalled(m_serverProgress, m_server->heartbeat(), m_server->clients() > 0, now.QuadPart))
+	{
+		restartServer();
+	}
+
+	return true;
+}
+
+bool Watchdog::stalled(Progress& progress, LONG heartbeat, bool waiting, LONGLONG now)
+{
+	if ((heartbeat != progress.heartbeat) || !waiting)
+	{
+		progress.heartbeat = heartbeat;
+		progress.changed = now;
+		return false;
+	}
+
+	if ((now - progress.changed) < m_timeout)
+	{
+		return false;
+	}
+
+	// whatever happens next, the stage gets another full timeout
+
+	progress.changed = now;
+	return true;
+}
+
+void Watchdog::restartServer()
+{
+	// the replacement takes over the stuck server's listening socket rather
+	// than binding the port next to it, and listens on it straight away. The
+	// stuck server is only given up on once it does, so a replacement that
+	// cannot even be started leaves it in place rather than nobody at all
+
+	HttpServer* server = new HttpServer;
+	bool restarted = server->create(m_server) && server->waitListening(ListenTimeout);
+	FlightRecorder::record(FlightRecorder::Stall, ServerStage, 0, restarted);
+
+	InterlockedIncrement(&s_stalls[ServerStage]);
+	if (!restarted)
+	{
+		// one still starting up may yet get going, and stops on its own
+		// thread; it is left to that like any other abandoned server
+
+		server->abandon();
+		Notify::update(Notify::HttpServer, Notify::Error, "Server stalled, could not restart");
+		return;
+	}
+
+	// the stuck server keeps its clients until it gets back round its loop;
+	// its listeners reconnect to the new one
+
+	m_server->abandon();
+	m_server = server;
+	m_serverProgress.heartbeat = 0;
+
+	InterlockedIncrement(&s_restarts[ServerStage]);
+	Notify::update(Notify::HttpServer, Notify::Warning, "Server stalled, restarted");
+}
+
+}
@@ -0,0 +1,95 @@
+#ifndef dsbridge_Watchdog_h
+#define dsbridge_Watchdog_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+
+namespace dsbridge
+{
+
+class HttpServer;
+
+// Restarts pipeline stages that stop making progress. Every encoder and the
+// HTTP server move a heartbeat each time round their loop; when one stands
+// still for WatchdogTimeout seconds while a listener waits on it, the stage
+// is started again on a new thread, and the stuck one is left to come back
+// (or not) on its own. Nothing the host's audio goes through is touched.
+
+class Watchdog
+{
+public:
+	enum Stage
+	{
+		EncoderStage,
+		ServerStage,
+		StageCount
+	};
+
+	Watchdog();
+	~Watchdog();
+
+	bool create(HttpServer* server);
+
+	static LONG stalls(Stage stage) { return s_stalls[stage]; }
+	static LONG restarts(Stage stage) { return s_restarts[stage]; }
+
+private:
+
+	enum
+	{
+		Interval = 250,
+		ListenTimeout = 5000
+	};
+
+	struct Progress
+	{
+		LONG heartbeat;
+		LONGLONG changed;
+	};
+
+	static DWORD WINAPI threadEntry(LPVOID parameter);
+
+	bool run();
+	bool stalled(Progress& progress, LONG heartbeat, bool waiting, LONGLONG now);
+	void restartServer();
+
+	HANDLE m_thread;
+	HttpServer* m_server;
+	LONGLONG m_timeout;
+
+	Progress* m_encoders;
+	Progress m_serverProgress;
+
+	static volatile LONG s_stalls[StageCount];
+	static volatile LONG s_restarts[StageCount];
+};
+
+}
+
+#endif
@@ -0,0 +1,238 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Capture.h"
+#include "Resampler.h"
+#include "Notify.h"
+
+#include <math.h>
+#include <stdio.h>
+
+using namespace dsbridge;
+
+// Writes a 1 kHz tone to the capture while the mix rate switches between
+// 44100, 22050 and 48000 Hz, and reads it back the way a mount encoder does:
+// every read is at a single rate, and at each switch the old filter is
+// flushed before a new one takes over. The result has to be the same tone
+// at 44100 Hz with no sample dropped or repeated, so it is compared against
+// the ideal tone over its whole length.
+
+namespace
+{
+
+enum
+{
+	OutputRate = 44100,
+	ChunkFrames = 1152,
+	WriteFrames = 733
+};
+
+struct Segment
+{
+	DWORD rate;
+	DWORD frames;
+};
+
+const Segment s_segments[] =
+{
+	{ 44100, 44100 },
+	{ 22050, 22050 },
+	{ 48000, 48000 },
+	{ 44100, 22050 },
+	{ 32000, 32000 },
+	{ 44100, 44100 }
+};
+
+const size_t SegmentCount = sizeof(s_segments) / sizeof(s_segments[0]);
+
+const double s_pi = 3.14159265358979323846;
+
+double tone(double time)
+{
+	return 10000.0 * ::sin(2.0 * s_pi * 1000.0 * time);
+}
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+
+	Capture capture;
+	if (!capture.create())
+	{
+		return 1;
+	}
+
+	Capture::Reader reader;
+	reader.chunkSize = ChunkFrames * 2 * 2;
+	capture.addReader(&reader);
+
+	// written in odd sized pieces, so the switches fall inside chunks
+
+	double time = 0.0;
+	short input[WriteFrames * 2];
+	for (size_t i = 0; i < SegmentCount; ++i)
+	{
+		capture.setSampleRate(s_segments[i].rate);
+
+		for (DWORD written = 0; written < s_segments[i].frames; )
+		{
+			DWORD count = s_segments[i].frames - written < WriteFrames ? s_segments[i].frames - written : WriteFrames;
+			for (DWORD j = 0; j < count; ++j)
+			{
+				input[j * 2 + 0] = input[j * 2 + 1] = static_cast<short>(tone(time + static_cast<double>(written + j) / s_segments[i].rate));
+			}
+
+			capture.write(input, count * 2 * 2, 0);
+			written += count;
+		}
+
+		time += static_cast<double>(s_segments[i].frames) / s_segments[i].rate;
+	}
+
+	size_t capacity = static_cast<size_t>(time * OutputRate) + OutputRate;
+	short* output = new short[capacity * 2];
+	size_t produced = 0;
+
+	short* chunk = new short[ChunkFrames * 2];
+	DWORD framesAtRate[SegmentCount] = { 0 };
+	size_t segment = 0;
+	DWORD rate = 0;
+
+	Resampler resampler;
+	bool passed = true;
+
+	for (;;)
+	{
+		size_t size = capture.read(reader, chunk);
+		if (!size)
+		{
+			break;
+		}
+
+		if (reader.sampleRate != rate)
+		{
+			if (rate)
+			{
+				++segment;
+			}
+
+			if (resampler.inputRate())
+			{
+				produced += resampler.flush(output + produced * 2);
+				resampler.destroy();
+			}
+
+			rate = reader.sampleRate;
+			if ((rate != OutputRate) && !resampler.create(rate, OutputRate, Resampler::Medium, ChunkFrames))
+			{
+				return 1;
+			}
+		}
+
+		if ((segment >= SegmentCount) || (rate != s_segments[segment].rate))
+		{
+			printf("read at %u Hz where %u Hz was written\n", rate, segment < SegmentCount ? s_segments[segment].rate : 0);
+			passed = false;
+			break;
+		}
+
+		size_t frames = size / (2 * 2);
+		framesAtRate[segment] += static_cast<DWORD>(frames);
+
+		if (rate == OutputRate)
+		{
+			::memcpy(output + produced * 2, chunk, size);
+			produced += frames;
+		}
+		else
+		{
+			produced += resampler.process(chunk, frames, output + produced * 2);
+		}
+	}
+
+	// everything up to the last switch has been read; the last segment leaves
+	// less than a chunk behind
+
+	for (size_t i = 0; (i + 1) < SegmentCount; ++i)
+	{
+		if (framesAtRate[i] != s_segments[i].frames)
+		{
+			printf("read %u frames at %u Hz, %u were written\n", framesAtRate[i], s_segments[i].rate, s_segments[i].frames);
+			passed = false;
+		}
+	}
+
+	if ((s_segments[SegmentCount - 1].frames - framesAtRate[SegmentCount - 1]) >= ChunkFrames)
+	{
+		printf("only %u frames of the last segment were read\n", framesAtRate[SegmentCount - 1]);
+		passed = false;
+	}
+
+	// each switch leaves a short dip where one filter drains and the next
+	// fills; everywhere else the tone has to be where it would be had it been
+	// mixed at 44100 Hz all along
+
+	double switches[SegmentCount];
+	double elapsed = 0.0;
+	for (size_t i = 0; i < SegmentCount; ++i)
+	{
+		elapsed += static_cast<double>(s_segments[i].frames) / s_segments[i].rate;
+		switches[i] = elapsed * OutputRate;
+	}
+
+	double worst = 0.0;
+	double worstSwitch = 0.0;
+	for (size_t i = 0; i < produced; ++i)
+	{
+		double error = ::fabs(output[i * 2] - tone(static_cast<double>(i) / OutputRate));
+
+		bool nearSwitch = i < 64;
+		for (size_t j = 0; (j + 1) < SegmentCount; ++j)
+		{
+			nearSwitch = nearSwitch || (::fabs(i - switches[j]) < 64.0);
+		}
+
+		double& target = nearSwitch ? worstSwitch : worst;
+		target = error > target ? error : target;
+	}
+
+	double expected = switches[SegmentCount - 2] + framesAtRate[SegmentCount - 1];
+	printf("%u frames out (%.0f expected), largest error %.1f, %.1f next to a switch\n", static_cast<DWORD>(produced), expected, worst, worstSwitch);
+
+	if ((::fabs(produced - expected) > 2.0) || (worst > 10.0))
+	{
+		passed = false;
+	}
+
+	delete [] chunk;
+	delete [] output;
+
+	printf("%s\n", passed ? "passed" : "FAILED");
+	return passed ? 0 : 1;
+}
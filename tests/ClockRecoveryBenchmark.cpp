@@ -0,0 +1,133 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "ClockRecovery.h"
+#include "Notify.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace dsbridge;
+
+// Follows a simulated sound card for hours, to show whether the recovered
+// position drifts away from the card's, and times the loop. The card and
+// its cursor behave as in ClockRecoveryTest. Takes the card's offset in ppm
+// and the number of hours, 150 ppm over 6 hours by default.
+
+namespace
+{
+
+enum
+{
+	BufferFrames = 8820,
+	CursorStep = 441
+};
+
+const double s_nominal = 44100.0;
+const double s_tick = 0.010;
+
+double seconds()
+{
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return static_cast<double>(counter.QuadPart) / frequency.QuadPart;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	Notify::setSink(Notify::console);
+
+	double ppm = argc > 1 ? ::atof(argv[1]) : 150.0;
+	double hours = argc > 2 ? ::atof(argv[2]) : 6.0;
+	double actual = s_nominal * (1.0 + ppm * 1e-6);
+
+	ClockRecovery clock;
+	clock.reset(s_nominal, 0.0, 0.0, BufferFrames);
+
+	::srand(1);
+
+	double offsetSum = 0.0;
+	double worst = 0.0;
+	size_t count = 0;
+	double elapsed = 0.0;
+
+	printf("card at %+.0f ppm for %.1f hours\n", ppm, hours);
+
+	size_t ticks = static_cast<size_t>(hours * 3600.0 / s_tick);
+	for (size_t tick = 1; tick <= ticks; ++tick)
+	{
+		double time = tick * s_tick;
+
+		// the cursor the game would have seen this tick, if it looked
+
+		double second = ::fmod(time, 60.0);
+		bool polled = !((second > 30.0) && (second < 32.0)) && (::rand() % 4);
+
+		DWORD cursor = 0;
+		if (polled)
+		{
+			double seen = time - (::rand() / static_cast<double>(RAND_MAX)) * s_tick;
+			cursor = static_cast<DWORD>(::fmod(::floor(actual * seen / CursorStep) * CursorStep, BufferFrames));
+		}
+
+		double begin = seconds();
+		if (polled)
+		{
+			clock.observe(time, cursor);
+		}
+		double position = clock.position(time);
+		elapsed += seconds() - begin;
+
+		if (time < 60.0)
+		{
+			continue;
+		}
+
+		double offset = (position - actual * time) / s_nominal;
+		offsetSum += offset;
+		worst = ::fabs(offset) > worst ? ::fabs(offset) : worst;
+		++count;
+
+		if (!(tick % static_cast<size_t>(3600.0 / s_tick)) || (tick == ticks))
+		{
+			printf("%5.2f h: offset %6.2f ms on average, worst %5.2f ms, rate %+7.1f ppm, jitter %5.1f frames\n", time / 3600.0, offsetSum / count * 1000.0,
+				worst * 1000.0, (clock.rate() / s_nominal - 1.0) * 1e6, clock.jitter());
+
+			offsetSum = 0.0;
+			worst = 0.0;
+			count = 0;
+		}
+	}
+
+	printf("%.0f ns per tick\n", elapsed * 1e9 / ticks);
+	return 0;
+}
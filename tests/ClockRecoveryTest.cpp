@@ -0,0 +1,231 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "ClockRecovery.h"
+#include "Notify.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace dsbridge;
+
+// Runs the clock recovery against a simulated sound card that is off from
+// its nominal rate, seen through the play cursor of a 200 ms buffer the way
+// a game sees it: the mixer ticks every 10 ms, the cursor moves in 10 ms
+// steps and is up to one tick stale, a quarter of the ticks have no cursor
+// at all, and for 2 s of every minute nothing polls it.
+//
+// Once locked the recovered rate has to stay close to the card's, and the
+// recovered position has to keep a steady offset from the card's (the
+// cursor is always behind, by about 10 ms on average) instead of drifting.
+
+namespace
+{
+
+enum
+{
+	BufferFrames = 8820
+};
+
+const double s_tick = 0.010;
+const double s_lockTime = 60.0;
+
+const double s_maxRateError = 75.0;		// ppm
+const double s_maxOffset = 0.015;		// seconds
+const double s_maxDrift = 0.001;		// seconds
+
+class Device
+{
+public:
+	Device(double rate)
+	: m_rate(rate)
+	, m_step(::floor(rate / 100.0))
+	, m_time(0.0)
+	, m_position(0.0)
+	{
+	}
+
+	// the card's rate changes when the game calls SetFrequency
+
+	void retune(double rate, double time)
+	{
+		m_position = position(time);
+		m_time = time;
+		m_rate = rate;
+		m_step = ::floor(rate / 100.0);
+	}
+
+	double position(double time) const
+	{
+		return m_position + m_rate * (time - m_time);
+	}
+
+	bool poll(double time, DWORD& cursor) const
+	{
+		double second = ::fmod(time, 60.0);
+		if (((second > 30.0) && (second < 32.0)) || !(::rand() % 4))
+		{
+			return false;
+		}
+
+		double seen = time - (::rand() / static_cast<double>(RAND_MAX)) * s_tick;
+		double frames = ::floor(position(seen) / m_step) * m_step;
+		cursor = static_cast<DWORD>(::fmod(frames, BufferFrames));
+		return true;
+	}
+
+private:
+	double m_rate;
+	double m_step;
+	double m_time;
+	double m_position;
+};
+
+struct Result
+{
+	double rateLow;
+	double rateHigh;
+	double worstOffset;
+	double firstOffset;
+	double lastOffset;
+};
+
+// the offset of the first and last minute is averaged over that minute
+
+void run(double nominal, double ppm, double seconds, double retuneAt, double retuneTo, Result& result)
+{
+	double actual = nominal * (1.0 + ppm * 1e-6);
+
+	Device device(actual);
+	ClockRecovery clock;
+	clock.reset(nominal, 0.0, 0.0, BufferFrames);
+
+	result.rateLow = 1e9;
+	result.rateHigh = -1e9;
+	result.worstOffset = 0.0;
+
+	double firstSum = 0.0;
+	double lastSum = 0.0;
+	size_t firstCount = 0;
+	size_t lastCount = 0;
+	double lockedAt = s_lockTime;
+
+	::srand(1);
+
+	size_t ticks = static_cast<size_t>(seconds / s_tick);
+	for (size_t tick = 1; tick <= ticks; ++tick)
+	{
+		double time = tick * s_tick;
+
+		if (retuneAt && (::fabs(time - retuneAt) < (s_tick / 2)))
+		{
+			nominal = retuneTo;
+			actual = nominal * (1.0 + ppm * 1e-6);
+			device.retune(actual, time);
+			clock.retune(nominal, time);
+			lockedAt = time + s_lockTime;
+
+			result.rateLow = 1e9;
+			result.rateHigh = -1e9;
+			firstSum = 0.0;
+			firstCount = 0;
+		}
+
+		DWORD cursor;
+		if (device.poll(time, cursor))
+		{
+			clock.observe(time, cursor);
+		}
+
+		if (time < lockedAt)
+		{
+			continue;
+		}
+
+		double rate = (clock.rate() / nominal - 1.0) * 1e6;
+		result.rateLow = rate < result.rateLow ? rate : result.rateLow;
+		result.rateHigh = rate > result.rateHigh ? rate : result.rateHigh;
+
+		double offset = (clock.position(time) - device.position(time)) / nominal;
+		result.worstOffset = ::fabs(offset) > result.worstOffset ? ::fabs(offset) : result.worstOffset;
+
+		if (time < (lockedAt + 60.0))
+		{
+			firstSum += offset;
+			++firstCount;
+		}
+
+		if (time > (seconds - 60.0))
+		{
+			lastSum += offset;
+			++lastCount;
+		}
+	}
+
+	result.firstOffset = firstCount ? firstSum / firstCount : 0.0;
+	result.lastOffset = lastCount ? lastSum / lastCount : 0.0;
+}
+
+bool check(const char* name, double ppm, const Result& result)
+{
+	bool passed = (::fabs(result.rateLow - ppm) <= s_maxRateError) && (::fabs(result.rateHigh - ppm) <= s_maxRateError) &&
+		(result.worstOffset <= s_maxOffset) && (::fabs(result.lastOffset - result.firstOffset) <= s_maxDrift);
+
+	printf("%-22s rate %+7.1f to %+7.1f ppm, offset %6.2f ms -> %6.2f ms, worst %5.2f ms%s\n", name, result.rateLow, result.rateHigh,
+		result.firstOffset * 1000.0, result.lastOffset * 1000.0, result.worstOffset * 1000.0, passed ? "" : " FAILED");
+	return passed;
+}
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+
+	static const double offsets[] = { -1000.0, -300.0, 0.0, 150.0, 1000.0 };
+
+	bool passed = true;
+	for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); ++i)
+	{
+		char name[32];
+		sprintf_s(name, sizeof(name), "%+.0f ppm", offsets[i]);
+
+		Result result;
+		run(44100.0, offsets[i], 1800.0, 0.0, 0.0, result);
+		passed = check(name, offsets[i], result) && passed;
+	}
+
+	// a SetFrequency halfway has to keep the position and lock again
+
+	Result result;
+	run(44100.0, 200.0, 1800.0, 600.0, 22050.0, result);
+	passed = check("+200 ppm, 44.1->22 kHz", 200.0, result) && passed;
+
+	printf("%s\n", passed ? "passed" : "FAILED");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Configuration.h"
+#include "Notify.h"
+
+#include <stdio.h>
+
+using namespace dsbridge;
+
+// Times setting lookups from 1, 2 and 4 threads at once, against this
+// benchmark's section of tests/dsbridge.ini, which holds every setting the
+// bridge reads. Two of the names looked up are not set, as a mount's
+// settings mostly are not.
+
+namespace
+{
+
+enum
+{
+	MaxThreads = 4,
+	Lookups = 2000000
+};
+
+const char* const s_names[] =
+{
+	"MP3BitRate",
+	"MuteWhenStreaming",
+	"CoverArt",
+	"TitlePrefix",
+	"LatencyLog",
+	"WatchdogTimeout",
+	"high.PreRoll",
+	"low.LowLatency"
+};
+
+// the sum of the values found, which every thread should agree on
+
+const int s_expected = (Lookups / 8) * (2 + 12 + 7 + 6 + 24 + 25 + 1 + 1);
+
+double seconds()
+{
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return static_cast<double>(counter.QuadPart) / frequency.QuadPart;
+}
+
+DWORD WINAPI lookups(LPVOID parameter)
+{
+	int sum = 0;
+	for (int i = 0; i < Lookups; ++i)
+	{
+		sum += Configuration::getInteger(s_names[i & 7], 1);
+	}
+
+	*static_cast<int*>(parameter) = sum;
+	return 0;
+}
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+
+	bool passed = true;
+	for (int threadCount = 1; threadCount <= MaxThreads; threadCount *= 2)
+	{
+		HANDLE threads[MaxThreads];
+		int sums[MaxThreads];
+
+		double begin = seconds();
+		for (int i = 0; i < threadCount; ++i)
+		{
+			threads[i] = CreateThread(0, 0, lookups, &sums[i], 0, 0);
+		}
+		WaitForMultipleObjects(threadCount, threads, TRUE, INFINITE);
+		double elapsed = seconds() - begin;
+
+		for (int i = 0; i < threadCount; ++i)
+		{
+			CloseHandle(threads[i]);
+			passed = passed && (sums[i] == s_expected);
+		}
+
+		printf("%d thread(s): %.1f ns per lookup on each, %.1f million lookups per second in all\n", threadCount, elapsed * 1e9 / Lookups,
+			threadCount * Lookups / elapsed * 1e-6);
+	}
+
+	if (!passed)
+	{
+		printf("lookups found the wrong values\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,141 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Configuration.h"
+#include "Notify.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace dsbridge;
+
+// Reads this test's section of tests/dsbridge.ini, named after the
+// executable, and checks that names are found whatever their case, that the
+// first of two settings with the same name wins, that missing settings
+// give the default, and that values convert to each type they may be asked
+// for. The section is longer than the buffer the file is read through, so
+// some line in it always straddles two reads.
+
+namespace
+{
+
+enum
+{
+	LineCount = 1000
+};
+
+bool s_passed = true;
+
+void expectString(const char* name, const char* value, const char* expected)
+{
+	if (::strcmp(value, expected))
+	{
+		printf("%s is \"%s\", expected \"%s\"\n", name, value, expected);
+		s_passed = false;
+	}
+}
+
+void expectNumber(const char* name, DWORD value, DWORD expected)
+{
+	if (value != expected)
+	{
+		printf("%s is %u, expected %u\n", name, value, expected);
+		s_passed = false;
+	}
+}
+
+void lookups()
+{
+	expectNumber("MP3BitRate", Configuration::getInteger("MP3BitRate"), 192);
+	expectNumber("mp3bitrate", Configuration::getInteger("mp3bitrate"), 192);
+	expectNumber("MP3BITRATE", Configuration::getInteger("MP3BITRATE"), 192);
+	expectString("TitlePrefix", Configuration::getString("TitlePrefix"), "Now playing: ");
+	expectString("LOW.PATH", Configuration::getString("LOW.PATH"), "/low.mp3");
+
+	// a mount's setting is not the plain one, and the other way around
+
+	expectString("high.Path", Configuration::getString("high.Path", "none"), "none");
+	expectNumber("low.MP3BitRate", Configuration::getInteger("low.MP3BitRate", 32), 32);
+
+	// other sections are not read
+
+	expectNumber("ResampleQuality", Configuration::getInteger("ResampleQuality", 1), 1);
+}
+
+void longSection()
+{
+	for (int i = 1; i <= LineCount; ++i)
+	{
+		char name[16];
+		sprintf_s(name, sizeof(name), "Line%04d", i);
+		expectNumber(name, Configuration::getInteger(name, -1), i);
+	}
+}
+
+void defaults()
+{
+	expectString("Missing string", Configuration::getString("Missing"), "");
+	expectString("Missing string with default", Configuration::getString("Missing", "default"), "default");
+	expectNumber("Missing integer", Configuration::getInteger("Missing", 7), 7);
+	expectNumber("Missing bool", Configuration::getBool("Missing", true), true);
+	expectNumber("Missing size", Configuration::getSize("Missing", 4096), 4096);
+	expectNumber("Missing duration", Configuration::getDuration("Missing", 42, 1000), 42);
+}
+
+void typed()
+{
+	expectNumber("CoverArt", Configuration::getBool("CoverArt"), true);
+	expectNumber("MuteWhenStreaming", Configuration::getBool("MuteWhenStreaming"), true);
+	expectNumber("DirectLock", Configuration::getBool("DirectLock"), true);
+	expectNumber("ZeroCopySend", Configuration::getBool("ZeroCopySend", true), false);
+	expectNumber("LowLatency", Configuration::getBool("LowLatency", true), false);
+	expectNumber("Mounts", Configuration::getBool("Mounts"), true);
+
+	expectNumber("PreRollBuffer", Configuration::getSize("PreRollBuffer"), 64 * 1024);
+	expectNumber("SendBuffer", Configuration::getSize("SendBuffer"), 3 * 1024 * 1024);
+	expectNumber("RecordBuffer", Configuration::getSize("RecordBuffer"), 100);
+
+	expectNumber("IdleTimeout", Configuration::getDuration("IdleTimeout", 0, 1000), 10000);
+	expectNumber("WatchdogTimeout", Configuration::getDuration("WatchdogTimeout", 0, 1000), 250);
+	expectNumber("PreRoll", Configuration::getDuration("PreRoll", 0, 1000), 1500);
+	expectNumber("ReconnectDelay", Configuration::getDuration("ReconnectDelay", 0, 1000), 120000);
+}
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+
+	lookups();
+	longSection();
+	defaults();
+	typed();
+
+	printf("%s\n", s_passed ? "passed" : "FAILED");
+	return s_passed ? 0 : 1;
+}
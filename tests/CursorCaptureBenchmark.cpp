@@ -0,0 +1,176 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Notify.h"
+#include "Voice.h"
+
+#include <stdio.h>
+
+using namespace dsbridge;
+
+// Times what a wrapped GetCurrentPosition adds to the game's call while the
+// mixer is busy with the same buffer, from 1 to 8 threads polling at once.
+// Published is the cursor handed to the voice without a lock, as it is now;
+// locked takes a lock the mixer holds while it mixes and reads the clock
+// under it, as the encoder's cursor tracking used to.
+
+namespace
+{
+
+enum
+{
+	MaxPollers = 8,
+	RunMilliseconds = 500,
+	MixMilliseconds = 10,
+	MixFrames = 441
+};
+
+Voice s_voice;
+CRITICAL_SECTION s_cs;
+ULONGLONG s_goal;
+LONGLONG s_last;
+
+volatile LONG s_stop;
+volatile LONG s_locked;
+
+void lockedUpdate(DWORD position)
+{
+	EnterCriticalSection(&s_cs);
+	do
+	{
+		LARGE_INTEGER now, frequency;
+		QueryPerformanceCounter(&now);
+		QueryPerformanceFrequency(&frequency);
+
+		s_goal += (ULONGLONG(now.QuadPart - s_last) * 44100) / frequency.QuadPart + (position & 1);
+		s_last = now.QuadPart;
+	}
+	while (0);
+	LeaveCriticalSection(&s_cs);
+}
+
+DWORD WINAPI mixer(LPVOID)
+{
+	int accumulator[MixFrames * 2];
+	while (!s_stop)
+	{
+		EnterCriticalSection(&s_cs);
+		do
+		{
+			::memset(accumulator, 0, sizeof(accumulator));
+			s_voice.mix(accumulator, MixFrames, 44100);
+		}
+		while (0);
+		LeaveCriticalSection(&s_cs);
+
+		Sleep(MixMilliseconds);
+	}
+	return 0;
+}
+
+DWORD WINAPI poller(LPVOID parameter)
+{
+	ULONGLONG calls = 0;
+	bool locked = s_locked != 0;
+
+	while (!s_stop)
+	{
+		DWORD position = static_cast<DWORD>(calls * 4) % (44100 * 4);
+		if (locked)
+		{
+			lockedUpdate(position);
+		}
+		else
+		{
+			s_voice.onUpdate(position);
+		}
+		++calls;
+	}
+
+	*static_cast<ULONGLONG*>(parameter) = calls;
+	return 0;
+}
+
+ULONGLONG measure(bool locked, int pollerCount)
+{
+	s_stop = 0;
+	s_locked = locked;
+
+	HANDLE threads[MaxPollers + 1];
+	ULONGLONG calls[MaxPollers];
+
+	threads[0] = CreateThread(0, 0, mixer, 0, 0, 0);
+	for (int i = 0; i < pollerCount; ++i)
+	{
+		threads[i + 1] = CreateThread(0, 0, poller, &calls[i], 0, 0);
+	}
+
+	Sleep(RunMilliseconds);
+	InterlockedExchange(&s_stop, 1);
+	WaitForMultipleObjects(pollerCount + 1, threads, TRUE, INFINITE);
+
+	ULONGLONG total = 0;
+	for (int i = 0; i <= pollerCount; ++i)
+	{
+		CloseHandle(threads[i]);
+		total += i < pollerCount ? calls[i] : 0;
+	}
+
+	return total;
+}
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+
+	InitializeCriticalSection(&s_cs);
+
+	WAVEFORMATEX format;
+	::memset(&format, 0, sizeof(format));
+	format.wFormatTag = WAVE_FORMAT_PCM;
+	format.nChannels = 2;
+	format.nSamplesPerSec = 44100;
+	format.wBitsPerSample = 16;
+	format.nBlockAlign = 4;
+	format.nAvgBytesPerSec = 44100 * 4;
+
+	s_voice.create(&format, 44100 * 4);
+	s_voice.onPlay(0);
+
+	for (int pollerCount = 1; pollerCount <= MaxPollers; pollerCount *= 2)
+	{
+		// every poller had the whole run, so each of its calls took that share of it
+
+		double published = (RunMilliseconds * 1e6 * pollerCount) / measure(false, pollerCount);
+		double locked = (RunMilliseconds * 1e6 * pollerCount) / measure(true, pollerCount);
+		printf("%d polling thread(s): published %6.1f ns per call on each, locked %6.1f ns\n", pollerCount, published, locked);
+	}
+
+	return 0;
+}
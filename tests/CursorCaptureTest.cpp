@@ -0,0 +1,171 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "CursorCapture.h"
+#include "Notify.h"
+#include "TestBuffer.h"
+#include "Voice.h"
+
+#include <stdio.h>
+
+using namespace dsbridge;
+
+// Plays buffers through the cursor capture and checks that what the card
+// played is read from them once and in order: a buffer played without
+// looping to its end and then again, one stopped early, and a looping one.
+// One that plays to its end is read exactly; one that is stopped may have
+// been read up to the write cursor's lead past where it stopped.
+
+namespace
+{
+
+enum
+{
+	SampleRate = 44100,
+	BlockAlign = 4
+};
+
+bool s_passed = true;
+
+CursorCapture s_capture;
+
+WAVEFORMATEX makeFormat()
+{
+	WAVEFORMATEX format;
+	::memset(&format, 0, sizeof(format));
+	format.wFormatTag = WAVE_FORMAT_PCM;
+	format.nChannels = 2;
+	format.nSamplesPerSec = SampleRate;
+	format.wBitsPerSample = 16;
+	format.nBlockAlign = BlockAlign;
+	format.nAvgBytesPerSec = SampleRate * BlockAlign;
+	return format;
+}
+
+void expect(const char* name, TestBuffer& buffer, ULONGLONG played, ULONGLONG lead)
+{
+	ULONGLONG locked = buffer.locked();
+	printf("%-24s %7u bytes captured, %7u played\n", name, static_cast<DWORD>(locked), static_cast<DWORD>(played));
+
+	if ((locked < played) || (locked > (played + lead)))
+	{
+		s_passed = false;
+	}
+
+	if (!buffer.lockedInOrder())
+	{
+		printf("%s: captured out of order\n", name);
+		s_passed = false;
+	}
+}
+
+// the cursor capture and the wrapper call the capture the way DirectSoundBuffer
+// does around the real buffer's own calls
+
+void play(TestBuffer& buffer, CursorCapture::Source& source, bool looping)
+{
+	buffer.Play(0, 0, looping ? DSBPLAY_LOOPING : 0);
+	s_capture.onPlay(&source, looping);
+}
+
+void stop(TestBuffer& buffer, CursorCapture::Source& source)
+{
+	buffer.Stop();
+	s_capture.onStop(&source);
+}
+
+void run(const char* name, DWORD milliseconds, bool looping, int plays, DWORD stopAfter)
+{
+	WAVEFORMATEX format = makeFormat();
+	DWORD bufferBytes = (SampleRate * milliseconds / 1000) * BlockAlign;
+
+	TestBuffer buffer(format, bufferBytes);
+	Voice voice;
+	voice.create(&format, bufferBytes);
+
+	CursorCapture::Source source;
+	source.buffer = &buffer;
+	source.voice = &voice;
+	source.bufferSize = bufferBytes;
+	source.bytesPerSecond = format.nAvgBytesPerSec;
+
+	if (!s_capture.add(&source))
+	{
+		printf("%s: could not add the buffer\n", name);
+		s_passed = false;
+		return;
+	}
+
+	ULONGLONG played = 0;
+	for (int i = 0; i < plays; ++i)
+	{
+		if (i)
+		{
+			buffer.SetCurrentPosition(0);
+			s_capture.onSeek(&source, 0);
+		}
+
+		play(buffer, source, looping);
+
+		// unless stopped, a one-shot buffer plays to its end and stops by
+		// itself, with the capture polling it all the while
+
+		Sleep(stopAfter ? stopAfter : milliseconds * 2);
+		if (stopAfter)
+		{
+			stop(buffer, source);
+		}
+
+		played += buffer.played();
+	}
+
+	s_capture.remove(&source);
+
+	DWORD lead = stopAfter ? (format.nAvgBytesPerSec * TestBuffer::WriteLead / 1000) : 0;
+	expect(name, buffer, played, lead);
+}
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+
+	if (!s_capture.create())
+	{
+		printf("FAILED\n");
+		return 1;
+	}
+
+	run("one-shot", 250, false, 1, 0);
+	run("one-shot played twice", 250, false, 2, 0);
+	run("one-shot stopped early", 1000, false, 1, 400);
+	run("looping", 250, true, 1, 900);
+
+	printf("%s\n", s_passed ? "passed" : "FAILED");
+	return s_passed ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "DirectSoundBuffer.h"
+#include "Notify.h"
+#include "TestBuffer.h"
+#include "Voice.h"
+
+#include <stdio.h>
+
+using namespace dsbridge;
+
+// Times a game's Lock, write and Unlock on a stand-in buffer, as the game's
+// audio thread pays for it: on the bare buffer, through the wrapper, which
+// captures straight from the locked memory, and through a copy of the path
+// the wrapper takes with DirectLock off, where the game writes to a private
+// buffer that Unlock copies into the real one and captures from.
+
+namespace
+{
+
+enum
+{
+	SampleRate = 44100,
+	BlockAlign = 4,
+	BufferBytes = SampleRate * BlockAlign,
+	RunMilliseconds = 1000
+};
+
+BYTE s_mix[BufferBytes];
+BYTE s_private[BufferBytes];
+
+double seconds()
+{
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return static_cast<double>(counter.QuadPart) / frequency.QuadPart;
+}
+
+// the game's mix going into the locked memory
+
+void fill(DWORD offset, LPVOID audio1, DWORD bytes1, LPVOID audio2, DWORD bytes2)
+{
+	::memcpy(audio1, s_mix + offset, bytes1);
+	if (audio2)
+	{
+		::memcpy(audio2, s_mix, bytes2);
+	}
+}
+
+void bare(LPDIRECTSOUNDBUFFER buffer, DWORD offset, DWORD bytes)
+{
+	LPVOID audio1, audio2;
+	DWORD bytes1, bytes2;
+	buffer->Lock(offset, bytes, &audio1, &bytes1, &audio2, &bytes2, 0);
+	fill(offset, audio1, bytes1, audio2, bytes2);
+	buffer->Unlock(audio1, bytes1, audio2, bytes2);
+}
+
+void copied(LPDIRECTSOUNDBUFFER buffer, Voice& voice, DWORD offset, DWORD bytes)
+{
+	LPVOID physical1, physical2;
+	DWORD bytes1, bytes2;
+	buffer->Lock(offset, bytes, &physical1, &bytes1, &physical2, &bytes2, 0);
+
+	LPVOID audio1 = s_private;
+	LPVOID audio2 = physical2 ? s_private + ((bytes1 + 15) & ~15) : 0;
+	fill(offset, audio1, bytes1, audio2, bytes2);
+
+	::memcpy(physical1, audio1, bytes1);
+	if (physical2)
+	{
+		::memcpy(physical2, audio2, bytes2);
+	}
+	buffer->Unlock(physical1, bytes1, physical2, bytes2);
+
+	voice.write(audio1, bytes1);
+	if (audio2)
+	{
+		voice.write(audio2, bytes2);
+	}
+
+	DWORD position;
+	buffer->GetCurrentPosition(&position, 0);
+	voice.onUpdate(position);
+}
+
+template<typename T> double measure(T& path, DWORD bytes)
+{
+	ULONGLONG count = 0;
+	DWORD offset = 0;
+
+	double begin = seconds();
+	double elapsed = 0.0;
+	while (elapsed < (RunMilliseconds / 1000.0))
+	{
+		for (int i = 0; i < 64; ++i)
+		{
+			path(offset, bytes);
+			offset = (offset + bytes) % BufferBytes;
+		}
+		count += 64;
+		elapsed = seconds() - begin;
+	}
+
+	return elapsed * 1e9 / count;
+}
+
+struct Bare
+{
+	LPDIRECTSOUNDBUFFER buffer;
+	void operator()(DWORD offset, DWORD bytes) { bare(buffer, offset, bytes); }
+};
+
+struct Copied
+{
+	LPDIRECTSOUNDBUFFER buffer;
+	Voice* voice;
+	void operator()(DWORD offset, DWORD bytes) { copied(buffer, *voice, offset, bytes); }
+};
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+
+	WAVEFORMATEX format;
+	::memset(&format, 0, sizeof(format));
+	format.wFormatTag = WAVE_FORMAT_PCM;
+	format.nChannels = 2;
+	format.nSamplesPerSec = SampleRate;
+	format.wBitsPerSample = 16;
+	format.nBlockAlign = BlockAlign;
+	format.nAvgBytesPerSec = SampleRate * BlockAlign;
+
+	for (size_t i = 0; i < sizeof(s_mix); ++i)
+	{
+		s_mix[i] = static_cast<BYTE>(i * 7);
+	}
+
+	TestBuffer buffer(format, BufferBytes);
+	LPDIRECTSOUNDBUFFER wrapper = createWrapper(&buffer);
+	buffer.Play(0, 0, DSBPLAY_LOOPING);
+
+	Voice voice;
+	voice.create(&format, BufferBytes);
+
+	static const DWORD sizes[] = { BufferBytes / 100, BufferBytes / 10 };
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+	{
+		DWORD bytes = sizes[i];
+
+		Bare unwrapped = { &buffer };
+		Bare wrapped = { wrapper };
+		Copied privateCopy = { &buffer, &voice };
+
+		double bareTime = measure(unwrapped, bytes);
+		double directTime = measure(wrapped, bytes);
+		double copiedTime = measure(privateCopy, bytes);
+
+		printf("%5u bytes per Unlock: bare %7.0f ns, wrapped %7.0f ns (+%.0f), copied %7.0f ns (+%.0f)\n", bytes, bareTime, directTime,
+			directTime - bareTime, copiedTime, copiedTime - bareTime);
+	}
+
+	wrapper->Release();
+	return 0;
+}
@@ -0,0 +1,933 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Capture.h"
+#include "EncoderBackend.h"
+#include "Latency.h"
+#include "Mount.h"
+#include "Notify.h"
+
+#include <math.h>
+#include <stdio.h>
+
+using namespace dsbridge;
+
+// Checks what the codec backends put on the wire: the WAV header and PCM/L16
+// chunks byte for byte, FLAC frames by decoding them back to the input, and
+// Opus in Ogg by running a mount's encoder over the capture and reading its
+// stream buffer as a listener from the start would, and as one that joins
+// once the buffer has wrapped.
+//
+// opus.dll is replaced by an encoder whose packets carry the number written
+// into the first sample of their chunk, and come in a spread of sizes that
+// need one to four lacing values.
+
+namespace dsbridge
+{
+
+extern Capture g_capture;
+
+}
+
+namespace
+{
+
+bool s_passed = true;
+
+void fail(const char* name, const char* message)
+{
+	printf("%s: %s\n", name, message);
+	s_passed = false;
+}
+
+// bitstream reading, most significant bit first
+
+class BitReader
+{
+public:
+	BitReader(const BYTE* data, size_t size)
+	: m_data(data)
+	, m_size(size)
+	, m_bit(0)
+	{}
+
+	DWORD read(int bits)
+	{
+		DWORD value = 0;
+		for (int i = 0; i < bits; ++i)
+		{
+			value = (value << 1) | bit();
+		}
+		return value;
+	}
+
+	int readSigned(int bits)
+	{
+		DWORD value = read(bits);
+		return (value & (DWORD(1) << (bits - 1))) ? static_cast<int>(value) - (1 << bits) : static_cast<int>(value);
+	}
+
+	DWORD readUnary()
+	{
+		DWORD zeros = 0;
+		while (!bit() && (m_bit <= m_size * 8))
+		{
+			++zeros;
+		}
+		return zeros;
+	}
+
+	void align() { m_bit = (m_bit + 7) & ~size_t(7); }
+	size_t bytes() const { return m_bit / 8; }
+	bool overrun() const { return m_bit > m_size * 8; }
+
+private:
+	DWORD bit()
+	{
+		size_t bit = m_bit++;
+		return bit < m_size * 8 ? (m_data[bit / 8] >> (7 - (bit % 8))) & 1 : 0;
+	}
+
+	const BYTE* m_data;
+	size_t m_size;
+	size_t m_bit;
+};
+
+DWORD crc(const BYTE* data, size_t size, int width, DWORD polynomial)
+{
+	DWORD top = DWORD(1) << (width - 1);
+	DWORD mask = width < 32 ? (DWORD(1) << width) - 1 : 0xffffffff;
+
+	DWORD result = 0;
+	for (size_t i = 0; i < size; ++i)
+	{
+		result ^= DWORD(data[i]) << (width - 8);
+		for (int j = 0; j < 8; ++j)
+		{
+			result = ((result & top) ? (result << 1) ^ polynomial : (result << 1)) & mask;
+		}
+	}
+	return result;
+}
+
+DWORD s_random = 1;
+
+short noise()
+{
+	s_random = s_random * 1103515245 + 12345;
+	return static_cast<short>(s_random >> 16);
+}
+
+EncoderBackend* create(const char* name, const char* mount, const char* contentType, const char* extension, size_t chunkSize)
+{
+	EncoderBackend* backend = EncoderBackend::create(mount);
+	if (!backend)
+	{
+		fail(name, "not created");
+		return 0;
+	}
+
+	if (::strcmp(backend->contentType(), contentType) || ::strcmp(backend->extension(), extension))
+	{
+		fail(name, "wrong content type or extension");
+	}
+
+	if (backend->chunkSize() != chunkSize)
+	{
+		printf("%s: chunks of %u bytes, expected %u\n", name, static_cast<DWORD>(backend->chunkSize()), static_cast<DWORD>(chunkSize));
+		s_passed = false;
+	}
+
+	if (!backend->start())
+	{
+		fail(name, "did not start");
+	}
+
+	return backend;
+}
+
+bool encode(const char* name, EncoderBackend* backend, const short* input, const BYTE*& data, DWORD& size)
+{
+	::memcpy(backend->input(), input, backend->chunkSize());
+	if (!backend->encode() || !backend->output(data, size))
+	{
+		fail(name, "no output");
+		return false;
+	}
+
+	const BYTE* more;
+	DWORD moreSize;
+	if (backend->output(more, moreSize))
+	{
+		fail(name, "more than one output per chunk");
+		return false;
+	}
+
+	return true;
+}
+
+// PCM
+
+void pcm(const char* name, const char* mount, size_t samples)
+{
+	EncoderBackend* backend = create(name, mount, "audio/wav", "wav", samples * 2 * 2);
+	if (!backend)
+	{
+		return;
+	}
+
+	static const BYTE expected[] =
+	{
+		'R', 'I', 'F', 'F', 0xff, 0xff, 0xff, 0xff, 'W', 'A', 'V', 'E',
+		'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 2, 0, 0x44, 0xac, 0, 0, 0x10, 0xb1, 0x02, 0, 4, 0, 16, 0,
+		'd', 'a', 't', 'a', 0xff, 0xff, 0xff, 0xff
+	};
+
+	DWORD headerSize;
+	const BYTE* header = backend->header(headerSize);
+	if (!header || (headerSize != sizeof(expected)) || ::memcmp(header, expected, sizeof(expected)))
+	{
+		fail(name, "wrong WAV header");
+	}
+
+	short input[1024 * 2];
+	for (size_t i = 0; i < samples * 2; ++i)
+	{
+		input[i] = noise();
+	}
+
+	const BYTE* data;
+	DWORD size;
+	if (encode(name, backend, input, data, size) && ((size != samples * 2 * 2) || ::memcmp(data, input, size)))
+	{
+		fail(name, "samples changed");
+	}
+
+	delete backend;
+}
+
+void l16()
+{
+	const char* name = "L16";
+	EncoderBackend* backend = create(name, "l16", "audio/L16;rate=44100;channels=2", "pcm", 1024 * 2 * 2);
+	if (!backend)
+	{
+		return;
+	}
+
+	DWORD headerSize;
+	if (backend->header(headerSize) || headerSize)
+	{
+		fail(name, "has a header");
+	}
+
+	short input[1024 * 2];
+	for (size_t i = 0; i < 1024 * 2; ++i)
+	{
+		input[i] = noise();
+	}
+
+	const BYTE* data;
+	DWORD size;
+	if (encode(name, backend, input, data, size))
+	{
+		if (size != sizeof(input))
+		{
+			fail(name, "wrong chunk size");
+		}
+
+		for (size_t i = 0; i < 1024 * 2; ++i)
+		{
+			if (static_cast<short>((data[i * 2] << 8) | data[i * 2 + 1]) != input[i])
+			{
+				printf("%s: sample %u is not big-endian\n", name, static_cast<DWORD>(i));
+				s_passed = false;
+				break;
+			}
+		}
+	}
+
+	delete backend;
+}
+
+// FLAC
+
+bool decodeSubframe(BitReader& in, int bps, size_t blockSize, int* samples)
+{
+	if (in.read(1))
+	{
+		return false;
+	}
+
+	DWORD type = in.read(6);
+	if (in.read(1))
+	{
+		return false;
+	}
+
+	if (type == 0)
+	{
+		int value = in.readSigned(bps);
+		for (size_t i = 0; i < blockSize; ++i)
+		{
+			samples[i] = value;
+		}
+		return true;
+	}
+
+	if (type == 1)
+	{
+		for (size_t i = 0; i < blockSize; ++i)
+		{
+			samples[i] = in.readSigned(bps);
+		}
+		return true;
+	}
+
+	if ((type < 8) || (type > 12))
+	{
+		return false;
+	}
+
+	int order = static_cast<int>(type - 8);
+	for (int i = 0; i < order; ++i)
+	{
+		samples[i] = in.readSigned(bps);
+	}
+
+	if (in.read(2))
+	{
+		return false;
+	}
+
+	int partitionOrder = static_cast<int>(in.read(4));
+	size_t partitionSize = blockSize >> partitionOrder;
+
+	for (int p = 0; p < (1 << partitionOrder); ++p)
+	{
+		int k = static_cast<int>(in.read(4));
+		if (k == 15)
+		{
+			return false;
+		}
+
+		for (size_t i = p ? p * partitionSize : order, end = (p + 1) * partitionSize; i < end; ++i)
+		{
+			DWORD folded = (in.readUnary() << k) | in.read(k);
+			int residual = static_cast<int>(folded >> 1) ^ -static_cast<int>(folded & 1);
+
+			switch (order)
+			{
+				case 0: samples[i] = residual; break;
+				case 1: samples[i] = residual + samples[i - 1]; break;
+				case 2: samples[i] = residual + 2 * samples[i - 1] - samples[i - 2]; break;
+				case 3: samples[i] = residual + 3 * samples[i - 1] - 3 * samples[i - 2] + samples[i - 3]; break;
+				default: samples[i] = residual + 4 * samples[i - 1] - 6 * samples[i - 2] + 4 * samples[i - 3] - samples[i - 4]; break;
+			}
+		}
+	}
+
+	return true;
+}
+
+const char* decodeFrame(const BYTE* data, DWORD size, size_t blockSize, DWORD blockCode, DWORD number, const short* expected)
+{
+	BitReader in(data, size);
+	if ((in.read(14) != 0x3ffe) || in.read(1) || in.read(1))
+	{
+		return "no frame sync";
+	}
+
+	if ((in.read(4) != blockCode) || (in.read(4) != 9))
+	{
+		return "wrong block size or sample rate code";
+	}
+
+	DWORD assignment = in.read(4);
+	if ((assignment != 1) && ((assignment < 8) || (assignment > 10)))
+	{
+		return "wrong channel assignment";
+	}
+
+	if ((in.read(3) != 4) || in.read(1))
+	{
+		return "wrong sample size";
+	}
+
+	DWORD value = in.read(8);
+	if (value & 0x80)
+	{
+		int count = 0;
+		while (value & (0x80 >> count))
+		{
+			++count;
+		}
+
+		value &= 0x7f >> count;
+		for (int i = 1; i < count; ++i)
+		{
+			DWORD next = in.read(8);
+			if ((next & 0xc0) != 0x80)
+			{
+				return "malformed frame number";
+			}
+			value = (value << 6) | (next & 0x3f);
+		}
+	}
+
+	if (value != number)
+	{
+		return "wrong frame number";
+	}
+
+	if (crc(data, in.bytes(), 8, 0x07) != in.read(8))
+	{
+		return "wrong header CRC";
+	}
+
+	// the side channel has an extra bit
+
+	static int channels[2][4096];
+	for (int i = 0; i < 2; ++i)
+	{
+		bool side = ((assignment == 8) && (i == 1)) || ((assignment == 9) && (i == 0)) || ((assignment == 10) && (i == 1));
+		if (!decodeSubframe(in, side ? 17 : 16, blockSize, channels[i]))
+		{
+			return "malformed subframe";
+		}
+	}
+
+	in.align();
+	if (crc(data, in.bytes(), 16, 0x8005) != in.read(16))
+	{
+		return "wrong frame CRC";
+	}
+
+	if (in.overrun() || (in.bytes() != size))
+	{
+		return "frame size does not match its contents";
+	}
+
+	for (size_t i = 0; i < blockSize; ++i)
+	{
+		int a = channels[0][i];
+		int b = channels[1][i];
+
+		int left, right;
+		switch (assignment)
+		{
+			case 8: left = a; right = a - b; break;
+			case 9: left = a + b; right = b; break;
+			case 10: left = (((a << 1) | (b & 1)) + b) >> 1; right = (((a << 1) | (b & 1)) - b) >> 1; break;
+			default: left = a; right = b; break;
+		}
+
+		if ((left != expected[i * 2]) || (right != expected[i * 2 + 1]))
+		{
+			return "decoded samples differ from the input";
+		}
+	}
+
+	return 0;
+}
+
+void flac(const char* name, const char* mount, size_t blockSize, DWORD blockCode, DWORD frames)
+{
+	EncoderBackend* backend = create(name, mount, "audio/flac", "flac", blockSize * 2 * 2);
+	if (!backend)
+	{
+		return;
+	}
+
+	DWORD headerSize;
+	const BYTE* header = backend->header(headerSize);
+	if (!header || (headerSize != 42) || ::memcmp(header, "fLaC", 4))
+	{
+		fail(name, "no FLAC marker");
+		delete backend;
+		return;
+	}
+
+	// the only metadata block, STREAMINFO
+
+	BitReader info(header + 4, headerSize - 4);
+	if ((info.read(1) != 1) || (info.read(7) != 0) || (info.read(24) != 34))
+	{
+		fail(name, "wrong metadata block header");
+	}
+
+	if ((info.read(16) != blockSize) || (info.read(16) != blockSize) || info.read(24) || info.read(24))
+	{
+		fail(name, "wrong block or frame sizes in STREAMINFO");
+	}
+
+	if ((info.read(20) != 44100) || (info.read(3) != 1) || (info.read(5) != 15))
+	{
+		fail(name, "wrong format in STREAMINFO");
+	}
+
+	// silence, a constant, a sine in both channels, different sines, noise
+	// and alternating extremes, which need the 17-bit side channel; enough
+	// frames that the numbers need more than one byte
+
+	static short input[4096 * 2];
+	for (DWORD frame = 0; frame < frames; ++frame)
+	{
+		for (size_t i = 0; i < blockSize; ++i)
+		{
+			double t = static_cast<double>(frame * blockSize + i) / 44100.0;
+			short left, right;
+			switch (frame % 6)
+			{
+				case 0: left = right = 0; break;
+				case 1: left = -1000; right = 1234; break;
+				case 2: left = right = static_cast<short>(20000.0 * sin(t * 2.0 * 3.14159265 * 440.0)); break;
+				case 3:
+					left = static_cast<short>(12000.0 * sin(t * 2.0 * 3.14159265 * 330.0));
+					right = static_cast<short>(9000.0 * sin(t * 2.0 * 3.14159265 * 555.0));
+					break;
+				case 4: left = noise(); right = noise(); break;
+				default: left = (i & 1) ? 32767 : -32768; right = (i & 1) ? -32768 : 32767; break;
+			}
+
+			input[i * 2] = left;
+			input[i * 2 + 1] = right;
+		}
+
+		const BYTE* data;
+		DWORD size;
+		if (!encode(name, backend, input, data, size))
+		{
+			break;
+		}
+
+		const char* error = decodeFrame(data, size, blockSize, blockCode, frame, input);
+		if (error)
+		{
+			printf("%s: frame %u, %s\n", name, frame, error);
+			s_passed = false;
+			break;
+		}
+	}
+
+	delete backend;
+}
+
+// Opus
+
+enum
+{
+	OpusFrameSamples = 960,
+	OpusLookahead = 312,
+	EarlyChunks = 16,
+	TotalChunks = 400,
+	FeedChunks = 16
+};
+
+static const DWORD s_packetSizes[] = { 40, 254, 255, 256, 510, 700, 1000 };
+
+DWORD packetSize(DWORD chunk)
+{
+	return s_packetSizes[chunk % (sizeof(s_packetSizes) / sizeof(s_packetSizes[0]))];
+}
+
+DWORD pageSize(DWORD chunk)
+{
+	return 27 + packetSize(chunk) / 255 + 1 + packetSize(chunk);
+}
+
+// where the page for a chunk starts in the mount's stream
+
+ULONGLONG pageOffset(DWORD chunk)
+{
+	ULONGLONG offset = 0;
+	for (DWORD i = 0; i < chunk; ++i)
+	{
+		offset += pageSize(i);
+	}
+	return offset;
+}
+
+struct FakeOpus
+{
+	int channels;
+};
+
+FakeOpus* fakeEncoderCreate(int rate, int channels, int, int* error)
+{
+	if ((rate != 48000) || (channels != 2))
+	{
+		*error = -1;
+		return 0;
+	}
+
+	FakeOpus* fake = new FakeOpus;
+	fake->channels = channels;
+	*error = 0;
+	return fake;
+}
+
+int fakeEncode(FakeOpus*, const short* pcm, int frameSize, unsigned char* data, int maxBytes)
+{
+	if (frameSize != OpusFrameSamples)
+	{
+		return -1;
+	}
+
+	DWORD chunk = static_cast<WORD>(pcm[0]);
+	int size = static_cast<int>(packetSize(chunk));
+	if (size > maxBytes)
+	{
+		return -2;
+	}
+
+	::memset(data, static_cast<BYTE>(chunk), size);
+	::memcpy(data, pcm, sizeof(short));
+	return size;
+}
+
+int fakeEncoderCtl(FakeOpus*, int request, ...)
+{
+	if (request == 4027)
+	{
+		va_list args;
+		va_start(args, request);
+		*va_arg(args, int*) = OpusLookahead;
+		va_end(args);
+	}
+	return 0;
+}
+
+void fakeEncoderDestroy(FakeOpus* fake)
+{
+	delete fake;
+}
+
+const ModuleExport s_opusExports[] =
+{
+	{ "opus_encoder_create", reinterpret_cast<void*>(fakeEncoderCreate) },
+	{ "opus_encode", reinterpret_cast<void*>(fakeEncode) },
+	{ "opus_encoder_ctl", reinterpret_cast<void*>(fakeEncoderCtl) },
+	{ "opus_encoder_destroy", reinterpret_cast<void*>(fakeEncoderDestroy) },
+	{ 0, 0 }
+};
+
+struct Page
+{
+	BYTE flags;
+	ULONGLONG granule;
+	DWORD serial;
+	DWORD sequence;
+	const BYTE* packet;
+	DWORD packetSize;
+	DWORD size;
+};
+
+ULONGLONG little(const BYTE* data, size_t bytes)
+{
+	ULONGLONG value = 0;
+	for (size_t i = bytes; i > 0; --i)
+	{
+		value = (value << 8) | data[i - 1];
+	}
+	return value;
+}
+
+// one page holding one whole packet, with a valid checksum
+
+const char* parsePage(const BYTE* data, size_t available, Page& page)
+{
+	if ((available < 27) || ::memcmp(data, "OggS", 4) || data[4])
+	{
+		return "no page";
+	}
+
+	DWORD segments = data[26];
+	if (!segments || (available < (27 + segments)))
+	{
+		return "truncated page";
+	}
+
+	DWORD packetSize = 0;
+	for (DWORD i = 0; i < segments; ++i)
+	{
+		BYTE lacing = data[27 + i];
+		if ((i + 1 < segments) ? (lacing != 255) : (lacing == 255))
+		{
+			return "not a single whole packet";
+		}
+		packetSize += lacing;
+	}
+
+	page.flags = data[5];
+	page.granule = little(data + 6, 8);
+	page.serial = static_cast<DWORD>(little(data + 14, 4));
+	page.sequence = static_cast<DWORD>(little(data + 18, 4));
+	page.packet = data + 27 + segments;
+	page.packetSize = packetSize;
+	page.size = 27 + segments + packetSize;
+
+	if (available < page.size)
+	{
+		return "truncated page";
+	}
+
+	static BYTE copy[27 + 255 + 65536];
+	::memcpy(copy, data, page.size);
+	::memset(copy + 22, 0, 4);
+	if (crc(copy, page.size, 32, 0x04c11db7) != static_cast<DWORD>(little(data + 22, 4)))
+	{
+		return "wrong page CRC";
+	}
+
+	return 0;
+}
+
+// what a listener gets: the stream header, then pages for a run of chunks
+// that ends with the last one fed
+
+void checkStream(const char* name, const BYTE* header, DWORD headerSize, const BYTE* data, size_t size, DWORD firstChunk, DWORD endChunk)
+{
+	Page head, tags;
+	const char* error = parsePage(header, headerSize, head);
+	if (!error)
+	{
+		error = parsePage(header + head.size, headerSize - head.size, tags);
+	}
+
+	if (error)
+	{
+		printf("%s: header, %s\n", name, error);
+		s_passed = false;
+		return;
+	}
+
+	if ((head.size + tags.size != headerSize) || (head.flags != 0x02) || head.sequence || head.granule ||
+		(head.packetSize != 19) || ::memcmp(head.packet, "OpusHead", 8) || (little(head.packet + 10, 2) != OpusLookahead) ||
+		(little(head.packet + 12, 4) != 48000))
+	{
+		fail(name, "wrong identification header");
+	}
+
+	if ((tags.flags != 0) || (tags.sequence != 1) || tags.granule || (tags.serial != head.serial) || ::memcmp(tags.packet, "OpusTags", 8))
+	{
+		fail(name, "wrong comment header");
+	}
+
+	// every chunk in its own page, numbered on from the headers of the same
+	// logical stream however late the listener came
+
+	DWORD chunk = firstChunk;
+	for (size_t offset = 0; offset < size; ++chunk)
+	{
+		Page page;
+		error = parsePage(data + offset, size - offset, page);
+		if (error)
+		{
+			printf("%s: page for chunk %u, %s\n", name, chunk, error);
+			s_passed = false;
+			return;
+		}
+
+		if ((page.serial != head.serial) || page.flags || (page.sequence != chunk + 2) || (page.granule != ULONGLONG(chunk + 1) * OpusFrameSamples))
+		{
+			printf("%s: chunk %u has serial %08x, flags %u, sequence %u, granule %u\n", name, chunk, page.serial, page.flags, page.sequence, static_cast<DWORD>(page.granule));
+			s_passed = false;
+			return;
+		}
+
+		if ((page.packetSize != packetSize(chunk)) || (little(page.packet, 2) != chunk))
+		{
+			printf("%s: page %u holds the wrong packet\n", name, page.sequence);
+			s_passed = false;
+			return;
+		}
+
+		offset += page.size;
+	}
+
+	if (chunk != endChunk)
+	{
+		printf("%s: stream ends at chunk %u\n", name, chunk);
+		s_passed = false;
+	}
+}
+
+bool feed(Mount& mount, DWORD begin, DWORD end)
+{
+	static short chunk[OpusFrameSamples * 2];
+
+	for (DWORD batch = begin; batch < end; batch += FeedChunks)
+	{
+		DWORD last = (batch + FeedChunks) < end ? (batch + FeedChunks) : end;
+		for (DWORD i = batch; i < last; ++i)
+		{
+			for (size_t j = 0; j < OpusFrameSamples * 2; ++j)
+			{
+				chunk[j] = noise();
+			}
+			chunk[0] = static_cast<short>(i);
+
+			g_capture.write(chunk, sizeof(chunk), Latency::now());
+		}
+
+		// the encoder thread has written every page once the head is past them
+
+		ULONGLONG expected = pageOffset(last);
+		DWORD started = GetTickCount();
+		for (;;)
+		{
+			mount.lock();
+			ULONGLONG head = mount.buffer().head();
+			mount.unlock();
+
+			if (head == expected)
+			{
+				break;
+			}
+
+			if ((head > expected) || ((GetTickCount() - started) > 5000))
+			{
+				return false;
+			}
+
+			Sleep(1);
+		}
+	}
+
+	return true;
+}
+
+size_t readStream(Mount& mount, ULONGLONG position, BYTE* buffer, size_t size)
+{
+	size_t result = 0;
+
+	mount.lock();
+	for (;;)
+	{
+		size_t count = mount.buffer().read(position, buffer + result, size - result);
+		if (!count)
+		{
+			break;
+		}
+		result += count;
+	}
+	mount.unlock();
+
+	return result;
+}
+
+void opus()
+{
+	const char* name = "Opus";
+
+	RegisterModule("opus.dll", s_opusExports);
+
+	if (!g_capture.create() || !Mount::createAll() || (Mount::count() != 1))
+	{
+		fail(name, "mount not created");
+		return;
+	}
+
+	g_capture.setSampleRate(48000);
+
+	Mount& mount = Mount::at(0);
+	if (::strcmp(mount.contentType(), "audio/ogg"))
+	{
+		fail(name, "wrong content type");
+	}
+
+	DWORD headerSize;
+	const BYTE* header = mount.header(headerSize);
+	if (!header)
+	{
+		fail(name, "no stream header");
+		return;
+	}
+
+	static BYTE stream[256 * 1024];
+
+	// the first listener wakes the encoder and hears everything
+
+	DWORD generation;
+	ULONGLONG first = mount.addListener(generation);
+	if (!feed(mount, 0, EarlyChunks))
+	{
+		fail(name, "encoder did not write the first pages");
+		return;
+	}
+
+	checkStream("Opus first listener", header, headerSize, stream, readStream(mount, first, stream, sizeof(stream)), 0, EarlyChunks);
+
+	// a listener joining after the buffer has wrapped starts at the oldest
+	// whole page still held
+
+	if (!feed(mount, EarlyChunks, TotalChunks))
+	{
+		fail(name, "encoder did not write the later pages");
+		return;
+	}
+
+	mount.lock();
+	ULONGLONG tail = mount.buffer().tail();
+	mount.unlock();
+
+	DWORD oldest = 0;
+	while (pageOffset(oldest) < tail)
+	{
+		++oldest;
+	}
+
+	ULONGLONG late = mount.addListener(generation);
+	if (!tail || (late != pageOffset(oldest)))
+	{
+		printf("%s: late listener starts at %u, the oldest whole page is at %u\n", name, static_cast<DWORD>(late), static_cast<DWORD>(pageOffset(oldest)));
+		s_passed = false;
+		return;
+	}
+
+	checkStream("Opus late listener", header, headerSize, stream, readStream(mount, late, stream, sizeof(stream)), oldest, TotalChunks);
+}
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+
+	pcm("WAV", "wav", 1024);
+	pcm("WAV low latency", "lowwav", 256);
+	l16();
+
+	flac("FLAC", "flac", 4096, 12, 200);
+	flac("FLAC low latency", "lowflac", 1024, 10, 300);
+
+	opus();
+
+	printf("%s\n", s_passed ? "passed" : "FAILED");
+	return s_passed ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "FormatConverter.h"
+#include "Notify.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace dsbridge;
+
+// Times the conversion of a minute of random audio to 16-bit stereo for the
+// layouts with a kernel of their own and a few that go through the matrix,
+// with and without SSE2.
+
+namespace
+{
+
+enum
+{
+	Frames = 44100 * 60
+};
+
+struct Layout
+{
+	const char* name;
+	WORD tag;
+	WORD channels;
+	WORD bits;
+};
+
+const Layout s_layouts[] =
+{
+	{ "stereo 16-bit", WAVE_FORMAT_PCM, 2, 16 },
+	{ "stereo 8-bit", WAVE_FORMAT_PCM, 2, 8 },
+	{ "stereo float", WAVE_FORMAT_IEEE_FLOAT, 2, 32 },
+	{ "mono 16-bit", WAVE_FORMAT_PCM, 1, 16 },
+	{ "stereo 24-bit", WAVE_FORMAT_PCM, 2, 24 },
+	{ "5.1 16-bit", WAVE_FORMAT_PCM, 6, 16 },
+	{ "5.1 float", WAVE_FORMAT_IEEE_FLOAT, 6, 32 },
+	{ "7.1 float", WAVE_FORMAT_IEEE_FLOAT, 8, 32 }
+};
+
+double seconds()
+{
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return static_cast<double>(counter.QuadPart) / frequency.QuadPart;
+}
+
+double measure(const WAVEFORMATEX& format, const BYTE* input, short* output)
+{
+	FormatConverter converter;
+	converter.configure(&format);
+
+	double begin = seconds();
+	converter.convert(input, Frames, output);
+	return seconds() - begin;
+}
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+
+	// touched up front so the first layout does not pay for the page faults
+
+	short* output = new short[Frames * 2];
+	::memset(output, 0, Frames * 2 * sizeof(short));
+
+	for (size_t i = 0; i < sizeof(s_layouts) / sizeof(s_layouts[0]); ++i)
+	{
+		const Layout& layout = s_layouts[i];
+
+		WAVEFORMATEX format;
+		::memset(&format, 0, sizeof(format));
+		format.wFormatTag = layout.tag;
+		format.nChannels = layout.channels;
+		format.nSamplesPerSec = 44100;
+		format.wBitsPerSample = layout.bits;
+		format.nBlockAlign = static_cast<WORD>(layout.channels * layout.bits / 8);
+		format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+
+		BYTE* input = new BYTE[Frames * format.nBlockAlign];
+		for (size_t j = 0; j < Frames * format.nBlockAlign; ++j)
+		{
+			input[j] = static_cast<BYTE>(::rand());
+		}
+
+		if (layout.tag == WAVE_FORMAT_IEEE_FLOAT)
+		{
+			float* samples = reinterpret_cast<float*>(input);
+			for (size_t j = 0; j < Frames * layout.channels; ++j)
+			{
+				samples[j] = (::rand() / static_cast<float>(RAND_MAX)) * 2.0f - 1.0f;
+			}
+		}
+
+		double simd = measure(format, input, output);
+
+		SetProcessorFeature(PF_XMMI64_INSTRUCTIONS_AVAILABLE, FALSE);
+		double scalar = measure(format, input, output);
+		SetProcessorFeature(PF_XMMI64_INSTRUCTIONS_AVAILABLE, TRUE);
+
+		double audio = static_cast<double>(Frames) / format.nSamplesPerSec;
+		printf("%-14s %7.0fx realtime, %7.0fx without SSE2\n", layout.name, audio / simd, audio / scalar);
+
+		delete [] input;
+	}
+
+	delete [] output;
+	return 0;
+}
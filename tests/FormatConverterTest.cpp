@@ -0,0 +1,249 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "FormatConverter.h"
+#include "Notify.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace dsbridge;
+
+// Checks a few known samples through every sample encoding and the 5.1 fold
+// down, that malformed formats are refused, and that the SSE2 kernels give
+// the same output as the scalar path on random input.
+
+namespace
+{
+
+bool s_passed = true;
+
+void expect(const char* name, const short* output, const short* expected, size_t samples)
+{
+	for (size_t i = 0; i < samples; ++i)
+	{
+		if (output[i] != expected[i])
+		{
+			printf("%s: sample %u is %d, expected %d\n", name, static_cast<DWORD>(i), output[i], expected[i]);
+			s_passed = false;
+			return;
+		}
+	}
+}
+
+WAVEFORMATEX makeFormat(WORD tag, WORD channels, WORD bits)
+{
+	WAVEFORMATEX format;
+	::memset(&format, 0, sizeof(format));
+	format.wFormatTag = tag;
+	format.nChannels = channels;
+	format.nSamplesPerSec = 44100;
+	format.wBitsPerSample = bits;
+	format.nBlockAlign = static_cast<WORD>(channels * bits / 8);
+	format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+	return format;
+}
+
+void convert(const char* name, const WAVEFORMATEX& format, const void* input, size_t frames, const short* expected)
+{
+	FormatConverter converter;
+	if (!converter.configure(&format))
+	{
+		printf("%s: format refused\n", name);
+		s_passed = false;
+		return;
+	}
+
+	short output[16];
+	converter.convert(static_cast<const BYTE*>(input), frames, output);
+	expect(name, output, expected, frames * 2);
+}
+
+void knownSamples()
+{
+	{
+		BYTE input[] = { 0, 128, 255, 64 };
+		short expected[] = { -32768, 0, 32512, -16384 };
+		convert("unsigned 8-bit", makeFormat(WAVE_FORMAT_PCM, 2, 8), input, 2, expected);
+	}
+
+	{
+		short input[] = { -32768, 32767, 1, -1 };
+		convert("signed 16-bit", makeFormat(WAVE_FORMAT_PCM, 2, 16), input, 2, input);
+	}
+
+	{
+		BYTE input[] = { 0xff, 0xff, 0x7f, 0x00, 0x00, 0x80, 0x00, 0x01, 0x00, 0x80, 0x00, 0x00 };
+		short expected[] = { 32767, -32768, 1, 1 };
+		convert("signed 24-bit", makeFormat(WAVE_FORMAT_PCM, 2, 24), input, 2, expected);
+	}
+
+	{
+		int input[] = { 0x40000000, -0x40000000, 0x7fffffff, 0x00018000 };
+		short expected[] = { 16384, -16384, 32767, 2 };
+		convert("signed 32-bit", makeFormat(WAVE_FORMAT_PCM, 2, 32), input, 2, expected);
+	}
+
+	{
+		float input[] = { 0.5f, -0.25f, 1.5f, -1.5f };
+		short expected[] = { 16384, -8192, 32767, -32768 };
+		convert("float", makeFormat(WAVE_FORMAT_IEEE_FLOAT, 2, 32), input, 2, expected);
+	}
+
+	{
+		short input[] = { 1000, -2000 };
+		short expected[] = { 1000, 1000, -2000, -2000 };
+		convert("mono", makeFormat(WAVE_FORMAT_PCM, 1, 16), input, 2, expected);
+	}
+
+	// front left and right, center, LFE (dropped), back left and right
+
+	{
+		short input[] = { 1000, 2000, 3000, 30000, 400, 800 };
+		short expected[] = { 3404, 4687 };
+		convert("5.1", makeFormat(WAVE_FORMAT_PCM, 6, 16), input, 1, expected);
+	}
+
+	{
+		WAVEFORMATEXTENSIBLE format;
+		::memset(&format, 0, sizeof(format));
+		format.Format = makeFormat(WAVE_FORMAT_EXTENSIBLE, 2, 32);
+		format.Format.cbSize = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX);
+		format.Samples.wValidBitsPerSample = 32;
+		format.dwChannelMask = 0x3;
+		format.SubFormat.Data1 = WAVE_FORMAT_IEEE_FLOAT;
+
+		float input[] = { 0.5f, -0.25f };
+		short expected[] = { 16384, -8192 };
+		convert("extensible float", format.Format, input, 1, expected);
+	}
+}
+
+void refused()
+{
+	WAVEFORMATEX formats[] =
+	{
+		makeFormat(WAVE_FORMAT_PCM, 2, 12),
+		makeFormat(WAVE_FORMAT_IEEE_FLOAT, 2, 16),
+		makeFormat(WAVE_FORMAT_PCM, 0, 16),
+		makeFormat(WAVE_FORMAT_PCM, 19, 16),
+		makeFormat(2, 2, 16)
+	};
+
+	WAVEFORMATEX misaligned = makeFormat(WAVE_FORMAT_PCM, 2, 16);
+	misaligned.nBlockAlign = 6;
+
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i)
+	{
+		FormatConverter converter;
+		if (converter.configure(&formats[i]))
+		{
+			printf("format %u was accepted\n", static_cast<DWORD>(i));
+			s_passed = false;
+		}
+	}
+
+	FormatConverter converter;
+	if (converter.configure(&misaligned))
+	{
+		printf("misaligned format was accepted\n");
+		s_passed = false;
+	}
+}
+
+// float input may differ by one where the SSE2 conversion rounds half to
+// even and the scalar path rounds half away from zero
+
+void kernel(const char* name, const WAVEFORMATEX& format, int tolerance)
+{
+	enum
+	{
+		Frames = 4099
+	};
+
+	BYTE* input = new BYTE[Frames * format.nBlockAlign];
+	for (size_t i = 0; i < Frames * format.nBlockAlign; ++i)
+	{
+		input[i] = static_cast<BYTE>(::rand());
+	}
+
+	if (format.wFormatTag == WAVE_FORMAT_IEEE_FLOAT)
+	{
+		float* samples = reinterpret_cast<float*>(input);
+		for (size_t i = 0; i < Frames * format.nChannels; ++i)
+		{
+			samples[i] = (::rand() / static_cast<float>(RAND_MAX)) * 2.2f - 1.1f;
+		}
+	}
+
+	short* simd = new short[Frames * 2];
+	short* scalar = new short[Frames * 2];
+
+	FormatConverter vector;
+	vector.configure(&format);
+	vector.convert(input, Frames, simd);
+
+	SetProcessorFeature(PF_XMMI64_INSTRUCTIONS_AVAILABLE, FALSE);
+	FormatConverter plain;
+	plain.configure(&format);
+	plain.convert(input, Frames, scalar);
+	SetProcessorFeature(PF_XMMI64_INSTRUCTIONS_AVAILABLE, TRUE);
+
+	int difference = 0;
+	for (size_t i = 0; i < Frames * 2; ++i)
+	{
+		int curr = ::abs(simd[i] - scalar[i]);
+		difference = curr > difference ? curr : difference;
+	}
+
+	printf("%-16s largest difference from scalar %d\n", name, difference);
+	if (difference > tolerance)
+	{
+		s_passed = false;
+	}
+
+	delete [] scalar;
+	delete [] simd;
+	delete [] input;
+}
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+
+	knownSamples();
+	refused();
+
+	kernel("stereo 8-bit", makeFormat(WAVE_FORMAT_PCM, 2, 8), 0);
+	kernel("stereo float", makeFormat(WAVE_FORMAT_IEEE_FLOAT, 2, 32), 1);
+	kernel("mono 16-bit", makeFormat(WAVE_FORMAT_PCM, 1, 16), 0);
+
+	printf("%s\n", s_passed ? "passed" : "FAILED");
+	return s_passed ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "NotifyQueue.h"
+#include "Notify.h"
+
+#include <stdio.h>
+
+using namespace dsbridge;
+
+// Times what a notification costs the thread raising it, copying its
+// arguments into the queue, against what the notify thread pays later to
+// format it, and against formatting it on the spot as was done before.
+
+namespace
+{
+
+enum
+{
+	EventCount = 4096 * NotifyQueue::Capacity
+};
+
+const char* const s_format = "%s listener left, %d ms average and %d ms worst";
+
+NotifyQueue s_queue;
+
+double seconds()
+{
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return static_cast<double>(counter.QuadPart) / frequency.QuadPart;
+}
+
+void push(const char* format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	s_queue.push(Notify::HttpServer, Notify::Info, format, ap);
+	va_end(ap);
+}
+
+void print(char* buffer, size_t size, const char* format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	_vsnprintf_s(buffer, size, _TRUNCATE, format, ap);
+	va_end(ap);
+}
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+
+	char buffer[128];
+	NotifyQueue::Event event;
+
+	double pushTime = 0.0;
+	double formatTime = 0.0;
+
+	// a queue's worth at a time, so that nothing is dropped and the clock is
+	// not read for every event
+
+	for (int i = 0; i < EventCount; i += NotifyQueue::Capacity)
+	{
+		double begin = seconds();
+		for (int j = i; j < (i + NotifyQueue::Capacity); ++j)
+		{
+			push(s_format, "/stream.mp3", j, j * 2);
+		}
+		double pushed = seconds();
+
+		while (s_queue.pop(event))
+		{
+			NotifyQueue::format(event, buffer, sizeof(buffer));
+		}
+		double formatted = seconds();
+
+		pushTime += pushed - begin;
+		formatTime += formatted - pushed;
+	}
+
+	double begin = seconds();
+	for (int i = 0; i < EventCount; ++i)
+	{
+		print(buffer, sizeof(buffer), s_format, "/stream.mp3", i, i * 2);
+	}
+	double printTime = seconds() - begin;
+
+	printf("push %.0f ns, pop and format %.0f ns, formatting in place %.0f ns per notification\n", pushTime * 1e9 / EventCount, formatTime * 1e9 / EventCount,
+		printTime * 1e9 / EventCount);
+
+	if (s_queue.dropped())
+	{
+		printf("%d notifications dropped\n", static_cast<int>(s_queue.dropped()));
+		return 1;
+	}
+
+	return 0;
+}
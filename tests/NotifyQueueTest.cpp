@@ -0,0 +1,280 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "NotifyQueue.h"
+#include "Notify.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace dsbridge;
+
+// Checks that events formatted on the reading side come out the same as the
+// format string would have on the caller's, that a full queue drops and
+// counts what does not fit, and that every notification from several
+// threads reaches the sink: shown, counted as a repeat, or counted as
+// dropped.
+
+namespace
+{
+
+enum
+{
+	ProducerCount = 4,
+	ProducerEvents = 20000
+};
+
+bool s_passed = true;
+
+NotifyQueue s_queue;
+
+void checkFormat(const char* format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	bool pushed = s_queue.push(Notify::Encoder, Notify::Info, format, ap);
+	va_end(ap);
+
+	char expected[NotifyQueue::ArgumentCapacity * 2];
+	va_start(ap, format);
+	vsnprintf_s(expected, sizeof(expected), _TRUNCATE, format, ap);
+	va_end(ap);
+
+	NotifyQueue::Event event;
+	char formatted[sizeof(expected)];
+	if (!pushed || !s_queue.pop(event))
+	{
+		printf("\"%s\" was not queued\n", format);
+		s_passed = false;
+		return;
+	}
+
+	NotifyQueue::format(event, formatted, sizeof(formatted));
+	if (::strcmp(formatted, expected))
+	{
+		printf("\"%s\" came out as \"%s\", expected \"%s\"\n", format, formatted, expected);
+		s_passed = false;
+	}
+}
+
+void push(const char* format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	s_queue.push(Notify::Encoder, Notify::Info, format, ap);
+	va_end(ap);
+}
+
+void formats()
+{
+	int value = 0;
+
+	checkFormat("plain text");
+	checkFormat("%d%% of %s at %*d and %-.*f", 42, "stream", 6, 7, 2, 3.14159);
+	checkFormat("Could not write packet (%08x)", 0xdeadbeef);
+	checkFormat("%I64u bytes, %ld, %Iu, %c", 12345678901234ULL, 7L, static_cast<size_t>(9), 'x');
+	checkFormat("%-8s|%8s|%.2s", "left", "right", "cut");
+	checkFormat("%e %g %5.1f", 1.5e-7, 0.25, -3.75);
+	checkFormat("%p", static_cast<void*>(&value));
+	checkFormat("%hd %hu %o %X", 12, 65535, 8, 255);
+}
+
+// a string that does not fit is cut short rather than dropping the event,
+// and the arguments after it are left out
+
+void longString()
+{
+	char text[NotifyQueue::ArgumentCapacity * 2];
+	::memset(text, 'a', sizeof(text) - 1);
+	text[sizeof(text) - 1] = '\0';
+
+	push("%s then %d", text, 5);
+
+	NotifyQueue::Event event;
+	char formatted[sizeof(text) * 2];
+	if (!s_queue.pop(event))
+	{
+		printf("long string was not queued\n");
+		s_passed = false;
+		return;
+	}
+
+	char expected[sizeof(formatted)];
+	sprintf_s(expected, sizeof(expected), "%.*s then ...", static_cast<int>(NotifyQueue::ArgumentCapacity - 1), text);
+
+	NotifyQueue::format(event, formatted, sizeof(formatted));
+	if (::strcmp(formatted, expected))
+	{
+		printf("long string came out as \"%s\"\n", formatted);
+		s_passed = false;
+	}
+}
+
+void full()
+{
+	for (int i = 0; i < NotifyQueue::Capacity + 44; ++i)
+	{
+		push("event %d", i);
+	}
+
+	NotifyQueue::Event event;
+	int popped = 0;
+	while (s_queue.pop(event))
+	{
+		char formatted[32];
+		NotifyQueue::format(event, formatted, sizeof(formatted));
+
+		char expected[32];
+		sprintf_s(expected, sizeof(expected), "event %d", popped);
+		if (::strcmp(formatted, expected))
+		{
+			printf("popped \"%s\", expected \"%s\"\n", formatted, expected);
+			s_passed = false;
+			break;
+		}
+
+		++popped;
+	}
+
+	if ((popped != NotifyQueue::Capacity) || (s_queue.dropped() != 44))
+	{
+		printf("full queue kept %d and dropped %d\n", popped, static_cast<int>(s_queue.dropped()));
+		s_passed = false;
+	}
+}
+
+// every notification is accounted for by the sink
+
+volatile LONG s_shown = 0;
+volatile LONG s_repeated = 0;
+volatile LONG s_dropped = 0;
+volatile LONG s_messages = 0;
+volatile LONG s_done = 0;
+
+void countingSink(Notify::ClassType classType, Notify::State state, const char* message)
+{
+	if (!::strcmp(message, "done"))
+	{
+		InterlockedExchange(&s_done, 1);
+		return;
+	}
+
+	const char* more = ::strstr(message, " more)");
+	const char* dropped = ::strstr(message, " notifications dropped");
+	if (more)
+	{
+		const char* open = more;
+		while ((open > message) && (*open != '('))
+		{
+			--open;
+		}
+		InterlockedExchangeAdd(&s_repeated, ::atoi(open + 1));
+	}
+	else if (dropped)
+	{
+		InterlockedExchangeAdd(&s_dropped, ::atoi(message));
+	}
+	else
+	{
+		InterlockedIncrement(&s_shown);
+	}
+
+	// the first few go to the console to show what the sink gets
+
+	if (InterlockedIncrement(&s_messages) <= 8)
+	{
+		Notify::console(classType, state, message);
+	}
+}
+
+DWORD WINAPI producer(LPVOID parameter)
+{
+	int id = static_cast<int>(reinterpret_cast<size_t>(parameter));
+	for (int i = 0; i < ProducerEvents; ++i)
+	{
+		switch (i % 4)
+		{
+			case 0: Notify::update(Notify::Encoder, Notify::Info, "worker %d step %d", id, i); break;
+			case 1: Notify::update(Notify::HttpServer, Notify::Warning, "worker %d says %s", id, "hello"); break;
+			case 2: Notify::update(Notify::DirectSound, Notify::Info, "ratio %.3f for %I64u bytes", i / 7.0, static_cast<ULONGLONG>(i) << 20); break;
+			case 3: Notify::update(Notify::Encoder, Notify::Error, "%-6s|%5.2f%%", "w", i / 3.0); break;
+		}
+	}
+	return 0;
+}
+
+void producers()
+{
+	Notify::setSink(countingSink);
+
+	HANDLE threads[ProducerCount];
+	for (size_t i = 0; i < ProducerCount; ++i)
+	{
+		threads[i] = CreateThread(0, 0, producer, reinterpret_cast<LPVOID>(i), 0, 0);
+	}
+
+	WaitForMultipleObjects(ProducerCount, threads, TRUE, INFINITE);
+	for (size_t i = 0; i < ProducerCount; ++i)
+	{
+		CloseHandle(threads[i]);
+	}
+
+	// repeats are shown once they have stopped for a second
+
+	Sleep(1500);
+	Notify::update(Notify::Encoder, Notify::Info, "done");
+	for (int i = 0; (i < 500) && !s_done; ++i)
+	{
+		Sleep(10);
+	}
+
+	Notify::setSink(Notify::console);
+
+	LONG delivered = s_shown + s_repeated + s_dropped;
+	printf("%d of %d notifications delivered: %d shown, %d counted as repeats, %d counted as dropped\n", static_cast<int>(delivered),
+		ProducerCount * ProducerEvents, static_cast<int>(s_shown), static_cast<int>(s_repeated), static_cast<int>(s_dropped));
+
+	if (!s_done || (delivered != (ProducerCount * ProducerEvents)))
+	{
+		s_passed = false;
+	}
+}
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+
+	formats();
+	longString();
+	full();
+	producers();
+
+	printf("%s\n", s_passed ? "passed" : "FAILED");
+	return s_passed ? 0 : 1;
+}
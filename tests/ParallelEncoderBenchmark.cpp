@@ -0,0 +1,467 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "ParallelEncoder.h"
+#include "Notify.h"
+
+#include <math.h>
+#include <stdio.h>
+
+using namespace dsbridge;
+
+// Feeds a few minutes of audio through ParallelEncoder with 1, 2, 4 and 8
+// workers, timing each run and checking that the stream spliced together from
+// the segments holds every chunk exactly once, in order, and that each frame
+// was encoded from the same audio as it would have been in one stream.
+//
+// lame_enc.dll is replaced by an encoder that turns each chunk into one
+// 128 kbps 44.1 kHz MPEG-1 layer III frame after doing about as much
+// arithmetic as LAME spends on one. Like LAME it starts with a delay of
+// silence and holds back audio for its analysis, so frames come out a chunk
+// late and each one depends on the end of the chunk before and the start of
+// the one after it; only the overlap ParallelEncoder encodes around every
+// segment makes the frames at its edges come out right. Unless the stream
+// is opened without the bit reservoir, every frame but the first borrows
+// from the one before it. A frame carries the sequence number found where
+// its chunk starts, a hash of the audio it was encoded from and where in
+// which stream it was made, so the splice can be checked without a decoder.
+
+namespace
+{
+
+enum
+{
+	ChunkSamples = 2304,
+	FrameSamples = ChunkSamples / 2,
+	SampleRate = 44100,
+	BitRate = 128,
+	SegmentChunks = 32,
+	TotalChunks = SegmentChunks * 200,
+	EncodeRounds = 48,
+
+	// in sample frames, about what LAME has
+
+	EncoderDelay = 1105,
+	Lookahead = FrameSamples + 576,
+	FifoSamples = EncoderDelay + 2 * FrameSamples + Lookahead
+};
+
+// what each frame carries after its header
+
+struct FrameInfo
+{
+	DWORD sequence;
+	DWORD hash;
+	DWORD stream;
+	DWORD frame;
+};
+
+struct FakeStream
+{
+	DWORD id;
+	BOOL reservoir;
+	ULONGLONG frames;
+	float state;
+	SHORT fifo[FifoSamples * 2];
+	DWORD fifoSamples;
+};
+
+volatile LONG s_streams = 0;
+
+DWORD hash(const SHORT* samples, size_t count)
+{
+	DWORD result = 2166136261u;
+	const BYTE* bytes = reinterpret_cast<const BYTE*>(samples);
+	for (size_t i = 0; i < count * 2 * sizeof(SHORT); ++i)
+	{
+		result = (result ^ bytes[i]) * 16777619u;
+	}
+	return result;
+}
+
+BE_ERR fakeInitStream(PBE_CONFIG config, PDWORD samples, PDWORD bufferSize, PHBE_STREAM stream)
+{
+	FakeStream* fake = new FakeStream;
+	fake->id = static_cast<DWORD>(InterlockedIncrement(&s_streams));
+	fake->reservoir = !config->format.LHV1.bNoRes;
+	fake->frames = 0;
+	fake->state = 0.0f;
+
+	// the encoder delay is silence ahead of the first chunk
+
+	::memset(fake->fifo, 0, sizeof(fake->fifo));
+	fake->fifoSamples = EncoderDelay;
+
+	*samples = ChunkSamples;
+	*bufferSize = 1441;
+	*stream = reinterpret_cast<HBE_STREAM>(fake);
+	return BE_ERR_SUCCESSFUL;
+}
+
+// one frame from the front of the fifo, encoded with the lookahead after it
+
+DWORD emitFrame(FakeStream* fake, PBYTE output)
+{
+	// padding slots are spread so the stream averages the exact bit rate
+
+	ULONGLONG bytesPerFrames = 144ULL * BitRate * 1000;
+	DWORD size = static_cast<DWORD>(((fake->frames + 1) * bytesPerFrames) / SampleRate - (fake->frames * bytesPerFrames) / SampleRate);
+	DWORD padding = size - static_cast<DWORD>(bytesPerFrames / SampleRate);
+
+	::memset(output, 0, size);
+	output[0] = 0xff;
+	output[1] = 0xfb;
+	output[2] = static_cast<BYTE>((9 << 4) | (padding << 1));
+	output[3] = 0x44;
+
+	// main_data_begin, the bytes borrowed from the frames before
+
+	WORD borrowed = (fake->reservoir && fake->frames) ? 100 : 0;
+	output[4] = static_cast<BYTE>(borrowed >> 1);
+	output[5] = static_cast<BYTE>(borrowed << 7);
+
+	FrameInfo info;
+	::memcpy(&info.sequence, fake->fifo + EncoderDelay * 2, sizeof(info.sequence));
+	info.hash = hash(fake->fifo, FrameSamples + Lookahead);
+	info.stream = fake->id;
+	info.frame = static_cast<DWORD>(fake->frames);
+	::memcpy(output + 6, &info, sizeof(info));
+
+	++fake->frames;
+
+	fake->fifoSamples -= FrameSamples;
+	::memmove(fake->fifo, fake->fifo + FrameSamples * 2, fake->fifoSamples * 2 * sizeof(SHORT));
+	::memset(fake->fifo + fake->fifoSamples * 2, 0, (FifoSamples - fake->fifoSamples) * 2 * sizeof(SHORT));
+
+	return size;
+}
+
+BE_ERR fakeEncodeChunk(HBE_STREAM stream, DWORD samples, PSHORT input, PBYTE output, PDWORD outputSize)
+{
+	FakeStream* fake = reinterpret_cast<FakeStream*>(stream);
+
+	// stands in for the filterbank and quantization loops
+
+	float state = fake->state;
+	for (size_t round = 0; round < EncodeRounds; ++round)
+	{
+		for (DWORD i = 0; i < samples; ++i)
+		{
+			state = state * 0.999f + input[i] * (1.0f / 32768.0f);
+		}
+	}
+	fake->state = state;
+
+	::memcpy(fake->fifo + fake->fifoSamples * 2, input, samples * sizeof(SHORT));
+	fake->fifoSamples += samples / 2;
+
+	*outputSize = 0;
+	while (fake->fifoSamples >= (FrameSamples + Lookahead))
+	{
+		*outputSize += emitFrame(fake, output + *outputSize);
+	}
+
+	return BE_ERR_SUCCESSFUL;
+}
+
+BE_ERR fakeDeinitStream(HBE_STREAM stream, PBYTE output, PDWORD outputSize)
+{
+	FakeStream* fake = reinterpret_cast<FakeStream*>(stream);
+
+	// what is held back goes out padded with silence
+
+	*outputSize = 0;
+	while (fake->fifoSamples)
+	{
+		fake->fifoSamples = fake->fifoSamples > FrameSamples ? fake->fifoSamples : FrameSamples;
+		*outputSize += emitFrame(fake, output + *outputSize);
+	}
+
+	return BE_ERR_SUCCESSFUL;
+}
+
+
+BE_ERR fakeCloseStream(HBE_STREAM stream)
+{
+	delete reinterpret_cast<FakeStream*>(stream);
+	return BE_ERR_SUCCESSFUL;
+}
+
+const ModuleExport s_lameExports[] =
+{
+	{ "beInitStream", reinterpret_cast<void*>(fakeInitStream) },
+	{ "beEncodeChunk", reinterpret_cast<void*>(fakeEncodeChunk) },
+	{ "beDeinitStream", reinterpret_cast<void*>(fakeDeinitStream) },
+	{ "beCloseStream", reinterpret_cast<void*>(fakeCloseStream) },
+	{ 0, 0 }
+};
+
+double seconds()
+{
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return static_cast<double>(counter.QuadPart) / frequency.QuadPart;
+}
+
+void fill(SHORT* chunk, DWORD sequence)
+{
+	for (size_t i = 0; i < FrameSamples; ++i)
+	{
+		double phase = (sequence * FrameSamples + i) * (2.0 * 3.14159265358979 * 440.0 / SampleRate);
+		chunk[i * 2 + 0] = chunk[i * 2 + 1] = static_cast<SHORT>(::sin(phase) * 16384.0);
+	}
+
+	// sequence numbers start at one; the silence the encoder starts from reads as zero
+
+	::memcpy(chunk, &sequence, sizeof(sequence));
+}
+
+// the audio around a frame as one stream would have held it: silence, then
+// every chunk in order
+
+void window(LONGLONG start, SHORT* samples)
+{
+	static SHORT chunks[4][ChunkSamples];
+	static LONGLONG filled[4] = { -1, -1, -1, -1 };
+
+	for (size_t i = 0; i < FrameSamples + Lookahead; ++i)
+	{
+		LONGLONG position = start + static_cast<LONGLONG>(i);
+		if (position < 0)
+		{
+			samples[i * 2] = samples[i * 2 + 1] = 0;
+			continue;
+		}
+
+		LONGLONG sequence = position / FrameSamples + 1;
+		size_t slot = static_cast<size_t>(sequence % 4);
+		if (filled[slot] != sequence)
+		{
+			fill(chunks[slot], static_cast<DWORD>(sequence));
+			filled[slot] = sequence;
+		}
+
+		::memcpy(samples + i * 2, chunks[slot] + (position % FrameSamples) * 2, 2 * sizeof(SHORT));
+	}
+}
+
+// the leading overlap of the first segment is silence, after which every
+// chunk has to follow the one before it, encoded from the audio around it
+// and borrowing only from the frame it was encoded after
+
+bool verify(const BYTE* stream, size_t size)
+{
+	size_t first = 0;
+	for (size_t offset = 0, frames = 0; (offset + 4) <= size; ++frames)
+	{
+		size_t length = ParallelEncoder::frameLength(stream + offset);
+		if (!length || ((offset + length) > size))
+		{
+			printf("lost frame sync at byte %u\n", static_cast<DWORD>(offset));
+			return false;
+		}
+
+		FrameInfo info;
+		::memcpy(&info, stream + offset + 6, sizeof(info));
+		if (info.sequence)
+		{
+			first = frames;
+			break;
+		}
+
+		offset += length;
+	}
+
+	static SHORT samples[(FrameSamples + Lookahead) * 2];
+
+	size_t offset = 0;
+	size_t frames = 0;
+	FrameInfo previous = { 0, 0, 0, 0 };
+	while (offset < size)
+	{
+		size_t length = ((offset + 4) <= size) ? ParallelEncoder::frameLength(stream + offset) : 0;
+		if (!length || ((offset + length) > size))
+		{
+			printf("lost frame sync at byte %u\n", static_cast<DWORD>(offset));
+			return false;
+		}
+
+		LONGLONG sequence = static_cast<LONGLONG>(frames) - static_cast<LONGLONG>(first) + 1;
+
+		FrameInfo info;
+		::memcpy(&info, stream + offset + 6, sizeof(info));
+		if (info.sequence != (sequence > 0 ? static_cast<DWORD>(sequence) : 0))
+		{
+			printf("frame %u holds chunk %u, expected %d\n", static_cast<DWORD>(frames), info.sequence, static_cast<int>(sequence));
+			return false;
+		}
+
+		window((sequence - 1) * FrameSamples - EncoderDelay, samples);
+		if (info.hash != hash(samples, FrameSamples + Lookahead))
+		{
+			printf("frame %u was not encoded from the audio around chunk %d\n", static_cast<DWORD>(frames), static_cast<int>(sequence));
+			return false;
+		}
+
+		DWORD borrowed = (stream[offset + 4] << 1) | (stream[offset + 5] >> 7);
+		if (borrowed && ((info.stream != previous.stream) || (info.frame != previous.frame + 1)))
+		{
+			printf("frame %u borrows from a frame its segment did not keep\n", static_cast<DWORD>(frames));
+			return false;
+		}
+
+		previous = info;
+		offset += length;
+		++frames;
+	}
+
+	if (frames != TotalChunks)
+	{
+		printf("%u frames for %u chunks\n", static_cast<DWORD>(frames), TotalChunks);
+		return false;
+	}
+
+	return true;
+}
+
+bool run(const BE_CONFIG& config, size_t workers, double& elapsed)
+{
+	ParallelEncoder encoder;
+	if (!encoder.create(config, ChunkSamples, workers, SegmentChunks))
+	{
+		return false;
+	}
+
+	size_t capacity = TotalChunks * 1441;
+	BYTE* stream = new BYTE[capacity];
+	size_t size = 0;
+
+	double begin = seconds();
+
+	DWORD submitted = 0;
+	size_t collected = 0;
+	while (collected < (TotalChunks / SegmentChunks))
+	{
+		void* input = (submitted < TotalChunks) ? encoder.input() : 0;
+		if (input)
+		{
+			fill(static_cast<SHORT*>(input), ++submitted);
+			encoder.submit();
+			continue;
+		}
+
+		const BYTE* output;
+		DWORD outputSize;
+		if (encoder.collect(output, outputSize))
+		{
+			::memcpy(stream + size, output, outputSize);
+			size += outputSize;
+			++collected;
+			continue;
+		}
+
+		SleepEx(1, FALSE);
+	}
+
+	elapsed = seconds() - begin;
+
+	encoder.destroy();
+
+	bool result = verify(stream, size);
+	delete [] stream;
+	return result;
+}
+
+// the same chunks through the stand-in encoder on this thread alone
+
+double serial()
+{
+	BE_CONFIG config;
+	::memset(&config, 0, sizeof(config));
+	config.format.LHV1.bNoRes = TRUE;
+
+	DWORD samples;
+	DWORD bufferSize;
+	HBE_STREAM stream;
+	fakeInitStream(&config, &samples, &bufferSize, &stream);
+
+	SHORT chunk[ChunkSamples];
+	BYTE output[1441];
+
+	double begin = seconds();
+	for (DWORD i = 1; i <= TotalChunks; ++i)
+	{
+		DWORD outputSize;
+		fill(chunk, i);
+		fakeEncodeChunk(stream, ChunkSamples, chunk, output, &outputSize);
+	}
+	double elapsed = seconds() - begin;
+
+	fakeCloseStream(stream);
+	return elapsed;
+}
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+	RegisterModule("lame_enc.dll", s_lameExports);
+
+	BE_CONFIG config;
+	::memset(&config, 0, sizeof(config));
+	config.dwConfig = BE_CONFIG_LAME;
+	config.format.LHV1.dwSampleRate = SampleRate;
+	config.format.LHV1.nMode = BE_MP3_MODE_JSTEREO;
+	config.format.LHV1.dwBitrate = BitRate;
+
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+
+	double audio = static_cast<double>(TotalChunks) * FrameSamples / SampleRate;
+	printf("%u chunks (%.0f s of audio), %u chunks per segment, %u processors\n", TotalChunks, audio, SegmentChunks, info.dwNumberOfProcessors);
+
+	double reference = serial();
+	printf("serial     %8.0f chunks/s %6.0fx realtime\n", TotalChunks / reference, audio / reference);
+
+	static const size_t workers[] = { 1, 2, 4, 8 };
+	for (size_t i = 0; i < sizeof(workers) / sizeof(workers[0]); ++i)
+	{
+		double elapsed;
+		if (!run(config, workers[i], elapsed))
+		{
+			printf("%u workers: spliced stream is broken\n", static_cast<DWORD>(workers[i]));
+			return 1;
+		}
+
+		printf("%u workers  %8.0f chunks/s %6.0fx realtime %5.2fx serial, stream intact\n", static_cast<DWORD>(workers[i]), TotalChunks / elapsed, audio / elapsed, reference / elapsed);
+	}
+
+	return 0;
+}
@@ -0,0 +1,121 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Resampler.h"
+#include "Notify.h"
+
+#include <math.h>
+#include <stdio.h>
+
+using namespace dsbridge;
+
+// Times the resampler on a minute of stereo audio for the rate pairs games
+// commonly use, at every quality setting.
+
+namespace
+{
+
+enum
+{
+	ChunkFrames = 1152,
+	Seconds = 60
+};
+
+struct Case
+{
+	DWORD inputRate;
+	DWORD outputRate;
+};
+
+const Case s_cases[] =
+{
+	{ 48000, 44100 },
+	{ 22050, 44100 },
+	{ 44100, 48000 },
+	{ 32000, 44100 },
+	{ 44056, 44100 }
+};
+
+const char* s_qualityNames[] = { "low", "medium", "high" };
+
+double seconds()
+{
+	LARGE_INTEGER counter;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return static_cast<double>(counter.QuadPart) / frequency.QuadPart;
+}
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+
+	for (size_t i = 0; i < sizeof(s_cases) / sizeof(s_cases[0]); ++i)
+	{
+		const Case& test = s_cases[i];
+
+		size_t chunks = test.inputRate * Seconds / ChunkFrames;
+		short* input = new short[chunks * ChunkFrames * 2];
+		for (size_t frame = 0; frame < chunks * ChunkFrames; ++frame)
+		{
+			double time = static_cast<double>(frame) / test.inputRate;
+			input[frame * 2 + 0] = static_cast<short>(16000.0 * ::sin(2.0 * 3.14159265358979 * 997.0 * time));
+			input[frame * 2 + 1] = static_cast<short>(::rand() % 32768 - 16384);
+		}
+
+		for (int quality = Resampler::Low; quality <= Resampler::High; ++quality)
+		{
+			Resampler resampler;
+			if (!resampler.create(test.inputRate, test.outputRate, static_cast<Resampler::Quality>(quality), ChunkFrames))
+			{
+				return 1;
+			}
+
+			short* output = new short[resampler.maxOutput(ChunkFrames) * 2];
+
+			double begin = seconds();
+			for (size_t chunk = 0; chunk < chunks; ++chunk)
+			{
+				resampler.process(input + chunk * ChunkFrames * 2, ChunkFrames, output);
+			}
+			resampler.flush(output);
+			double elapsed = seconds() - begin;
+
+			delete [] output;
+
+			double audio = static_cast<double>(chunks * ChunkFrames) / test.inputRate;
+			printf("%5u -> %5u %-6s %6.0fx realtime, %5.1f ns per output frame\n", test.inputRate, test.outputRate, s_qualityNames[quality], audio / elapsed, elapsed * 1e9 / (audio * test.outputRate));
+		}
+
+		delete [] input;
+	}
+
+	return 0;
+}
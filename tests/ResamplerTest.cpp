@@ -0,0 +1,162 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Resampler.h"
+#include "Notify.h"
+
+#include <math.h>
+#include <stdio.h>
+
+using namespace dsbridge;
+
+// Resamples ten seconds of two tones, 997 Hz on the left and 1495.5 Hz on
+// the right at -6 dBFS, and measures the signal to noise ratio of the result
+// against the tones computed at the output rate. Also checks that the output
+// holds as many frames as the rate ratio says it should.
+
+namespace
+{
+
+enum
+{
+	ChunkFrames = 1152,
+	Seconds = 10
+};
+
+struct Case
+{
+	DWORD inputRate;
+	DWORD outputRate;
+};
+
+const Case s_cases[] =
+{
+	{ 48000, 44100 },
+	{ 22050, 44100 },
+	{ 44100, 48000 },
+	{ 32000, 44100 },
+	{ 11025, 48000 },
+	{ 44056, 44100 }
+};
+
+// the shortest filter gives up stopband depth for speed
+
+const double s_minimumSnr[] = { 50.0, 75.0, 75.0 };
+
+const char* s_qualityNames[] = { "low", "medium", "high" };
+
+const double s_pi = 3.14159265358979323846;
+
+double tone(size_t channel, double time)
+{
+	double frequency = channel ? 1495.5 : 997.0;
+	return 16000.0 * ::sin(2.0 * s_pi * frequency * time);
+}
+
+bool run(const Case& test, Resampler::Quality quality)
+{
+	Resampler resampler;
+	if (!resampler.create(test.inputRate, test.outputRate, quality, ChunkFrames))
+	{
+		printf("could not create a resampler\n");
+		return false;
+	}
+
+	short input[ChunkFrames * 2];
+	short* output = new short[resampler.maxOutput(ChunkFrames) * 2];
+
+	size_t chunks = test.inputRate * Seconds / ChunkFrames;
+	size_t produced = 0;
+	double signal = 0.0;
+	double noise = 0.0;
+
+	for (size_t chunk = 0; chunk <= chunks; ++chunk)
+	{
+		size_t count = 0;
+		if (chunk < chunks)
+		{
+			for (size_t i = 0; i < ChunkFrames; ++i)
+			{
+				double time = static_cast<double>(chunk * ChunkFrames + i) / test.inputRate;
+				input[i * 2 + 0] = static_cast<short>(tone(0, time));
+				input[i * 2 + 1] = static_cast<short>(tone(1, time));
+			}
+			count = resampler.process(input, ChunkFrames, output);
+		}
+		else
+		{
+			count = resampler.flush(output);
+		}
+
+		// the first and last second are left out, where the filter fills up
+		// and drains
+
+		for (size_t i = 0; i < count; ++i, ++produced)
+		{
+			if ((produced < test.outputRate) || (produced >= test.outputRate * (Seconds - 1)))
+			{
+				continue;
+			}
+
+			double time = static_cast<double>(produced) / test.outputRate;
+			for (size_t channel = 0; channel < 2; ++channel)
+			{
+				double expected = tone(channel, time);
+				double error = output[i * 2 + channel] - expected;
+				signal += expected * expected;
+				noise += error * error;
+			}
+		}
+	}
+
+	delete [] output;
+
+	double snr = 10.0 * ::log10(signal / noise);
+	double expected = static_cast<double>(chunks * ChunkFrames) * test.outputRate / test.inputRate;
+	bool passed = (snr >= s_minimumSnr[quality]) && (::fabs(produced - expected) <= 2.0);
+
+	printf("%5u -> %5u %-6s SNR %5.1f dB, %u frames (%.0f expected)%s\n", test.inputRate, test.outputRate, s_qualityNames[quality], snr, static_cast<DWORD>(produced), expected, passed ? "" : " FAILED");
+	return passed;
+}
+
+}
+
+int main()
+{
+	Notify::setSink(Notify::console);
+
+	bool passed = true;
+	for (size_t i = 0; i < sizeof(s_cases) / sizeof(s_cases[0]); ++i)
+	{
+		for (int quality = Resampler::Low; quality <= Resampler::High; ++quality)
+		{
+			passed = run(s_cases[i], static_cast<Resampler::Quality>(quality)) && passed;
+		}
+	}
+
+	return passed ? 0 : 1;
+}
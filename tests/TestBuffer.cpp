@@ -0,0 +1,313 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "TestBuffer.h"
+
+static LONGLONG now()
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
+
+TestBuffer::TestBuffer(const WAVEFORMATEX& format, DWORD bufferBytes)
+: m_references(1)
+, m_format(format)
+, m_memory(new BYTE[bufferBytes])
+, m_bufferBytes(bufferBytes)
+, m_playing(false)
+, m_looping(false)
+, m_started(0)
+, m_startPosition(0)
+, m_played(0)
+, m_locked(0)
+, m_nextLock(0)
+, m_lockedInOrder(true)
+{
+	InitializeCriticalSection(&m_cs);
+	::memset(m_memory, 0, bufferBytes);
+}
+
+TestBuffer::~TestBuffer()
+{
+	delete [] m_memory;
+	DeleteCriticalSection(&m_cs);
+}
+
+ULONGLONG TestBuffer::played()
+{
+	EnterCriticalSection(&m_cs);
+	update();
+	ULONGLONG result = m_played;
+	LeaveCriticalSection(&m_cs);
+	return result;
+}
+
+ULONGLONG TestBuffer::locked()
+{
+	EnterCriticalSection(&m_cs);
+	ULONGLONG result = m_locked;
+	LeaveCriticalSection(&m_cs);
+	return result;
+}
+
+bool TestBuffer::lockedInOrder()
+{
+	EnterCriticalSection(&m_cs);
+	bool result = m_lockedInOrder;
+	LeaveCriticalSection(&m_cs);
+	return result;
+}
+
+void TestBuffer::update()
+{
+	if (!m_playing)
+	{
+		return;
+	}
+
+	// whole frames played since Play, as the card would have
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+
+	ULONGLONG frames = static_cast<ULONGLONG>(double(now() - m_started) * m_format.nSamplesPerSec / frequency.QuadPart);
+	m_played = frames * m_format.nBlockAlign;
+
+	if (!m_looping && ((m_startPosition + m_played) >= m_bufferBytes))
+	{
+		m_played = m_bufferBytes - m_startPosition;
+		m_playing = false;
+	}
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::QueryInterface(REFIID, LPVOID* ppvObj)
+{
+	*ppvObj = 0;
+	return E_NOTIMPL;
+}
+
+ULONG STDMETHODCALLTYPE TestBuffer::AddRef()
+{
+	return InterlockedIncrement(&m_references);
+}
+
+ULONG STDMETHODCALLTYPE TestBuffer::Release()
+{
+	// the test owns the buffer, so it outlives its last reference
+
+	return InterlockedDecrement(&m_references);
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::GetCaps(LPDSBCAPS pDSBufferCaps)
+{
+	::memset(pDSBufferCaps, 0, sizeof(DSBCAPS));
+	pDSBufferCaps->dwSize = sizeof(DSBCAPS);
+	pDSBufferCaps->dwBufferBytes = m_bufferBytes;
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::GetCurrentPosition(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor)
+{
+	EnterCriticalSection(&m_cs);
+	update();
+
+	// a buffer that played to its end without looping is back at the start
+
+	DWORD play = static_cast<DWORD>((m_startPosition + m_played) % m_bufferBytes);
+	DWORD lead = (m_format.nAvgBytesPerSec * WriteLead / 1000) / m_format.nBlockAlign * m_format.nBlockAlign;
+	DWORD write = m_playing ? (play + lead) % m_bufferBytes : play;
+	LeaveCriticalSection(&m_cs);
+
+	if (pdwCurrentPlayCursor)
+	{
+		*pdwCurrentPlayCursor = play;
+	}
+
+	if (pdwCurrentWriteCursor)
+	{
+		*pdwCurrentWriteCursor = write;
+	}
+
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::GetFormat(LPWAVEFORMATEX pwfxFormat, DWORD dwSizeAllocated, LPDWORD pdwSizeWritten)
+{
+	if (pdwSizeWritten)
+	{
+		*pdwSizeWritten = sizeof(WAVEFORMATEX);
+	}
+
+	if (pwfxFormat)
+	{
+		if (dwSizeAllocated < sizeof(WAVEFORMATEX))
+		{
+			return DSERR_INVALIDPARAM;
+		}
+
+		*pwfxFormat = m_format;
+	}
+
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::GetVolume(LPLONG plVolume)
+{
+	*plVolume = 0;
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::GetPan(LPLONG plPan)
+{
+	*plPan = 0;
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::GetFrequency(LPDWORD pdwFrequency)
+{
+	*pdwFrequency = m_format.nSamplesPerSec;
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::GetStatus(LPDWORD pdwStatus)
+{
+	EnterCriticalSection(&m_cs);
+	update();
+	*pdwStatus = (m_playing ? DSBSTATUS_PLAYING : 0) | (m_playing && m_looping ? DSBSTATUS_LOOPING : 0);
+	LeaveCriticalSection(&m_cs);
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::Initialize(LPDIRECTSOUND, LPCDSBUFFERDESC)
+{
+	return E_NOTIMPL;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::Lock(DWORD dwOffset, DWORD dwBytes, LPVOID* ppvAudioPtr1, LPDWORD pdwAudioBytes1, LPVOID* ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags)
+{
+	if (dwFlags & DSBLOCK_ENTIREBUFFER)
+	{
+		dwOffset = 0;
+		dwBytes = m_bufferBytes;
+	}
+
+	if ((dwOffset >= m_bufferBytes) || (dwBytes > m_bufferBytes))
+	{
+		return DSERR_INVALIDPARAM;
+	}
+
+	DWORD first = (dwOffset + dwBytes) > m_bufferBytes ? m_bufferBytes - dwOffset : dwBytes;
+
+	*ppvAudioPtr1 = m_memory + dwOffset;
+	*pdwAudioBytes1 = first;
+
+	if (ppvAudioPtr2)
+	{
+		*ppvAudioPtr2 = first < dwBytes ? m_memory : 0;
+	}
+
+	if (pdwAudioBytes2)
+	{
+		*pdwAudioBytes2 = dwBytes - first;
+	}
+
+	EnterCriticalSection(&m_cs);
+	m_lockedInOrder = m_lockedInOrder && (dwOffset == m_nextLock);
+	m_nextLock = (dwOffset + dwBytes) % m_bufferBytes;
+	m_locked += dwBytes;
+	LeaveCriticalSection(&m_cs);
+
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::Play(DWORD, DWORD, DWORD dwFlags)
+{
+	EnterCriticalSection(&m_cs);
+	update();
+	if (!m_playing)
+	{
+		m_startPosition = (m_startPosition + m_played) % m_bufferBytes;
+		m_played = 0;
+		m_started = now();
+		m_playing = true;
+	}
+	m_looping = (dwFlags & DSBPLAY_LOOPING) != 0;
+	LeaveCriticalSection(&m_cs);
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::SetCurrentPosition(DWORD dwNewPosition)
+{
+	EnterCriticalSection(&m_cs);
+	update();
+	m_startPosition = dwNewPosition;
+	m_played = 0;
+	m_started = now();
+	LeaveCriticalSection(&m_cs);
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::SetFormat(LPCWAVEFORMATEX pcfxFormat)
+{
+	m_format = *pcfxFormat;
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::SetVolume(LONG)
+{
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::SetPan(LONG)
+{
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::SetFrequency(DWORD)
+{
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::Stop()
+{
+	EnterCriticalSection(&m_cs);
+	update();
+	m_playing = false;
+	LeaveCriticalSection(&m_cs);
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::Unlock(LPVOID, DWORD, LPVOID, DWORD)
+{
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE TestBuffer::Restore()
+{
+	return S_OK;
+}
@@ -0,0 +1,103 @@
+#ifndef dsbridge_TestBuffer_h
+#define dsbridge_TestBuffer_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+#include <audiodefs.h>
+#include <dsound.h>
+
+// Stands in for a sound card's buffer. Once played, its cursors move with the
+// wall clock at the buffer's rate, the write cursor a fixed lead ahead of the
+// play cursor; without looping it stops by itself at the end. Locked regions
+// point straight into its memory, and it counts what was locked.
+
+class TestBuffer : public IDirectSoundBuffer
+{
+public:
+	enum
+	{
+		WriteLead = 15
+	};
+
+	TestBuffer(const WAVEFORMATEX& format, DWORD bufferBytes);
+	virtual ~TestBuffer();
+
+	BYTE* memory() { return m_memory; }
+	DWORD bufferBytes() const { return m_bufferBytes; }
+
+	ULONGLONG played();
+	ULONGLONG locked();
+	bool lockedInOrder();
+
+	virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, LPVOID*);
+	virtual ULONG STDMETHODCALLTYPE AddRef();
+	virtual ULONG STDMETHODCALLTYPE Release();
+
+	virtual HRESULT STDMETHODCALLTYPE GetCaps(LPDSBCAPS pDSBufferCaps);
+	virtual HRESULT STDMETHODCALLTYPE GetCurrentPosition(LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor);
+	virtual HRESULT STDMETHODCALLTYPE GetFormat(LPWAVEFORMATEX pwfxFormat, DWORD dwSizeAllocated, LPDWORD pdwSizeWritten);
+	virtual HRESULT STDMETHODCALLTYPE GetVolume(LPLONG plVolume);
+	virtual HRESULT STDMETHODCALLTYPE GetPan(LPLONG plPan);
+	virtual HRESULT STDMETHODCALLTYPE GetFrequency(LPDWORD pdwFrequency);
+	virtual HRESULT STDMETHODCALLTYPE GetStatus(LPDWORD pdwStatus);
+	virtual HRESULT STDMETHODCALLTYPE Initialize(LPDIRECTSOUND pDirectSound, LPCDSBUFFERDESC pcDSBufferDesc);
+	virtual HRESULT STDMETHODCALLTYPE Lock(DWORD dwOffset, DWORD dwBytes, LPVOID* ppvAudioPtr1, LPDWORD pdwAudioBytes1, LPVOID* ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags);
+	virtual HRESULT STDMETHODCALLTYPE Play(DWORD dwReserved1, DWORD dwPriority, DWORD dwFlags);
+	virtual HRESULT STDMETHODCALLTYPE SetCurrentPosition(DWORD dwNewPosition);
+	virtual HRESULT STDMETHODCALLTYPE SetFormat(LPCWAVEFORMATEX pcfxFormat);
+	virtual HRESULT STDMETHODCALLTYPE SetVolume(LONG lVolume);
+	virtual HRESULT STDMETHODCALLTYPE SetPan(LONG lPan);
+	virtual HRESULT STDMETHODCALLTYPE SetFrequency(DWORD dwFrequency);
+	virtual HRESULT STDMETHODCALLTYPE Stop();
+	virtual HRESULT STDMETHODCALLTYPE Unlock(LPVOID pvAudioPtr1, DWORD dwAudioBytes1, LPVOID pvAudioPtr2, DWORD dwAudioBytes2);
+	virtual HRESULT STDMETHODCALLTYPE Restore();
+
+private:
+
+	void update();
+
+	CRITICAL_SECTION m_cs;
+	volatile LONG m_references;
+
+	WAVEFORMATEX m_format;
+	BYTE* m_memory;
+	DWORD m_bufferBytes;
+
+	bool m_playing;
+	bool m_looping;
+	LONGLONG m_started;
+	ULONGLONG m_startPosition;
+	ULONGLONG m_played;
+
+	ULONGLONG m_locked;
+	DWORD m_nextLock;
+	bool m_lockedInOrder;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef dsbridge_win32_BladeMP3EncDLL_h
+#define dsbridge_win32_BladeMP3EncDLL_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+// The parts of the lame_enc.dll SDK header the sources use, laid out like the
+// LHV1 structure it ships with.
+
+#include <windows.h>
+
+typedef unsigned long HBE_STREAM;
+typedef HBE_STREAM* PHBE_STREAM;
+typedef unsigned long BE_ERR;
+
+#define BE_ERR_SUCCESSFUL 0x00000000
+
+#define BE_CONFIG_LAME 256
+
+#define BE_MP3_MODE_STEREO 0
+#define BE_MP3_MODE_JSTEREO 1
+#define BE_MP3_MODE_DUALCHANNEL 2
+#define BE_MP3_MODE_MONO 3
+
+typedef enum
+{
+	LQP_NOPRESET = -1,
+	LQP_NORMAL_QUALITY = 0,
+	LQP_LOW_QUALITY = 1,
+	LQP_HIGH_QUALITY = 2
+} LAME_QUALITY_PRESET;
+
+typedef enum
+{
+	VBR_METHOD_NONE = -1,
+	VBR_METHOD_DEFAULT = 0
+} VBRMETHOD;
+
+#pragma pack(push, 1)
+
+typedef struct
+{
+	DWORD dwConfig;
+
+	union
+	{
+		struct
+		{
+			DWORD dwStructVersion;
+			DWORD dwStructSize;
+
+			DWORD dwSampleRate;
+			DWORD dwReSampleRate;
+			LONG nMode;
+			DWORD dwBitrate;
+			DWORD dwMaxBitrate;
+			LONG nPreset;
+			DWORD dwMpegVersion;
+			DWORD dwPsyModel;
+			DWORD dwEmphasis;
+
+			BOOL bPrivate;
+			BOOL bCRC;
+			BOOL bCopyright;
+			BOOL bOriginal;
+
+			BOOL bWriteVBRHeader;
+			BOOL bEnableVBR;
+			int nVBRQuality;
+			DWORD dwVbrAbr_bps;
+			VBRMETHOD nVbrMethod;
+			BOOL bNoRes;
+
+			BOOL bStrictIso;
+			WORD nQuality;
+
+			BYTE btReserved[255 - 4 * sizeof(DWORD) - sizeof(WORD)];
+		} LHV1;
+	} format;
+} BE_CONFIG, *PBE_CONFIG;
+
+#pragma pack(pop)
+
+typedef BE_ERR (*BEINITSTREAM)(PBE_CONFIG config, PDWORD samples, PDWORD bufferSize, PHBE_STREAM stream);
+typedef BE_ERR (*BEENCODECHUNK)(HBE_STREAM stream, DWORD samples, PSHORT input, PBYTE output, PDWORD outputSize);
+typedef BE_ERR (*BEDEINITSTREAM)(HBE_STREAM stream, PBYTE output, PDWORD outputSize);
+typedef BE_ERR (*BECLOSESTREAM)(HBE_STREAM stream);
+
+#endif
@@ -0,0 +1,869 @@
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+#include <ShellAPI.h>
+
+#include "ExceptionHandler.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// Every handle is an Object. Waits take one process wide lock and sleep on
+// one condition, which is plenty for tests and makes waiting on several
+// objects at once simple.
+
+namespace
+{
+
+enum ObjectType
+{
+	EventObject,
+	SemaphoreObject,
+	ThreadObject,
+	FileObject
+};
+
+struct Object
+{
+	ObjectType type;
+	LONG references;
+
+	// events and semaphores
+
+	bool manualReset;
+	bool signaled;
+	LONG count;
+	LONG maximumCount;
+
+	// threads
+
+	pthread_t thread;
+	bool started;
+	bool finished;
+	LPTHREAD_START_ROUTINE start;
+	LPVOID parameter;
+
+	// files
+
+	FILE* file;
+};
+
+enum
+{
+	MaxModules = 8,
+	MaxFeatures = 64
+};
+
+struct Module
+{
+	const char* name;
+	const ModuleExport* exports;
+};
+
+pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t s_changed = PTHREAD_COND_INITIALIZER;
+
+Module s_modules[MaxModules];
+size_t s_moduleCount = 0;
+
+bool s_featureMissing[MaxFeatures];
+
+Object* create(ObjectType type)
+{
+	Object* object = new Object;
+	::memset(object, 0, sizeof(*object));
+	object->type = type;
+	object->references = 1;
+	return object;
+}
+
+// both called with s_lock held
+
+void release(Object* object)
+{
+	if (!--object->references)
+	{
+		delete object;
+	}
+}
+
+bool acquire(Object* object)
+{
+	switch (object->type)
+	{
+		case EventObject:
+		{
+			if (!object->signaled)
+			{
+				return false;
+			}
+
+			if (!object->manualReset)
+			{
+				object->signaled = false;
+			}
+			return true;
+		}
+
+		case SemaphoreObject:
+		{
+			if (!object->count)
+			{
+				return false;
+			}
+
+			--object->count;
+			return true;
+		}
+
+		case ThreadObject:
+		{
+			return object->finished;
+		}
+
+		case FileObject:
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ready(Object* object)
+{
+	switch (object->type)
+	{
+		case EventObject: return object->signaled;
+		case SemaphoreObject: return object->count > 0;
+		case ThreadObject: return object->finished;
+		case FileObject: return true;
+	}
+	return false;
+}
+
+void* threadEntry(void* parameter)
+{
+	Object* object = static_cast<Object*>(parameter);
+	object->start(object->parameter);
+
+	pthread_mutex_lock(&s_lock);
+	object->finished = true;
+	pthread_cond_broadcast(&s_changed);
+	release(object);
+	pthread_mutex_unlock(&s_lock);
+
+	return 0;
+}
+
+bool startThread(Object* object)
+{
+	pthread_attr_t attributes;
+	pthread_attr_init(&attributes);
+	pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+
+	// the thread holds a reference of its own until it has finished
+
+	++object->references;
+	object->started = true;
+	if (pthread_create(&object->thread, &attributes, threadEntry, object))
+	{
+		--object->references;
+		object->started = false;
+		pthread_attr_destroy(&attributes);
+		return false;
+	}
+
+	pthread_attr_destroy(&attributes);
+	return true;
+}
+
+void deadline(timespec& result, DWORD milliseconds)
+{
+	clock_gettime(CLOCK_REALTIME, &result);
+	result.tv_sec += milliseconds / 1000;
+	result.tv_nsec += (milliseconds % 1000) * 1000000L;
+	if (result.tv_nsec >= 1000000000L)
+	{
+		++result.tv_sec;
+		result.tv_nsec -= 1000000000L;
+	}
+}
+
+// MSVC spells 64-bit integer conversions %I64u
+
+void translate(char* target, size_t size, const char* format)
+{
+	size_t length = 0;
+	while (*format && (length + 3) < size)
+	{
+		if (!::strncmp(format, "I64", 3))
+		{
+			target[length++] = 'l';
+			target[length++] = 'l';
+			format += 3;
+			continue;
+		}
+
+		target[length++] = *format++;
+	}
+	target[length] = '\0';
+}
+
+int formatString(char* buffer, size_t size, size_t count, const char* format, va_list ap)
+{
+	char translated[1024];
+	translate(translated, sizeof(translated), format);
+
+	if (!size)
+	{
+		return -1;
+	}
+
+	size_t limit = (count == _TRUNCATE || count >= size) ? size : count + 1;
+	int length = vsnprintf(buffer, limit, translated, ap);
+	if ((length < 0) || (static_cast<size_t>(length) >= limit))
+	{
+		return -1;
+	}
+	return length;
+}
+
+}
+
+void InitializeCriticalSection(CRITICAL_SECTION* cs)
+{
+	pthread_mutexattr_t attributes;
+	pthread_mutexattr_init(&attributes);
+	pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+
+	pthread_mutex_t* mutex = new pthread_mutex_t;
+	pthread_mutex_init(mutex, &attributes);
+	pthread_mutexattr_destroy(&attributes);
+
+	cs->mutex = mutex;
+}
+
+void DeleteCriticalSection(CRITICAL_SECTION*)
+{
+	// threads still running at exit may hold the lock, so it is left behind
+}
+
+void EnterCriticalSection(CRITICAL_SECTION* cs)
+{
+	pthread_mutex_lock(static_cast<pthread_mutex_t*>(cs->mutex));
+}
+
+void LeaveCriticalSection(CRITICAL_SECTION* cs)
+{
+	pthread_mutex_unlock(static_cast<pthread_mutex_t*>(cs->mutex));
+}
+
+HANDLE CreateEvent(void*, BOOL manualReset, BOOL initialState, LPCSTR)
+{
+	Object* object = create(EventObject);
+	object->manualReset = manualReset != FALSE;
+	object->signaled = initialState != FALSE;
+	return object;
+}
+
+BOOL SetEvent(HANDLE event)
+{
+	pthread_mutex_lock(&s_lock);
+	static_cast<Object*>(event)->signaled = true;
+	pthread_cond_broadcast(&s_changed);
+	pthread_mutex_unlock(&s_lock);
+	return TRUE;
+}
+
+BOOL ResetEvent(HANDLE event)
+{
+	pthread_mutex_lock(&s_lock);
+	static_cast<Object*>(event)->signaled = false;
+	pthread_mutex_unlock(&s_lock);
+	return TRUE;
+}
+
+HANDLE CreateSemaphore(void*, LONG initialCount, LONG maximumCount, LPCSTR)
+{
+	Object* object = create(SemaphoreObject);
+	object->count = initialCount;
+	object->maximumCount = maximumCount;
+	return object;
+}
+
+BOOL ReleaseSemaphore(HANDLE semaphore, LONG releaseCount, LPLONG previousCount)
+{
+	Object* object = static_cast<Object*>(semaphore);
+	BOOL result = FALSE;
+
+	pthread_mutex_lock(&s_lock);
+	if (previousCount)
+	{
+		*previousCount = object->count;
+	}
+
+	if ((object->count + releaseCount) <= object->maximumCount)
+	{
+		object->count += releaseCount;
+		pthread_cond_broadcast(&s_changed);
+		result = TRUE;
+	}
+	pthread_mutex_unlock(&s_lock);
+
+	return result;
+}
+
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds)
+{
+	return WaitForMultipleObjects(1, &handle, FALSE, milliseconds);
+}
+
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL waitAll, DWORD milliseconds)
+{
+	timespec until;
+	deadline(until, milliseconds != INFINITE ? milliseconds : 0);
+
+	DWORD result = WAIT_TIMEOUT;
+
+	pthread_mutex_lock(&s_lock);
+	for (;;)
+	{
+		if (waitAll)
+		{
+			DWORD signaled = 0;
+			while ((signaled < count) && ready(static_cast<Object*>(handles[signaled])))
+			{
+				++signaled;
+			}
+
+			if (signaled == count)
+			{
+				for (DWORD i = 0; i < count; ++i)
+				{
+					acquire(static_cast<Object*>(handles[i]));
+				}
+
+				result = WAIT_OBJECT_0;
+				break;
+			}
+		}
+		else
+		{
+			DWORD index = 0;
+			while ((index < count) && !acquire(static_cast<Object*>(handles[index])))
+			{
+				++index;
+			}
+
+			if (index < count)
+			{
+				result = WAIT_OBJECT_0 + index;
+				break;
+			}
+		}
+
+		if (milliseconds == INFINITE)
+		{
+			pthread_cond_wait(&s_changed, &s_lock);
+		}
+		else if (pthread_cond_timedwait(&s_changed, &s_lock, &until) == ETIMEDOUT)
+		{
+			result = WAIT_TIMEOUT;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&s_lock);
+
+	return result;
+}
+
+BOOL CloseHandle(HANDLE handle)
+{
+	Object* object = static_cast<Object*>(handle);
+	if (!object || (object == INVALID_HANDLE_VALUE))
+	{
+		return FALSE;
+	}
+
+	if (object->type == FileObject)
+	{
+		fclose(object->file);
+	}
+
+	pthread_mutex_lock(&s_lock);
+	release(object);
+	pthread_mutex_unlock(&s_lock);
+
+	return TRUE;
+}
+
+LONG InterlockedIncrement(volatile LONG* target)
+{
+	return __sync_add_and_fetch(target, 1);
+}
+
+LONG InterlockedDecrement(volatile LONG* target)
+{
+	return __sync_sub_and_fetch(target, 1);
+}
+
+LONG InterlockedExchange(volatile LONG* target, LONG value)
+{
+	__sync_synchronize();
+	return __sync_lock_test_and_set(target, value);
+}
+
+LONG InterlockedExchangeAdd(volatile LONG* target, LONG value)
+{
+	return __sync_fetch_and_add(target, value);
+}
+
+LONG InterlockedCompareExchange(volatile LONG* target, LONG exchange, LONG comparand)
+{
+	return __sync_val_compare_and_swap(target, comparand, exchange);
+}
+
+PVOID InterlockedExchangePointer(PVOID volatile* target, PVOID value)
+{
+	__sync_synchronize();
+	return __sync_lock_test_and_set(target, value);
+}
+
+PVOID InterlockedCompareExchangePointer(PVOID volatile* target, PVOID exchange, PVOID comparand)
+{
+	return __sync_val_compare_and_swap(target, comparand, exchange);
+}
+
+HANDLE CreateThread(void*, SIZE_T, LPTHREAD_START_ROUTINE start, LPVOID parameter, DWORD flags, LPDWORD threadId)
+{
+	Object* object = create(ThreadObject);
+	object->start = start;
+	object->parameter = parameter;
+
+	if (threadId)
+	{
+		*threadId = 0;
+	}
+
+	if (flags & CREATE_SUSPENDED)
+	{
+		return object;
+	}
+
+	pthread_mutex_lock(&s_lock);
+	bool started = startThread(object);
+	pthread_mutex_unlock(&s_lock);
+
+	if (!started)
+	{
+		CloseHandle(object);
+		return 0;
+	}
+
+	return object;
+}
+
+DWORD ResumeThread(HANDLE thread)
+{
+	Object* object = static_cast<Object*>(thread);
+	DWORD result = 0;
+
+	pthread_mutex_lock(&s_lock);
+	if (!object->started)
+	{
+		result = startThread(object) ? 1 : static_cast<DWORD>(-1);
+	}
+	pthread_mutex_unlock(&s_lock);
+
+	return result;
+}
+
+BOOL SetThreadPriority(HANDLE, int)
+{
+	return TRUE;
+}
+
+DWORD SetThreadIdealProcessor(HANDLE, DWORD)
+{
+	return 0;
+}
+
+DWORD GetCurrentThreadId()
+{
+	return static_cast<DWORD>(syscall(SYS_gettid));
+}
+
+DWORD GetCurrentProcessId()
+{
+	return static_cast<DWORD>(getpid());
+}
+
+void GetSystemInfo(SYSTEM_INFO* info)
+{
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	info->dwNumberOfProcessors = processors > 0 ? static_cast<DWORD>(processors) : 1;
+}
+
+BOOL IsProcessorFeaturePresent(DWORD feature)
+{
+	// every x86-64 processor has SSE and SSE2
+
+	if ((feature >= MaxFeatures) || s_featureMissing[feature])
+	{
+		return FALSE;
+	}
+
+	return (feature == PF_XMMI_INSTRUCTIONS_AVAILABLE) || (feature == PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+}
+
+void SetProcessorFeature(DWORD feature, BOOL present)
+{
+	if (feature < MaxFeatures)
+	{
+		s_featureMissing[feature] = !present;
+	}
+}
+
+DWORD SleepEx(DWORD milliseconds, BOOL)
+{
+	timespec duration;
+	duration.tv_sec = milliseconds / 1000;
+	duration.tv_nsec = (milliseconds % 1000) * 1000000L;
+	while (nanosleep(&duration, &duration) && (errno == EINTR))
+	{
+	}
+	return 0;
+}
+
+void Sleep(DWORD milliseconds)
+{
+	SleepEx(milliseconds, FALSE);
+}
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER* counter)
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	counter->QuadPart = static_cast<LONGLONG>(now.tv_sec) * 10000000 + now.tv_nsec / 100;
+	return TRUE;
+}
+
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency)
+{
+	frequency->QuadPart = 10000000;
+	return TRUE;
+}
+
+DWORD GetTickCount()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<DWORD>(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+void RegisterModule(const char* name, const ModuleExport* exports)
+{
+	if (s_moduleCount < MaxModules)
+	{
+		s_modules[s_moduleCount].name = name;
+		s_modules[s_moduleCount].exports = exports;
+		++s_moduleCount;
+	}
+}
+
+HMODULE LoadLibrary(LPCSTR name)
+{
+	for (size_t i = 0; i < s_moduleCount; ++i)
+	{
+		if (!_stricmp(s_modules[i].name, name))
+		{
+			return reinterpret_cast<HMODULE>(&s_modules[i]);
+		}
+	}
+	return 0;
+}
+
+BOOL FreeLibrary(HMODULE module)
+{
+	return module ? TRUE : FALSE;
+}
+
+void* GetProcAddress(HMODULE module, LPCSTR name)
+{
+	const ModuleExport* exports = reinterpret_cast<Module*>(module)->exports;
+	for (size_t i = 0; exports[i].name; ++i)
+	{
+		if (!::strcmp(exports[i].name, name))
+		{
+			return exports[i].proc;
+		}
+	}
+	return 0;
+}
+
+DWORD GetModuleFileName(HMODULE, LPSTR path, DWORD size)
+{
+	// paths look like Windows ones to the sources; CreateFile turns them back
+
+	ssize_t length = readlink("/proc/self/exe", path, size - 1);
+	if (length < 0)
+	{
+		length = 0;
+	}
+
+	path[length] = '\0';
+	for (ssize_t i = 0; i < length; ++i)
+	{
+		if (path[i] == '/')
+		{
+			path[i] = '\\';
+		}
+	}
+	return static_cast<DWORD>(length);
+}
+
+HANDLE CreateFile(LPCSTR path, DWORD access, DWORD, void*, DWORD disposition, DWORD flags, HANDLE)
+{
+	// directories cannot be watched here
+
+	if (flags & FILE_FLAG_BACKUP_SEMANTICS)
+	{
+		return INVALID_HANDLE_VALUE;
+	}
+
+	char translated[MAX_PATH];
+	strncpy_s(translated, sizeof(translated), path, _TRUNCATE);
+	for (char* curr = translated; *curr; ++curr)
+	{
+		if (*curr == '\\')
+		{
+			*curr = '/';
+		}
+	}
+
+	const char* mode = (access & GENERIC_WRITE) ? (disposition == CREATE_ALWAYS ? "wb" : "r+b") : "rb";
+	FILE* file = fopen(translated, mode);
+	if (!file)
+	{
+		return INVALID_HANDLE_VALUE;
+	}
+
+	Object* object = create(FileObject);
+	object->file = file;
+	return object;
+}
+
+BOOL ReadFile(HANDLE file, LPVOID buffer, DWORD size, LPDWORD read, LPOVERLAPPED)
+{
+	Object* object = static_cast<Object*>(file);
+	size_t count = fread(buffer, 1, size, object->file);
+	if (read)
+	{
+		*read = static_cast<DWORD>(count);
+	}
+	return !ferror(object->file);
+}
+
+BOOL WriteFile(HANDLE file, LPCVOID buffer, DWORD size, LPDWORD written, LPOVERLAPPED)
+{
+	Object* object = static_cast<Object*>(file);
+	size_t count = fwrite(buffer, 1, size, object->file);
+	if (written)
+	{
+		*written = static_cast<DWORD>(count);
+	}
+	return count == size;
+}
+
+BOOL ReadDirectoryChangesW(HANDLE, LPVOID, DWORD, BOOL, DWORD, LPDWORD, LPOVERLAPPED, void*)
+{
+	return FALSE;
+}
+
+DWORD GetLastError()
+{
+	return static_cast<DWORD>(errno);
+}
+
+void OutputDebugString(LPCSTR message)
+{
+	fputs(message, stderr);
+}
+
+BOOL EnumWindows(WNDENUMPROC, LPARAM)
+{
+	return TRUE;
+}
+
+int GetWindowText(HWND, LPSTR text, int size)
+{
+	if (size > 0)
+	{
+		text[0] = '\0';
+	}
+	return 0;
+}
+
+UINT RealGetWindowClass(HWND, LPSTR name, UINT size)
+{
+	if (size > 0)
+	{
+		name[0] = '\0';
+	}
+	return 0;
+}
+
+DWORD GetWindowThreadProcessId(HWND, LPDWORD processId)
+{
+	if (processId)
+	{
+		*processId = 0;
+	}
+	return 0;
+}
+
+HICON LoadIcon(HINSTANCE, LPCSTR)
+{
+	return 0;
+}
+
+BOOL Shell_NotifyIcon(DWORD, NOTIFYICONDATA*)
+{
+	return TRUE;
+}
+
+int sprintf_s(char* buffer, size_t size, const char* format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	int result = formatString(buffer, size, _TRUNCATE, format, ap);
+	va_end(ap);
+	return result;
+}
+
+int _snprintf_s(char* buffer, size_t size, size_t count, const char* format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	int result = formatString(buffer, size, count, format, ap);
+	va_end(ap);
+	return result;
+}
+
+int vsnprintf_s(char* buffer, size_t size, size_t count, const char* format, va_list ap)
+{
+	return formatString(buffer, size, count, format, ap);
+}
+
+int _vsnprintf_s(char* buffer, size_t size, size_t count, const char* format, va_list ap)
+{
+	return formatString(buffer, size, count, format, ap);
+}
+
+int memcpy_s(void* destination, size_t size, const void* source, size_t count)
+{
+	if (count > size)
+	{
+		::memset(destination, 0, size);
+		return ERANGE;
+	}
+
+	::memcpy(destination, source, count);
+	return 0;
+}
+
+int strcpy_s(char* destination, size_t size, const char* source)
+{
+	return strncpy_s(destination, size, source, _TRUNCATE);
+}
+
+int strncpy_s(char* destination, size_t size, const char* source, size_t count)
+{
+	if (!size)
+	{
+		return EINVAL;
+	}
+
+	size_t length = 0;
+	while (source[length] && (length < count) && ((length + 1) < size))
+	{
+		destination[length] = source[length];
+		++length;
+	}
+	destination[length] = '\0';
+	return 0;
+}
+
+int strcat_s(char* destination, size_t size, const char* source)
+{
+	size_t length = ::strlen(destination);
+	return strncpy_s(destination + length, size - length, source, _TRUNCATE);
+}
+
+int _stricmp(const char* first, const char* second)
+{
+	return strcasecmp(first, second);
+}
+
+int _strnicmp(const char* first, const char* second, size_t count)
+{
+	return strncasecmp(first, second, count);
+}
+
+int _wcsnicmp(const wchar_t* first, const wchar_t* second, size_t count)
+{
+	return wcsncasecmp(first, second, count);
+}
+
+void* _aligned_malloc(size_t size, size_t alignment)
+{
+	void* memory = 0;
+	return posix_memalign(&memory, alignment, size) ? 0 : memory;
+}
+
+void _aligned_free(void* memory)
+{
+	free(memory);
+}
+
+namespace dsbridge
+{
+
+// a crash in a test is reported by the test runner instead of a minidump
+
+LONG WINAPI ExceptionHandler::filter(const char*, struct _EXCEPTION_POINTERS*)
+{
+	return 0;
+}
+
+}
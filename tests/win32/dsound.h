@@ -0,0 +1,98 @@
+#ifndef dsbridge_win32_dsound_h
+#define dsbridge_win32_dsound_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <windows.h>
+#include <audiodefs.h>
+
+// The parts of the DirectSound API the buffer wrapper and the cursor capture
+// use; tests implement IDirectSoundBuffer themselves to stand in for a
+// sound card.
+
+#define DSBCAPS_PRIMARYBUFFER 0x1
+#define DSBCAPS_STATIC 0x2
+
+#define DSBPLAY_LOOPING 0x1
+
+#define DSBSTATUS_PLAYING 0x1
+#define DSBSTATUS_LOOPING 0x4
+
+#define DSBLOCK_FROMWRITECURSOR 0x1
+#define DSBLOCK_ENTIREBUFFER 0x2
+
+#define DSERR_INVALIDPARAM ((HRESULT)0x80070057)
+
+typedef struct
+{
+	DWORD dwSize;
+	DWORD dwFlags;
+	DWORD dwBufferBytes;
+	DWORD dwUnlockTransferRate;
+	DWORD dwPlayCpuOverhead;
+} DSBCAPS, *LPDSBCAPS;
+
+typedef struct
+{
+	DWORD dwSize;
+	DWORD dwFlags;
+	DWORD dwBufferBytes;
+	DWORD dwReserved;
+	LPWAVEFORMATEX lpwfxFormat;
+} DSBUFFERDESC;
+
+typedef const DSBUFFERDESC* LPCDSBUFFERDESC;
+
+struct IDirectSound;
+typedef IDirectSound* LPDIRECTSOUND;
+
+DECLARE_INTERFACE_(IDirectSoundBuffer, IUnknown)
+{
+	STDMETHOD(GetCaps) (THIS_ LPDSBCAPS pDSBufferCaps) PURE;
+	STDMETHOD(GetCurrentPosition) (THIS_ LPDWORD pdwCurrentPlayCursor, LPDWORD pdwCurrentWriteCursor) PURE;
+	STDMETHOD(GetFormat) (THIS_ LPWAVEFORMATEX pwfxFormat, DWORD dwSizeAllocated, LPDWORD pdwSizeWritten) PURE;
+	STDMETHOD(GetVolume) (THIS_ LPLONG plVolume) PURE;
+	STDMETHOD(GetPan) (THIS_ LPLONG plPan) PURE;
+	STDMETHOD(GetFrequency) (THIS_ LPDWORD pdwFrequency) PURE;
+	STDMETHOD(GetStatus) (THIS_ LPDWORD pdwStatus) PURE;
+	STDMETHOD(Initialize) (THIS_ LPDIRECTSOUND pDirectSound, LPCDSBUFFERDESC pcDSBufferDesc) PURE;
+	STDMETHOD(Lock) (THIS_ DWORD dwOffset, DWORD dwBytes, LPVOID* ppvAudioPtr1, LPDWORD pdwAudioBytes1, LPVOID* ppvAudioPtr2, LPDWORD pdwAudioBytes2, DWORD dwFlags) PURE;
+	STDMETHOD(Play) (THIS_ DWORD dwReserved1, DWORD dwPriority, DWORD dwFlags) PURE;
+	STDMETHOD(SetCurrentPosition) (THIS_ DWORD dwNewPosition) PURE;
+	STDMETHOD(SetFormat) (THIS_ LPCWAVEFORMATEX pcfxFormat) PURE;
+	STDMETHOD(SetVolume) (THIS_ LONG lVolume) PURE;
+	STDMETHOD(SetPan) (THIS_ LONG lPan) PURE;
+	STDMETHOD(SetFrequency) (THIS_ DWORD dwFrequency) PURE;
+	STDMETHOD(Stop) (THIS) PURE;
+	STDMETHOD(Unlock) (THIS_ LPVOID pvAudioPtr1, DWORD dwAudioBytes1, LPVOID pvAudioPtr2, DWORD dwAudioBytes2) PURE;
+	STDMETHOD(Restore) (THIS) PURE;
+};
+
+typedef IDirectSoundBuffer* LPDIRECTSOUNDBUFFER;
+
+#endif
@@ -0,0 +1,345 @@
+#ifndef dsbridge_win32_windows_h
+#define dsbridge_win32_windows_h
+
+/*
+
+Copyright 2009 Jesper Svennevid
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+// Just enough of the Win32 API for the tests to build the DSound sources with
+// gcc on Linux. Types keep their Windows sizes where the sources depend on
+// them; the functions are implemented on top of pthreads in Win32.cpp.
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <malloc.h>
+#include <wchar.h>
+
+#define WINAPI
+#define CALLBACK
+#define __cdecl
+#define IN
+#define OPTIONAL
+#define CONST const
+
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+#define INFINITE 0xffffffff
+#define WAIT_OBJECT_0 0
+#define WAIT_TIMEOUT 258
+#define WAIT_FAILED 0xffffffff
+#define CREATE_SUSPENDED 4
+#define THREAD_PRIORITY_LOWEST -2
+#define THREAD_PRIORITY_BELOW_NORMAL -1
+#define THREAD_PRIORITY_NORMAL 0
+#define THREAD_PRIORITY_ABOVE_NORMAL 1
+#define THREAD_PRIORITY_HIGHEST 2
+#define THREAD_PRIORITY_TIME_CRITICAL 15
+
+#define GENERIC_READ 0x80000000
+#define GENERIC_WRITE 0x40000000
+#define FILE_SHARE_READ 1
+#define FILE_SHARE_WRITE 2
+#define FILE_SHARE_DELETE 4
+#define CREATE_ALWAYS 2
+#define OPEN_EXISTING 3
+#define FILE_ATTRIBUTE_NORMAL 0x80
+#define FILE_LIST_DIRECTORY 1
+#define FILE_FLAG_OVERLAPPED 0x40000000
+#define FILE_FLAG_BACKUP_SEMANTICS 0x02000000
+#define FILE_NOTIFY_CHANGE_FILE_NAME 0x1
+#define FILE_NOTIFY_CHANGE_SIZE 0x8
+#define FILE_NOTIFY_CHANGE_LAST_WRITE 0x10
+
+#define PF_XMMI_INSTRUCTIONS_AVAILABLE 6
+#define PF_XMMI64_INSTRUCTIONS_AVAILABLE 10
+
+#define MAKEINTRESOURCE(i) ((LPCSTR)(ULONG_PTR)(i))
+#define _TRUNCATE ((size_t)-1)
+
+// structured exception handling becomes a plain block; the filter is still
+// referenced so the handler keeps compiling
+
+#define __try if (1)
+#define __except(filter) else if ((filter), 0)
+#define GetExceptionInformation() ((struct _EXCEPTION_POINTERS*)0)
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned int DWORD;
+typedef int LONG;
+typedef unsigned int ULONG;
+typedef unsigned int UINT;
+typedef short SHORT;
+typedef char CHAR;
+typedef wchar_t WCHAR;
+typedef long long LONGLONG;
+typedef unsigned long long ULONGLONG;
+typedef long LONG_PTR;
+typedef unsigned long ULONG_PTR;
+typedef ULONG_PTR DWORD_PTR;
+typedef ULONG_PTR SIZE_T;
+
+typedef BYTE* PBYTE;
+typedef SHORT* PSHORT;
+typedef DWORD* PDWORD;
+typedef DWORD* LPDWORD;
+typedef LONG* LPLONG;
+typedef void* PVOID;
+typedef void* LPVOID;
+typedef const void* LPCVOID;
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+
+typedef void* HANDLE;
+typedef struct HINSTANCE__* HINSTANCE;
+typedef HINSTANCE HMODULE;
+typedef struct HWND__* HWND;
+typedef struct HICON__* HICON;
+typedef LONG_PTR LPARAM;
+
+#define INVALID_HANDLE_VALUE ((HANDLE)(LONG_PTR)-1)
+
+typedef union
+{
+	struct
+	{
+		DWORD LowPart;
+		LONG HighPart;
+	};
+	LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+typedef struct
+{
+	DWORD Data1;
+	WORD Data2;
+	WORD Data3;
+	BYTE Data4[8];
+} GUID;
+
+typedef struct
+{
+	DWORD dwNumberOfProcessors;
+} SYSTEM_INFO;
+
+typedef struct
+{
+	DWORD Internal;
+	DWORD InternalHigh;
+	DWORD Offset;
+	DWORD OffsetHigh;
+	HANDLE hEvent;
+} OVERLAPPED, *LPOVERLAPPED;
+
+typedef struct
+{
+	DWORD NextEntryOffset;
+	DWORD Action;
+	DWORD FileNameLength;
+	WCHAR FileName[1];
+} FILE_NOTIFY_INFORMATION;
+
+typedef struct
+{
+	void* mutex;
+} CRITICAL_SECTION;
+
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID parameter);
+
+// COM, as far as the DirectSound interfaces need it
+
+typedef LONG HRESULT;
+typedef GUID IID;
+typedef const IID& REFIID;
+typedef const GUID* LPCGUID;
+
+#define S_OK ((HRESULT)0)
+#define E_NOTIMPL ((HRESULT)0x80004001)
+#define E_FAIL ((HRESULT)0x80004005)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+#define FAR
+#define STDMETHODCALLTYPE
+#define PURE = 0
+#define THIS_
+#define THIS void
+#define STDMETHOD(method) virtual HRESULT STDMETHODCALLTYPE method
+#define STDMETHOD_(type, method) virtual type STDMETHODCALLTYPE method
+#define DECLARE_INTERFACE_(iface, base) struct iface : public base
+
+struct IUnknown
+{
+	STDMETHOD(QueryInterface) (THIS_ REFIID, LPVOID FAR*) PURE;
+	STDMETHOD_(ULONG,AddRef) (THIS) PURE;
+	STDMETHOD_(ULONG,Release) (THIS) PURE;
+};
+
+typedef IUnknown* LPUNKNOWN;
+
+// types that only appear in declarations the tests include, for the HTTP
+// server and the cover extractor
+
+typedef ULONG_PTR SOCKET;
+typedef DWORD COLORREF;
+typedef GUID CLSID;
+
+#define INVALID_SOCKET ((SOCKET)~0)
+
+typedef union
+{
+	struct
+	{
+		DWORD LowPart;
+		DWORD HighPart;
+	};
+	ULONGLONG QuadPart;
+} ULARGE_INTEGER;
+
+typedef struct
+{
+	LONG left;
+	LONG top;
+	LONG right;
+	LONG bottom;
+} RECT;
+
+typedef struct
+{
+	UINT cbSize;
+	int iMinAnimate;
+} ANIMATIONINFO;
+
+struct STATSTG;
+
+struct IStream : public IUnknown
+{
+};
+typedef BOOL (CALLBACK *WNDENUMPROC)(HWND hwnd, LPARAM lParam);
+
+struct _EXCEPTION_POINTERS;
+
+// synchronization
+
+void InitializeCriticalSection(CRITICAL_SECTION* cs);
+void DeleteCriticalSection(CRITICAL_SECTION* cs);
+void EnterCriticalSection(CRITICAL_SECTION* cs);
+void LeaveCriticalSection(CRITICAL_SECTION* cs);
+
+HANDLE CreateEvent(void* attributes, BOOL manualReset, BOOL initialState, LPCSTR name);
+BOOL SetEvent(HANDLE event);
+BOOL ResetEvent(HANDLE event);
+HANDLE CreateSemaphore(void* attributes, LONG initialCount, LONG maximumCount, LPCSTR name);
+BOOL ReleaseSemaphore(HANDLE semaphore, LONG releaseCount, LPLONG previousCount);
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds);
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL waitAll, DWORD milliseconds);
+BOOL CloseHandle(HANDLE handle);
+
+LONG InterlockedIncrement(volatile LONG* target);
+LONG InterlockedDecrement(volatile LONG* target);
+LONG InterlockedExchange(volatile LONG* target, LONG value);
+LONG InterlockedExchangeAdd(volatile LONG* target, LONG value);
+LONG InterlockedCompareExchange(volatile LONG* target, LONG exchange, LONG comparand);
+PVOID InterlockedExchangePointer(PVOID volatile* target, PVOID value);
+PVOID InterlockedCompareExchangePointer(PVOID volatile* target, PVOID exchange, PVOID comparand);
+
+// threads and processes
+
+HANDLE CreateThread(void* attributes, SIZE_T stackSize, LPTHREAD_START_ROUTINE start, LPVOID parameter, DWORD flags, LPDWORD threadId);
+DWORD ResumeThread(HANDLE thread);
+BOOL SetThreadPriority(HANDLE thread, int priority);
+DWORD SetThreadIdealProcessor(HANDLE thread, DWORD processor);
+DWORD GetCurrentThreadId();
+DWORD GetCurrentProcessId();
+void GetSystemInfo(SYSTEM_INFO* info);
+BOOL IsProcessorFeaturePresent(DWORD feature);
+DWORD SleepEx(DWORD milliseconds, BOOL alertable);
+void Sleep(DWORD milliseconds);
+
+// time
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER* counter);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency);
+DWORD GetTickCount();
+
+// modules and files
+
+HMODULE LoadLibrary(LPCSTR name);
+BOOL FreeLibrary(HMODULE module);
+void* GetProcAddress(HMODULE module, LPCSTR name);
+DWORD GetModuleFileName(HMODULE module, LPSTR path, DWORD size);
+
+HANDLE CreateFile(LPCSTR path, DWORD access, DWORD share, void* attributes, DWORD disposition, DWORD flags, HANDLE templateFile);
+BOOL ReadFile(HANDLE file, LPVOID buffer, DWORD size, LPDWORD read, LPOVERLAPPED overlapped);
+BOOL WriteFile(HANDLE file, LPCVOID buffer, DWORD size, LPDWORD written, LPOVERLAPPED overlapped);
+BOOL ReadDirectoryChangesW(HANDLE directory, LPVOID buffer, DWORD size, BOOL subtree, DWORD filter, LPDWORD returned, LPOVERLAPPED overlapped, void* routine);
+DWORD GetLastError();
+void OutputDebugString(LPCSTR message);
+
+// windows, which the tests never have
+
+BOOL EnumWindows(WNDENUMPROC enumerator, LPARAM lParam);
+int GetWindowText(HWND hwnd, LPSTR text, int size);
+UINT RealGetWindowClass(HWND hwnd, LPSTR name, UINT size);
+DWORD GetWindowThreadProcessId(HWND hwnd, LPDWORD processId);
+HICON LoadIcon(HINSTANCE instance, LPCSTR name);
+
+// C runtime
+
+int sprintf_s(char* buffer, size_t size, const char* format, ...);
+int _snprintf_s(char* buffer, size_t size, size_t count, const char* format, ...);
+int vsnprintf_s(char* buffer, size_t size, size_t count, const char* format, va_list ap);
+int _vsnprintf_s(char* buffer, size_t size, size_t count, const char* format, va_list ap);
+int memcpy_s(void* destination, size_t size, const void* source, size_t count);
+int strcpy_s(char* destination, size_t size, const char* source);
+int strncpy_s(char* destination, size_t size, const char* source, size_t count);
+int strcat_s(char* destination, size_t size, const char* source);
+int _stricmp(const char* first, const char* second);
+int _strnicmp(const char* first, const char* second, size_t count);
+int _wcsnicmp(const wchar_t* first, const wchar_t* second, size_t count);
+void* _aligned_malloc(size_t size, size_t alignment);
+void _aligned_free(void* memory);
+
+// tests stand in for DLLs by registering the entry points LoadLibrary should find
+
+struct ModuleExport
+{
+	const char* name;
+	void* proc;
+};
+
+void RegisterModule(const char* name, const ModuleExport* exports);
+
+// and can take processor features away to reach the scalar paths
+
+void SetProcessorFeature(DWORD feature, BOOL present);
+
+#endif